@@ -0,0 +1,435 @@
+// Open-loop load generator for POST /api/property/analyze. Requests are scheduled at a
+// fixed rate (or with exponential gaps under --poisson) whether or not earlier ones
+// have returned, and each latency is measured from its scheduled start, so a stalled
+// server shows up as queueing delay instead of silently lowering the offered load
+// (coordinated omission). Prints one JSON object.
+//
+//   bench_analyze --corpus DIR [--host H] [--port P] [--rps R] [--duration S] [--warmup S]
+//                 [--images N|MIN-MAX] [--formats jpg,png,webp] [--min-bytes N] [--max-bytes N]
+//                 [--connections N] [--timeout-ms N] [--header "Name: value"] [--poisson] [--seed N]
+//
+// Each request carries a random draw of --images files from the corpus (read into
+// memory up front; --formats and --min/max-bytes filter it). Latencies are recorded in
+// per-connection HDR histograms (3 significant digits, 1us to 1h) merged at the end.
+// "latency_ms" is from the scheduled start, "service_ms" from when a connection sent it.
+#include "utils/httplib.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int highest_bit(std::uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int bit = 0;
+    while (v >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+// Log-linear histogram in the layout of HdrHistogram: values below 2 * 10^digits are
+// exact, and every power of two above is split into the same number of sub-buckets,
+// so any recorded value is off by less than 10^-digits relative.
+class HdrHistogram {
+public:
+    HdrHistogram(std::int64_t highest, int digits) : highest_(highest) {
+        const double largest_single_unit = 2.0 * std::pow(10.0, digits);
+        const int sub_bucket_count_magnitude = static_cast<int>(std::ceil(std::log2(largest_single_unit)));
+        half_magnitude_ = std::max(0, sub_bucket_count_magnitude - 1);
+        sub_bucket_count_ = std::int64_t{1} << (half_magnitude_ + 1);
+        half_count_ = sub_bucket_count_ / 2;
+        sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+        int buckets = 1;
+        for (std::int64_t untrackable = sub_bucket_count_; untrackable <= highest; untrackable <<= 1) ++buckets;
+        counts_.assign(static_cast<std::size_t>((buckets + 1) * half_count_), 0);
+    }
+
+    void record(std::int64_t value) {
+        value = std::clamp<std::int64_t>(value, 0, highest_);
+        ++counts_[index_of(value)];
+        ++total_;
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value);
+    }
+
+    void add(const HdrHistogram& other) {
+        for (std::size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    std::int64_t count() const noexcept { return total_; }
+    std::int64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return total_ ? sum_ / static_cast<double>(total_) : 0.0; }
+
+    // Highest value equivalent to the one at `percentile` (0-100], as HdrHistogram reports it.
+    std::int64_t value_at(double percentile) const {
+        if (total_ == 0) return 0;
+        const auto wanted = std::max<std::int64_t>(
+            1, static_cast<std::int64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_))));
+        std::int64_t seen = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= wanted) return std::min(max_, highest_equivalent(value_of(i)));
+        }
+        return max_;
+    }
+
+private:
+    int bucket_of(std::int64_t value) const {
+        return highest_bit(static_cast<std::uint64_t>(value | sub_bucket_mask_)) - half_magnitude_;
+    }
+
+    std::size_t index_of(std::int64_t value) const {
+        const int bucket = bucket_of(value);
+        const std::int64_t sub = value >> bucket;
+        return static_cast<std::size_t>((static_cast<std::int64_t>(bucket + 1) << half_magnitude_) + (sub - half_count_));
+    }
+
+    std::int64_t value_of(std::size_t index) const {
+        int bucket = static_cast<int>(index >> half_magnitude_) - 1;
+        std::int64_t sub = static_cast<std::int64_t>(index & static_cast<std::size_t>(half_count_ - 1)) + half_count_;
+        if (bucket < 0) {
+            sub -= half_count_;
+            bucket = 0;
+        }
+        return sub << bucket;
+    }
+
+    std::int64_t highest_equivalent(std::int64_t value) const {
+        const int bucket = bucket_of(value);
+        const std::int64_t sub = value >> bucket;
+        const int adjusted = sub >= sub_bucket_count_ ? bucket + 1 : bucket;
+        const std::int64_t lowest = sub << bucket;
+        return lowest + (std::int64_t{1} << adjusted) - 1;
+    }
+
+    std::int64_t highest_;
+    int half_magnitude_ = 0;
+    std::int64_t sub_bucket_count_ = 0;
+    std::int64_t half_count_ = 0;
+    std::int64_t sub_bucket_mask_ = 0;
+    std::vector<std::int64_t> counts_;
+    std::int64_t total_ = 0;
+    std::int64_t max_ = 0;
+    double sum_ = 0.0;
+};
+
+constexpr std::int64_t kHighestUs = 3600LL * 1000 * 1000;
+constexpr int kDigits = 3;
+
+struct Args {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    double rps = 10.0;
+    double duration_s = 30.0;
+    double warmup_s = 0.0;
+    int images_min = 1;
+    int images_max = 1;
+    std::vector<std::string> formats{"jpg", "jpeg", "png", "webp"};
+    std::uintmax_t min_bytes = 0;
+    std::uintmax_t max_bytes = 10 * 1024 * 1024;
+    int connections = 32;
+    int timeout_ms = 60000;
+    std::string corpus;
+    httplib::Headers headers;
+    bool poisson = false;
+    unsigned seed = 1;
+};
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream in(s);
+    for (std::string item; std::getline(in, item, sep);) {
+        if (!item.empty()) out.push_back(lower(item));
+    }
+    return out;
+}
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag == "--poisson") {
+            args.poisson = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const std::string value = argv[++i];
+        if (flag == "--host") args.host = value;
+        else if (flag == "--port") args.port = std::atoi(value.c_str());
+        else if (flag == "--rps") args.rps = std::atof(value.c_str());
+        else if (flag == "--duration") args.duration_s = std::atof(value.c_str());
+        else if (flag == "--warmup") args.warmup_s = std::max(0.0, std::atof(value.c_str()));
+        else if (flag == "--images") {
+            const auto dash = value.find('-');
+            args.images_min = std::atoi(value.substr(0, dash).c_str());
+            args.images_max = dash == std::string::npos ? args.images_min : std::atoi(value.substr(dash + 1).c_str());
+        }
+        else if (flag == "--formats") args.formats = split(value, ',');
+        else if (flag == "--min-bytes") args.min_bytes = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--max-bytes") args.max_bytes = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--connections") args.connections = std::atoi(value.c_str());
+        else if (flag == "--timeout-ms") args.timeout_ms = std::atoi(value.c_str());
+        else if (flag == "--corpus") args.corpus = value;
+        else if (flag == "--seed") args.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (flag == "--header") {
+            const auto colon = value.find(':');
+            if (colon == std::string::npos) return false;
+            std::string v = value.substr(colon + 1);
+            v.erase(0, v.find_first_not_of(' '));
+            args.headers.emplace(value.substr(0, colon), v);
+        }
+        else return false;
+    }
+    return !args.corpus.empty() && args.rps > 0.0 && args.duration_s > 0.0 && args.connections > 0 &&
+           args.images_min > 0 && args.images_max >= args.images_min && args.port > 0;
+}
+
+struct CorpusFile {
+    std::string name;
+    std::string content_type;
+    std::string bytes;
+};
+
+std::vector<CorpusFile> load_corpus(const Args& args) {
+    namespace fs = std::filesystem;
+    std::vector<CorpusFile> out;
+    std::error_code ec;
+    for (const auto& entry : fs::recursive_directory_iterator(args.corpus, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = lower(entry.path().extension().string());
+        if (!ext.empty()) ext.erase(0, 1);
+        if (std::find(args.formats.begin(), args.formats.end(), ext) == args.formats.end()) continue;
+        const auto size = entry.file_size();
+        if (size < args.min_bytes || size > args.max_bytes) continue;
+
+        std::ifstream in(entry.path(), std::ios::binary);
+        CorpusFile f;
+        f.name = entry.path().filename().string();
+        f.content_type = ext == "png" ? "image/png" : ext == "webp" ? "image/webp" : "image/jpeg";
+        f.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (!f.bytes.empty()) out.push_back(std::move(f));
+    }
+    std::sort(out.begin(), out.end(), [](const CorpusFile& a, const CorpusFile& b) { return a.name < b.name; });
+    return out;
+}
+
+constexpr const char* kBoundary = "----buildcheck-bench-7f3a9c2e";
+
+std::string multipart_body(const std::vector<CorpusFile>& corpus, std::mt19937& rng, const Args& args) {
+    const int images = std::uniform_int_distribution<int>(args.images_min, args.images_max)(rng);
+    std::uniform_int_distribution<std::size_t> pick(0, corpus.size() - 1);
+    std::string body;
+    for (int i = 0; i < images; ++i) {
+        const CorpusFile& f = corpus[pick(rng)];
+        body += "--";
+        body += kBoundary;
+        body += "\r\nContent-Disposition: form-data; name=\"images\"; filename=\"";
+        body += f.name;
+        body += "\"\r\nContent-Type: ";
+        body += f.content_type;
+        body += "\r\n\r\n";
+        body += f.bytes;
+        body += "\r\n";
+    }
+    body += "--";
+    body += kBoundary;
+    body += "--\r\n";
+    return body;
+}
+
+// What one connection saw; merged once the run is over.
+struct Tally {
+    HdrHistogram latency{kHighestUs, kDigits};
+    HdrHistogram service{kHighestUs, kDigits};
+    std::map<int, std::int64_t> statuses;
+    std::map<std::string, std::int64_t> errors;   // transport failures by httplib::Error
+    std::int64_t bytes_sent = 0;
+};
+
+struct Schedule {
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<Clock::time_point> due;
+    bool done = false;
+    std::size_t max_backlog = 0;
+};
+
+void connection_loop(const Args& args, const std::vector<CorpusFile>& corpus, Schedule& schedule,
+                     Clock::time_point record_from, unsigned seed, Tally& tally) {
+    httplib::Client cli(args.host, args.port);
+    cli.set_keep_alive(true);
+    cli.set_connection_timeout(std::chrono::milliseconds(args.timeout_ms));
+    cli.set_read_timeout(std::chrono::milliseconds(args.timeout_ms));
+    cli.set_write_timeout(std::chrono::milliseconds(args.timeout_ms));
+    const std::string content_type = std::string("multipart/form-data; boundary=") + kBoundary;
+    std::mt19937 rng(seed);
+
+    for (;;) {
+        Clock::time_point due;
+        {
+            std::unique_lock<std::mutex> lock(schedule.mu);
+            schedule.cv.wait(lock, [&] { return schedule.done || !schedule.due.empty(); });
+            if (schedule.due.empty()) return;
+            due = schedule.due.front();
+            schedule.due.pop_front();
+        }
+        const std::string body = multipart_body(corpus, rng, args);
+        const auto sent = Clock::now();
+        const auto res = cli.Post("/api/property/analyze", args.headers, body, content_type);
+        const auto done = Clock::now();
+        if (due < record_from) continue;
+
+        tally.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(done - due).count());
+        tally.service.record(std::chrono::duration_cast<std::chrono::microseconds>(done - sent).count());
+        tally.bytes_sent += static_cast<std::int64_t>(body.size());
+        if (res) {
+            ++tally.statuses[res->status];
+        } else {
+            ++tally.errors[httplib::to_string(res.error())];
+        }
+    }
+}
+
+void print_histogram(std::ostream& out, const char* name, const HdrHistogram& h) {
+    const auto ms = [](std::int64_t us) { return static_cast<double>(us) / 1000.0; };
+    out << ",\"" << name << "\":{\"p50\":" << ms(h.value_at(50.0)) << ",\"p90\":" << ms(h.value_at(90.0))
+        << ",\"p99\":" << ms(h.value_at(99.0)) << ",\"p999\":" << ms(h.value_at(99.9))
+        << ",\"max\":" << ms(h.max()) << ",\"mean\":" << h.mean() / 1000.0 << "}";
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        std::cerr << "usage: bench_analyze --corpus DIR [--host H] [--port P] [--rps R] [--duration S]\n"
+                     "                     [--warmup S] [--images N|MIN-MAX] [--formats jpg,png,webp]\n"
+                     "                     [--min-bytes N] [--max-bytes N] [--connections N] [--timeout-ms N]\n"
+                     "                     [--header \"Name: value\"] [--poisson] [--seed N]\n";
+        return 2;
+    }
+    const std::vector<CorpusFile> corpus = load_corpus(args);
+    if (corpus.empty()) {
+        std::cerr << "bench_analyze: no matching images under " << args.corpus << "\n";
+        return 2;
+    }
+
+    Schedule schedule;
+    std::vector<Tally> tallies(static_cast<std::size_t>(args.connections));
+    const auto start = Clock::now() + std::chrono::milliseconds(100);
+    const auto record_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args.warmup_s));
+    const auto stop = record_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args.duration_s));
+
+    std::vector<std::thread> connections;
+    for (int i = 0; i < args.connections; ++i) {
+        connections.emplace_back(connection_loop, std::cref(args), std::cref(corpus), std::ref(schedule), record_from,
+                                 args.seed + static_cast<unsigned>(i) + 1, std::ref(tallies[static_cast<std::size_t>(i)]));
+    }
+
+    // The schedule only depends on the clock: the n-th request is due at start + n / rps
+    // (or after exponential gaps), however far behind the connections are.
+    std::mt19937 rng(args.seed);
+    std::exponential_distribution<double> gap(args.rps);
+    double offset_s = 0.0;
+    std::int64_t scheduled = 0;
+    for (;;) {
+        const auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset_s));
+        if (due >= stop) break;
+        std::this_thread::sleep_until(due);
+        {
+            std::lock_guard<std::mutex> lock(schedule.mu);
+            schedule.due.push_back(due);
+            schedule.max_backlog = std::max(schedule.max_backlog, schedule.due.size());
+        }
+        schedule.cv.notify_one();
+        if (due >= record_from) ++scheduled;
+        offset_s += args.poisson ? gap(rng) : 1.0 / args.rps;
+    }
+    {
+        std::lock_guard<std::mutex> lock(schedule.mu);
+        schedule.done = true;
+    }
+    schedule.cv.notify_all();
+    for (auto& t : connections) t.join();
+    const double elapsed_s = std::chrono::duration<double>(Clock::now() - record_from).count();
+
+    Tally total;
+    for (const auto& t : tallies) {
+        total.latency.add(t.latency);
+        total.service.add(t.service);
+        for (const auto& [status, n] : t.statuses) total.statuses[status] += n;
+        for (const auto& [error, n] : t.errors) total.errors[error] += n;
+        total.bytes_sent += t.bytes_sent;
+    }
+    std::int64_t ok = 0;
+    std::int64_t failed = 0;
+    for (const auto& [status, n] : total.statuses) (status >= 200 && status < 300 ? ok : failed) += n;
+    for (const auto& [error, n] : total.errors) failed += n;
+    const std::int64_t completed = total.latency.count();
+
+    std::cout << "{\"target_rps\":" << args.rps << ",\"duration_s\":" << args.duration_s
+              << ",\"arrivals\":\"" << (args.poisson ? "poisson" : "uniform") << "\""
+              << ",\"connections\":" << args.connections << ",\"images\":\"" << args.images_min << "-"
+              << args.images_max << "\",\"corpus_files\":" << corpus.size()
+              << ",\"scheduled\":" << scheduled << ",\"completed\":" << completed << ",\"ok\":" << ok
+              << ",\"error_rate\":" << (completed ? static_cast<double>(failed) / static_cast<double>(completed) : 0.0)
+              << ",\"throughput_rps\":" << static_cast<double>(completed) / elapsed_s
+              << ",\"ok_rps\":" << static_cast<double>(ok) / elapsed_s
+              << ",\"upload_mbps\":" << static_cast<double>(total.bytes_sent) * 8.0 / 1e6 / elapsed_s
+              << ",\"max_backlog\":" << schedule.max_backlog;
+    std::cout << ",\"status\":{";
+    bool first = true;
+    for (const auto& [status, n] : total.statuses) {
+        std::cout << (first ? "" : ",") << "\"" << status << "\":" << n;
+        first = false;
+    }
+    std::cout << "},\"transport_errors\":{";
+    first = true;
+    for (const auto& [error, n] : total.errors) {
+        std::cout << (first ? "" : ",") << "\"" << json_escape(error) << "\":" << n;
+        first = false;
+    }
+    std::cout << "}";
+    print_histogram(std::cout, "latency_ms", total.latency);
+    print_histogram(std::cout, "service_ms", total.service);
+    std::cout << "}\n";
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Times turning an /engine/analyze body into per-image verdicts: nlohmann DOM parse +
+// contains/operator[] lookups (the previous analyze_route path) against the SAX
+// parse_engine_response, and parse_engine_frame on the same results encoded as an
+// /engine/analyze/frame body, and prints one JSON line.
+//
+//   bench_engine_response [--results N] [--detections N] [--iterations N]
+//
+// --detections adds that many detection objects per image, which the API ignores
+// but still has to read past.
+#include "services/engine_response.h"
+#include "utils/engine_frame.h"
+#include "third_party/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using nlohmann::json;
+
+struct Args {
+    int results = 50;
+    int detections = 4;
+    int iterations = 5000;
+};
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (flag == "--results") args.results = std::max(0, std::atoi(value));
+        else if (flag == "--detections") args.detections = std::max(0, std::atoi(value));
+        else if (flag == "--iterations") args.iterations = std::max(1, std::atoi(value));
+        else return false;
+    }
+    return true;
+}
+
+const char* const kLabels[] = {"crack", "spalling", "efflorescence", "exposed_rebar", "mold", "leak"};
+
+std::string make_body(const Args& args) {
+    json results = json::array();
+    for (int i = 0; i < args.results; ++i) {
+        const bool ok = (i % 3) != 2;
+        json item{
+            {"path", "/tmp/buildcheck_api/req_0123456789abcdef_" + std::to_string(i) + ".jpg"},
+            {"ok", ok},
+            {"inference_mode", "model"}
+        };
+        json damage = json::array();
+        json detections = json::array();
+        for (int d = 0; ok && d < args.detections; ++d) {
+            const int cls = (i + d) % 6;
+            if (d < 2) damage.push_back(kLabels[cls]);
+            detections.push_back({{"label", kLabels[cls]}, {"class_id", cls}, {"score", 0.5 + 0.01 * d},
+                                  {"box", {12.5 * d, 40.25, 300.0 + d, 412.75}}});
+        }
+        item["damage_types"] = std::move(damage);
+        if (!detections.empty()) item["detections"] = std::move(detections);
+        if (!ok) item["error"] = "no damage detected";
+        results.push_back(std::move(item));
+    }
+    return json{{"ok", true}, {"results", std::move(results)}}.dump();
+}
+
+std::string make_frame(const Args& args) {
+    FrameAnalyzeResponse res;
+    res.ok = true;
+    res.has_results = true;
+    for (int i = 0; i < args.results; ++i) {
+        FrameImageResult item;
+        item.ok = (i % 3) != 2;
+        item.handle = "/tmp/buildcheck_api/req_0123456789abcdef_" + std::to_string(i) + ".jpg";
+        item.inference_mode = "model";
+        for (int d = 0; item.ok && d < args.detections; ++d) {
+            const int cls = (i + d) % 6;
+            if (d < 2) item.damage_types.push_back(kLabels[cls]);
+            FrameDetection det;
+            det.label = kLabels[cls];
+            det.class_id = cls;
+            det.score = 0.5f + 0.01f * d;
+            det.box[0] = 12.5f * d;
+            det.box[1] = 40.25f;
+            det.box[2] = 300.0f + d;
+            det.box[3] = 412.75f;
+            item.detections.push_back(std::move(det));
+        }
+        if (!item.ok) item.error = "no damage detected";
+        res.results.push_back(std::move(item));
+    }
+    return encode_frame_response(res);
+}
+
+// Shape of the mapping loop analyze_route used before parse_engine_response.
+std::size_t dom_path(const std::string& body) {
+    const json ej = json::parse(body, nullptr, false);
+    if (ej.is_discarded() || !ej.contains("results") || !ej["results"].is_array()) return 0;
+    std::size_t mapped = 0;
+    for (const auto& er : ej["results"]) {
+        std::string handle;
+        for (const char* key : {"path", "shm"}) {
+            if (er.contains(key) && er[key].is_string()) {
+                handle = er[key].get<std::string>();
+                break;
+            }
+        }
+        CachedAnalysis verdict;
+        verdict.ok = er.value("ok", false);
+        verdict.inference_mode = er.value("inference_mode", "");
+        if (er.contains("damage_types") && er["damage_types"].is_array()) {
+            for (const auto& dt : er["damage_types"]) {
+                if (dt.is_string()) verdict.damage_types.push_back(dt.get<std::string>());
+            }
+        }
+        if (!verdict.ok) verdict.error = er.value("error", "Engine failed to analyze image");
+        mapped += handle.empty() ? 0 : 1;
+    }
+    return mapped;
+}
+
+template <bool Frame>
+std::size_t parsed_path(const std::string& body) {
+    ParsedEngineResponse parsed;
+    const bool ok = Frame ? parse_engine_frame(body, parsed) : parse_engine_response(body, parsed);
+    if (!ok || !parsed.has_results) return 0;
+    std::size_t mapped = 0;
+    for (const auto& er : parsed.results) mapped += (er.path.empty() && er.shm.empty()) ? 0 : 1;
+    return mapped;
+}
+
+template <typename Fn>
+std::vector<double> time_path(int iterations, std::size_t expect, Fn&& fn) {
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(iterations));
+    for (int i = 0; i < iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t mapped = fn();
+        const auto end = std::chrono::steady_clock::now();
+        if (mapped != expect) std::exit(1);   // keeps the call observable
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+double pct(const std::vector<double>& samples, double p) {
+    return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        std::cerr << "usage: bench_engine_response [--results N] [--detections N] [--iterations N]\n";
+        return 2;
+    }
+    const std::string body = make_body(args);
+    const std::string frame = make_frame(args);
+    const std::size_t expect = static_cast<std::size_t>(args.results);
+
+    const auto dom = time_path(args.iterations, expect, [&body] { return dom_path(body); });
+    const auto sax = time_path(args.iterations, expect, [&body] { return parsed_path<false>(body); });
+    const auto bin = time_path(args.iterations, expect, [&frame] { return parsed_path<true>(frame); });
+
+    std::cout << "{\"results\":" << args.results << ",\"detections\":" << args.detections
+              << ",\"bytes\":" << body.size() << ",\"frame_bytes\":" << frame.size()
+              << ",\"iterations\":" << args.iterations
+              << ",\"dom\":{\"p50_us\":" << pct(dom, 0.50) << ",\"p99_us\":" << pct(dom, 0.99) << "}"
+              << ",\"sax\":{\"p50_us\":" << pct(sax, 0.50) << ",\"p99_us\":" << pct(sax, 0.99) << "}"
+              << ",\"frame\":{\"p50_us\":" << pct(bin, 0.50) << ",\"p99_us\":" << pct(bin, 0.99) << "}"
+              << "}\n";
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Times ImageHeaderParser on synthetic JPEG (behind a large EXIF segment), PNG and
+// WebP (VP8 / VP8L / VP8X) uploads fed in request-sized chunks, the way analyze_route
+// feeds it, and prints one JSON line. Every sample is first checked to decode the same
+// dimensions whole, in chunks and one byte at a time.
+//
+//   bench_image_header [--exif-bytes N] [--chunk N] [--iterations N]
+#include "utils/image_header.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Args {
+    int exif_bytes = 60000;
+    int chunk = 16384;
+    int iterations = 20000;
+};
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (flag == "--exif-bytes") args.exif_bytes = std::clamp(std::atoi(value), 0, 65533);
+        else if (flag == "--chunk") args.chunk = std::max(1, std::atoi(value));
+        else if (flag == "--iterations") args.iterations = std::max(1, std::atoi(value));
+        else return false;
+    }
+    return true;
+}
+
+struct Sample {
+    const char* name;
+    std::string bytes;
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+void put_be16(std::string& s, std::uint32_t v) {
+    s.push_back(static_cast<char>((v >> 8) & 0xFF));
+    s.push_back(static_cast<char>(v & 0xFF));
+}
+void put_be32(std::string& s, std::uint32_t v) {
+    put_be16(s, v >> 16);
+    put_be16(s, v & 0xFFFF);
+}
+void put_le(std::string& s, std::uint32_t v, int n) {
+    for (int i = 0; i < n; ++i) s.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+// Padded with filler so the body looks like a real upload to the chunked feed.
+std::string pad(std::string s) {
+    s.resize(s.size() + 256 * 1024, '\x5A');
+    return s;
+}
+
+std::vector<Sample> make_samples(const Args& args) {
+    std::vector<Sample> out;
+
+    std::string jpeg("\xFF\xD8", 2);
+    jpeg += "\xFF\xE1";                                   // APP1 (EXIF)
+    put_be16(jpeg, static_cast<std::uint32_t>(args.exif_bytes) + 2);
+    jpeg.append(static_cast<std::size_t>(args.exif_bytes), '\x00');
+    jpeg += "\xFF\xFF\xDB";                               // fill byte, then DQT
+    put_be16(jpeg, 67);
+    jpeg.append(65, '\x01');
+    jpeg += "\xFF\xC2";                                   // progressive SOF2
+    put_be16(jpeg, 17);
+    jpeg.push_back(8);
+    put_be16(jpeg, 3024);
+    put_be16(jpeg, 4032);
+    jpeg.push_back(3);
+    jpeg.append(9, '\x11');
+    out.push_back({"jpeg", pad(jpeg), 4032, 3024});
+
+    std::string png("\x89PNG\r\n\x1A\n", 8);
+    put_be32(png, 13);
+    png += "IHDR";
+    put_be32(png, 50000);
+    put_be32(png, 50000);
+    png += std::string("\x08\x06\x00\x00\x00", 5);
+    put_be32(png, 0);                                     // CRC, not checked
+    out.push_back({"png", pad(png), 50000, 50000});
+
+    std::string vp8("RIFF\0\0\0\0WEBPVP8 \0\0\0\0", 20);
+    vp8 += std::string("\x10\x02\x00\x9D\x01\x2A", 6);
+    put_le(vp8, 1920, 2);
+    put_le(vp8, 1080, 2);
+    out.push_back({"webp_vp8", pad(vp8), 1920, 1080});
+
+    std::string vp8l("RIFF\0\0\0\0WEBPVP8L\0\0\0\0", 20);
+    vp8l.push_back('\x2F');
+    put_le(vp8l, (800u - 1) | ((600u - 1) << 14) | (1u << 28), 4);
+    out.push_back({"webp_vp8l", pad(vp8l), 800, 600});
+
+    std::string vp8x("RIFF\0\0\0\0WEBPVP8X\0\0\0\0", 20);
+    vp8x += std::string("\x10\x00\x00\x00", 4);
+    put_le(vp8x, 16383 - 1, 3);
+    put_le(vp8x, 9000 - 1, 3);
+    out.push_back({"webp_vp8x", pad(vp8x), 16383, 9000});
+    return out;
+}
+
+bool parses_to(const Sample& s, std::size_t chunk) {
+    ImageHeaderParser parser;
+    for (std::size_t pos = 0; pos < s.bytes.size() && parser.state() == ImageHeaderParser::State::NeedMore;
+         pos += chunk) {
+        parser.feed(s.bytes.data() + pos, std::min(chunk, s.bytes.size() - pos));
+    }
+    return parser.state() == ImageHeaderParser::State::Done && parser.info().width == s.width &&
+           parser.info().height == s.height;
+}
+
+std::vector<double> time_sample(const Sample& s, const Args& args) {
+    const std::size_t chunk = static_cast<std::size_t>(args.chunk);
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(args.iterations));
+    for (int i = 0; i < args.iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = parses_to(s, chunk);
+        const auto end = std::chrono::steady_clock::now();
+        if (!ok) std::exit(1);   // keeps the call observable
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+double pct(const std::vector<double>& samples, double p) {
+    return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        std::cerr << "usage: bench_image_header [--exif-bytes N] [--chunk N] [--iterations N]\n";
+        return 2;
+    }
+    const std::vector<Sample> samples = make_samples(args);
+    for (const Sample& s : samples) {
+        if (!parses_to(s, s.bytes.size()) || !parses_to(s, static_cast<std::size_t>(args.chunk)) || !parses_to(s, 1)) {
+            std::cerr << "bench_image_header: " << s.name << " did not parse to " << s.width << "x" << s.height << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "{\"chunk\":" << args.chunk << ",\"exif_bytes\":" << args.exif_bytes
+              << ",\"iterations\":" << args.iterations;
+    for (const Sample& s : samples) {
+        const auto t = time_sample(s, args);
+        std::cout << ",\"" << s.name << "\":{\"p50_us\":" << pct(t, 0.50) << ",\"p99_us\":" << pct(t, 0.99) << "}";
+    }
+    std::cout << "}\n";
+    return 0;
+}
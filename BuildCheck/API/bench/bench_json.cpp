@@ -0,0 +1,200 @@
+// Times serializing an analyze response through the old ostringstream path, an
+// nlohmann DOM + dump() (what the contact routes did) and JsonWriter, on identical
+// input, and prints one JSON line.
+//
+//   bench_json [--results N] [--damage N] [--text-bytes N] [--iterations N] [--seed N]
+//
+// --text-bytes sizes the free-text field (error message) of each result; every 64th
+// byte is a quote or newline so the escape path is exercised, not just the fast run.
+#include "dto/analyze_response.h"
+#include "third_party/json.hpp"
+#include "utils/json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Args {
+    int results = 20;
+    int damage = 3;
+    int text_bytes = 256;
+    int iterations = 20000;
+    unsigned seed = 7;
+};
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (flag == "--results") args.results = std::max(0, std::atoi(value));
+        else if (flag == "--damage") args.damage = std::max(0, std::atoi(value));
+        else if (flag == "--text-bytes") args.text_bytes = std::max(0, std::atoi(value));
+        else if (flag == "--iterations") args.iterations = std::max(1, std::atoi(value));
+        else if (flag == "--seed") args.seed = static_cast<unsigned>(std::atoi(value));
+        else return false;
+    }
+    return true;
+}
+
+// The serializer AnalyzeResponse::to_json used before JsonWriter, kept as the baseline.
+std::string legacy_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 8);
+    const char* hex = "0123456789abcdef";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0x0F];
+                    out += hex[c & 0x0F];
+                } else {
+                    out += static_cast<char>(c);
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+std::string legacy_to_json(const AnalyzeResponse& res) {
+    std::ostringstream os;
+    os << R"({"ok":)" << (res.ok ? "true" : "false")
+       << R"(,"request_id":")" << legacy_escape(res.request_id) << R"(")"
+       << R"(,"results":[)";
+    for (std::size_t i = 0; i < res.results.size(); ++i) {
+        const auto& r = res.results[i];
+        if (i) os << ",";
+        os << R"({"filename":")" << legacy_escape(r.filename) << R"(")"
+           << R"(,"ok":)" << (r.ok ? "true" : "false");
+        if (r.ok) {
+            os << R"(,"damage_types":[)";
+            for (std::size_t j = 0; j < r.damage_types.size(); ++j) {
+                if (j) os << ",";
+                os << "\"" << legacy_escape(r.damage_types[j]) << "\"";
+            }
+            os << R"(],"cost_min":)" << r.cost_min << R"(,"cost_max":)" << r.cost_max;
+        } else {
+            os << R"(,"error":")" << legacy_escape(r.error) << R"(")";
+        }
+        if (!r.inference_mode.empty()) {
+            os << R"(,"inference_mode":")" << legacy_escape(r.inference_mode) << R"(")";
+        }
+        os << "}";
+    }
+    os << "]}";
+    return os.str();
+}
+
+std::string dom_to_json(const AnalyzeResponse& res) {
+    nlohmann::json results = nlohmann::json::array();
+    for (const auto& r : res.results) {
+        nlohmann::json item{{"filename", r.filename}, {"ok", r.ok}};
+        if (r.ok) {
+            item["damage_types"] = r.damage_types;
+            item["cost_min"] = r.cost_min;
+            item["cost_max"] = r.cost_max;
+        } else {
+            item["error"] = r.error;
+        }
+        if (!r.inference_mode.empty()) item["inference_mode"] = r.inference_mode;
+        results.push_back(std::move(item));
+    }
+    return nlohmann::json{{"ok", res.ok}, {"request_id", res.request_id}, {"results", std::move(results)}}.dump();
+}
+
+AnalyzeResponse make_response(const Args& args) {
+    std::mt19937 rng(args.seed);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    static const char* labels[] = {"crack", "spalling", "efflorescence", "exposed_rebar", "mold", "leak"};
+
+    AnalyzeResponse res;
+    res.ok = true;
+    res.request_id = "9f1c2a7be0d34f6a8c51e2d7b4a09c3e";
+    for (int i = 0; i < args.results; ++i) {
+        AnalyzeImageResult r;
+        r.filename = "IMG_" + std::to_string(1000 + i) + "_front wall.jpg";
+        r.inference_mode = "model";
+        r.ok = (i % 2) == 0;
+        if (r.ok) {
+            for (int d = 0; d < args.damage; ++d) r.damage_types.push_back(labels[(i + d) % 6]);
+            r.cost_min = 500 * (i + 1);
+            r.cost_max = 900 * (i + 1);
+        } else {
+            r.error.reserve(static_cast<std::size_t>(args.text_bytes));
+            for (int b = 0; b < args.text_bytes; ++b) {
+                r.error.push_back(b % 64 == 63 ? (b % 128 == 127 ? '\n' : '"') : static_cast<char>(letter(rng)));
+            }
+        }
+        res.results.push_back(std::move(r));
+    }
+    return res;
+}
+
+template <typename Fn>
+std::vector<double> time_path(int iterations, std::size_t& bytes, Fn&& fn) {
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(iterations));
+    for (int i = 0; i < iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string out = fn();
+        const auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        bytes = out.size();
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+double pct(const std::vector<double>& samples, double p) {
+    return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        std::cerr << "usage: bench_json [--results N] [--damage N] [--text-bytes N] "
+                     "[--iterations N] [--seed N]\n";
+        return 2;
+    }
+    const AnalyzeResponse res = make_response(args);
+
+    // All three must produce the same document; nlohmann sorts keys, so compare parsed.
+    const std::string writer_out = res.to_json();
+    if (nlohmann::json::parse(writer_out) != nlohmann::json::parse(legacy_to_json(res)) ||
+        nlohmann::json::parse(writer_out) != nlohmann::json::parse(dom_to_json(res))) {
+        std::cerr << "serializers disagree\n";
+        return 1;
+    }
+
+    std::size_t bytes = 0;
+    const auto legacy = time_path(args.iterations, bytes, [&res] { return legacy_to_json(res); });
+    const auto dom = time_path(args.iterations, bytes, [&res] { return dom_to_json(res); });
+    const auto writer = time_path(args.iterations, bytes, [&res] { return res.to_json(); });
+
+    std::cout << "{\"kernel\":\"" << json_escape_kernel_name() << "\""
+              << ",\"results\":" << args.results << ",\"text_bytes\":" << args.text_bytes
+              << ",\"iterations\":" << args.iterations << ",\"bytes\":" << bytes
+              << ",\"ostringstream\":{\"p50_us\":" << pct(legacy, 0.50) << ",\"p99_us\":" << pct(legacy, 0.99) << "}"
+              << ",\"nlohmann_dom\":{\"p50_us\":" << pct(dom, 0.50) << ",\"p99_us\":" << pct(dom, 0.99) << "}"
+              << ",\"json_writer\":{\"p50_us\":" << pct(writer, 0.50) << ",\"p99_us\":" << pct(writer, 0.99) << "}"
+              << "}\n";
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Differential fuzz target for parse_engine_response: every input is also parsed into
+// a nlohmann DOM and mapped field by field the way analyze_route did before the SAX
+// parser, and the two results must match exactly (validity, results, errors). The same
+// bytes also go through parse_engine_frame, which only has to reject them cleanly.
+//
+// With clang, -DBUILDCHECK_API_BUILD_FUZZERS=ON builds a libFuzzer binary:
+//   fuzz_engine_response -max_total_time=60 corpus/
+// Other compilers get a standalone driver that mutates built-in seeds:
+//   fuzz_engine_response [--iterations N] [--seed N]
+#include "services/engine_response.h"
+#include "utils/engine_frame.h"
+#include "third_party/json.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using nlohmann::json;
+
+bool dom_reference(std::string_view body, ParsedEngineResponse& out) {
+    out = ParsedEngineResponse{};
+    const json ej = json::parse(body.begin(), body.end(), nullptr, false);
+    if (ej.is_discarded()) return false;
+    if (!ej.is_object()) return true;
+
+    const auto results = ej.find("results");
+    if (results != ej.end() && results->is_array()) {
+        out.has_results = true;
+        for (const auto& er : *results) {
+            EngineResultItem item;
+            if (er.is_object()) {
+                if (er.contains("path") && er["path"].is_string()) item.path = er["path"].get<std::string>();
+                if (er.contains("shm") && er["shm"].is_string()) item.shm = er["shm"].get<std::string>();
+                item.verdict.ok = er.contains("ok") && er["ok"].is_boolean() && er["ok"].get<bool>();
+                if (er.contains("inference_mode") && er["inference_mode"].is_string()) {
+                    item.verdict.inference_mode = er["inference_mode"].get<std::string>();
+                }
+                if (er.contains("damage_types") && er["damage_types"].is_array()) {
+                    for (const auto& dt : er["damage_types"]) {
+                        if (dt.is_string()) item.verdict.damage_types.push_back(dt.get<std::string>());
+                    }
+                }
+            }
+            if (!item.verdict.ok) {
+                item.verdict.error = er.is_object() && er.contains("error") && er["error"].is_string()
+                    ? er["error"].get<std::string>()
+                    : "Engine failed to analyze image";
+            }
+            out.results.push_back(std::move(item));
+        }
+    }
+
+    const auto error = ej.find("error");
+    if (error != ej.end()) {
+        if (error->is_string()) {
+            out.has_error = true;
+            out.error = error->get<std::string>();
+        } else if (error->is_object() && error->contains("message") && (*error)["message"].is_string()) {
+            out.has_error = true;
+            out.error = (*error)["message"].get<std::string>();
+        }
+    }
+    return true;
+}
+
+bool same(const ParsedEngineResponse& a, const ParsedEngineResponse& b) {
+    if (a.has_results != b.has_results || a.has_error != b.has_error || a.error != b.error ||
+        a.results.size() != b.results.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.results.size(); ++i) {
+        const EngineResultItem& x = a.results[i];
+        const EngineResultItem& y = b.results[i];
+        if (x.path != y.path || x.shm != y.shm || x.verdict.ok != y.verdict.ok ||
+            x.verdict.inference_mode != y.verdict.inference_mode || x.verdict.error != y.verdict.error ||
+            x.verdict.damage_types != y.verdict.damage_types) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns whether the input was valid JSON.
+bool check_one(const std::uint8_t* data, std::size_t size) {
+    const std::string_view body(reinterpret_cast<const char*>(data), size);
+    ParsedEngineResponse sax;
+    ParsedEngineResponse dom;
+    const bool sax_ok = parse_engine_response(body, sax);
+    const bool dom_ok = dom_reference(body, dom);
+    if (sax_ok != dom_ok || !same(sax, dom)) {
+        std::cerr << "parse_engine_response disagrees with the DOM path on input:\n" << body << "\n";
+        std::abort();
+    }
+    ParsedEngineResponse frame;
+    (void)parse_engine_frame(body, frame);
+    return sax_ok;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    (void)check_one(data, size);
+    return 0;
+}
+
+#if !defined(BUILDCHECK_LIBFUZZER)
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv) {
+    long iterations = 200000;
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--iterations") == 0) iterations = std::atol(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--seed") == 0) seed = static_cast<unsigned>(std::atoi(argv[i + 1]));
+    }
+
+    FrameAnalyzeResponse frame_seed;
+    frame_seed.ok = frame_seed.has_results = true;
+    frame_seed.results.resize(2);
+    frame_seed.results[0].ok = true;
+    frame_seed.results[0].handle = "/tmp/buildcheck_api/a.jpg";
+    frame_seed.results[0].damage_types = {"crack", "mold"};
+    frame_seed.results[0].detections.resize(1);
+    frame_seed.results[1].source = FrameSource::Shm;
+    frame_seed.results[1].handle = "/buildcheck_x_1";
+
+    const std::vector<std::string> seeds = {
+        encode_frame_response(frame_seed),
+        R"({"ok":true,"results":[{"path":"/tmp/buildcheck_api/a.jpg","ok":true,"damage_types":["crack","mold"],"inference_mode":"model"},{"shm":"/buildcheck_x_1","ok":false,"error":"no damage detected","inference_mode":"model"}]})",
+        R"({"ok":false,"error":{"code":"BAD","message":"engine busy"}})",
+        R"({"ok":false,"error":"unauthorized","results":null})",
+        R"({"results":[1,"x",[],{"ok":1,"error":2,"damage_types":[1,"a",{"b":[]}]},{"ok":true,"ok":false,"path":"a","path":{}}],"results":[{"shm":"s"}]})",
+        R"({"error":{"message":"a","message":3},"detections":[{"box":[1.5,2,3e2,-4]}]})",
+        R"([{"results":[]}])",
+        R"("plain")",
+    };
+    // Tokens spliced in so mutations stay structurally interesting, not just invalid.
+    static const char* tokens[] = {"{", "}", "[", "]", ",", ":", "\"", "\"results\"", "\"error\"", "\"ok\"",
+                                   "\"path\"", "\"damage_types\"", "true", "false", "null", "0", "-1.5e3",
+                                   "\\u00e9", "\\\"", "\xc3\xa9", "\xff"};
+
+    for (const auto& s : seeds) check_one(reinterpret_cast<const std::uint8_t*>(s.data()), s.size());
+
+    std::mt19937 rng(seed);
+    std::string input;
+    long valid = 0;
+    for (long it = 0; it < iterations; ++it) {
+        input = seeds[rng() % seeds.size()];
+        const int mutations = 1 + static_cast<int>(rng() % 4);
+        for (int m = 0; m < mutations && !input.empty(); ++m) {
+            const std::size_t pos = rng() % (input.size() + 1);
+            switch (rng() % 4) {
+                case 0: input.insert(pos, tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))]); break;
+                case 1: if (pos < input.size()) input.erase(pos, 1 + rng() % 8); break;
+                case 2: if (pos < input.size()) input[pos] = static_cast<char>(rng() & 0xFF); break;
+                default: input.resize(pos); break;
+            }
+        }
+        if (check_one(reinterpret_cast<const std::uint8_t*>(input.data()), input.size())) ++valid;
+    }
+    std::cout << "{\"iterations\":" << iterations << ",\"seed\":" << seed << ",\"valid_json\":" << valid
+              << ",\"mismatches\":0}\n";
+    return 0;
+}
+#endif
@@ -1,7 +1,8 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <sstream>
+
+#include "utils/json.h"
 
 struct AnalyzeImageResult {
     std::string filename;
@@ -22,65 +23,29 @@ struct AnalyzeResponse {
     std::string request_id;
     std::vector<AnalyzeImageResult> results;
 
-    // Minimal JSON builder (no external JSON lib)
-    static std::string escape_json(const std::string& s) {
-        std::string out;
-        out.reserve(s.size() + 8);
-        const char* hex = "0123456789abcdef";
-        for (unsigned char c : s) {
-            switch (c) {
-                case '\\': out += "\\\\"; break;
-                case '"':  out += "\\\""; break;
-                case '\n': out += "\\n"; break;
-                case '\r': out += "\\r"; break;
-                case '\t': out += "\\t"; break;
-                case '\b': out += "\\b"; break;
-                case '\f': out += "\\f"; break;
-                default:
-                    if (c < 0x20) {
-                        out += "\\u00";
-                        out += hex[(c >> 4) & 0x0F];
-                        out += hex[c & 0x0F];
-                    } else {
-                        out += static_cast<char>(c);
-                    }
-                    break;
-            }
-        }
-        return out;
-    }
-
     std::string to_json() const {
-        std::ostringstream os;
-        os << R"({"ok":)" << (ok ? "true" : "false")
-           << R"(,"request_id":")" << escape_json(request_id) << R"(")"
-           << R"(,"results":[)";
-
-        for (size_t i = 0; i < results.size(); ++i) {
-            const auto& r = results[i];
-            if (i) os << ",";
-            os << R"({"filename":")" << escape_json(r.filename) << R"(")"
-               << R"(,"ok":)" << (r.ok ? "true" : "false");
-
+        JsonWriter w;
+        w.begin_object()
+         .kv("ok", ok)
+         .kv("request_id", request_id)
+         .key("results").begin_array();
+        for (const auto& r : results) {
+            w.begin_object()
+             .kv("filename", r.filename)
+             .kv("ok", r.ok);
             if (r.ok) {
-                os << R"(,"damage_types":[)";
-                for (size_t j = 0; j < r.damage_types.size(); ++j) {
-                    if (j) os << ",";
-                    os << "\"" << escape_json(r.damage_types[j]) << "\"";
-                }
-                os << R"(],"cost_min":)" << r.cost_min
-                   << R"(,"cost_max":)" << r.cost_max;
+                w.key("damage_types").begin_array();
+                for (const auto& d : r.damage_types) w.value(d);
+                w.end_array()
+                 .kv("cost_min", r.cost_min)
+                 .kv("cost_max", r.cost_max);
             } else {
-                os << R"(,"error":")" << escape_json(r.error) << R"(")";
-            }
-            if (!r.inference_mode.empty()) {
-                os << R"(,"inference_mode":")" << escape_json(r.inference_mode) << R"(")";
+                w.kv("error", r.error);
             }
-
-            os << "}";
+            if (!r.inference_mode.empty()) w.kv("inference_mode", r.inference_mode);
+            w.end_object();
         }
-
-        os << "]}";
-        return os.str();
+        w.end_array().end_object();
+        return w.str();
     }
 };
@@ -1,5 +1,15 @@
 #pragma once
 #include "utils/httplib.h"
 #include "services/engine_client.h"
+#include "services/job_queue.h"
+#include "services/rate_limiter.h"
+#include "services/result_cache.h"
+#include "services/spool_pool.h"
 
-void register_analyze_route(httplib::Server& server, const EngineClient& engine);
+void register_analyze_route(httplib::Server& server, const EngineClient& engine, ResultCache& cache,
+                            JobQueue& jobs, SpoolPool& spool);
+
+// Edge rate limit for POST /api/property/analyze, keyed like the engine's X-RateLimit-Key.
+// Runs before the body is read (see configure_http_server); fills in a 429 RATE_LIMITED
+// with Retry-After and returns false when `limiter` refuses the client.
+bool admit_analyze_request(RateLimiter& limiter, const httplib::Request& req, httplib::Response& res);
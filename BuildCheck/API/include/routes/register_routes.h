@@ -1,5 +1,12 @@
 #pragma once
 #include "utils/httplib.h"
 #include "services/engine_client.h"
+#include "services/job_queue.h"
+#include "services/result_cache.h"
+#include "services/spool_pool.h"
 
-void register_routes(httplib::Server& server, const EngineClient& engine);
+void register_routes(httplib::Server& server, const EngineClient& engine, ResultCache& cache, JobQueue& jobs,
+                     SpoolPool& spool);
+
+// GET /metrics, registered on the internal metrics listener only.
+void register_metrics_route(httplib::Server& server, ResultCache& cache, JobQueue& jobs);
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+struct ConcurrencyLimitOptions {
+    std::size_t initial_limit = 8;   // ENGINE_LIMIT_INITIAL, 0 disables the limiter
+    std::size_t min_limit = 2;       // ENGINE_LIMIT_MIN
+    std::size_t max_limit = 64;      // ENGINE_LIMIT_MAX
+    double tolerance = 2.0;          // ENGINE_LIMIT_TOLERANCE_PCT / 100: latency growth accepted before shrinking
+    double smoothing = 0.2;          // weight of each new estimate in the limit
+    double backoff = 0.9;            // multiplicative decrease on a dropped call
+    std::size_t long_window = 600;   // samples in the baseline latency average
+};
+
+// Gradient-style adaptive cap on outstanding engine calls (after Netflix's Gradient2).
+// Every completed call reports its latency per image; the limit follows
+//     limit = limit * clamp(tolerance * baseline / latency, 0.5, 1) + sqrt(limit)
+// where `baseline` is a slow moving average of the per-image latency. While the engine
+// keeps up the gradient is 1 and the sqrt term grows the limit; once calls queue inside
+// the engine their latency rises above the baseline and the limit shrinks towards what
+// it can actually run. A timed-out, unreachable or 5xx call cuts the limit by
+// `backoff`. Calls over the limit are refused immediately instead of queueing behind
+// the slow ones until the read timeout.
+class ConcurrencyLimiter {
+    enum class Outcome { Success, Dropped, Ignored };
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Held for the duration of one call. Report the outcome with success() or dropped();
+    // a permit released without either (the engine answered 4xx) leaves the limit alone.
+    class Permit {
+    public:
+        Permit() = default;
+        Permit(ConcurrencyLimiter* limiter, Clock::time_point start) : limiter_(limiter), start_(start) {}
+        ~Permit() { release(Outcome::Ignored); }
+        Permit(Permit&& other) noexcept : limiter_(other.limiter_), start_(other.start_) { other.limiter_ = nullptr; }
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+        Permit& operator=(Permit&&) = delete;
+
+        explicit operator bool() const noexcept { return limiter_ != nullptr; }
+        // `units` is the number of images in the call; latency is compared per image so
+        // batch size does not read as engine slowness.
+        void success(std::size_t units = 1) { release(Outcome::Success, units); }
+        void dropped() { release(Outcome::Dropped); }
+
+    private:
+        void release(Outcome outcome, std::size_t units = 1);
+
+        ConcurrencyLimiter* limiter_ = nullptr;
+        Clock::time_point start_{};
+    };
+
+    explicit ConcurrencyLimiter(ConcurrencyLimitOptions options);
+
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    // An empty permit when `limit()` calls are already outstanding. Always succeeds
+    // when the limiter is disabled.
+    Permit try_acquire();
+
+    bool enabled() const noexcept { return enabled_; }
+    std::size_t limit() const;
+    std::size_t in_flight() const;
+
+private:
+    void on_release(Outcome outcome, std::size_t units, Clock::duration elapsed);
+
+    ConcurrencyLimitOptions options_;
+    bool enabled_;
+    mutable std::mutex mu_;
+    double limit_;
+    std::size_t in_flight_ = 0;
+    double baseline_ = 0.0;          // per-image seconds, long-term average
+    std::size_t samples_ = 0;
+};
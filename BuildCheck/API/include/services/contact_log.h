@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+
+struct ContactEntry {
+    std::string name;
+    std::string phone;
+    std::string message;
+    std::string registered_at;
+};
+
+struct ContactLogLoadStats {
+    std::size_t records = 0;        // valid records read from disk
+    std::size_t dropped = 0;        // lines that failed checksum or JSON parse
+    bool torn_tail = false;         // last line had no newline (crash mid-append)
+    bool migrated_legacy = false;   // file was the old whole-array JSON format
+};
+
+// Append-only store for contact submissions at BUILDCHECK_CONTACT_DB_PATH.
+// One record per line: "<16 hex xxh64 of the JSON>\t<JSON object>\n". An insert is a
+// single small append + flush; the file is rewritten (tmp + rename) only when it holds
+// `compact_after` records, or on load after recovering from a torn or corrupt line.
+// Not thread-safe: callers serialize access (register_routes holds g_contact_mutex).
+class ContactLog {
+public:
+    ContactLog(std::string path, std::size_t max_entries, std::size_t compact_after);
+
+    // Reads the log (or a legacy JSON array file) into `out`, keeping the newest
+    // `max_entries`. Torn tails and corrupt lines are dropped and the file is compacted
+    // so later appends start on a clean line.
+    ContactLogLoadStats load(std::deque<ContactEntry>& out);
+
+    bool append(const ContactEntry& entry);
+
+    // True once the file has grown to `compact_after` records, or when a failed append
+    // may have left a partial line that the next write must not follow.
+    bool needs_compaction() const noexcept { return needs_rewrite_ || on_disk_ >= compact_after_; }
+
+    // Rewrites the file to exactly `live` (tmp + fsync + rename) and reopens it for
+    // appends. On failure the previous file is left as it was.
+    bool compact(const std::deque<ContactEntry>& live);
+
+    const std::string& path() const noexcept { return path_; }
+
+private:
+    bool open_for_append();
+
+    std::string path_;
+    std::size_t max_entries_;
+    std::size_t compact_after_;
+    std::size_t on_disk_ = 0;      // records in the file, live or superseded
+    bool needs_rewrite_ = false;   // an append failed part-way; tail may be torn
+    std::ofstream out_;
+};
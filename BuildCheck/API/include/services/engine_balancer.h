@@ -0,0 +1,110 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "services/engine_connection_pool.h"
+
+struct EngineEndpoint {
+    std::string host;
+    int port = 9090;
+};
+
+// "host:port,host:port" (ENGINE_ENDPOINTS). Entries without a port use `default_port`;
+// malformed entries are skipped.
+std::vector<EngineEndpoint> parse_engine_endpoints(const std::string& list, int default_port);
+
+struct EngineBalancerOptions {
+    int health_interval_ms = 2000;        // ENGINE_HEALTH_INTERVAL_MS, active checks
+    int health_timeout_ms = 1000;         // ENGINE_HEALTH_TIMEOUT_MS
+    std::size_t eject_after_failures = 5; // ENGINE_EJECT_AFTER_FAILURES, consecutive failed calls, or failed checks
+    int eject_ms = 10000;                 // ENGINE_EJECT_MS, first ejection; doubles on each repeat, up to 10x
+    int slow_start_ms = 30000;            // ENGINE_SLOW_START_MS, ramp after an endpoint comes back; 0 disables
+};
+
+// Spreads engine calls over several endpoints, each with its own connection pool.
+// Every call goes to the less loaded of two endpoints drawn at random (power of two
+// choices), where load is outstanding calls divided by the endpoint's weight. An
+// endpoint that fails `eject_after_failures` calls in a row, or as many health checks
+// in a row, is ejected (circuit open) for `eject_ms`; calls and checks are counted
+// apart so a passing check does not hide failing calls. Once `eject_ms` has passed and
+// a GET /engine/health answers 200 it takes traffic again, its weight ramping from 10%
+// to full over `slow_start_ms` so a cold engine is not handed its whole share at once.
+// When every endpoint is ejected, calls are spread over all of them rather than refused.
+//
+// The same checks record what each endpoint reports about itself (model version, conf
+// threshold, protocols), which EngineClient uses for result caching and protocol
+// negotiation. A single endpoint is checked too, for those answers, but never ejected.
+class EngineBalancer {
+    struct Endpoint;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // One call's hold on an endpoint: counts as outstanding until destroyed. Report
+    // failed() for transport errors and 5xx answers, succeeded() for any other answer.
+    class Pick {
+    public:
+        Pick(EngineBalancer* balancer, Endpoint* endpoint) : balancer_(balancer), endpoint_(endpoint) {}
+        ~Pick();
+        Pick(Pick&& other) noexcept : balancer_(other.balancer_), endpoint_(other.endpoint_) { other.endpoint_ = nullptr; }
+        Pick(const Pick&) = delete;
+        Pick& operator=(const Pick&) = delete;
+        Pick& operator=(Pick&&) = delete;
+
+        EngineConnectionPool& pool();
+        const std::string& name() const;
+        void succeeded();
+        void failed();
+
+    private:
+        friend class EngineBalancer;
+        EngineBalancer* balancer_;
+        Endpoint* endpoint_;
+    };
+
+    EngineBalancer(const std::vector<EngineEndpoint>& endpoints, const EnginePoolOptions& pool_options,
+                   EngineBalancerOptions options);
+    ~EngineBalancer();
+
+    EngineBalancer(const EngineBalancer&) = delete;
+    EngineBalancer& operator=(const EngineBalancer&) = delete;
+
+    // `avoid` (an earlier pick of the same call) is skipped when another endpoint is available.
+    Pick pick(const Pick* avoid = nullptr);
+
+    std::size_t size() const noexcept { return endpoints_.size(); }
+
+    // "<model_version>|conf=<threshold>" shared by every endpoint in service that has
+    // answered a health check. Empty while none has, or while two of them disagree;
+    // ejected endpoints and ones that never answered do not count.
+    std::string model_fingerprint() const;
+    // Same endpoints: true when each lists `protocol` under "protocols".
+    bool all_list_protocol(const std::string& protocol) const;
+    // Completed rounds of health checks.
+    std::uint64_t health_rounds() const;
+    // Waits up to `timeout` for the first round; false if it is not done.
+    bool await_health(std::chrono::milliseconds timeout) const;
+
+private:
+    enum class Signal { call, check };
+
+    void record(Endpoint& endpoint, bool ok, Signal signal);
+    double weight_locked(const Endpoint& endpoint, Clock::time_point now) const;
+    Clock::duration ejection_for(const Endpoint& endpoint) const;
+    void health_loop();
+
+    EngineBalancerOptions options_;
+    std::vector<std::unique_ptr<Endpoint>> endpoints_;
+    mutable std::mutex mu_;
+    mutable std::condition_variable cv_;
+    std::uint64_t health_rounds_ = 0;
+    bool stopping_ = false;
+    std::thread checker_;
+};
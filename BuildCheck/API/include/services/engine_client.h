@@ -1,8 +1,19 @@
 #pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <stdexcept>
 
+#include "services/concurrency_limiter.h"
+#include "services/engine_balancer.h"
+#include "services/engine_connection_pool.h"
+#include "services/engine_response.h"
+
 class EngineClientError : public std::runtime_error {
 public:
     EngineClientError(std::string message, int status_code = 500, std::string response_body = "")
@@ -18,19 +29,100 @@ private:
     std::string response_body_;
 };
 
+// Image handed to the engine through a shared-memory segment (see ShmSegment).
+struct EngineShmImage {
+    std::string name;
+    std::size_t size = 0;
+};
+
+// Remaining time budget of a request, in milliseconds: sent by clients to the API and
+// by the API to the engine, which stops starting new images once it is spent.
+constexpr const char* kRequestTimeoutHeader = "X-Request-Timeout-Ms";
+
+// Deadline for one analyze call. The engine is given `budget` (kRequestTimeoutHeader) and
+// answers images it could not start as "deadline exceeded"; the call itself waits up to
+// `budget + grace`, so the batch in flight can finish and the partial answer arrive.
+struct EngineBudget {
+    std::chrono::milliseconds budget{0};   // 0: no deadline, the pool's read timeout applies
+    std::chrono::milliseconds grace{0};
+};
+
+// Body format for analyze calls (BUILDCHECK_ENGINE_PROTOCOL). Auto uses the binary
+// frame (utils/engine_frame.h) when /engine/health on every endpoint in service lists
+// it and JSON otherwise, as last seen by the balancer's health checks.
+enum class EngineProtocol { Auto, Json, Frame };
+
+// "auto" | "json" | "frame"; anything else is Auto.
+EngineProtocol parse_engine_protocol(const std::string& value);
+const char* engine_protocol_name(EngineProtocol protocol);
+
 class EngineClient {
 public:
-    EngineClient(std::string host = "127.0.0.1", int port = 9090, std::string api_key = "")
-        : host_(std::move(host)), port_(port), api_key_(std::move(api_key)) {}
+    EngineClient(std::string host = "127.0.0.1", int port = 9090, std::string api_key = "",
+                 EnginePoolOptions pool_options = {}, EngineProtocol protocol = EngineProtocol::Auto,
+                 ConcurrencyLimitOptions limit_options = {})
+        : EngineClient(std::vector<EngineEndpoint>{{std::move(host), port}}, std::move(api_key), pool_options,
+                       protocol, limit_options) {}
+
+    // Balances calls over `endpoints` (see EngineBalancer), one connection pool each.
+    EngineClient(const std::vector<EngineEndpoint>& endpoints, std::string api_key,
+                 EnginePoolOptions pool_options, EngineProtocol protocol,
+                 ConcurrencyLimitOptions limit_options, EngineBalancerOptions balancer_options = {});
+
+    // Sends the request in the negotiated format and parses the 200 answer into `out`.
+    // Returns false when the engine answered 200 with a body that does not parse;
+    // transport and status errors throw EngineClientError as the *_json calls do, and
+    // a call over the adaptive concurrency limit throws ("ENGINE_OVERLOADED", 503)
+    // without reaching the engine; one that outlives `budget` throws
+    // ("ENGINE_DEADLINE_EXCEEDED", 504). In Auto mode a 404/415 from the frame endpoint
+    // (an engine that dropped it) switches back to JSON until the next health refresh
+    // and the call is retried as JSON.
+    bool analyze(const std::string& request_id,
+                 const std::vector<std::string>& image_paths,
+                 const std::vector<EngineShmImage>& images,
+                 const std::string& rate_limit_key,
+                 ParsedEngineResponse& out,
+                 const EngineBudget& budget = {}) const;
 
     // מחזיר JSON של ה-Engine
     std::string analyze_paths_json(const std::string& request_id,
                                    const std::vector<std::string>& image_paths,
                                    const std::string& rate_limit_key = "") const;
 
+    // Same contract as analyze_paths_json, but images are passed as shm handles.
+    std::string analyze_shm_json(const std::string& request_id,
+                                 const std::vector<EngineShmImage>& images,
+                                 const std::string& rate_limit_key = "") const;
+
+    // Both transports in one request (some uploads fell back from shm to temp files).
+    std::string analyze_json(const std::string& request_id,
+                             const std::vector<std::string>& image_paths,
+                             const std::vector<EngineShmImage>& images,
+                             const std::string& rate_limit_key = "",
+                             const EngineBudget& budget = {}) const;
+
+    // "<model_version>|conf=<threshold>" as reported by /engine/health, read from the
+    // balancer's health checks (EngineBalancer::model_fingerprint). Empty, so result
+    // caching is skipped, until an endpoint in service has answered with a model
+    // version, and while two endpoints in service disagree.
+    std::string model_fingerprint() const;
+
+    // Format analyze() uses right now; Auto picks frames once every endpoint in service lists them.
+    EngineProtocol negotiated_protocol() const;
+
+    // Waits up to `timeout` for the first round of health checks; false if it is not done.
+    bool await_health(std::chrono::milliseconds timeout) const;
+
 private:
-    std::string host_;
-    int port_;
+    std::string post_analyze(const char* path, const std::string& body, const char* content_type,
+                             const std::string& rate_limit_key, std::size_t images,
+                             const EngineBudget& budget) const;
+
     std::string api_key_;
+    EngineProtocol protocol_;
+    std::shared_ptr<EngineBalancer> balancer_;
+    std::shared_ptr<ConcurrencyLimiter> limiter_;
+    // Health round during which the frame endpoint answered 404/415; JSON until the next.
+    std::shared_ptr<std::atomic<std::uint64_t>> frame_refused_round_;
 };
 
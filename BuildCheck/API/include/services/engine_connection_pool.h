@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace httplib { class Client; }
+
+struct EnginePoolOptions {
+    std::size_t max_size = 8;          // open connections (leased + idle)
+    int idle_timeout_ms = 4000;        // evict idle connections (uvicorn drops keep-alive after 5s)
+    int probe_after_ms = 2000;         // GET /engine/health before reusing a connection idle this long; 0 disables
+    int acquire_timeout_ms = 5000;     // wait for a free connection before failing with 503
+    int connect_timeout_ms = 5000;
+    int write_timeout_ms = 20000;
+    int read_timeout_ms = 60000;
+};
+
+// Thread-safe pool of keep-alive httplib clients bound to one engine endpoint.
+// httplib::Client is not safe for concurrent use, so each call leases one.
+class EngineConnectionPool {
+public:
+    class Lease {
+    public:
+        Lease(EngineConnectionPool* pool, std::unique_ptr<httplib::Client> client, bool reused);
+        ~Lease();
+        Lease(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        httplib::Client& client() { return *client_; }
+        bool reused() const noexcept { return reused_; }
+        // Drop the connection instead of returning it (broken socket, protocol error).
+        void discard() noexcept { reusable_ = false; }
+        // Replace the leased connection with a freshly opened one on the same slot.
+        void reconnect();
+
+    private:
+        EngineConnectionPool* pool_;
+        std::unique_ptr<httplib::Client> client_;
+        bool reused_;
+        bool reusable_ = true;
+    };
+
+    EngineConnectionPool(std::string host, int port, EnginePoolOptions options);
+    ~EngineConnectionPool();
+
+    EngineConnectionPool(const EngineConnectionPool&) = delete;
+    EngineConnectionPool& operator=(const EngineConnectionPool&) = delete;
+
+    // Throws EngineClientError("ENGINE_POOL_EXHAUSTED", 503) when no connection frees up in time.
+    Lease acquire();
+
+    const EnginePoolOptions& options() const noexcept { return options_; }
+    std::size_t idle_count() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct IdleConnection {
+        std::unique_ptr<httplib::Client> client;
+        Clock::time_point last_used;
+    };
+
+    std::unique_ptr<httplib::Client> make_client() const;
+    bool probe(httplib::Client& client) const;
+    void release(std::unique_ptr<httplib::Client> client, bool reusable);
+
+    std::string host_;
+    int port_;
+    EnginePoolOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<IdleConnection> idle_;   // oldest at front, most recently used at back
+    std::size_t open_ = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "services/result_cache.h"
+
+// Per-image error of inputs the engine did not start before the request's deadline
+// (kRequestTimeoutHeader); never cached.
+constexpr const char* kEngineDeadlineError = "deadline exceeded";
+
+// One entry of the engine's "results" array. `path` / `shm` echo the handle the API
+// sent, used to map the verdict back onto its upload.
+struct EngineResultItem {
+    std::string path;
+    std::string shm;
+    CachedAnalysis verdict;
+};
+
+struct ParsedEngineResponse {
+    bool has_results = false;            // top-level "results" was an array
+    std::vector<EngineResultItem> results;
+    bool has_error = false;              // top-level "error" string or error.message
+    std::string error;
+};
+
+// Parses an /engine/analyze (or engine error) body in one SAX pass straight into
+// `out`, without building a DOM. Fields of an unexpected type fall back to their
+// defaults the same way missing ones do: ok=false, error="Engine failed to analyze
+// image" when not ok, non-string damage types skipped; unknown keys are skipped
+// whatever they contain. When a key repeats, the last occurrence wins, as with a
+// nlohmann DOM. Returns false only when `body` is not valid JSON.
+bool parse_engine_response(std::string_view body, ParsedEngineResponse& out);
+
+// Same mapping for a 200 answer from /engine/analyze/frame (see utils/engine_frame.h):
+// an empty per-image error on a failed image becomes the default message. Returns
+// false when `frame` does not decode.
+bool parse_engine_frame(std::string_view frame, ParsedEngineResponse& out);
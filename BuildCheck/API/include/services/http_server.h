@@ -0,0 +1,57 @@
+#pragma once
+#include "utils/httplib.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct HttpServerOptions {
+    std::size_t workers = 0;                // BUILDCHECK_HTTP_WORKERS, 0 = httplib default (max(8, cores - 1)); split across acceptors
+    std::size_t max_queue = 256;            // BUILDCHECK_HTTP_QUEUE, accepted connections waiting for a worker, per acceptor
+    std::size_t acceptors = 1;              // BUILDCHECK_HTTP_ACCEPTORS, listening sockets bound to the port with SO_REUSEPORT
+    std::size_t keep_alive_max = 100;       // BUILDCHECK_HTTP_KEEPALIVE_MAX, requests per connection
+    int keep_alive_timeout_sec = 5;         // BUILDCHECK_HTTP_KEEPALIVE_TIMEOUT_SEC
+    bool tcp_nodelay = true;                // BUILDCHECK_HTTP_TCP_NODELAY
+    bool reuse_port = false;                // BUILDCHECK_HTTP_REUSEPORT, implied by acceptors > 1
+};
+
+// httplib task queue with a bounded backlog. httplib's own ThreadPool closes the
+// socket when its queue is full, which clients see as a reset; here the overflow
+// connection goes to a single shedder thread instead, whose requests are answered
+// 503 with Retry-After by the pre-routing handler configure_http_server() installs,
+// before any body is read. Only when the shedder is backed up too is the
+// connection closed outright.
+class SheddingTaskQueue final : public httplib::TaskQueue {
+public:
+    SheddingTaskQueue(std::size_t workers, std::size_t max_queue);
+    ~SheddingTaskQueue() override;
+
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+private:
+    void shed_loop();
+
+    httplib::ThreadPool pool_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> shed_;
+    bool stopping_ = false;
+    std::thread shedder_;
+};
+
+// True while the calling thread serves a connection SheddingTaskQueue is shedding.
+bool is_shedding_connection() noexcept;
+
+// Decides from the request line and headers alone whether a request may proceed; on
+// false it has filled in `res`, which is sent without reading the body.
+using AdmissionCheck = std::function<bool(const httplib::Request& req, httplib::Response& res)>;
+
+// Applies `options` (task queue, keep-alive, TCP_NODELAY, SO_REUSEADDR/SO_REUSEPORT)
+// and installs the pre-routing handler: 503 for shed connections, then `admit`. With
+// `Expect: 100-continue`, `admit` runs before the 100 is sent so a refused client never
+// uploads the body at all.
+void configure_http_server(httplib::Server& server, const HttpServerOptions& options, AdmissionCheck admit = {});
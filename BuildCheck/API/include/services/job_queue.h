@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Final HTTP answer of a job, replayed verbatim by the polling endpoint.
+struct JobResult {
+    int status = 500;
+    std::string body;
+};
+
+enum class JobState { Queued, Running, Done };
+
+struct JobSnapshot {
+    JobState state = JobState::Queued;
+    JobResult result;                       // set once state == Done
+};
+
+struct JobQueueOptions {
+    std::size_t workers = 4;                // BUILDCHECK_JOB_WORKERS
+    std::size_t max_queue = 64;             // BUILDCHECK_JOB_QUEUE, jobs waiting for a worker
+    std::chrono::seconds ttl{600};          // BUILDCHECK_JOB_TTL_SEC, how long results stay pollable
+    std::size_t max_retained = 4096;        // finished jobs kept before the oldest are dropped
+};
+
+struct JobQueueStats {
+    std::size_t queued = 0;
+    std::size_t running = 0;
+    std::size_t retained = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t rejected = 0;
+};
+
+// Bounded executor for async analyze requests. A fixed set of workers drains a FIFO of
+// at most max_queue jobs; submit() refuses work beyond that instead of letting a burst
+// pile up unbounded. Finished results are kept for `ttl` so clients can poll for them.
+class JobQueue {
+public:
+    using Task = std::function<JobResult()>;
+
+    explicit JobQueue(JobQueueOptions options);
+    ~JobQueue();
+
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    // false when the queue is full or `id` is already known. `owner` identifies the
+    // submitting client; only lookups from the same owner see the job.
+    bool submit(const std::string& id, const std::string& owner, Task task);
+
+    // false for unknown or expired ids, and for jobs submitted by another owner.
+    bool lookup(const std::string& id, const std::string& owner, JobSnapshot& out);
+
+    JobQueueStats stats() const;
+    std::size_t max_queue() const noexcept { return options_.max_queue; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        JobState state = JobState::Queued;
+        JobResult result;
+        Task task;
+        std::string owner;
+        Clock::time_point finished_at{};
+    };
+
+    void worker_loop();
+    void prune_locked(Clock::time_point now);
+
+    JobQueueOptions options_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::string> pending_;
+    std::deque<std::string> finished_;      // completion order, for expiry
+    std::unordered_map<std::string, Job> jobs_;
+    std::size_t running_ = 0;
+    std::uint64_t completed_ = 0;
+    std::uint64_t rejected_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct RateLimitOptions {
+    std::size_t per_minute = 60;    // BUILDCHECK_RATE_LIMIT_RPM, sustained requests per key; 0 disables
+    std::size_t burst = 60;         // BUILDCHECK_RATE_LIMIT_BURST, requests a fresh key may send at once
+    std::size_t max_keys = 100000;  // BUILDCHECK_RATE_LIMIT_MAX_KEYS, tracked keys before new ones are refused
+};
+
+// Per-key rate limit using GCRA (generic cell rate algorithm): each key keeps one
+// timestamp, its theoretical arrival time (TAT). A request at `now` is admitted when
+// TAT - now <= (burst - 1) * interval, and pushes TAT to max(TAT, now) + interval, so
+// a key can send `burst` requests at once and then one every 60s / per_minute. Keys
+// are spread over lock-striped shards. A key whose TAT has passed is in the same state
+// as one never seen, so expired keys are only swept from a shard when it has grown to
+// twice its size after the previous sweep; there is no timer thread. A shard that is
+// full of keys still inside their window refuses new keys until the earliest window
+// ends, so flooding it with fresh keys cannot buy unlimited requests.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Decision {
+        bool allowed = true;
+        std::chrono::milliseconds retry_after{0};   // until the next request would be admitted
+    };
+
+    explicit RateLimiter(RateLimitOptions options);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    Decision admit(std::string_view key, Clock::time_point now = Clock::now());
+
+    bool enabled() const noexcept { return interval_ns_ > 0; }
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t kShards = 64;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, std::int64_t> tat;   // steady-clock nanoseconds
+        std::size_t sweep_at = 0;
+        std::int64_t frees_at = 0;   // no tracked key expires before this; a full shard sweeps again then
+    };
+
+    Shard& shard_for(std::string_view key);
+
+    std::int64_t interval_ns_ = 0;
+    std::int64_t tolerance_ns_ = 0;
+    std::size_t max_keys_per_shard_;
+    std::array<Shard, kShards> shards_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Engine verdict for one image, as much as the API needs to answer without the engine.
+struct CachedAnalysis {
+    bool ok = false;
+    std::vector<std::string> damage_types;
+    std::string inference_mode;
+    std::string error;
+};
+
+struct ResultCacheOptions {
+    std::size_t max_entries = 4096;               // BUILDCHECK_RESULT_CACHE_ENTRIES, 0 disables
+    std::chrono::seconds ttl{3600};               // BUILDCHECK_RESULT_CACHE_TTL_SEC
+    std::string disk_dir;                         // BUILDCHECK_RESULT_CACHE_DIR, empty = memory only
+    std::size_t max_disk_entries = 100000;        // BUILDCHECK_RESULT_CACHE_DISK_ENTRIES
+};
+
+struct ResultCacheStats {
+    std::uint64_t memory_hits = 0;
+    std::uint64_t disk_hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t stores = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t expirations = 0;
+    std::size_t entries = 0;
+};
+
+// Engine results keyed by upload content hash + model fingerprint (model version and
+// confidence threshold reported by /engine/health). In-process LRU with TTL, plus an
+// optional directory of one JSON file per key that survives restarts and is shared by
+// API replicas on the same volume.
+class ResultCache {
+public:
+    explicit ResultCache(ResultCacheOptions options);
+
+    bool enabled() const noexcept { return options_.max_entries > 0; }
+
+    // `content_hash` is content_hash_hex() of the upload bytes.
+    static std::string make_key(const std::string& content_hash, const std::string& model_fingerprint);
+
+    bool lookup(const std::string& key, CachedAnalysis& out);
+    void store(const std::string& key, const CachedAnalysis& value);
+
+    ResultCacheStats stats() const;
+
+private:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        std::string key;
+        CachedAnalysis value;
+        Clock::time_point expires_at;
+    };
+
+    void insert_locked(const std::string& key, const CachedAnalysis& value, Clock::time_point expires_at);
+    bool disk_lookup(const std::string& key, CachedAnalysis& out, Clock::time_point& expires_at);
+    void disk_store(const std::string& key, const CachedAnalysis& value, Clock::time_point stored_at);
+    void disk_prune();
+
+    ResultCacheOptions options_;
+
+    mutable std::mutex mu_;
+    std::list<Entry> lru_;   // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+    std::mutex disk_prune_mu_;
+    std::atomic<std::uint64_t> disk_writes_{0};
+
+    std::atomic<std::uint64_t> memory_hits_{0};
+    std::atomic<std::uint64_t> disk_hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> stores_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+    std::atomic<std::uint64_t> expirations_{0};
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct SessionStoreOptions {
+    std::string path;                                   // BUILDCHECK_ADMIN_SESSION_DB_PATH, empty = memory only
+    std::chrono::milliseconds flush_interval{250};      // BUILDCHECK_ADMIN_SESSION_FLUSH_MS
+    std::size_t shards = 16;
+};
+
+// Admin sessions (id -> unix expiry). Ids hash to one of `shards` independently locked
+// maps, so session checks neither contend with each other much nor with contact writes.
+// Each shard keeps a min-heap of expiries: a check pops only what has expired since the
+// last one instead of scanning every session. Changes mark the store dirty and a
+// background thread writes the whole set (tmp + rename) at most every flush_interval,
+// so no request waits on disk; a crash loses at most that window of logins/logouts.
+class SessionStore {
+public:
+    explicit SessionStore(SessionStoreOptions options);
+    ~SessionStore();
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    void create(const std::string& id, long long expires_at);
+    // false for unknown, revoked or expired ids.
+    bool validate(const std::string& id, long long now);
+    void revoke(const std::string& id);
+
+    std::size_t size() const;
+
+    // Writes the current set if anything changed since the last write.
+    bool flush();
+
+private:
+    using Expiry = std::pair<long long, std::string>;
+
+    struct Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, long long> sessions;
+        std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiry;
+    };
+
+    Shard& shard_for(const std::string& id) const;
+    // Drops heap entries due by `now`; ids revoked or re-created since are skipped.
+    bool expire_locked(Shard& shard, long long now);
+    void load();
+    bool write_snapshot();
+    void flusher_loop();
+
+    SessionStoreOptions options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> dirty_{false};
+
+    std::mutex write_mu_;
+    std::mutex flusher_mu_;
+    std::condition_variable flusher_cv_;
+    bool stopping_ = false;
+    std::thread flusher_;
+};
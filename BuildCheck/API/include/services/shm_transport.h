@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// One validated upload copied into a POSIX shared-memory segment so the engine
+// can map it directly instead of re-reading a temp file from the shared volume.
+// The segment is unlinked when the object is destroyed.
+class ShmSegment {
+public:
+    ShmSegment() = default;
+    ~ShmSegment();
+
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+    ShmSegment(ShmSegment&& other) noexcept;
+    ShmSegment& operator=(ShmSegment&& other) noexcept;
+
+    // false on platforms without shm_open (Windows builds use the file transport)
+    static bool supported();
+
+    bool create(const std::string& name, const char* data, std::size_t size, std::string& error);
+
+    // Streaming variant for uploads that arrive in chunks: open() creates an empty
+    // segment, append() grows it, finish() closes the descriptor. On failure the
+    // bytes appended so far can still be copied out with copy_to() before release().
+    bool open(const std::string& name, std::string& error);
+    bool append(const char* data, std::size_t size, std::string& error);
+    bool finish(std::string& error);
+    bool copy_to(std::ostream& out) const;
+    // Reads a finished segment back (e.g. to re-encode it before the engine sees it).
+    bool read_all(std::string& out, std::string& error) const;
+
+    void release();
+
+    const std::string& name() const noexcept { return name_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    std::string name_;
+    std::size_t size_ = 0;
+    int fd_ = -1;
+};
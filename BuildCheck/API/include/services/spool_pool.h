@@ -0,0 +1,67 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SpoolPoolOptions {
+    std::size_t workers = 4;                // BUILDCHECK_SPOOL_WORKERS, 0 spools on the request thread
+    std::size_t max_queue = 256;            // BUILDCHECK_SPOOL_QUEUE, tasks waiting for a worker
+};
+
+// Workers shared by every upload request for writing, flushing and checking spooled
+// files, so one request's files are persisted side by side instead of one after the
+// other. The queue is bounded; when it is full (or there are no workers) submit()
+// runs the task on the calling thread, which throttles the uploader instead of
+// failing the request.
+class SpoolPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit SpoolPool(SpoolPoolOptions options);
+    ~SpoolPool();
+
+    SpoolPool(const SpoolPool&) = delete;
+    SpoolPool& operator=(const SpoolPool&) = delete;
+
+    void submit(Task task);
+
+    std::size_t workers() const noexcept { return workers_.size(); }
+
+private:
+    void worker_loop();
+
+    SpoolPoolOptions options_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Task> pending_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Serializes the tasks of one upload on a SpoolPool: they run one at a time, in the
+// order they were posted, while other strands run in parallel.
+class SpoolStrand {
+public:
+    explicit SpoolStrand(SpoolPool& pool) : pool_(pool) {}
+    ~SpoolStrand() { wait(); }
+
+    SpoolStrand(const SpoolStrand&) = delete;
+    SpoolStrand& operator=(const SpoolStrand&) = delete;
+
+    void post(SpoolPool::Task task);
+    // Blocks until every posted task has run.
+    void wait();
+
+private:
+    void drain();
+
+    SpoolPool& pool_;
+    std::mutex mu_;
+    std::condition_variable idle_cv_;
+    std::deque<SpoolPool::Task> tasks_;
+    bool running_ = false;
+};
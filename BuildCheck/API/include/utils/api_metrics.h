@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "utils/metrics.h"
+
+// Routes get a fixed label set so request counters stay a flat array of atomics.
+enum class ApiRoute : std::size_t {
+    Analyze,
+    AnalyzeJob,
+    Health,
+    Metrics,
+    Contact,
+    AdminLogin,
+    AdminLogout,
+    AdminSubmissions,
+    Other,
+    Count
+};
+
+enum class EngineErrorKind : std::size_t {
+    Unreachable,       // no HTTP response (connect/read failure)
+    BadStatus,         // engine answered non-200
+    PoolExhausted,     // no pooled connection within ENGINE_POOL_ACQUIRE_TIMEOUT_MS
+    InvalidResponse,   // 200 but not parseable JSON
+    Overloaded,        // refused locally: the adaptive engine concurrency limit was reached
+    DeadlineExceeded,  // no answer within the request's remaining time budget
+    Count
+};
+
+// Process-wide instrumentation for api_server, exposed on GET /metrics.
+struct ApiMetrics {
+    static constexpr int kMinStatus = 100;
+    static constexpr int kMaxStatus = 599;
+    static constexpr std::size_t kRoutes = static_cast<std::size_t>(ApiRoute::Count);
+    static constexpr std::size_t kStatuses = kMaxStatus - kMinStatus + 1;
+
+    std::array<std::array<MetricCounter, kStatuses>, kRoutes> requests;
+    std::array<LatencyHistogram, kRoutes> request_duration;
+
+    // /api/property/analyze phases
+    LatencyHistogram validation_duration;    // multipart read + per-part checks + spooling
+    LatencyHistogram spool_write_duration;   // per stored upload: temp file / shm writes
+    LatencyHistogram engine_call_duration;   // POST /engine/analyze incl. pool wait
+
+    MetricGauge analyze_in_flight;
+    MetricGauge engine_calls_in_flight;
+    MetricGauge engine_concurrency_limit;   // ConcurrencyLimiter's current cap, 0 when disabled
+    MetricGauge engine_endpoints_available; // ENGINE_ENDPOINTS not ejected by EngineBalancer
+    MetricCounter engine_ejections;
+    MetricCounter upload_bytes;
+    MetricCounter uploads_accepted;
+    MetricCounter uploads_rejected;
+    std::array<MetricCounter, static_cast<std::size_t>(EngineErrorKind::Count)> engine_errors;
+
+    // HTTP worker pool overflow (BUILDCHECK_HTTP_QUEUE)
+    MetricCounter connections_shed;      // answered 503 by the shedder thread
+    MetricCounter connections_dropped;   // closed unanswered: the shedder was backed up too
+    MetricCounter rate_limited;          // 429 from RateLimiter, before the body was read
+
+    static ApiRoute route_for(const std::string& matched_route);
+
+    // `matched_route` is httplib's Request::matched_route (the registered pattern).
+    void observe_request(const std::string& matched_route, int status,
+                         std::chrono::steady_clock::duration elapsed) noexcept;
+    void count_engine_error(EngineErrorKind kind) noexcept {
+        engine_errors[static_cast<std::size_t>(kind)].inc();
+    }
+
+    void render(PrometheusWriter& out) const;
+};
+
+ApiMetrics& api_metrics();
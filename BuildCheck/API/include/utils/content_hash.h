@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// XXH64 (xxHash, 64-bit variant). Fast, non-cryptographic: fine for cache keys
+// over upload bytes, not for anything an attacker must not be able to collide.
+std::uint64_t xxh64(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+// Incremental XXH64 for uploads hashed chunk by chunk as they stream in;
+// digest() equals xxh64() over the concatenated input.
+class Xxh64Stream {
+public:
+    explicit Xxh64Stream(std::uint64_t seed = 0);
+
+    void update(const void* data, std::size_t size);
+    std::uint64_t digest() const;
+    std::uint64_t total_size() const noexcept { return total_; }
+
+private:
+    std::uint64_t seed_;
+    std::uint64_t acc_[4];
+    unsigned char buf_[32];
+    std::size_t buffered_ = 0;
+    std::uint64_t total_ = 0;
+};
+
+// "<16 hex digits of xxh64>-<byte length>", the content part of result cache keys.
+std::string content_hash_hex(std::uint64_t hash, std::uint64_t size);
+std::string content_hash_hex(const std::string& data);
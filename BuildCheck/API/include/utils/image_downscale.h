@@ -0,0 +1,29 @@
+#pragma once
+#include "utils/image_header.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Optional pre-engine shrink of accepted uploads: decode, area-resample so the longer
+// edge is `max_edge`, re-encode as JPEG. The model runs at 640 px, so a 12 MP phone
+// photo costs the shared volume, the engine's decoder and its memory ~20x what the
+// detector can use. JPEG sources are decoded with libjpeg's DCT scaling (1/2, 1/4,
+// 1/8), which skips most of the decode work before the resampler runs, and keep
+// their EXIF block so orientation is unchanged. Needs libjpeg at build time
+// (BUILDCHECK_HAVE_JPEG); PNG sources also need libpng (BUILDCHECK_HAVE_PNG).
+struct DownscaleOptions {
+    std::uint32_t max_edge = 0;   // BUILDCHECK_DOWNSCALE_MAX_EDGE, 0 disables
+    int jpeg_quality = 90;        // BUILDCHECK_DOWNSCALE_QUALITY, 1..100
+};
+
+// False when the API was built without libjpeg.
+bool image_downscale_supported() noexcept;
+
+// True when `info` is longer than options.max_edge on some side and its decoder is built in.
+bool should_downscale(const ImageInfo& info, const DownscaleOptions& options) noexcept;
+
+// Writes the shrunk JPEG to `out`. False (with `error`) when the data does not decode;
+// the caller then keeps the original bytes.
+bool downscale_to_jpeg(const std::uint8_t* data, std::size_t size, const DownscaleOptions& options,
+                       std::string& out, std::string& error);
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Header-only inspection of uploaded images: reads just enough of a JPEG (up to its
+// SOFn frame header), PNG (IHDR) or WebP (VP8 / VP8L / VP8X) to learn the pixel
+// dimensions, without decoding anything. Used to refuse decompression bombs (a few MB
+// that decode to gigapixels) before they reach the engine, and to plan resizing.
+
+enum class ImageFormat : std::uint8_t { Unknown, Jpeg, Png, Webp };
+
+const char* image_format_name(ImageFormat format) noexcept;
+
+struct ImageInfo {
+    ImageFormat format = ImageFormat::Unknown;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint8_t channels = 0;   // decoded channels: 1 gray, 2 gray+alpha, 3 color, 4 color+alpha
+
+    std::uint64_t pixels() const noexcept { return static_cast<std::uint64_t>(width) * height; }
+};
+
+// Incremental parser fed with the upload's chunks as they arrive, in order. It keeps at
+// most a few dozen bytes and skips JPEG segments (EXIF, ICC, ...) without buffering
+// them, so feeding a whole file costs about as much as feeding its header.
+class ImageHeaderParser {
+public:
+    enum class State : std::uint8_t { NeedMore, Done, Invalid };
+
+    // Returns the state after consuming `data`; once Done or Invalid, further input is ignored.
+    State feed(const void* data, std::size_t size);
+
+    State state() const noexcept { return state_; }
+    const ImageInfo& info() const noexcept { return info_; }
+    // Why the header was rejected; set with State::Invalid.
+    const std::string& error() const noexcept { return error_; }
+
+private:
+    enum class Step : std::uint8_t {
+        Signature,
+        JpegMarker,
+        JpegFill,
+        JpegLength,
+        JpegFrame,
+        PngHeader,
+        WebpChunk,
+        WebpBitstream,
+    };
+
+    void step();
+    void jpeg_marker(std::uint8_t code);
+    void expect(Step next, std::size_t bytes);
+    void fail(const char* why);
+    void done(ImageFormat format, std::uint32_t width, std::uint32_t height, std::uint8_t channels);
+
+    State state_ = State::NeedMore;
+    Step step_ = Step::Signature;
+    unsigned char buf_[32] = {};
+    std::size_t have_ = 0;
+    std::size_t need_ = 12;
+    std::uint64_t skip_ = 0;
+    std::uint8_t marker_ = 0;
+    ImageInfo info_;
+    std::string error_;
+};
+
+// Whole-buffer form of ImageHeaderParser; false (with `error`) when the header is
+// malformed or `size` ends before the dimensions.
+bool parse_image_header(const void* data, std::size_t size, ImageInfo& info, std::string& error);
+
+struct ImageLimits {
+    std::uint64_t max_pixels = 50'000'000;   // BUILDCHECK_MAX_IMAGE_PIXELS
+    std::uint32_t max_side = 20'000;         // BUILDCHECK_MAX_IMAGE_SIDE, per dimension
+};
+
+// False (with `error`) when `info` is over either limit.
+bool check_image_limits(const ImageInfo& info, const ImageLimits& limits, std::string& error);
@@ -0,0 +1,80 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Appends `s` to `out` as the body of a JSON string (no surrounding quotes).
+// Runs of bytes that need no escaping are found 16 at a time (SSE2 on x86-64,
+// NEON on aarch64) and copied in one append; UTF-8 passes through untouched.
+void json_escape_append(std::string& out, std::string_view s);
+
+// "sse2", "neon" or "scalar": the kernel json_escape_append dispatches to.
+const char* json_escape_kernel_name();
+
+// Streaming JSON serializer for API responses. Writes straight into a string with
+// commas tracked per nesting level, so a response is built without a DOM and without
+// per-field temporaries. The default constructor borrows a per-thread buffer that keeps
+// its capacity between responses; str() copies the finished document out once. A
+// writer created while the thread's buffer is already borrowed uses its own string.
+//
+//   JsonWriter w;
+//   w.begin_object().kv("ok", false).key("error").begin_object()
+//    .kv("code", code).kv("message", message).end_object().end_object();
+//   return w.str();
+class JsonWriter {
+public:
+    JsonWriter();
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& begin_object() { open('{'); return *this; }
+    JsonWriter& end_object() { close('}'); return *this; }
+    JsonWriter& begin_array() { open('['); return *this; }
+    JsonWriter& end_array() { close(']'); return *this; }
+
+    JsonWriter& key(std::string_view k);
+
+    JsonWriter& value(std::string_view s);
+    JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+    JsonWriter& value(const std::string& s) { return value(std::string_view(s)); }
+    JsonWriter& value(bool b);
+    JsonWriter& value(double d);
+    JsonWriter& null();
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    JsonWriter& value(T v) {
+        separate();
+        char buf[24];
+        const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out_->append(buf, static_cast<std::size_t>(r.ptr - buf));
+        return *this;
+    }
+
+    // Already-serialized JSON (e.g. a nested document), inserted as one value.
+    JsonWriter& raw(std::string_view json);
+
+    template <typename T>
+    JsonWriter& kv(std::string_view k, const T& v) { key(k); return value(v); }
+
+    std::string_view view() const noexcept { return *out_; }
+    std::string str() const { return *out_; }
+
+private:
+    void separate();
+    void open(char c);
+    void close(char c);
+
+    std::string owned_;
+    std::string* out_;
+    bool borrowed_ = false;
+    // Bit d-1 set = the container at depth d already has a member. Nesting is
+    // limited to 64 levels; API responses use at most four.
+    std::uint64_t has_member_ = 0;
+    int depth_ = 0;
+    bool after_key_ = false;
+};
@@ -2,10 +2,21 @@
 #include <cstdlib>
 #include <string>
 #include <algorithm>
+#include <chrono>
 #include <cctype>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "utils/httplib.h"
+#include "routes/analyze_route.h"
 #include "routes/register_routes.h"
 #include "services/engine_client.h"
+#include "services/http_server.h"
+#include "services/job_queue.h"
+#include "services/rate_limiter.h"
+#include "services/result_cache.h"
+#include "services/spool_pool.h"
+#include "utils/api_metrics.h"
 
 namespace {
 std::string trim_copy(std::string s) {
@@ -44,7 +55,6 @@ bool is_engine_key_strong(const std::string& key) {
 } // namespace
 
 int main() {
-    httplib::Server server;
     const char* env_host = std::getenv("ENGINE_HOST");
     const char* env_port = std::getenv("ENGINE_PORT");
     const char* env_key = std::getenv("ENGINE_API_KEY");
@@ -78,15 +88,134 @@ int main() {
         }
     }
 
-    EngineClient engine(engine_host, engine_port, engine_api_key);
+    EnginePoolOptions pool_options;
+    pool_options.max_size = static_cast<std::size_t>(std::max(1, env_int("ENGINE_POOL_SIZE", 8)));
+    pool_options.idle_timeout_ms = std::max(0, env_int("ENGINE_POOL_IDLE_TIMEOUT_MS", pool_options.idle_timeout_ms));
+    pool_options.probe_after_ms = std::max(0, env_int("ENGINE_POOL_PROBE_AFTER_MS", pool_options.probe_after_ms));
+    pool_options.acquire_timeout_ms = std::max(0, env_int("ENGINE_POOL_ACQUIRE_TIMEOUT_MS", pool_options.acquire_timeout_ms));
+
+    ConcurrencyLimitOptions limit_options;
+    limit_options.initial_limit = static_cast<std::size_t>(std::max(0, env_int("ENGINE_LIMIT_INITIAL", 8)));
+    limit_options.min_limit = static_cast<std::size_t>(std::max(1, env_int("ENGINE_LIMIT_MIN", 2)));
+    limit_options.max_limit = static_cast<std::size_t>(std::max(1, env_int("ENGINE_LIMIT_MAX", 64)));
+    limit_options.tolerance = std::max(100, env_int("ENGINE_LIMIT_TOLERANCE_PCT", 200)) / 100.0;
+
+    const char* env_protocol = std::getenv("BUILDCHECK_ENGINE_PROTOCOL");
+    const EngineProtocol engine_protocol = parse_engine_protocol(env_protocol ? env_protocol : "auto");
+    // ENGINE_ENDPOINTS ("host:port,host:port") takes precedence over ENGINE_HOST/ENGINE_PORT.
+    std::vector<EngineEndpoint> engine_endpoints;
+    if (const char* list = std::getenv("ENGINE_ENDPOINTS"); list && *list) {
+        engine_endpoints = parse_engine_endpoints(list, engine_port);
+    }
+    if (engine_endpoints.empty()) engine_endpoints.push_back({engine_host, engine_port});
+
+    EngineBalancerOptions balancer_options;
+    balancer_options.health_interval_ms = std::max(100, env_int("ENGINE_HEALTH_INTERVAL_MS", balancer_options.health_interval_ms));
+    balancer_options.health_timeout_ms = std::max(1, env_int("ENGINE_HEALTH_TIMEOUT_MS", balancer_options.health_timeout_ms));
+    balancer_options.eject_after_failures =
+        static_cast<std::size_t>(std::max(1, env_int("ENGINE_EJECT_AFTER_FAILURES", 5)));
+    balancer_options.eject_ms = std::max(0, env_int("ENGINE_EJECT_MS", balancer_options.eject_ms));
+    balancer_options.slow_start_ms = std::max(0, env_int("ENGINE_SLOW_START_MS", balancer_options.slow_start_ms));
+    for (const auto& ep : engine_endpoints) std::cerr << "[ENGINE] endpoint " << ep.host << ":" << ep.port << "\n";
+
+    EngineClient engine(engine_endpoints, engine_api_key, pool_options, engine_protocol, limit_options,
+                        balancer_options);
+    // Give the first health probes a moment so early uploads already use the negotiated format.
+    engine.await_health(std::chrono::seconds(3));
+    const EngineProtocol negotiated = engine.negotiated_protocol();
+    std::cerr << "[ENGINE] protocol=" << engine_protocol_name(engine_protocol) << " using="
+              << engine_protocol_name(negotiated) << "\n";
     std::size_t payload_max = static_cast<std::size_t>(env_int("BUILDCHECK_PAYLOAD_MAX_BYTES", 256 * 1024 * 1024));
     if (payload_max < 1024 * 1024) payload_max = 1024 * 1024;
-    server.set_payload_max_length(payload_max);
 
-    register_routes(server, engine);
+    ResultCacheOptions cache_options;
+    cache_options.max_entries = static_cast<std::size_t>(std::max(0, env_int("BUILDCHECK_RESULT_CACHE_ENTRIES", 4096)));
+    cache_options.ttl = std::chrono::seconds(std::max(1, env_int("BUILDCHECK_RESULT_CACHE_TTL_SEC", 3600)));
+    if (const char* dir = std::getenv("BUILDCHECK_RESULT_CACHE_DIR"); dir && *dir) cache_options.disk_dir = dir;
+    cache_options.max_disk_entries =
+        static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_RESULT_CACHE_DISK_ENTRIES", 100000)));
+    ResultCache result_cache(cache_options);
+
+    SpoolPoolOptions spool_options;
+    spool_options.workers = static_cast<std::size_t>(std::max(0, env_int("BUILDCHECK_SPOOL_WORKERS", 4)));
+    spool_options.max_queue = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_SPOOL_QUEUE", 256)));
+    SpoolPool spool(spool_options);
+
+    JobQueueOptions job_options;
+    job_options.workers = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_JOB_WORKERS", 4)));
+    job_options.max_queue = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_JOB_QUEUE", 64)));
+    job_options.ttl = std::chrono::seconds(std::max(1, env_int("BUILDCHECK_JOB_TTL_SEC", 600)));
+    JobQueue jobs(job_options);
+
+    HttpServerOptions http_options;
+    http_options.workers = static_cast<std::size_t>(std::max(0, env_int("BUILDCHECK_HTTP_WORKERS", 0)));
+    http_options.max_queue = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_HTTP_QUEUE", 256)));
+    http_options.acceptors = static_cast<std::size_t>(std::clamp(env_int("BUILDCHECK_HTTP_ACCEPTORS", 1), 1, 64));
+    http_options.keep_alive_max = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_HTTP_KEEPALIVE_MAX", 100)));
+    http_options.keep_alive_timeout_sec = std::max(1, env_int("BUILDCHECK_HTTP_KEEPALIVE_TIMEOUT_SEC", 5));
+    http_options.tcp_nodelay = env_int("BUILDCHECK_HTTP_TCP_NODELAY", 1) != 0;
+    http_options.reuse_port = env_int("BUILDCHECK_HTTP_REUSEPORT", 0) != 0;
+
+    // Shared by every acceptor so a client's budget does not depend on which socket it hit.
+    RateLimitOptions rate_options;
+    rate_options.per_minute = static_cast<std::size_t>(std::max(0, env_int("BUILDCHECK_RATE_LIMIT_RPM", 60)));
+    rate_options.burst = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_RATE_LIMIT_BURST", 60)));
+    rate_options.max_keys = static_cast<std::size_t>(std::max(1, env_int("BUILDCHECK_RATE_LIMIT_MAX_KEYS", 100000)));
+    RateLimiter rate_limiter(rate_options);
 
-    std::cout << "BuildCheck API running on http://127.0.0.1:" << api_port << "\n";
-    if (!server.listen("0.0.0.0", api_port)) {
+    // Runs for every response just before it is written, including ones httplib
+    // produces itself (404, 413), so route/status counts cover all traffic.
+    const auto observe_request = [](const httplib::Request& req, httplib::Response& res) {
+        api_metrics().observe_request(req.matched_route, res.status, std::chrono::steady_clock::now() - req.start_time_);
+    };
+
+    // One httplib::Server per acceptor, all bound to the port with SO_REUSEPORT so the
+    // kernel spreads incoming connections across their accept loops and worker pools.
+    std::vector<std::unique_ptr<httplib::Server>> servers;
+    for (std::size_t i = 0; i < http_options.acceptors; ++i) {
+        servers.push_back(std::make_unique<httplib::Server>());
+        httplib::Server& server = *servers.back();
+        configure_http_server(server, http_options, [&rate_limiter](const httplib::Request& req, httplib::Response& res) {
+            return admit_analyze_request(rate_limiter, req, res);
+        });
+        server.set_payload_max_length(payload_max);
+        register_routes(server, engine, result_cache, jobs, spool);
+        server.set_post_routing_handler(observe_request);
+        if (!server.bind_to_port("0.0.0.0", api_port)) {
+            std::cerr << "Failed to listen on port " << api_port << ".\n";
+            return 1;
+        }
+    }
+
+    // GET /metrics lives on a separate listener, loopback-only by default, so the public
+    // API port never serves it. BUILDCHECK_METRICS_PORT=0 turns it off.
+    const int metrics_port = std::max(0, env_int("BUILDCHECK_METRICS_PORT", 9464));
+    const char* env_metrics_bind = std::getenv("BUILDCHECK_METRICS_BIND");
+    const std::string metrics_bind = (env_metrics_bind && *env_metrics_bind) ? env_metrics_bind : "127.0.0.1";
+    httplib::Server metrics_server;
+    if (metrics_port > 0) {
+        metrics_server.new_task_queue = [] { return new httplib::ThreadPool(1); };
+        register_metrics_route(metrics_server, result_cache, jobs);
+        metrics_server.set_post_routing_handler(observe_request);
+        if (!metrics_server.bind_to_port(metrics_bind, metrics_port)) {
+            std::cerr << "Failed to listen on metrics port " << metrics_bind << ":" << metrics_port << ".\n";
+            return 1;
+        }
+        std::cout << "Metrics on http://" << metrics_bind << ":" << metrics_port << "/metrics\n";
+    }
+
+    std::cout << "BuildCheck API running on http://127.0.0.1:" << api_port << " (acceptors="
+              << http_options.acceptors << ")\n";
+    std::vector<std::thread> acceptor_threads;
+    for (std::size_t i = 1; i < servers.size(); ++i) {
+        acceptor_threads.emplace_back([&server = *servers[i]] { server.listen_after_bind(); });
+    }
+    if (metrics_port > 0) acceptor_threads.emplace_back([&metrics_server] { metrics_server.listen_after_bind(); });
+    const bool listened = servers.front()->listen_after_bind();
+    for (auto& server : servers) server->stop();
+    metrics_server.stop();
+    for (auto& t : acceptor_threads) t.join();
+    if (!listened) {
         std::cerr << "Failed to listen on port " << api_port << ".\n";
         return 1;
     }
@@ -1,18 +1,36 @@
 // API/src/routes/analyze_route.cpp
 #include "routes/analyze_route.h"
 #include "services/engine_client.h"
+#include "services/engine_response.h"
+#include "services/shm_transport.h"
+#include "services/spool_pool.h"
+#include "services/result_cache.h"
+#include "utils/api_metrics.h"
+#include "utils/content_hash.h"
+#include "utils/image_downscale.h"
+#include "utils/image_header.h"
+#include "utils/json.h"
 #include "utils/httplib.h"
 #include "dto/analyze_request.h"
 #include "dto/analyze_response.h"
 
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <vector>
 #include <algorithm>
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <iostream>
+#include <iterator>
 #include <chrono>
 #include <random>
 #include <filesystem>
@@ -21,7 +39,10 @@
 // [CHANGE #1] needed for temp file write + cleanup + json parse
 #include <fstream>
 #include <cstdio>
-#include "third_party/json.hpp"
+
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
 
 // ----------------- logging + response helpers -----------------
 
@@ -34,6 +55,36 @@ static std::string gen_request_id() {
     return os.str();
 }
 
+// Job ids are bearer handles to someone's results, so unlike request ids (which only
+// trace a request through the logs) they take 128 bits from the OS CSPRNG. Empty if
+// no source is available.
+static std::string gen_job_id() {
+    unsigned char bytes[16];
+    bool filled = false;
+#if defined(_WIN32)
+    std::random_device rd;   // rand_s (RtlGenRandom) on MSVC
+    for (auto& b : bytes) b = static_cast<unsigned char>(rd() & 0xFFu);
+    filled = true;
+#else
+#if defined(__linux__)
+    filled = getrandom(bytes, sizeof(bytes), 0) == static_cast<ssize_t>(sizeof(bytes));
+#endif
+    if (!filled) {
+        std::ifstream urandom("/dev/urandom", std::ios::binary);
+        filled = static_cast<bool>(urandom.read(reinterpret_cast<char*>(bytes), sizeof(bytes)));
+    }
+#endif
+    if (!filled) return "";
+    static const char* hex = "0123456789abcdef";
+    std::string out;
+    out.reserve(sizeof(bytes) * 2);
+    for (unsigned char b : bytes) {
+        out.push_back(hex[b >> 4]);
+        out.push_back(hex[b & 0x0F]);
+    }
+    return out;
+}
+
 static long long ms_since(const std::chrono::steady_clock::time_point& start) {
     using namespace std::chrono;
     return duration_cast<milliseconds>(steady_clock::now() - start).count();
@@ -51,57 +102,26 @@ static void send_json(httplib::Response& res, int status, const std::string& req
     res.set_content(body, "application/json");
 }
 
-static std::string json_escape(const std::string& s) {
-    std::string out;
-    out.reserve(s.size() + 8);
-    const char* hex = "0123456789abcdef";
-    for (unsigned char c : s) {
-        switch (c) {
-            case '\\': out += "\\\\"; break;
-            case '"':  out += "\\\""; break;
-            case '\n': out += "\\n"; break;
-            case '\r': out += "\\r"; break;
-            case '\t': out += "\\t"; break;
-            case '\b': out += "\\b"; break;
-            case '\f': out += "\\f"; break;
-            default:
-                if (c < 0x20) {
-                    out += "\\u00";
-                    out += hex[(c >> 4) & 0x0F];
-                    out += hex[c & 0x0F];
-                } else {
-                    out += static_cast<char>(c);
-                }
-                break;
-        }
-    }
-    return out;
-}
-
 static std::string make_error_json(const std::string& request_id,
                                   const std::string& code,
                                   const std::string& message) {
-    std::ostringstream os;
-    os << R"({"ok":false,"request_id":")" << json_escape(request_id) << R"(","error":{"code":")"
-       << json_escape(code) << R"(","message":")" << json_escape(message) << R"("}})";
-    return os.str();
+    JsonWriter w;
+    w.begin_object()
+     .kv("ok", false)
+     .kv("request_id", request_id)
+     .key("error").begin_object()
+     .kv("code", code)
+     .kv("message", message)
+     .end_object()
+     .end_object();
+    return w.str();
 }
 
 static std::string extract_engine_error_message(const EngineClientError& e) {
     if (e.response_body().empty()) return "Engine request failed";
-    nlohmann::json ej = nlohmann::json::parse(e.response_body(), nullptr, false);
-    if (ej.is_discarded()) return "Engine request failed";
-    if (ej.contains("error")) {
-        if (ej["error"].is_string()) {
-            return ej["error"].get<std::string>();
-        }
-        if (ej["error"].is_object() &&
-            ej["error"].contains("message") &&
-            ej["error"]["message"].is_string()) {
-            return ej["error"]["message"].get<std::string>();
-        }
-    }
-    return "Engine request failed";
+    ParsedEngineResponse parsed;
+    if (!parse_engine_response(e.response_body(), parsed) || !parsed.has_error) return "Engine request failed";
+    return parsed.error;
 }
 
 // ----------------- validation helpers -----------------
@@ -123,8 +143,8 @@ static bool is_allowed_image_ext(const std::string& ext_in) {
     return (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".webp");
 }
 
-static bool looks_like_image_by_magic(const std::string& data) {
-    if (data.size() < 12) return false;
+static bool looks_like_image_by_magic(const char* data, std::size_t size) {
+    if (size < 12) return false;
 
     if ((unsigned char)data[0] == 0xFF &&
         (unsigned char)data[1] == 0xD8 &&
@@ -154,6 +174,380 @@ static std::string sanitize_filename(std::string name) {
     return name;
 }
 
+static bool resolve_temp_dir(std::filesystem::path& temp_dir, std::string& error) {
+    try {
+        const char* shared_tmp = std::getenv("BUILDCHECK_SHARED_TMP");
+        if (shared_tmp && *shared_tmp) {
+            temp_dir = std::filesystem::path(shared_tmp);
+        } else {
+            temp_dir = std::filesystem::temp_directory_path() / "buildcheck_api";
+        }
+    } catch (const std::exception&) {
+        error = "Failed to resolve temp directory";
+        return false;
+    }
+    std::error_code mk_ec;
+    std::filesystem::create_directories(temp_dir, mk_ec);
+    if (mk_ec) {
+        error = "Failed to create temp directory";
+        return false;
+    }
+    return true;
+}
+
+// ----------------- streaming upload -----------------
+
+constexpr std::size_t kMagicBytes = 12;
+
+// One "images" part while it streams in. Only the signature prefix is kept in memory;
+// once it checks out, every byte is handed to the upload's strand on the spool pool,
+// which hashes it and writes it to its destination (shm segment or temp file), so the
+// request thread goes on parsing the next part while earlier ones are still being
+// written, flushed and checked. A request costs the same memory whatever the upload
+// sizes. Anything still on disk or in /dev/shm is removed when the upload is destroyed.
+struct StreamedUpload {
+    // Owned by the request thread.
+    std::size_t index = 0;       // position in the request, used in destination names
+    std::string filename;
+    std::string reject;          // header-time verdict (extension / content-type)
+    std::size_t size = 0;        // counted even after storing stops, for "File too large"
+    char head[kMagicBytes] = {};
+    std::size_t head_len = 0;
+    ImageHeaderParser header;    // dimensions, from the leading bytes only
+    bool storing = true;
+    std::unique_ptr<SpoolStrand> strand;   // set once the signature passed
+
+    // Owned by the strand while it runs; read only after strand->wait().
+    bool stored = false;         // destination complete and verified
+    bool downscaled = false;     // destination replaced by a smaller JPEG
+    bool failed = false;         // destination dropped; later chunks are ignored
+    std::string io_error;
+    Xxh64Stream hash;
+    std::chrono::steady_clock::duration write_time{};
+
+    bool to_shm = false;
+    ShmSegment shm;
+    std::filesystem::path tmp_path;
+    std::ofstream out;
+
+    StreamedUpload() = default;
+    StreamedUpload(const StreamedUpload&) = delete;
+    StreamedUpload& operator=(const StreamedUpload&) = delete;
+    ~StreamedUpload() {
+        if (strand) strand->wait();
+        discard();
+    }
+
+    void release_destination() {
+        shm.release();
+        if (out.is_open()) out.close();
+        if (!tmp_path.empty()) {
+            std::error_code rm_ec;
+            std::filesystem::remove(tmp_path, rm_ec);
+            tmp_path.clear();
+        }
+        stored = false;
+    }
+
+    // Only when no strand task can still be running for this upload.
+    void discard() {
+        release_destination();
+        storing = false;
+    }
+};
+
+// Per-request sink state shared by the multipart callbacks (request thread) and the
+// upload strands (spool workers).
+struct UploadSpooler {
+    // Bytes copied for the strands but not written yet; the request thread waits
+    // beyond this, so a slow volume throttles the upload instead of buffering it.
+    static constexpr std::size_t kMaxBacklogBytes = 4 * 1024 * 1024;
+
+    std::string request_id;
+    SpoolPool* pool = nullptr;
+    ImageLimits limits;
+    std::atomic<bool> use_shm{false};
+    std::deque<StreamedUpload> uploads;
+
+    std::mutex mu;
+    std::filesystem::path temp_dir;  // empty until a temp file is needed; guarded by mu
+    std::size_t backlog_bytes = 0;   // guarded by mu
+    std::condition_variable backlog_cv;
+
+    UploadSpooler() = default;
+    UploadSpooler(const UploadSpooler&) = delete;
+    UploadSpooler& operator=(const UploadSpooler&) = delete;
+    // Strand tasks use the members above; let them finish before any is destroyed.
+    ~UploadSpooler() { wait(); }
+
+    // Destination names and metrics below run on the upload's strand.
+    bool open_temp_file(StreamedUpload& u) {
+        std::filesystem::path dir;
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            if (temp_dir.empty()) {
+                std::string dir_error;
+                if (!resolve_temp_dir(temp_dir, dir_error)) {
+                    temp_dir.clear();
+                    return false;
+                }
+            }
+            dir = temp_dir;
+        }
+        u.tmp_path = dir / (request_id + "_" + std::to_string(u.index) + "_" + sanitize_filename(u.filename));
+        u.out.open(u.tmp_path, std::ios::binary | std::ios::trunc);
+        return u.out.is_open();
+    }
+
+    bool open_destination(StreamedUpload& u) {
+        if (use_shm.load()) {
+            std::string shm_error;
+            const std::string name = "/buildcheck_" + request_id + "_" + std::to_string(u.index);
+            if (u.shm.open(name, shm_error)) {
+                u.to_shm = true;
+                return true;
+            }
+            if (use_shm.exchange(false)) {
+                std::cerr << "[REQ " << request_id << "] shm transport failed (" << shm_error
+                          << "), falling back to temp files\n";
+            }
+        }
+        if (!open_temp_file(u)) {
+            u.io_error = "Failed to open temp file";
+            return false;
+        }
+        return true;
+    }
+
+    bool write(StreamedUpload& u, const char* data, std::size_t n) {
+        if (u.to_shm) {
+            std::string shm_error;
+            if (u.shm.append(data, n, shm_error)) return true;
+            // /dev/shm is full: move what already arrived into a temp file and keep going there.
+            if (use_shm.exchange(false)) {
+                std::cerr << "[REQ " << request_id << "] shm transport failed (" << shm_error
+                          << "), falling back to temp files\n";
+            }
+            u.to_shm = false;
+            if (!open_temp_file(u) || !u.shm.copy_to(u.out)) {
+                u.io_error = "Failed to write temp file";
+                return false;
+            }
+            u.shm.release();
+        }
+        u.out.write(data, static_cast<std::streamsize>(n));
+        if (!u.out.good()) {
+            u.io_error = "Failed to write temp file";
+            return false;
+        }
+        return true;
+    }
+
+    // Strand task: open the destination and write the signature prefix.
+    void spool_head(StreamedUpload& u) {
+        const auto w0 = std::chrono::steady_clock::now();
+        u.hash.update(u.head, kMagicBytes);
+        const bool ok = open_destination(u) && write(u, u.head, kMagicBytes);
+        u.write_time += std::chrono::steady_clock::now() - w0;
+        if (!ok) fail(u);
+    }
+
+    // Strand task: hash and write one body chunk.
+    void spool_chunk(StreamedUpload& u, const std::string& chunk) {
+        if (!u.failed) {
+            const auto w0 = std::chrono::steady_clock::now();
+            u.hash.update(chunk.data(), chunk.size());
+            const bool ok = write(u, chunk.data(), chunk.size());
+            u.write_time += std::chrono::steady_clock::now() - w0;
+            if (!ok) fail(u);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            backlog_bytes -= chunk.size();
+        }
+        backlog_cv.notify_one();
+    }
+
+    // Strand task: flush, close and verify once the part's last chunk arrived.
+    void spool_close(StreamedUpload& u) {
+        if (u.failed) return;
+        const auto w0 = std::chrono::steady_clock::now();
+        const bool ok = close_destination(u);
+        u.write_time += std::chrono::steady_clock::now() - w0;
+        if (!ok) {
+            fail(u);
+            return;
+        }
+        u.stored = true;
+        api_metrics().spool_write_duration.observe(u.write_time);
+    }
+
+    void fail(StreamedUpload& u) {
+        u.release_destination();
+        u.failed = true;
+    }
+
+    // Request thread: stop storing `u`, whether or not its strand started.
+    void drop(StreamedUpload& u) {
+        if (!u.strand) {
+            u.discard();
+            return;
+        }
+        u.storing = false;
+        u.strand->post([this, &u] { fail(u); });
+    }
+
+    // Header parse failed or the dimensions are over `limits` (decompression bombs).
+    bool header_rejected(const StreamedUpload& u) const {
+        std::string error;
+        return u.header.state() == ImageHeaderParser::State::Invalid ||
+               (u.header.state() == ImageHeaderParser::State::Done && !check_image_limits(u.header.info(), limits, error));
+    }
+
+    // Called for every body chunk of the current part.
+    void receive(StreamedUpload& u, const char* data, std::size_t n, std::size_t max_bytes) {
+        u.size += n;
+        if (!u.storing) return;
+        if (u.size > max_bytes) {
+            drop(u);
+            return;
+        }
+        if (u.header.state() == ImageHeaderParser::State::NeedMore) u.header.feed(data, n);
+
+        if (u.head_len < kMagicBytes) {
+            const std::size_t take = std::min(kMagicBytes - u.head_len, n);
+            std::memcpy(u.head + u.head_len, data, take);
+            u.head_len += take;
+            data += take;
+            n -= take;
+            if (u.head_len < kMagicBytes) return;
+            // Reject on the signature before anything is written out.
+            if (!looks_like_image_by_magic(u.head, kMagicBytes)) {
+                u.discard();
+                return;
+            }
+        }
+        if (header_rejected(u)) {
+            drop(u);
+            return;
+        }
+        if (!u.strand) {
+            u.strand = std::make_unique<SpoolStrand>(*pool);
+            u.strand->post([this, &u] { spool_head(u); });
+        }
+        if (n == 0) return;
+
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            backlog_cv.wait(lock, [this, n] { return backlog_bytes == 0 || backlog_bytes + n <= kMaxBacklogBytes; });
+            backlog_bytes += n;
+        }
+        u.strand->post([this, &u, chunk = std::string(data, n)] { spool_chunk(u, chunk); });
+    }
+
+    // Called once the part's last chunk has arrived.
+    void finish(StreamedUpload& u) {
+        if (!u.strand) {
+            u.discard();
+            return;
+        }
+        if (!u.storing) return;
+        // The part ended before its dimensions did.
+        if (u.header.state() != ImageHeaderParser::State::Done) {
+            drop(u);
+            return;
+        }
+        u.strand->post([this, &u] { spool_close(u); });
+    }
+
+    // Strand task: replace a stored upload with a JPEG no longer than options.max_edge.
+    // Any failure keeps the original bytes.
+    void shrink(StreamedUpload& u, const DownscaleOptions& options) {
+        std::string original;
+        std::string error;
+        if (u.to_shm) {
+            if (!u.shm.read_all(original, error)) return;
+        } else {
+            std::ifstream in(u.tmp_path, std::ios::binary);
+            original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            if (!in.good() && !in.eof()) return;
+        }
+        std::string shrunk;
+        if (!downscale_to_jpeg(reinterpret_cast<const std::uint8_t*>(original.data()), original.size(), options,
+                               shrunk, error)) {
+            std::cerr << "[REQ " << request_id << "] downscale skipped for " << u.filename << ": " << error << "\n";
+            return;
+        }
+        if (u.to_shm) {
+            ShmSegment small;
+            if (!small.create(u.shm.name() + "_s", shrunk.data(), shrunk.size(), error)) return;
+            u.shm = std::move(small);
+        } else {
+            std::filesystem::path small_path = u.tmp_path;
+            small_path += ".jpg";
+            std::ofstream out(small_path, std::ios::binary | std::ios::trunc);
+            out.write(shrunk.data(), static_cast<std::streamsize>(shrunk.size()));
+            out.close();
+            std::error_code ec;
+            if (!out) {
+                std::filesystem::remove(small_path, ec);
+                return;
+            }
+            std::filesystem::remove(u.tmp_path, ec);
+            u.tmp_path = small_path;
+        }
+        u.downscaled = true;
+    }
+
+    // Shrinks the accepted uploads that are over options.max_edge, in parallel on their
+    // strands; returns how many were replaced.
+    std::size_t downscale(const std::vector<std::size_t>& accepted, const DownscaleOptions& options) {
+        std::size_t planned = 0;
+        for (const std::size_t i : accepted) {
+            StreamedUpload& u = uploads[i];
+            if (!u.strand || !should_downscale(u.header.info(), options)) continue;
+            u.strand->post([this, &u, &options] { shrink(u, options); });
+            ++planned;
+        }
+        if (planned == 0) return 0;
+        wait();
+        return static_cast<std::size_t>(std::count_if(uploads.begin(), uploads.end(),
+                                                      [](const StreamedUpload& u) { return u.downscaled; }));
+    }
+
+    // Blocks until every upload's strand is idle; verdict fields are readable after it.
+    void wait() {
+        for (auto& u : uploads) {
+            if (u.strand) u.strand->wait();
+        }
+    }
+
+    bool close_destination(StreamedUpload& u) {
+        if (u.to_shm) {
+            std::string shm_error;
+            if (!u.shm.finish(shm_error)) {
+                u.io_error = "Failed to write shm segment";
+                return false;
+            }
+            return true;
+        }
+        u.out.flush();
+        if (!u.out.good()) {
+            u.io_error = "Failed to flush temp file";
+            return false;
+        }
+        u.out.close();
+        const std::filesystem::path& tmp_path = u.tmp_path;
+        std::error_code sz_ec;
+        const auto saved_size = std::filesystem::file_size(tmp_path, sz_ec);
+        if (sz_ec || saved_size != u.size) {
+            u.io_error = "Temp file size mismatch";
+            return false;
+        }
+        return true;
+    }
+};
+
 static std::string trim_copy(std::string s) {
     const auto not_space = [](unsigned char c) { return !std::isspace(c); };
     s.erase(s.begin(), std::find_if(s.begin(), s.end(), not_space));
@@ -181,34 +575,410 @@ static bool trust_proxy_headers() {
     return (v == "1" || v == "true" || v == "yes" || v == "on");
 }
 
-static std::string derive_rate_limit_key(const httplib::Request& req, const std::string& request_id) {
+// BUILDCHECK_ENGINE_TRANSPORT=shm hands images to the engine via shared memory;
+// anything else (default) keeps the temp-file path transport.
+static bool engine_transport_is_shm() {
+    const char* env = std::getenv("BUILDCHECK_ENGINE_TRANSPORT");
+    if (!env || !*env) return false;
+    return to_lower(trim_copy(env)) == "shm";
+}
+
+static std::uint64_t env_u64(const char* name, std::uint64_t fallback) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) return fallback;
+    try {
+        return std::stoull(env);
+    } catch (...) {
+        return fallback;
+    }
+}
+
+// BUILDCHECK_MAX_IMAGE_PIXELS / BUILDCHECK_MAX_IMAGE_SIDE, 0 disables either check.
+static ImageLimits image_limits_from_env() {
+    ImageLimits limits;
+    limits.max_pixels = env_u64("BUILDCHECK_MAX_IMAGE_PIXELS", limits.max_pixels);
+    limits.max_side = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(env_u64("BUILDCHECK_MAX_IMAGE_SIDE", limits.max_side), UINT32_MAX));
+    return limits;
+}
+
+// BUILDCHECK_DOWNSCALE_MAX_EDGE (0 = off) / BUILDCHECK_DOWNSCALE_QUALITY.
+static DownscaleOptions downscale_options_from_env() {
+    DownscaleOptions options;
+    options.max_edge = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(env_u64("BUILDCHECK_DOWNSCALE_MAX_EDGE", options.max_edge), UINT32_MAX));
+    options.jpeg_quality = static_cast<int>(
+        std::clamp<std::uint64_t>(env_u64("BUILDCHECK_DOWNSCALE_QUALITY", options.jpeg_quality), 1, 100));
+    if (options.max_edge > 0 && !image_downscale_supported()) {
+        std::cerr << "[DOWNSCALE] BUILDCHECK_DOWNSCALE_MAX_EDGE ignored: built without libjpeg\n";
+        options.max_edge = 0;
+    }
+    return options;
+}
+
+// Time budget of an analyze request, counted from its first byte.
+struct DeadlineOptions {
+    std::chrono::milliseconds default_budget{20000};   // BUILDCHECK_REQUEST_TIMEOUT_MS, synchronous calls; 0 disables
+    std::chrono::milliseconds max_budget{60000};       // BUILDCHECK_REQUEST_TIMEOUT_MAX_MS, cap on the client's header
+    std::chrono::milliseconds reserve{1500};           // BUILDCHECK_DEADLINE_RESERVE_MS, kept back for the batch in flight and the reply
+};
+
+static DeadlineOptions deadline_options_from_env() {
+    DeadlineOptions options;
+    options.default_budget = std::chrono::milliseconds(
+        std::min<std::uint64_t>(env_u64("BUILDCHECK_REQUEST_TIMEOUT_MS", options.default_budget.count()), 3600000));
+    options.max_budget = std::chrono::milliseconds(
+        std::clamp<std::uint64_t>(env_u64("BUILDCHECK_REQUEST_TIMEOUT_MAX_MS", options.max_budget.count()), 1, 3600000));
+    options.reserve = std::chrono::milliseconds(
+        std::min<std::uint64_t>(env_u64("BUILDCHECK_DEADLINE_RESERVE_MS", options.reserve.count()), 60000));
+    return options;
+}
+
+// The client's kRequestTimeoutHeader (capped), else the default for synchronous calls.
+// Async jobs have no default: nobody is waiting on the connection. Zero means none.
+static std::chrono::milliseconds request_budget(const httplib::Request& req, bool async,
+                                                const DeadlineOptions& options) {
+    const std::string raw = req.get_header_value(kRequestTimeoutHeader);
+    if (!raw.empty() && raw.size() <= 9 &&
+        std::all_of(raw.begin(), raw.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+        const std::chrono::milliseconds asked(std::stoll(raw));
+        if (asked.count() > 0) return std::min(asked, options.max_budget);
+    }
+    return async ? std::chrono::milliseconds(0) : options.default_budget;
+}
+
+// ?async=1 (or true/yes) queues the engine phase and answers 202 with a job id.
+static bool is_async_request(const httplib::Request& req) {
+    if (!req.has_param("async")) return false;
+    const std::string v = to_lower(trim_copy(req.get_param_value("async")));
+    return (v == "1" || v == "true" || v == "yes");
+}
+
+// Client IP, else `fallback`. Behind a trusted proxy that is the address the proxy
+// itself saw: X-Real-IP, or the last X-Forwarded-For hop (the one the proxy appended).
+// Earlier hops come from the client and can be anything.
+static std::string derive_rate_limit_key(const httplib::Request& req, const std::string& fallback) {
     std::string candidate;
     if (trust_proxy_headers()) {
+        candidate = trim_copy(req.get_header_value("X-Real-IP"));
         const std::string xff = req.get_header_value("X-Forwarded-For");
-        if (!xff.empty()) {
-            const auto comma = xff.find(',');
-            candidate = trim_copy(xff.substr(0, comma));
+        if (candidate.empty() && !xff.empty()) {
+            const auto comma = xff.rfind(',');
+            candidate = trim_copy(comma == std::string::npos ? xff : xff.substr(comma + 1));
         }
     }
     if (candidate.empty()) {
         candidate = req.remote_addr;
     }
-    return normalize_rate_limit_key(candidate, "req_" + request_id);
+    return normalize_rate_limit_key(candidate, fallback);
+}
+
+// Engine verdicts that depend only on the image and model, so they are safe to replay
+// from the result cache. Transient failures ("inference failed", "engine busy") are not.
+static bool is_cacheable_verdict(const CachedAnalysis& v) {
+    return v.ok || v.error == "no damage detected";
+}
+
+static void apply_verdict(AnalyzeImageResult& r, const CachedAnalysis& v) {
+    r.ok = v.ok;
+    r.inference_mode = v.inference_mode;
+    r.damage_types = v.damage_types;
+
+    // TEMP: pricing logic (same as stub for now)
+    if (r.ok) {
+        r.cost_min = 500;
+        r.cost_max = 1500;
+        r.error.clear();
+    } else {
+        r.error = v.error.empty() ? "Engine failed to analyze image" : v.error;
+    }
 }
 
 // ----------------- route -----------------
 
-void register_analyze_route(httplib::Server& server, const EngineClient& engine) {
+// Everything the engine phase needs once the request body has been read. Held by a
+// shared_ptr so an async job keeps the spooled uploads alive after the handler returns.
+struct PreparedAnalysis {
+    std::string request_id;
+    std::string rate_limit_key;
+    std::chrono::steady_clock::time_point t0;
+    bool async = false;
+    std::chrono::steady_clock::time_point deadline{};   // epoch: none
+    std::chrono::milliseconds deadline_reserve{0};
+    DownscaleOptions downscale;
+    UploadSpooler spooler;
+    AnalyzeResponse final_res;
+    std::vector<std::size_t> accepted;   // indexes into final_res.results / spooler.uploads
+};
+
+// Cache lookup, engine round trip and result mapping for the accepted uploads. Writes
+// the final answer into `res`, which for async jobs is a detached response the job
+// queue stores for polling.
+static void run_analysis(const EngineClient& engine, ResultCache& cache, PreparedAnalysis& job,
+                         httplib::Response& res) {
+    const std::string& request_id = job.request_id;
+    AnalyzeResponse& final_res = job.final_res;
+    std::vector<std::size_t>& accepted = job.accepted;
+    UploadSpooler& spooler = job.spooler;
+
+    auto finish_log = [&](int status) {
+        std::cout << "[REQ " << request_id << "] " << (job.async ? "JOB END" : "END") << " status=" << status
+                  << " ms=" << ms_since(job.t0) << "\n";
+    };
+
+    // Result cache: replay verdicts for uploads the current model has already seen.
+    // Only misses go on to the engine; their keys are kept to store the answers.
+    std::vector<std::string> cache_keys(final_res.results.size());
+    std::string model_fingerprint = cache.enabled() ? engine.model_fingerprint() : std::string();
+    if (!model_fingerprint.empty()) {
+        // Downscaled uploads can score differently than the originals.
+        if (job.downscale.max_edge > 0) model_fingerprint += "|max_edge=" + std::to_string(job.downscale.max_edge);
+        std::vector<std::size_t> misses;
+        misses.reserve(accepted.size());
+        for (const std::size_t i : accepted) {
+            StreamedUpload& u = spooler.uploads[i];
+            const std::string key = ResultCache::make_key(content_hash_hex(u.hash.digest(), u.size),
+                                                          model_fingerprint);
+            CachedAnalysis cached;
+            if (cache.lookup(key, cached)) {
+                apply_verdict(final_res.results[i], cached);
+                u.discard();
+            } else {
+                cache_keys[i] = key;
+                misses.push_back(i);
+            }
+        }
+        if (misses.size() != accepted.size()) {
+            std::cout << "[REQ " << request_id << "] result cache hits="
+                      << (accepted.size() - misses.size()) << "/" << accepted.size() << "\n";
+        }
+        accepted.swap(misses);
+
+        if (accepted.empty()) {
+            final_res.ok = std::any_of(final_res.results.begin(), final_res.results.end(),
+                                       [](const AnalyzeImageResult& r) { return r.ok; });
+            send_json(res, final_res.ok ? 200 : 422, request_id, final_res.to_json());
+            finish_log(res.status);
+            return;
+        }
+    }
+
+    if (job.downscale.max_edge > 0) {
+        const auto d0 = std::chrono::steady_clock::now();
+        const std::size_t shrunk = spooler.downscale(accepted, job.downscale);
+        if (shrunk > 0) {
+            std::cout << "[REQ " << request_id << "] downscaled " << shrunk << "/" << accepted.size()
+                      << " to max_edge=" << job.downscale.max_edge << " ms=" << ms_since(d0) << "\n";
+        }
+    }
+
+    // Engine handles: shm segment names and temp file paths. Both are removed when
+    // `spooler` goes out of scope, on every return path.
+    struct ValidMap { std::string handle; std::size_t idx; };
+    std::vector<ValidMap> valid_map;
+    valid_map.reserve(accepted.size());
+    std::unordered_map<std::string, std::size_t> path_to_out_idx;
+    path_to_out_idx.reserve(accepted.size());
+    std::vector<EngineShmImage> shm_images;
+    std::vector<std::string> temp_paths;
+    for (const std::size_t i : accepted) {
+        const StreamedUpload& u = spooler.uploads[i];
+        std::string handle;
+        if (u.to_shm) {
+            handle = u.shm.name();
+            shm_images.push_back({handle, u.shm.size()});
+        } else {
+            handle = u.tmp_path.string();
+            temp_paths.push_back(handle);
+        }
+        valid_map.push_back({handle, i});
+        path_to_out_idx[handle] = i;
+    }
+
+    // Hand the engine what is left of the budget, minus the reserve for finishing up.
+    EngineBudget budget;
+    if (job.deadline != std::chrono::steady_clock::time_point{}) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            job.deadline - std::chrono::steady_clock::now());
+        if (left <= job.deadline_reserve) {
+            send_json(res, 504, request_id,
+                      make_error_json(request_id, "DEADLINE_EXCEEDED", "Request deadline exceeded before analysis"));
+            finish_log(res.status);
+            return;
+        }
+        budget.budget = left - job.deadline_reserve;
+        budget.grace = job.deadline_reserve;
+    }
+
+    // [CHANGE #4] call engine via HTTP (negotiated body format) and merge by order
+    try {
+        ParsedEngineResponse parsed;
+        const bool parsed_ok = engine.analyze(request_id, temp_paths, shm_images, job.rate_limit_key, parsed, budget);
+
+        // the engine has read every image; drop temp files / shm segments now
+        spooler.uploads.clear();
+
+        if (!parsed_ok) {
+            api_metrics().count_engine_error(EngineErrorKind::InvalidResponse);
+            send_json(res, 500, request_id,
+                      make_error_json(request_id, "INTERNAL_ERROR", "Engine returned an invalid response"));
+            finish_log(res.status);
+            return;
+        }
+
+        if (parsed.has_results) {
+            std::vector<bool> filled(final_res.results.size(), false);
+            std::size_t fallback_i = 0;
+
+            for (const auto& er : parsed.results) {
+                bool has_out_idx = false;
+                std::size_t out_idx = 0;
+
+                for (const std::string* handle : {&er.path, &er.shm}) {
+                    if (handle->empty()) continue;
+                    const auto it = path_to_out_idx.find(*handle);
+                    if (it != path_to_out_idx.end()) {
+                        out_idx = it->second;
+                        has_out_idx = true;
+                        break;
+                    }
+                }
+
+                if (!has_out_idx) {
+                    while (fallback_i < valid_map.size() && filled[valid_map[fallback_i].idx]) {
+                        ++fallback_i;
+                    }
+                    if (fallback_i < valid_map.size()) {
+                        out_idx = valid_map[fallback_i].idx;
+                        has_out_idx = true;
+                        ++fallback_i;
+                    }
+                }
+
+                if (!has_out_idx) {
+                    continue;
+                }
+
+                filled[out_idx] = true;
+
+                const CachedAnalysis& verdict = er.verdict;
+                apply_verdict(final_res.results[out_idx], verdict);
+
+                if (!cache_keys[out_idx].empty() && is_cacheable_verdict(verdict)) {
+                    cache.store(cache_keys[out_idx], verdict);
+                }
+            }
+
+            // Mark any not-mapped images as failed instead of keeping placeholder state.
+            for (const auto& vm : valid_map) {
+                if (!filled[vm.idx]) {
+                    final_res.results[vm.idx].ok = false;
+                    final_res.results[vm.idx].error = "Missing engine result for image";
+                }
+            }
+        } else {
+            const std::string engine_err = parsed.has_error ? parsed.error : "Engine returned no results";
+
+            for (const auto& vm : valid_map) {
+                final_res.results[vm.idx].ok = false;
+                final_res.results[vm.idx].error = engine_err;
+            }
+        }
+
+        // final ok if any image ok
+        final_res.ok = false;
+        bool timed_out = false;
+        for (const auto& r : final_res.results) {
+            if (r.ok) { final_res.ok = true; break; }
+            timed_out = timed_out || r.error == kEngineDeadlineError;
+        }
+
+        // Partial answers keep their per-image results; 504 only when nothing made it in time.
+        std::string body = final_res.to_json();
+        send_json(res, final_res.ok ? 200 : (timed_out ? 504 : 422), request_id, body);
+        finish_log(res.status);
+        return;
+    }
+    catch (const EngineClientError& e) {
+        if (std::string_view(e.what()) == "ENGINE_DEADLINE_EXCEEDED") {
+            send_json(res, 504, request_id,
+                      make_error_json(request_id, "DEADLINE_EXCEEDED", "Request deadline exceeded"));
+            finish_log(res.status);
+            return;
+        }
+        if (std::string_view(e.what()) == "ENGINE_OVERLOADED") {
+            // Refused by the adaptive limiter before the engine saw it.
+            res.set_header("Retry-After", "1");
+            send_json(res, 503, request_id,
+                      make_error_json(request_id, "ENGINE_OVERLOADED", "Engine is at capacity, retry shortly"));
+            finish_log(res.status);
+            return;
+        }
+        int status = e.status_code();
+        if (status < 400 || status > 599) status = 502;
+        const std::string msg = extract_engine_error_message(e);
+        send_json(res, status, request_id,
+                  make_error_json(request_id, "ENGINE_ERROR", msg));
+        finish_log(res.status);
+        return;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[REQ " << request_id << "] INTERNAL_ERROR: " << e.what() << "\n";
+        send_json(res, 500, request_id,
+                  make_error_json(request_id, "INTERNAL_ERROR", "Internal server error"));
+        finish_log(res.status);
+        return;
+    }
+    catch (...) {
+        send_json(res, 500, request_id,
+                  make_error_json(request_id, "INTERNAL_ERROR", "Unknown error"));
+        finish_log(res.status);
+        return;
+    }
+}
+
+bool admit_analyze_request(RateLimiter& limiter, const httplib::Request& req, httplib::Response& res) {
+    if (!limiter.enabled() || req.method != "POST" || req.path != "/api/property/analyze") return true;
+    const std::string key = derive_rate_limit_key(req, "");
+    if (key.empty()) return true;
+    const RateLimiter::Decision decision = limiter.admit(key);
+    if (decision.allowed) return true;
+
+    api_metrics().rate_limited.inc();
+    const std::string request_id = gen_request_id();
+    const auto retry_sec = std::max<long long>(1, (decision.retry_after.count() + 999) / 1000);
+    res.set_header("Retry-After", std::to_string(retry_sec));
+    res.set_header("Connection", "close");   // the unread body must not be parsed as the next request
+    send_json(res, 429, request_id, make_error_json(request_id, "RATE_LIMITED", "Too many requests, retry later"));
+    return false;
+}
+
+void register_analyze_route(httplib::Server& server, const EngineClient& engine, ResultCache& cache,
+                            JobQueue& jobs, SpoolPool& spool) {
+    const ImageLimits image_limits = image_limits_from_env();
+    const DownscaleOptions downscale = downscale_options_from_env();
+    const DeadlineOptions deadlines = deadline_options_from_env();
+
     server.Options("/api/property/analyze", [](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Access-Control-Allow-Methods", "POST, OPTIONS");
-        res.set_header("Access-Control-Allow-Headers", "Content-Type");
+        res.set_header("Access-Control-Allow-Headers", std::string("Content-Type, ") + kRequestTimeoutHeader);
         res.status = 204;
     });
 
-    server.Post("/api/property/analyze", [&engine](const httplib::Request& req, httplib::Response& res) {
+    // Uploads are consumed through the content reader instead of httplib's buffered form:
+    // each part is validated and spooled while it arrives, so the request body is never
+    // held in memory and bad uploads stop being stored at the first failing check. The
+    // writes run on `spool`, one strand per file, so parts are persisted in parallel;
+    // verdicts are still assembled in upload order once every strand is idle.
+    // With ?async=1 the engine phase is queued on `jobs` and the handler answers 202.
+    server.Post("/api/property/analyze", [&engine, &cache, &jobs, &spool, image_limits, downscale,
+                                          deadlines](const httplib::Request& req, httplib::Response& res,
+                                                     const httplib::ContentReader& content_reader) {
         const auto t0 = std::chrono::steady_clock::now();
         const std::string request_id = gen_request_id();
+        ApiMetrics& metrics = api_metrics();
+        const GaugeGuard in_flight(metrics.analyze_in_flight);
 
         std::cout << "[REQ " << request_id << "] START "
                   << req.method << " " << req.path << "\n";
@@ -227,23 +997,6 @@ void register_analyze_route(httplib::Server& server, const EngineClient& engine)
             return;
         }
 
-        const auto& form = req.form;
-
-        if (!form.has_file("images")) {
-            send_json(res, 400, request_id,
-                      make_error_json(request_id, "MISSING_FIELD", "Field 'images' not found"));
-            finish_log(res.status);
-            return;
-        }
-
-        const auto files = form.get_files("images");
-        if (files.empty()) {
-            send_json(res, 400, request_id,
-                      make_error_json(request_id, "MISSING_FIELD", "No files under 'images'"));
-            finish_log(res.status);
-            return;
-        }
-
         std::size_t max_files = 20;
         constexpr std::size_t kMaxFilesHardCap = 100;
         if (const char* env_max_files = std::getenv("BUILDCHECK_MAX_FILES"); env_max_files && *env_max_files) {
@@ -254,140 +1007,132 @@ void register_analyze_route(httplib::Server& server, const EngineClient& engine)
                 max_files = 20;
             }
         }
-        if (files.size() > max_files) {
+
+        const std::size_t max_bytes = 10 * 1024 * 1024;
+
+        auto prepared = std::make_shared<PreparedAnalysis>();
+        prepared->request_id = request_id;
+        prepared->t0 = t0;
+        prepared->async = is_async_request(req);
+        if (const auto budget = request_budget(req, prepared->async, deadlines); budget.count() > 0) {
+            prepared->deadline = t0 + budget;
+            prepared->deadline_reserve = std::min(deadlines.reserve, budget / 2);
+        }
+        prepared->downscale = downscale;
+        UploadSpooler& spooler = prepared->spooler;
+        spooler.request_id = request_id;
+        spooler.pool = &spool;
+        spooler.limits = image_limits;
+        spooler.use_shm = engine_transport_is_shm() && ShmSegment::supported();
+        if (!spooler.use_shm) {
+            std::string dir_error;
+            if (!resolve_temp_dir(spooler.temp_dir, dir_error)) {
+                send_json(res, 500, request_id, make_error_json(request_id, "INTERNAL_ERROR", dir_error));
+                finish_log(res.status);
+                return;
+            }
+        }
+
+        // Parts arrive strictly one after another: a header callback closes the previous
+        // part. Fields other than "images" files are read and dropped.
+        StreamedUpload* current = nullptr;
+        bool too_many_files = false;
+        const bool read_ok = content_reader(
+            [&](const httplib::FormData& part) {
+                if (current) spooler.finish(*current);
+                current = nullptr;
+                if (part.name != "images" || part.filename.empty()) return true;
+                if (spooler.uploads.size() >= max_files) {
+                    too_many_files = true;
+                    return false;
+                }
+                StreamedUpload& u = spooler.uploads.emplace_back();
+                u.index = spooler.uploads.size() - 1;
+                u.filename = part.filename;
+                if (!is_allowed_image_ext(get_extension(part.filename))) {
+                    u.reject = "Bad extension";
+                } else if (!part.content_type.empty() && part.content_type.rfind("image/", 0) != 0) {
+                    u.reject = "Bad content-type";
+                }
+                u.storing = u.reject.empty();
+                current = &u;
+                return true;
+            },
+            [&](const char* data, std::size_t n) {
+                if (current) spooler.receive(*current, data, n, max_bytes);
+                return true;
+            });
+        if (current) spooler.finish(*current);
+        spooler.wait();
+
+        if (too_many_files) {
             send_json(res, 400, request_id,
                       make_error_json(request_id, "TOO_MANY_FILES",
                                       "Too many files in one request"));
             finish_log(res.status);
             return;
         }
-
-        AnalyzeResponse final_res;
-        final_res.request_id = request_id;
-        final_res.ok = false;
-
-        const std::size_t max_bytes = 10 * 1024 * 1024;
-
-        struct ValidMap { std::string temp_path; std::size_t idx; };
-        std::vector<ValidMap> valid_map;
-        valid_map.reserve(files.size());
-        std::unordered_map<std::string, std::size_t> path_to_out_idx;
-        path_to_out_idx.reserve(files.size());
-
-        // [CHANGE #2] collect temp file paths for engine (instead of bytes)
-        std::vector<std::string> temp_paths;
-        temp_paths.reserve(files.size());
-
-        std::filesystem::path temp_dir;
-        try {
-            const char* shared_tmp = std::getenv("BUILDCHECK_SHARED_TMP");
-            if (shared_tmp && *shared_tmp) {
-                temp_dir = std::filesystem::path(shared_tmp);
+        if (!read_ok) {
+            if (res.status == 413) {
+                send_json(res, 413, request_id,
+                          make_error_json(request_id, "PAYLOAD_TOO_LARGE", "Request body too large"));
             } else {
-                temp_dir = std::filesystem::temp_directory_path() / "buildcheck_api";
+                send_json(res, 400, request_id,
+                          make_error_json(request_id, "BAD_REQUEST", "Malformed multipart body"));
             }
-        } catch (const std::exception& e) {
-            send_json(res, 500, request_id,
-                      make_error_json(request_id, "INTERNAL_ERROR",
-                                      "Failed to resolve temp directory"));
             finish_log(res.status);
             return;
         }
-
-        std::error_code mk_ec;
-        std::filesystem::create_directories(temp_dir, mk_ec);
-        if (mk_ec) {
-            send_json(res, 500, request_id,
-                      make_error_json(request_id, "INTERNAL_ERROR", "Failed to create temp directory"));
+        if (spooler.uploads.empty()) {
+            send_json(res, 400, request_id,
+                      make_error_json(request_id, "MISSING_FIELD", "Field 'images' not found"));
             finish_log(res.status);
             return;
         }
 
-        for (const auto& f : files) {
-            AnalyzeImageResult r;
-            r.filename = f.filename;
-
-            const std::string ext = get_extension(f.filename);
-
-            if (f.content.empty()) {
-                r.ok = false; r.error = "Empty file";
-                final_res.results.push_back(r);
-                continue;
-            }
-            if (f.content.size() > max_bytes) {
-                r.ok = false; r.error = "File too large";
-                final_res.results.push_back(r);
-                continue;
-            }
-            if (!is_allowed_image_ext(ext)) {
-                r.ok = false; r.error = "Bad extension";
-                final_res.results.push_back(r);
-                continue;
-            }
-            if (!f.content_type.empty() && f.content_type.rfind("image/", 0) != 0) {
-                r.ok = false; r.error = "Bad content-type";
-                final_res.results.push_back(r);
-                continue;
-            }
-            if (!looks_like_image_by_magic(f.content)) {
-                r.ok = false; r.error = "Not an image (signature check failed)";
-                final_res.results.push_back(r);
-                continue;
-            }
-
-            std::string safe_name = sanitize_filename(f.filename);
-            std::filesystem::path tmp_path =
-                temp_dir / (request_id + "_" + std::to_string(temp_paths.size()) + "_" + safe_name);
+        AnalyzeResponse& final_res = prepared->final_res;
+        final_res.request_id = request_id;
+        final_res.ok = false;
 
-            std::ofstream out(tmp_path, std::ios::binary);
-            if (!out.is_open()) {
-                r.ok = false; r.error = "Failed to open temp file";
-                final_res.results.push_back(r);
-                continue;
-            }
-            out.write(f.content.data(), (std::streamsize)f.content.size());
-            if (!out.good()) {
-                out.close();
-                std::error_code rm_ec;
-                std::filesystem::remove(tmp_path, rm_ec);
-                r.ok = false; r.error = "Failed to write temp file";
-                final_res.results.push_back(r);
-                continue;
-            }
-            out.flush();
-            if (!out.good()) {
-                out.close();
-                std::error_code rm_ec;
-                std::filesystem::remove(tmp_path, rm_ec);
-                r.ok = false; r.error = "Failed to flush temp file";
-                final_res.results.push_back(r);
-                continue;
-            }
-            out.close();
-            std::error_code sz_ec;
-            const auto saved_size = std::filesystem::file_size(tmp_path, sz_ec);
-            if (sz_ec || saved_size != f.content.size()) {
-                std::error_code rm_ec;
-                std::filesystem::remove(tmp_path, rm_ec);
-                r.ok = false; r.error = "Temp file size mismatch";
-                final_res.results.push_back(r);
-                continue;
+        // Verdicts in the same precedence as the checks on a fully buffered file:
+        // empty, too large, extension, content-type, signature, header, dimensions,
+        // then spool errors.
+        std::vector<std::size_t>& accepted = prepared->accepted;
+        accepted.reserve(spooler.uploads.size());
+        for (std::size_t i = 0; i < spooler.uploads.size(); ++i) {
+            const StreamedUpload& u = spooler.uploads[i];
+            AnalyzeImageResult r;
+            r.filename = u.filename;
+            r.ok = false;
+
+            if (u.size == 0) {
+                r.error = "Empty file";
+            } else if (u.size > max_bytes) {
+                r.error = "File too large";
+            } else if (!u.reject.empty()) {
+                r.error = u.reject;
+            } else if (!looks_like_image_by_magic(u.head, u.head_len)) {
+                r.error = "Not an image (signature check failed)";
+            } else if (u.header.state() != ImageHeaderParser::State::Done) {
+                r.error = u.header.state() == ImageHeaderParser::State::Invalid
+                    ? "Invalid image header (" + u.header.error() + ")"
+                    : "Invalid image header (truncated)";
+            } else if (!check_image_limits(u.header.info(), image_limits, r.error)) {
+                // r.error set
+            } else if (!u.stored) {
+                r.error = u.io_error.empty() ? "Failed to write temp file" : u.io_error;
+            } else {
+                r.error = "Pending engine analysis"; // will be set from engine result only
+                accepted.push_back(i);
             }
-
-            temp_paths.push_back(tmp_path.string());
-
-            r.ok = false; // will be set from engine result only
-            r.error = "Pending engine analysis";
             final_res.results.push_back(r);
-
-            // NOTE: order-based mapping (engine returns in same order)
-            const std::size_t out_idx = final_res.results.size() - 1;
-            valid_map.push_back({tmp_path.string(), out_idx});
-            path_to_out_idx[tmp_path.string()] = out_idx;
+            metrics.upload_bytes.inc(u.size);
         }
+        metrics.uploads_accepted.inc(accepted.size());
+        metrics.uploads_rejected.inc(spooler.uploads.size() - accepted.size());
+        metrics.validation_duration.observe(std::chrono::steady_clock::now() - t0);
 
-        // [CHANGE #3] if no valid images -> return as-is
-        if (temp_paths.empty()) {
+        if (accepted.empty()) {
             final_res.ok = false;
             std::string body = final_res.to_json();
             send_json(res, 422, request_id, body);
@@ -395,154 +1140,72 @@ void register_analyze_route(httplib::Server& server, const EngineClient& engine)
             return;
         }
 
-        // [CHANGE #4] call engine via HTTP (paths json) and merge by order
-        try {
-            auto cleanup_temp_files = [&temp_paths]() {
-                for (const auto& p : temp_paths) {
-                    std::error_code rm_ec;
-                    std::filesystem::remove(p, rm_ec);
-                }
-            };
-
-            const std::string rl_key = derive_rate_limit_key(req, request_id);
-            const std::string engine_json = engine.analyze_paths_json(request_id, temp_paths, rl_key);
-
-            // cleanup temp files
-            cleanup_temp_files();
+        prepared->rate_limit_key = derive_rate_limit_key(req, "req_" + request_id);
 
-            nlohmann::json ej = nlohmann::json::parse(engine_json, nullptr, false);
-            if (ej.is_discarded()) {
-                send_json(res, 500, request_id,
-                          make_error_json(request_id, "INTERNAL_ERROR", "Engine returned invalid JSON"));
-                finish_log(res.status);
-                return;
-            }
-
-            if (ej.contains("results") && ej["results"].is_array()) {
-                const auto& arr = ej["results"];
-                std::vector<bool> filled(final_res.results.size(), false);
-                std::size_t fallback_i = 0;
-
-                for (const auto& er : arr) {
-                    bool has_out_idx = false;
-                    std::size_t out_idx = 0;
-
-                    if (er.contains("path") && er["path"].is_string()) {
-                        const std::string p = er["path"].get<std::string>();
-                        const auto it = path_to_out_idx.find(p);
-                        if (it != path_to_out_idx.end()) {
-                            out_idx = it->second;
-                            has_out_idx = true;
-                        }
-                    }
-
-                    if (!has_out_idx) {
-                        while (fallback_i < valid_map.size() && filled[valid_map[fallback_i].idx]) {
-                            ++fallback_i;
-                        }
-                        if (fallback_i < valid_map.size()) {
-                            out_idx = valid_map[fallback_i].idx;
-                            has_out_idx = true;
-                            ++fallback_i;
-                        }
-                    }
-
-                    if (!has_out_idx) {
-                        continue;
-                    }
-
-                    filled[out_idx] = true;
-
-                    final_res.results[out_idx].ok = er.value("ok", false);
-                    final_res.results[out_idx].inference_mode = er.value("inference_mode", "");
-
-                    // damage_types
-                    final_res.results[out_idx].damage_types.clear();
-                    if (er.contains("damage_types") && er["damage_types"].is_array()) {
-                        for (const auto& dt : er["damage_types"]) {
-                            if (dt.is_string()) final_res.results[out_idx].damage_types.push_back(dt.get<std::string>());
-                        }
-                    }
-
-                    // TEMP: pricing logic (same as stub for now)
-                    if (final_res.results[out_idx].ok) {
-                        final_res.results[out_idx].cost_min = 500;
-                        final_res.results[out_idx].cost_max = 1500;
-                        final_res.results[out_idx].error.clear();
-                    } else {
-                        final_res.results[out_idx].error = er.value("error", "Engine failed to analyze image");
-                    }
-                }
-
-                // Mark any not-mapped images as failed instead of keeping placeholder state.
-                for (const auto& vm : valid_map) {
-                    if (!filled[vm.idx]) {
-                        final_res.results[vm.idx].ok = false;
-                        final_res.results[vm.idx].error = "Missing engine result for image";
-                    }
-                }
-            } else {
-                std::string engine_err = "Engine returned no results";
-                if (ej.contains("error")) {
-                    if (ej["error"].is_string()) {
-                        engine_err = ej["error"].get<std::string>();
-                    } else if (ej["error"].is_object() &&
-                               ej["error"].contains("message") &&
-                               ej["error"]["message"].is_string()) {
-                        engine_err = ej["error"]["message"].get<std::string>();
-                    }
-                }
-
-                for (const auto& vm : valid_map) {
-                    final_res.results[vm.idx].ok = false;
-                    final_res.results[vm.idx].error = engine_err;
-                }
-            }
-
-            // final ok if any image ok
-            final_res.ok = false;
-            for (const auto& r : final_res.results) {
-                if (r.ok) { final_res.ok = true; break; }
-            }
+        if (!prepared->async) {
+            run_analysis(engine, cache, *prepared, res);
+            return;
+        }
 
-            std::string body = final_res.to_json();
-            send_json(res, final_res.ok ? 200 : 422, request_id, body);
+        // Async: rejected uploads were already answered above without a job; only engine
+        // work is queued. The job belongs to the submitting client (keyed like the rate
+        // limit), and its id is unguessable and unrelated to the request id.
+        const std::string job_id = gen_job_id();
+        if (job_id.empty()) {
+            send_json(res, 500, request_id,
+                      make_error_json(request_id, "INTERNAL_ERROR", "Could not allocate a job id"));
             finish_log(res.status);
             return;
         }
-        catch (const EngineClientError& e) {
-            for (const auto& p : temp_paths) {
-                std::error_code rm_ec;
-                std::filesystem::remove(p, rm_ec);
-            }
-            int status = e.status_code();
-            if (status < 400 || status > 599) status = 502;
-            const std::string msg = extract_engine_error_message(e);
-            send_json(res, status, request_id,
-                      make_error_json(request_id, "ENGINE_ERROR", msg));
+        const bool queued = jobs.submit(job_id, derive_rate_limit_key(req, ""), [&engine, &cache, prepared]() {
+            httplib::Response job_res;
+            run_analysis(engine, cache, *prepared, job_res);
+            return JobResult{job_res.status, job_res.body};
+        });
+        if (!queued) {
+            res.set_header("Retry-After", "1");
+            send_json(res, 503, request_id,
+                      make_error_json(request_id, "QUEUE_FULL", "Analysis queue is full, retry shortly"));
             finish_log(res.status);
             return;
         }
-        catch (const std::exception& e) {
-            for (const auto& p : temp_paths) {
-                std::error_code rm_ec;
-                std::filesystem::remove(p, rm_ec);
-            }
-            std::cerr << "[REQ " << request_id << "] INTERNAL_ERROR: " << e.what() << "\n";
-            send_json(res, 500, request_id,
-                      make_error_json(request_id, "INTERNAL_ERROR", "Internal server error"));
-            finish_log(res.status);
+        const std::string status_url = "/api/property/jobs/" + job_id;
+        res.set_header("Location", status_url);
+        JsonWriter body;
+        body.begin_object()
+            .kv("ok", true)
+            .kv("request_id", request_id)
+            .kv("job_id", job_id)
+            .kv("status", "queued")
+            .kv("status_url", status_url)
+            .end_object();
+        send_json(res, 202, request_id, body.str());
+        finish_log(res.status);
+    });
+
+    // Polling is answered only to the client that submitted the job; to anyone else the
+    // job does not exist.
+    server.Get(R"(/api/property/jobs/([0-9a-f]{32}))", [&jobs](const httplib::Request& req, httplib::Response& res) {
+        const std::string job_id = req.matches[1];
+        const std::string request_id = gen_request_id();
+        JobSnapshot job;
+        if (!jobs.lookup(job_id, derive_rate_limit_key(req, ""), job)) {
+            send_json(res, 404, request_id, make_error_json(request_id, "JOB_NOT_FOUND", "Unknown or expired job"));
             return;
         }
-        catch (...) {
-            for (const auto& p : temp_paths) {
-                std::error_code rm_ec;
-                std::filesystem::remove(p, rm_ec);
-            }
-            send_json(res, 500, request_id,
-                      make_error_json(request_id, "INTERNAL_ERROR", "Unknown error"));
-            finish_log(res.status);
+        if (job.state == JobState::Done) {
+            // The same status and AnalyzeResponse body the synchronous call would have returned.
+            send_json(res, job.result.status, request_id, job.result.body);
             return;
         }
+        JsonWriter pending;
+        pending.begin_object()
+               .kv("ok", true)
+               .kv("request_id", request_id)
+               .kv("job_id", job_id)
+               .kv("status", job.state == JobState::Running ? "running" : "queued")
+               .end_object();
+        res.set_header("Retry-After", "1");
+        send_json(res, 200, request_id, pending.str());
     });
 }
@@ -1,5 +1,9 @@
 #include "routes/register_routes.h"
 #include "routes/analyze_route.h"
+#include "services/contact_log.h"
+#include "services/session_store.h"
+#include "utils/api_metrics.h"
+#include "utils/json.h"
 
 #include <algorithm>
 #include <chrono>
@@ -7,13 +11,12 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <filesystem>
-#include <fstream>
 #include <mutex>
 #include <random>
 #include <regex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "third_party/json.hpp"
@@ -21,23 +24,15 @@
 namespace {
 using nlohmann::json;
 
-struct ContactEntry {
-    std::string name;
-    std::string phone;
-    std::string message;
-    std::string registered_at;
-};
-
 std::mutex g_contact_mutex;
-std::vector<ContactEntry> g_contact_entries;
+std::deque<ContactEntry> g_contact_entries;
 constexpr std::size_t kMaxContactEntries = 1000;
+// Superseded records are dropped from the log file once it holds this many.
+constexpr std::size_t kContactCompactAfter = 2 * kMaxContactEntries;
 bool g_contact_loaded = false;
-std::unordered_map<std::string, long long> g_admin_sessions;
-bool g_admin_sessions_loaded = false;
 constexpr int kAdminSessionMaxAgeSec = 8 * 60 * 60;
 
 bool persist_contacts_locked();
-bool persist_admin_sessions_locked();
 
 std::string trim_copy(std::string s) {
     const auto not_space = [](unsigned char c) { return !std::isspace(c); };
@@ -66,11 +61,31 @@ std::string now_utc_iso8601() {
     return std::string(buf);
 }
 
-json make_contact_error(const std::string& message) {
-    return json{
-        {"ok", false},
-        {"error", {{"code", "INVALID_CONTACT"}, {"message", message}}}
-    };
+std::string make_error_body(const std::string& code, const std::string& message) {
+    JsonWriter w;
+    w.begin_object()
+     .kv("ok", false)
+     .key("error").begin_object()
+     .kv("code", code)
+     .kv("message", message)
+     .end_object()
+     .end_object();
+    return w.str();
+}
+
+std::string make_contact_error(const std::string& message) {
+    return make_error_body("INVALID_CONTACT", message);
+}
+
+constexpr const char* kOkBody = R"({"ok":true})";
+
+void write_contact(JsonWriter& w, const ContactEntry& e) {
+    w.begin_object()
+     .kv("name", e.name)
+     .kv("phone", e.phone)
+     .kv("message", e.message)
+     .kv("registered_at", e.registered_at)
+     .end_object();
 }
 
 std::string contact_db_path() {
@@ -180,52 +195,25 @@ std::string session_cookie_header(const std::string& session_id, int max_age_sec
     return v;
 }
 
-bool cleanup_expired_sessions_locked() {
-    const long long now = static_cast<long long>(std::time(nullptr));
-    std::vector<std::string> stale;
-    stale.reserve(g_admin_sessions.size());
-    for (const auto& kv : g_admin_sessions) {
-        if (kv.second <= now) stale.push_back(kv.first);
-    }
-    if (stale.empty()) return false;
-    for (const auto& id : stale) g_admin_sessions.erase(id);
-    return true;
+SessionStore& admin_sessions() {
+    static SessionStore store([] {
+        SessionStoreOptions options;
+        options.path = admin_sessions_db_path();
+        if (const char* env = std::getenv("BUILDCHECK_ADMIN_SESSION_FLUSH_MS"); env && *env) {
+            try {
+                options.flush_interval = std::chrono::milliseconds(std::clamp(std::stoi(env), 10, 60000));
+            } catch (...) {
+            }
+        }
+        return options;
+    }());
+    return store;
 }
 
 bool is_admin_session_valid(const httplib::Request& req) {
     const std::string session_id = cookie_value(req, "buildcheck_admin_session");
     if (session_id.empty()) return false;
-    std::lock_guard<std::mutex> lock(g_contact_mutex);
-    if (!g_admin_sessions_loaded) {
-        const std::string path = admin_sessions_db_path();
-        std::ifstream in(path, std::ios::binary);
-        if (in.is_open()) {
-            const std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-            json payload = json::parse(raw, nullptr, false);
-            if (!payload.is_discarded() && payload.is_object()) {
-                g_admin_sessions.clear();
-                for (auto it = payload.begin(); it != payload.end(); ++it) {
-                    if (it.value().is_number_integer()) {
-                        g_admin_sessions[it.key()] = it.value().get<long long>();
-                    }
-                }
-            }
-        }
-        g_admin_sessions_loaded = true;
-    }
-    const bool removed_any = cleanup_expired_sessions_locked();
-    if (removed_any) {
-        (void)persist_admin_sessions_locked();
-    }
-    auto it = g_admin_sessions.find(session_id);
-    if (it == g_admin_sessions.end()) return false;
-    const long long now = static_cast<long long>(std::time(nullptr));
-    if (it->second <= now) {
-        g_admin_sessions.erase(it);
-        (void)persist_admin_sessions_locked();
-        return false;
-    }
-    return true;
+    return admin_sessions().validate(session_id, static_cast<long long>(std::time(nullptr)));
 }
 
 bool is_admin_authorized(const httplib::Request& req) {
@@ -239,123 +227,23 @@ bool is_admin_authorized(const httplib::Request& req) {
     return false;
 }
 
+ContactLog& contact_log() {
+    static ContactLog log(contact_db_path(), kMaxContactEntries, kContactCompactAfter);
+    return log;
+}
+
 void load_contacts_if_needed_locked() {
     if (g_contact_loaded) return;
     g_contact_loaded = true;
-
-    const std::string path = contact_db_path();
-    std::ifstream in(path, std::ios::binary);
-    if (!in.is_open()) return;
-
-    std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-    json payload = json::parse(raw, nullptr, false);
-    if (payload.is_discarded() || !payload.is_array()) return;
-
-    g_contact_entries.clear();
-    for (const auto& item : payload) {
-        if (!item.is_object()) continue;
-        g_contact_entries.push_back(ContactEntry{
-            item.value("name", ""),
-            item.value("phone", ""),
-            item.value("message", ""),
-            item.value("registered_at", "")
-        });
-        if (g_contact_entries.size() >= kMaxContactEntries) break;
-    }
+    (void)contact_log().load(g_contact_entries);
 }
 
+// Appends the newest entry; every kContactCompactAfter inserts (or after a failed
+// append) the file is rewritten to the live entries instead.
 bool persist_contacts_locked() {
-    const std::string path = contact_db_path();
-    std::filesystem::path p(path);
-    std::error_code ec;
-    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path(), ec);
-
-    json out = json::array();
-    for (const auto& e : g_contact_entries) {
-        out.push_back({
-            {"name", e.name},
-            {"phone", e.phone},
-            {"message", e.message},
-            {"registered_at", e.registered_at}
-        });
-    }
-
-    const std::string tmp_path = path + ".tmp";
-    std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
-    if (!f.is_open()) return false;
-    const std::string dumped = out.dump();
-    f.write(dumped.data(), static_cast<std::streamsize>(dumped.size()));
-    if (!f.good()) {
-        f.close();
-        std::error_code rm_ec;
-        std::filesystem::remove(tmp_path, rm_ec);
-        return false;
-    }
-    f.flush();
-    if (!f.good()) {
-        f.close();
-        std::error_code rm_ec;
-        std::filesystem::remove(tmp_path, rm_ec);
-        return false;
-    }
-    f.close();
-    std::error_code mv_ec;
-    std::filesystem::rename(tmp_path, path, mv_ec);
-    if (mv_ec) {
-        std::filesystem::remove(path, mv_ec);
-        mv_ec.clear();
-        std::filesystem::rename(tmp_path, path, mv_ec);
-        if (mv_ec) {
-            std::error_code rm_ec;
-            std::filesystem::remove(tmp_path, rm_ec);
-            return false;
-        }
-    }
-    return true;
-}
-
-bool persist_admin_sessions_locked() {
-    const std::string path = admin_sessions_db_path();
-    std::filesystem::path p(path);
-    std::error_code ec;
-    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path(), ec);
-
-    json payload = json::object();
-    for (const auto& kv : g_admin_sessions) payload[kv.first] = kv.second;
-
-    const std::string tmp_path = path + ".tmp";
-    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
-    if (!out.is_open()) return false;
-    const std::string dumped = payload.dump();
-    out.write(dumped.data(), static_cast<std::streamsize>(dumped.size()));
-    if (!out.good()) {
-        out.close();
-        std::error_code rm_ec;
-        std::filesystem::remove(tmp_path, rm_ec);
-        return false;
-    }
-    out.flush();
-    if (!out.good()) {
-        out.close();
-        std::error_code rm_ec;
-        std::filesystem::remove(tmp_path, rm_ec);
-        return false;
-    }
-    out.close();
-
-    std::error_code mv_ec;
-    std::filesystem::rename(tmp_path, path, mv_ec);
-    if (mv_ec) {
-        std::filesystem::remove(path, mv_ec);
-        mv_ec.clear();
-        std::filesystem::rename(tmp_path, path, mv_ec);
-        if (mv_ec) {
-            std::error_code rm_ec;
-            std::filesystem::remove(tmp_path, rm_ec);
-            return false;
-        }
-    }
-    return true;
+    ContactLog& log = contact_log();
+    if (log.needs_compaction()) return log.compact(g_contact_entries);
+    return log.append(g_contact_entries.back());
 }
 
 bool validate_contact(const std::string& name,
@@ -421,15 +309,41 @@ void set_cors_admin(const httplib::Request& req,
 }
 } // namespace
 
-void register_routes(httplib::Server& server, const EngineClient& engine) {
+void register_routes(httplib::Server& server, const EngineClient& engine, ResultCache& cache, JobQueue& jobs,
+                     SpoolPool& spool) {
     {
         std::lock_guard<std::mutex> lock(g_contact_mutex);
         load_contacts_if_needed_locked();
     }
+    (void)admin_sessions();
 
-    server.Get("/health", [](const httplib::Request&, httplib::Response& res) {
+    server.Get("/health", [&cache, &jobs](const httplib::Request&, httplib::Response& res) {
         set_cors_public(res);
-        res.set_content(R"({"status":"ok","service":"BuildCheck API"})", "application/json");
+        const ResultCacheStats stats = cache.stats();
+        const JobQueueStats job_stats = jobs.stats();
+        JsonWriter w;
+        w.begin_object()
+         .kv("status", "ok")
+         .kv("service", "BuildCheck API")
+         .key("result_cache").begin_object()
+         .kv("enabled", cache.enabled())
+         .kv("entries", stats.entries)
+         .kv("memory_hits", stats.memory_hits)
+         .kv("disk_hits", stats.disk_hits)
+         .kv("misses", stats.misses)
+         .kv("stores", stats.stores)
+         .kv("evictions", stats.evictions)
+         .kv("expirations", stats.expirations)
+         .end_object()
+         .key("jobs").begin_object()
+         .kv("queued", job_stats.queued)
+         .kv("running", job_stats.running)
+         .kv("max_queue", jobs.max_queue())
+         .kv("completed", job_stats.completed)
+         .kv("rejected", job_stats.rejected)
+         .end_object()
+         .end_object();
+        res.set_content(w.view().data(), w.view().size(), "application/json");
     });
 
     server.Options("/api/contact", [](const httplib::Request&, httplib::Response& res) {
@@ -460,7 +374,7 @@ void register_routes(httplib::Server& server, const EngineClient& engine) {
         json payload = json::parse(req.body, nullptr, false);
         if (payload.is_discarded() || !payload.is_object()) {
             res.status = 400;
-            res.set_content(make_contact_error("Expected JSON body").dump(), "application/json");
+            res.set_content(make_contact_error("Expected JSON body"), "application/json");
             return;
         }
 
@@ -470,7 +384,7 @@ void register_routes(httplib::Server& server, const EngineClient& engine) {
         std::string error_msg;
         if (!validate_contact(name, phone, message, error_msg)) {
             res.status = 400;
-            res.set_content(make_contact_error(error_msg).dump(), "application/json");
+            res.set_content(make_contact_error(error_msg), "application/json");
             return;
         }
 
@@ -478,30 +392,22 @@ void register_routes(httplib::Server& server, const EngineClient& engine) {
         {
             std::lock_guard<std::mutex> lock(g_contact_mutex);
             load_contacts_if_needed_locked();
-            if (g_contact_entries.size() >= kMaxContactEntries) {
-                g_contact_entries.erase(g_contact_entries.begin());
-            }
             g_contact_entries.push_back(entry);
             if (!persist_contacts_locked()) {
+                g_contact_entries.pop_back();
                 res.status = 500;
-                res.set_content(json{{"ok", false}, {"error", {{"code", "PERSISTENCE_ERROR"}, {"message", "Failed to persist contact submission"}}}}.dump(), "application/json");
+                res.set_content(make_error_body("PERSISTENCE_ERROR", "Failed to persist contact submission"), "application/json");
                 return;
             }
+            if (g_contact_entries.size() > kMaxContactEntries) g_contact_entries.pop_front();
         }
 
         res.status = 201;
-        res.set_content(
-            json{
-                {"ok", true},
-                {"item", {
-                    {"name", entry.name},
-                    {"phone", entry.phone},
-                    {"message", entry.message},
-                    {"registered_at", entry.registered_at}
-                }}
-            }.dump(),
-            "application/json"
-        );
+        JsonWriter w;
+        w.begin_object().kv("ok", true).key("item");
+        write_contact(w, entry);
+        w.end_object();
+        res.set_content(w.view().data(), w.view().size(), "application/json");
     });
 
     server.Post("/api/admin/login", [](const httplib::Request& req, httplib::Response& res) {
@@ -511,14 +417,14 @@ void register_routes(httplib::Server& server, const EngineClient& engine) {
         const std::string pass = admin_password();
         if (user.empty() || pass.empty()) {
             res.status = 503;
-            res.set_content(json{{"ok", false}, {"error", {{"code", "ADMIN_NOT_CONFIGURED"}, {"message", "Admin username/password not configured"}}}}.dump(), "application/json");
+            res.set_content(make_error_body("ADMIN_NOT_CONFIGURED", "Admin username/password not configured"), "application/json");
             return;
         }
 
         json payload = json::parse(req.body, nullptr, false);
         if (payload.is_discarded() || !payload.is_object()) {
             res.status = 400;
-            res.set_content(json{{"ok", false}, {"error", {{"code", "BAD_REQUEST"}, {"message", "Expected JSON body"}}}}.dump(), "application/json");
+            res.set_content(make_error_body("BAD_REQUEST", "Expected JSON body"), "application/json");
             return;
         }
 
@@ -526,72 +432,80 @@ void register_routes(httplib::Server& server, const EngineClient& engine) {
         const std::string in_pass = trim_copy(payload.value("password", ""));
         if (!constant_time_equals(in_user, user) || !constant_time_equals(in_pass, pass)) {
             res.status = 401;
-            res.set_content(json{{"ok", false}, {"error", {{"code", "UNAUTHORIZED"}, {"message", "Invalid credentials"}}}}.dump(), "application/json");
+            res.set_content(make_error_body("UNAUTHORIZED", "Invalid credentials"), "application/json");
             return;
         }
 
         const std::string session_id = random_hex(24);
-        {
-            std::lock_guard<std::mutex> lock(g_contact_mutex);
-            cleanup_expired_sessions_locked();
-            const long long now = static_cast<long long>(std::time(nullptr));
-            g_admin_sessions[session_id] = now + kAdminSessionMaxAgeSec;
-            if (!persist_admin_sessions_locked()) {
-                g_admin_sessions.erase(session_id);
-                res.status = 500;
-                res.set_content(json{{"ok", false}, {"error", {{"code", "PERSISTENCE_ERROR"}, {"message", "Failed to persist admin session"}}}}.dump(), "application/json");
-                return;
-            }
-        }
+        const long long now = static_cast<long long>(std::time(nullptr));
+        admin_sessions().create(session_id, now + kAdminSessionMaxAgeSec);
 
         res.set_header("Set-Cookie", session_cookie_header(session_id, kAdminSessionMaxAgeSec, should_set_secure_cookie(req)));
-        res.set_content(json{{"ok", true}}.dump(), "application/json");
+        res.set_content(kOkBody, "application/json");
     });
 
     server.Post("/api/admin/logout", [](const httplib::Request& req, httplib::Response& res) {
         set_cors_admin(req, res, "POST, OPTIONS", "Content-Type");
         const std::string session_id = cookie_value(req, "buildcheck_admin_session");
-        if (!session_id.empty()) {
-            std::lock_guard<std::mutex> lock(g_contact_mutex);
-            g_admin_sessions.erase(session_id);
-            if (!persist_admin_sessions_locked()) {
-                res.status = 500;
-                res.set_content(json{{"ok", false}, {"error", {{"code", "PERSISTENCE_ERROR"}, {"message", "Failed to persist admin session state"}}}}.dump(), "application/json");
-                return;
-            }
-        }
+        if (!session_id.empty()) admin_sessions().revoke(session_id);
         res.set_header("Set-Cookie", session_cookie_header("", 0, should_set_secure_cookie(req)));
-        res.set_content(json{{"ok", true}}.dump(), "application/json");
+        res.set_content(kOkBody, "application/json");
     });
 
     server.Get("/api/admin/contact/submissions", [](const httplib::Request& req, httplib::Response& res) {
         set_cors_admin(req, res, "GET, OPTIONS", "Content-Type, X-Admin-Token");
         if ((admin_username().empty() || admin_password().empty()) && admin_token().empty()) {
             res.status = 503;
-            res.set_content(json{{"ok", false}, {"error", {{"code", "ADMIN_NOT_CONFIGURED"}, {"message", "Admin auth is not configured"}}}}.dump(), "application/json");
+            res.set_content(make_error_body("ADMIN_NOT_CONFIGURED", "Admin auth is not configured"), "application/json");
             return;
         }
         if (!is_admin_authorized(req)) {
             res.status = 401;
-            res.set_content(json{{"ok", false}, {"error", {{"code", "UNAUTHORIZED"}, {"message", "Unauthorized"}}}}.dump(), "application/json");
+            res.set_content(make_error_body("UNAUTHORIZED", "Unauthorized"), "application/json");
             return;
         }
 
-        json items = json::array();
+        JsonWriter w;
+        w.begin_object().kv("ok", true).key("items").begin_array();
         {
             std::lock_guard<std::mutex> lock(g_contact_mutex);
             load_contacts_if_needed_locked();
             for (auto it = g_contact_entries.rbegin(); it != g_contact_entries.rend(); ++it) {
-                items.push_back({
-                    {"name", it->name},
-                    {"phone", it->phone},
-                    {"message", it->message},
-                    {"registered_at", it->registered_at}
-                });
+                write_contact(w, *it);
             }
         }
-        res.set_content(json{{"ok", true}, {"items", items}}.dump(), "application/json");
+        w.end_array().end_object();
+        res.set_content(w.view().data(), w.view().size(), "application/json");
     });
 
-    register_analyze_route(server, engine);
+    register_analyze_route(server, engine, cache, jobs, spool);
+}
+
+// Prometheus scrape endpoint, on its own listener (BUILDCHECK_METRICS_PORT) rather than
+// the public API port: the figures describe traffic and capacity, not anything a client
+// should read.
+void register_metrics_route(httplib::Server& server, ResultCache& cache, JobQueue& jobs) {
+    // Request/phase metrics come from lock-free counters; cache and job figures are
+    // read from their own stats snapshots at scrape time.
+    server.Get("/metrics", [&cache, &jobs](const httplib::Request&, httplib::Response& res) {
+        PrometheusWriter out;
+        api_metrics().render(out);
+
+        const ResultCacheStats cs = cache.stats();
+        out.family("buildcheck_api_result_cache_hits_total", "counter", "Result cache hits by tier.");
+        out.sample("buildcheck_api_result_cache_hits_total", "tier=\"memory\"", cs.memory_hits);
+        out.sample("buildcheck_api_result_cache_hits_total", "tier=\"disk\"", cs.disk_hits);
+        out.family("buildcheck_api_result_cache_misses_total", "counter", "Result cache misses.");
+        out.sample("buildcheck_api_result_cache_misses_total", "", cs.misses);
+
+        const JobQueueStats js = jobs.stats();
+        out.family("buildcheck_api_jobs_queued", "gauge", "Async analyze jobs waiting for a worker.");
+        out.sample("buildcheck_api_jobs_queued", "", static_cast<std::uint64_t>(js.queued));
+        out.family("buildcheck_api_jobs_running", "gauge", "Async analyze jobs being processed.");
+        out.sample("buildcheck_api_jobs_running", "", static_cast<std::uint64_t>(js.running));
+        out.family("buildcheck_api_jobs_rejected_total", "counter", "Async analyze jobs refused with QUEUE_FULL.");
+        out.sample("buildcheck_api_jobs_rejected_total", "", js.rejected);
+
+        res.set_content(out.str(), kPrometheusContentType);
+    });
 }
@@ -0,0 +1,65 @@
+#include "services/concurrency_limiter.h"
+#include "utils/api_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ConcurrencyLimiter::Permit::release(Outcome outcome, std::size_t units) {
+    if (!limiter_) return;
+    ConcurrencyLimiter* limiter = limiter_;
+    limiter_ = nullptr;
+    limiter->on_release(outcome, units, Clock::now() - start_);
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(ConcurrencyLimitOptions options)
+    : options_(options), enabled_(options.initial_limit > 0) {
+    options_.min_limit = std::max<std::size_t>(1, options_.min_limit);
+    options_.max_limit = std::max(options_.min_limit, options_.max_limit);
+    options_.long_window = std::max<std::size_t>(1, options_.long_window);
+    limit_ = static_cast<double>(std::clamp(options_.initial_limit, options_.min_limit, options_.max_limit));
+    if (enabled_) api_metrics().engine_concurrency_limit.set(static_cast<std::int64_t>(limit_));
+}
+
+ConcurrencyLimiter::Permit ConcurrencyLimiter::try_acquire() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (enabled_ && static_cast<double>(in_flight_) >= std::floor(limit_)) return {};
+    ++in_flight_;
+    return Permit(this, Clock::now());
+}
+
+std::size_t ConcurrencyLimiter::limit() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return static_cast<std::size_t>(limit_);
+}
+
+std::size_t ConcurrencyLimiter::in_flight() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return in_flight_;
+}
+
+void ConcurrencyLimiter::on_release(Outcome outcome, std::size_t units, Clock::duration elapsed) {
+    std::lock_guard<std::mutex> lock(mu_);
+    const std::size_t in_flight = in_flight_--;
+    if (!enabled_ || outcome == Outcome::Ignored) return;
+
+    const double lo = static_cast<double>(options_.min_limit);
+    const double hi = static_cast<double>(options_.max_limit);
+    if (outcome == Outcome::Dropped) {
+        limit_ = std::clamp(limit_ * options_.backoff, lo, hi);
+    } else {
+        const double rtt = std::chrono::duration<double>(elapsed).count() / static_cast<double>(std::max<std::size_t>(1, units));
+        if (samples_ < options_.long_window) ++samples_;
+        baseline_ += (rtt - baseline_) / static_cast<double>(samples_);
+        // A baseline well above the current latency is stale (the engine recovered or
+        // warmed up): let it decay faster than the window would.
+        if (baseline_ > 2.0 * rtt) baseline_ = 0.95 * baseline_ + 0.05 * rtt;
+
+        // Calls that finished with the limit mostly unused say nothing about headroom.
+        if (static_cast<double>(in_flight) < limit_ / 2.0) return;
+
+        const double gradient = rtt > 0.0 ? std::clamp(options_.tolerance * baseline_ / rtt, 0.5, 1.0) : 1.0;
+        const double estimate = limit_ * gradient + std::sqrt(limit_);
+        limit_ = std::clamp(limit_ * (1.0 - options_.smoothing) + estimate * options_.smoothing, lo, hi);
+    }
+    api_metrics().engine_concurrency_limit.set(static_cast<std::int64_t>(limit_));
+}
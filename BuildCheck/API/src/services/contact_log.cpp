@@ -0,0 +1,237 @@
+#include "services/contact_log.h"
+#include "utils/content_hash.h"
+#include "third_party/json.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using nlohmann::json;
+
+namespace {
+
+constexpr std::size_t kChecksumHexLen = 16;
+
+std::string checksum_hex(const std::string& data) {
+    static const char* hex = "0123456789abcdef";
+    const std::uint64_t h = xxh64(data.data(), data.size());
+    std::string out(kChecksumHexLen, '0');
+    for (std::size_t i = 0; i < kChecksumHexLen; ++i) out[kChecksumHexLen - 1 - i] = hex[(h >> (i * 4)) & 0xF];
+    return out;
+}
+
+json to_json(const ContactEntry& e) {
+    return json{
+        {"name", e.name},
+        {"phone", e.phone},
+        {"message", e.message},
+        {"registered_at", e.registered_at}
+    };
+}
+
+ContactEntry from_json(const json& item) {
+    return ContactEntry{
+        item.value("name", ""),
+        item.value("phone", ""),
+        item.value("message", ""),
+        item.value("registered_at", "")
+    };
+}
+
+std::string encode_record(const ContactEntry& e) {
+    const std::string body = to_json(e).dump();
+    std::string line;
+    line.reserve(kChecksumHexLen + 1 + body.size() + 1);
+    line += checksum_hex(body);
+    line += '\t';
+    line += body;
+    line += '\n';
+    return line;
+}
+
+// One line without its '\n'. False when the checksum or JSON does not hold up.
+bool decode_record(const std::string& line, ContactEntry& out) {
+    if (line.size() <= kChecksumHexLen + 1 || line[kChecksumHexLen] != '\t') return false;
+    const std::string body = line.substr(kChecksumHexLen + 1);
+    if (line.compare(0, kChecksumHexLen, checksum_hex(body)) != 0) return false;
+    const json item = json::parse(body, nullptr, false);
+    if (item.is_discarded() || !item.is_object()) return false;
+    out = from_json(item);
+    return true;
+}
+
+// Forces `path` (a file or a directory) to stable storage. A no-op on Windows, where
+// compaction then only survives a process crash, not a power loss.
+bool sync_path(const std::string& path) {
+#if defined(_WIN32)
+    (void)path;
+    return true;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+void push_bounded(std::deque<ContactEntry>& out, ContactEntry entry, std::size_t max_entries) {
+    out.push_back(std::move(entry));
+    while (out.size() > max_entries) out.pop_front();
+}
+
+} // namespace
+
+ContactLog::ContactLog(std::string path, std::size_t max_entries, std::size_t compact_after)
+    : path_(std::move(path)), max_entries_(max_entries), compact_after_(std::max(compact_after, max_entries)) {}
+
+ContactLogLoadStats ContactLog::load(std::deque<ContactEntry>& out) {
+    ContactLogLoadStats stats;
+    out.clear();
+    on_disk_ = 0;
+
+    // A crash during compaction leaves the .tmp behind with the original intact; only
+    // when the original is gone (the Windows replace below failed half-way) is the .tmp,
+    // which was complete and synced before anything was removed, the one to keep.
+    const std::string tmp_path = path_ + ".tmp";
+    std::error_code fs_ec;
+    if (std::filesystem::exists(tmp_path, fs_ec)) {
+        if (!std::filesystem::exists(path_, fs_ec)) {
+            std::filesystem::rename(tmp_path, path_, fs_ec);
+            std::cerr << "[CONTACT] promoted " << tmp_path << " left by an interrupted compaction\n";
+        } else {
+            std::filesystem::remove(tmp_path, fs_ec);
+        }
+    }
+
+    std::ifstream in(path_, std::ios::binary);
+    if (!in.is_open()) return stats;
+    const std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    const std::size_t first = raw.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && raw[first] == '[') {
+        // Pre-log format: one JSON array rewritten on every insert.
+        const json payload = json::parse(raw, nullptr, false);
+        if (!payload.is_discarded() && payload.is_array()) {
+            for (const auto& item : payload) {
+                if (!item.is_object()) continue;
+                push_bounded(out, from_json(item), max_entries_);
+                ++stats.records;
+            }
+        }
+        stats.migrated_legacy = true;
+    } else {
+        std::size_t start = 0;
+        while (start < raw.size()) {
+            const std::size_t end = raw.find('\n', start);
+            if (end == std::string::npos) {
+                stats.torn_tail = true;
+                break;
+            }
+            ContactEntry entry;
+            if (decode_record(raw.substr(start, end - start), entry)) {
+                push_bounded(out, std::move(entry), max_entries_);
+                ++stats.records;
+            } else {
+                ++stats.dropped;
+            }
+            start = end + 1;
+        }
+        on_disk_ = stats.records;
+    }
+
+    if (stats.migrated_legacy || stats.torn_tail || stats.dropped > 0) {
+        std::cerr << "[CONTACT] recovering " << path_ << ": records=" << stats.records
+                  << " dropped=" << stats.dropped << " torn_tail=" << (stats.torn_tail ? 1 : 0)
+                  << " legacy=" << (stats.migrated_legacy ? 1 : 0) << "\n";
+        if (!compact(out)) {
+            // Appending after a torn line would glue the next record onto it.
+            needs_rewrite_ = true;
+        }
+    }
+    return stats;
+}
+
+bool ContactLog::open_for_append() {
+    if (out_.is_open()) return true;
+    std::filesystem::path p(path_);
+    std::error_code ec;
+    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path(), ec);
+    out_.clear();
+    out_.open(path_, std::ios::binary | std::ios::app);
+    return out_.is_open();
+}
+
+bool ContactLog::append(const ContactEntry& entry) {
+    if (!open_for_append()) return false;
+    const std::string line = encode_record(entry);
+    out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+    out_.flush();
+    if (!out_.good()) {
+        out_.close();
+        needs_rewrite_ = true;
+        return false;
+    }
+    ++on_disk_;
+    return true;
+}
+
+bool ContactLog::compact(const std::deque<ContactEntry>& live) {
+    if (out_.is_open()) out_.close();
+
+    std::filesystem::path p(path_);
+    std::error_code ec;
+    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path(), ec);
+
+    const std::string tmp_path = path_ + ".tmp";
+    std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) return false;
+    for (const auto& e : live) {
+        const std::string line = encode_record(e);
+        f.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+    f.flush();
+    if (!f.good()) {
+        f.close();
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp_path, rm_ec);
+        return false;
+    }
+    f.close();
+    // The rename must not reach the disk before the data does, or a power loss could
+    // leave an empty log in place of the old one.
+    if (!sync_path(tmp_path)) {
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp_path, rm_ec);
+        return false;
+    }
+
+    std::error_code mv_ec;
+    std::filesystem::rename(tmp_path, path_, mv_ec);
+#if defined(_WIN32)
+    if (mv_ec) {
+        // Replacing a file another process holds open can fail here.
+        std::filesystem::remove(path_, mv_ec);
+        mv_ec.clear();
+        std::filesystem::rename(tmp_path, path_, mv_ec);
+        if (mv_ec && !std::filesystem::exists(path_, ec)) return false;   // keep the .tmp for load()
+    }
+#endif
+    if (mv_ec) {
+        // POSIX rename replaces atomically; when it fails the old log is still whole.
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp_path, rm_ec);
+        return false;
+    }
+    sync_path(p.parent_path().empty() ? "." : p.parent_path().string());   // the rename itself
+    on_disk_ = live.size();
+    needs_rewrite_ = false;
+    return open_for_append();
+}
@@ -0,0 +1,316 @@
+#include "services/engine_balancer.h"
+#include "utils/api_metrics.h"
+#include "utils/httplib.h"
+#include "third_party/json.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+struct EngineBalancer::Endpoint {
+    Endpoint(const EngineEndpoint& address, const EnginePoolOptions& pool_options)
+        : name(address.host + ":" + std::to_string(address.port)), host(address.host), port(address.port),
+          pool(address.host, address.port, pool_options) {}
+
+    std::string name;
+    std::string host;
+    int port;
+    EngineConnectionPool pool;
+
+    std::size_t outstanding = 0;
+    std::size_t call_failures = 0;    // consecutive failed calls
+    std::size_t check_failures = 0;   // consecutive failed health checks
+    std::size_t ejections = 0;        // consecutive ejections, for the backoff
+    bool ejected = false;
+    Clock::time_point ejected_until{};
+    Clock::time_point restored_at{};   // slow start origin; epoch = never ejected
+
+    // From the last health check that answered 200.
+    bool reported = false;
+    std::string fingerprint;
+    std::vector<std::string> protocols;
+};
+
+namespace {
+
+std::minstd_rand& rng() {
+    thread_local std::minstd_rand r(std::random_device{}());
+    return r;
+}
+
+struct HealthAnswer {
+    std::string fingerprint;   // empty when model_version or conf is missing
+    std::vector<std::string> protocols;
+};
+
+HealthAnswer parse_health(const std::string& body) {
+    HealthAnswer out;
+    const nlohmann::json health = nlohmann::json::parse(body, nullptr, false);
+    if (health.is_discarded() || !health.is_object()) return out;
+    const auto version = health.find("model_version");
+    const auto conf = health.find("conf");
+    if (version != health.end() && version->is_string() && conf != health.end() && conf->is_number()) {
+        out.fingerprint = version->get<std::string>() + "|conf=" + conf->dump();
+    }
+    const auto protocols = health.find("protocols");
+    if (protocols != health.end() && protocols->is_array()) {
+        for (const auto& p : *protocols) {
+            if (p.is_string()) out.protocols.push_back(p.get<std::string>());
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+std::vector<EngineEndpoint> parse_engine_endpoints(const std::string& list, int default_port) {
+    std::vector<EngineEndpoint> out;
+    std::size_t pos = 0;
+    while (pos <= list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(pos, end - pos);
+        pos = end + 1;
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (item.empty()) continue;
+
+        EngineEndpoint ep;
+        ep.port = default_port;
+        const std::size_t colon = item.rfind(':');
+        if (colon == std::string::npos) {
+            ep.host = item;
+        } else {
+            ep.host = item.substr(0, colon);
+            try {
+                ep.port = std::stoi(item.substr(colon + 1));
+            } catch (...) {
+                std::cerr << "[ENGINE] ignoring endpoint '" << item << "': bad port\n";
+                continue;
+            }
+        }
+        if (ep.host.empty() || ep.port <= 0 || ep.port > 65535) {
+            std::cerr << "[ENGINE] ignoring endpoint '" << item << "'\n";
+            continue;
+        }
+        out.push_back(std::move(ep));
+    }
+    return out;
+}
+
+EngineBalancer::Pick::~Pick() {
+    if (!endpoint_) return;
+    std::lock_guard<std::mutex> lock(balancer_->mu_);
+    --endpoint_->outstanding;
+}
+
+EngineConnectionPool& EngineBalancer::Pick::pool() {
+    return endpoint_->pool;
+}
+
+const std::string& EngineBalancer::Pick::name() const {
+    return endpoint_->name;
+}
+
+void EngineBalancer::Pick::succeeded() {
+    balancer_->record(*endpoint_, true, Signal::call);
+}
+
+void EngineBalancer::Pick::failed() {
+    balancer_->record(*endpoint_, false, Signal::call);
+}
+
+EngineBalancer::EngineBalancer(const std::vector<EngineEndpoint>& endpoints, const EnginePoolOptions& pool_options,
+                               EngineBalancerOptions options)
+    : options_(options) {
+    options_.eject_after_failures = std::max<std::size_t>(1, options_.eject_after_failures);
+    options_.health_interval_ms = std::max(100, options_.health_interval_ms);
+    options_.health_timeout_ms = std::max(1, options_.health_timeout_ms);
+    for (const auto& ep : endpoints) endpoints_.push_back(std::make_unique<Endpoint>(ep, pool_options));
+    if (endpoints_.empty()) endpoints_.push_back(std::make_unique<Endpoint>(EngineEndpoint{"127.0.0.1", 9090}, pool_options));
+    api_metrics().engine_endpoints_available.set(static_cast<std::int64_t>(endpoints_.size()));
+
+    checker_ = std::thread([this] { health_loop(); });
+}
+
+EngineBalancer::~EngineBalancer() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (checker_.joinable()) checker_.join();
+}
+
+double EngineBalancer::weight_locked(const Endpoint& endpoint, Clock::time_point now) const {
+    if (options_.slow_start_ms <= 0 || endpoint.restored_at == Clock::time_point{}) return 1.0;
+    const double ramp = std::chrono::duration<double, std::milli>(now - endpoint.restored_at).count() /
+                        options_.slow_start_ms;
+    return std::clamp(ramp, 0.1, 1.0);
+}
+
+EngineBalancer::Pick EngineBalancer::pick(const Pick* avoid) {
+    const Endpoint* skip = avoid ? avoid->endpoint_ : nullptr;
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto now = Clock::now();
+
+    Endpoint* candidates[2] = {nullptr, nullptr};
+    std::size_t seen = 0;
+    // Endpoints in service other than `skip` first, then `skip` too, then any endpoint
+    // (panic routing). Reservoir sampling keeps the pair uniformly random in one sweep.
+    for (int pass = 0; pass < 3 && seen == 0; ++pass) {
+        for (const auto& ep : endpoints_) {
+            if (pass < 2 && ep->ejected) continue;
+            if (pass != 1 && ep.get() == skip) continue;
+            ++seen;
+            if (seen <= 2) {
+                candidates[seen - 1] = ep.get();
+            } else {
+                const std::size_t slot = std::uniform_int_distribution<std::size_t>(0, seen - 1)(rng());
+                if (slot < 2) candidates[slot] = ep.get();
+            }
+        }
+    }
+    if (seen == 0) candidates[0] = endpoints_.front().get();   // a single endpoint that is `skip`
+
+    Endpoint* chosen = candidates[0];
+    if (seen >= 2) {
+        const double a = static_cast<double>(candidates[0]->outstanding + 1) / weight_locked(*candidates[0], now);
+        const double b = static_cast<double>(candidates[1]->outstanding + 1) / weight_locked(*candidates[1], now);
+        if (b < a || (b == a && (rng()() & 1))) chosen = candidates[1];
+    }
+    ++chosen->outstanding;
+    return Pick(this, chosen);
+}
+
+EngineBalancer::Clock::duration EngineBalancer::ejection_for(const Endpoint& endpoint) const {
+    const int factor = std::min(10, 1 << std::min<std::size_t>(endpoint.ejections, 4));
+    return std::chrono::milliseconds(options_.eject_ms) * factor;
+}
+
+void EngineBalancer::record(Endpoint& endpoint, bool ok, Signal signal) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (endpoint.ejected) return;   // the health checker decides when it comes back
+    std::size_t& failures = signal == Signal::call ? endpoint.call_failures : endpoint.check_failures;
+    if (ok) {
+        failures = 0;
+        if (options_.slow_start_ms <= 0 ||
+            Clock::now() - endpoint.restored_at >= std::chrono::milliseconds(options_.slow_start_ms)) {
+            endpoint.ejections = 0;
+        }
+        return;
+    }
+    if (++failures < options_.eject_after_failures || endpoints_.size() < 2) return;
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(ejection_for(endpoint));
+    endpoint.ejected = true;
+    endpoint.ejected_until = Clock::now() + duration;
+    endpoint.call_failures = 0;
+    endpoint.check_failures = 0;
+    ++endpoint.ejections;
+    api_metrics().engine_ejections.inc();
+    api_metrics().engine_endpoints_available.sub();
+    std::cerr << "[ENGINE] " << endpoint.name << " ejected for " << duration.count() << "ms after "
+              << options_.eject_after_failures << " failed " << (signal == Signal::call ? "calls" : "health checks")
+              << "\n";
+}
+
+std::string EngineBalancer::model_fingerprint() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    const std::string* common = nullptr;
+    for (const auto& ep : endpoints_) {
+        if (ep->ejected || !ep->reported) continue;
+        if (ep->fingerprint.empty() || (common && *common != ep->fingerprint)) return {};
+        common = &ep->fingerprint;
+    }
+    return common ? *common : std::string();
+}
+
+bool EngineBalancer::all_list_protocol(const std::string& protocol) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    bool any = false;
+    for (const auto& ep : endpoints_) {
+        if (ep->ejected || !ep->reported) continue;
+        if (std::find(ep->protocols.begin(), ep->protocols.end(), protocol) == ep->protocols.end()) return false;
+        any = true;
+    }
+    return any;
+}
+
+std::uint64_t EngineBalancer::health_rounds() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return health_rounds_;
+}
+
+bool EngineBalancer::await_health(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mu_);
+    return cv_.wait_for(lock, timeout, [this] { return health_rounds_ > 0 || stopping_; }) && health_rounds_ > 0;
+}
+
+void EngineBalancer::health_loop() {
+    std::vector<std::unique_ptr<httplib::Client>> clients;
+    for (const auto& ep : endpoints_) {
+        auto cli = std::make_unique<httplib::Client>(ep->host, ep->port);
+        cli->set_keep_alive(true);
+        cli->set_connection_timeout(std::chrono::milliseconds(options_.health_timeout_ms));
+        cli->set_read_timeout(std::chrono::milliseconds(options_.health_timeout_ms));
+        cli->set_write_timeout(std::chrono::milliseconds(options_.health_timeout_ms));
+        clients.push_back(std::move(cli));
+    }
+
+    std::unique_lock<std::mutex> lock(mu_);
+    std::string last_fingerprint;
+    // The first round runs straight away: EngineClient waits for it at startup.
+    while (!stopping_) {
+        for (std::size_t i = 0; i < endpoints_.size() && !stopping_; ++i) {
+            Endpoint& ep = *endpoints_[i];
+            if (ep.ejected && Clock::now() < ep.ejected_until) continue;   // its answer would be ignored
+            lock.unlock();
+            const auto r = clients[i]->Get("/engine/health");
+            const bool ok = r && r->status == 200;
+            HealthAnswer answer;
+            if (ok) answer = parse_health(r->body);
+            lock.lock();
+
+            if (ok) {
+                ep.reported = true;
+                ep.fingerprint = std::move(answer.fingerprint);
+                ep.protocols = std::move(answer.protocols);
+            }
+            if (!ep.ejected) {
+                lock.unlock();
+                record(ep, ok, Signal::check);
+                lock.lock();
+                continue;
+            }
+            const auto now = Clock::now();
+            if (now < ep.ejected_until) continue;   // ejected by calls while this check was out
+            if (ok) {
+                ep.ejected = false;
+                ep.restored_at = now;
+                api_metrics().engine_endpoints_available.add();
+                std::cerr << "[ENGINE] " << ep.name << " healthy again";
+                if (options_.slow_start_ms > 0) std::cerr << ", slow start over " << options_.slow_start_ms << "ms";
+                std::cerr << "\n";
+            } else {
+                ep.ejected_until = now + ejection_for(ep);
+                ++ep.ejections;
+            }
+        }
+        ++health_rounds_;
+        cv_.notify_all();
+
+        lock.unlock();
+        const std::string fingerprint = model_fingerprint();
+        lock.lock();
+        if (fingerprint != last_fingerprint) {
+            if (fingerprint.empty()) {
+                std::cerr << "[ENGINE] endpoints in service report no common model; result caching paused\n";
+            } else {
+                std::cerr << "[ENGINE] endpoints in service report model " << fingerprint << "\n";
+            }
+            last_fingerprint = fingerprint;
+        }
+        cv_.wait_for(lock, std::chrono::milliseconds(options_.health_interval_ms), [this] { return stopping_; });
+    }
+}
@@ -1,20 +1,110 @@
 #include "services/engine_client.h"
+#include "utils/api_metrics.h"
+#include "utils/engine_frame.h"
 #include "utils/httplib.h"
 #include "third_party/json.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <optional>
 #include <stdexcept>
 using nlohmann::json;
+
+EngineClient::EngineClient(const std::vector<EngineEndpoint>& endpoints, std::string api_key,
+                           EnginePoolOptions pool_options, EngineProtocol protocol,
+                           ConcurrencyLimitOptions limit_options, EngineBalancerOptions balancer_options)
+    : api_key_(std::move(api_key)), protocol_(protocol),
+      balancer_(std::make_shared<EngineBalancer>(endpoints, pool_options, balancer_options)),
+      limiter_(std::make_shared<ConcurrencyLimiter>(limit_options)),
+      frame_refused_round_(std::make_shared<std::atomic<std::uint64_t>>(UINT64_MAX)) {}
+
+EngineProtocol parse_engine_protocol(const std::string& value) {
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (v == "json") return EngineProtocol::Json;
+    if (v == "frame") return EngineProtocol::Frame;
+    return EngineProtocol::Auto;
+}
+
+const char* engine_protocol_name(EngineProtocol protocol) {
+    switch (protocol) {
+        case EngineProtocol::Json: return "json";
+        case EngineProtocol::Frame: return "frame";
+        default: return "auto";
+    }
+}
+
 std::string EngineClient::analyze_paths_json(const std::string& request_id,
                                              const std::vector<std::string>& image_paths,
                                              const std::string& rate_limit_key) const {
-    httplib::Client cli(host_, port_);
-    cli.set_connection_timeout(5, 0);
-    cli.set_write_timeout(20, 0);
-    cli.set_read_timeout(60, 0);
-
     json payload;
     payload["request_id"] = request_id;
     payload["paths"] = image_paths;
+    return post_analyze("/engine/analyze", payload.dump(), "application/json", rate_limit_key,
+                        image_paths.size(), {});
+}
+
+std::string EngineClient::analyze_shm_json(const std::string& request_id,
+                                           const std::vector<EngineShmImage>& images,
+                                           const std::string& rate_limit_key) const {
+    return analyze_json(request_id, {}, images, rate_limit_key);
+}
+
+std::string EngineClient::analyze_json(const std::string& request_id,
+                                       const std::vector<std::string>& image_paths,
+                                       const std::vector<EngineShmImage>& images,
+                                       const std::string& rate_limit_key,
+                                       const EngineBudget& budget) const {
+    json payload;
+    payload["request_id"] = request_id;
+    if (!image_paths.empty()) payload["paths"] = image_paths;
+    payload["shm"] = json::array();
+    for (const auto& img : images) {
+        payload["shm"].push_back({{"name", img.name}, {"size", img.size}});
+    }
+    return post_analyze("/engine/analyze", payload.dump(), "application/json", rate_limit_key,
+                        image_paths.size() + images.size(), budget);
+}
+
+bool EngineClient::analyze(const std::string& request_id,
+                           const std::vector<std::string>& image_paths,
+                           const std::vector<EngineShmImage>& images,
+                           const std::string& rate_limit_key,
+                           ParsedEngineResponse& out,
+                           const EngineBudget& budget) const {
+    if (negotiated_protocol() == EngineProtocol::Frame) {
+        FrameAnalyzeRequest req;
+        req.request_id = request_id;
+        req.paths = image_paths;
+        req.shm.reserve(images.size());
+        for (const auto& img : images) req.shm.push_back({img.name, img.size});
+        try {
+            const std::string body = post_analyze(kEngineFramePath, encode_frame_request(req),
+                                                  kEngineFrameContentType, rate_limit_key,
+                                                  image_paths.size() + images.size(), budget);
+            return parse_engine_frame(body, out);
+        } catch (const EngineClientError& e) {
+            if (protocol_ != EngineProtocol::Auto || (e.status_code() != 404 && e.status_code() != 415)) throw;
+            const std::uint64_t round = balancer_->health_rounds();
+            if (frame_refused_round_->exchange(round) != round) {
+                std::cerr << "[ENGINE] " << kEngineFramePath << " answered " << e.status_code()
+                          << "; using JSON until the next health check\n";
+            }
+        }
+    }
+    return parse_engine_response(analyze_json(request_id, image_paths, images, rate_limit_key, budget), out);
+}
+
+std::string EngineClient::post_analyze(const char* path, const std::string& body, const char* content_type,
+                                       const std::string& rate_limit_key, std::size_t images,
+                                       const EngineBudget& budget) const {
+    ApiMetrics& metrics = api_metrics();
+    auto permit = limiter_->try_acquire();
+    if (!permit) {
+        metrics.count_engine_error(EngineErrorKind::Overloaded);
+        throw EngineClientError("ENGINE_OVERLOADED", 503);
+    }
 
     httplib::Headers headers;
     if (!api_key_.empty()) {
@@ -23,14 +113,90 @@ std::string EngineClient::analyze_paths_json(const std::string& request_id,
     if (!rate_limit_key.empty()) {
         headers.emplace("X-RateLimit-Key", rate_limit_key);
     }
+    if (budget.budget.count() > 0) {
+        headers.emplace(kRequestTimeoutHeader, std::to_string(budget.budget.count()));
+    }
 
-    auto r = cli.Post("/engine/analyze", headers, payload.dump(), "application/json");
-    if (!r) throw EngineClientError("ENGINE_UNREACHABLE", 503);
-    if (r->status != 200) {
-        throw EngineClientError("ENGINE_BAD_STATUS", r->status, r->body);
+    const GaugeGuard in_flight(metrics.engine_calls_in_flight);
+    const auto t0 = std::chrono::steady_clock::now();
+    struct ObserveOnExit {
+        LatencyHistogram& h;
+        std::chrono::steady_clock::time_point t0;
+        ~ObserveOnExit() { h.observe(std::chrono::steady_clock::now() - t0); }
+    } observe{metrics.engine_call_duration, t0};
+
+    std::optional<EngineBalancer::Pick> refused;
+    for (;;) {
+        EngineBalancer::Pick pick = balancer_->pick(refused ? &*refused : nullptr);
+        auto lease = [&] {
+            try {
+                return pick.pool().acquire();
+            } catch (const EngineClientError&) {
+                permit.dropped();
+                throw;
+            }
+        }();
+        // Pooled clients are shared between calls, so the read timeout is set on every one.
+        auto read_timeout = std::chrono::milliseconds(pick.pool().options().read_timeout_ms);
+        if (budget.budget.count() > 0) read_timeout = std::min(read_timeout, budget.budget + budget.grace);
+        lease.client().set_read_timeout(read_timeout);
+        auto r = lease.client().Post(path, headers, body, content_type);
+        if (!r && lease.reused() && r.error() == httplib::Error::Write) {
+            // The engine dropped the kept-alive socket before the request went out: retry once fresh.
+            lease.reconnect();
+            lease.client().set_read_timeout(read_timeout);
+            r = lease.client().Post(path, headers, body, content_type);
+        }
+        if (!r && r.error() == httplib::Error::Read && budget.budget.count() > 0 &&
+            std::chrono::steady_clock::now() - t0 >= read_timeout) {
+            // Out of time: the engine may be fine, the request was just too slow to finish.
+            lease.discard();
+            permit.dropped();
+            metrics.count_engine_error(EngineErrorKind::DeadlineExceeded);
+            throw EngineClientError("ENGINE_DEADLINE_EXCEEDED", 504);
+        }
+        if (!r) {
+            lease.discard();
+            pick.failed();
+            if (r.error() == httplib::Error::Connection && !refused && balancer_->size() > 1) {
+                // The connection was refused, so the request never ran: another endpoint can take it.
+                refused.emplace(std::move(pick));
+                continue;
+            }
+            permit.dropped();
+            metrics.count_engine_error(EngineErrorKind::Unreachable);
+            throw EngineClientError("ENGINE_UNREACHABLE", 503);
+        }
+        if (r->status != 200) {
+            // 5xx means the engine is struggling; a 4xx is about the request and leaves the limit alone.
+            if (r->status >= 500) {
+                permit.dropped();
+                pick.failed();
+            } else {
+                pick.succeeded();
+            }
+            metrics.count_engine_error(EngineErrorKind::BadStatus);
+            throw EngineClientError("ENGINE_BAD_STATUS", r->status, r->body);
+        }
+
+        pick.succeeded();
+        permit.success(images);
+        return r->body;
     }
+}
+
 
-    return r->body;
+
+std::string EngineClient::model_fingerprint() const {
+    return balancer_->model_fingerprint();
 }
 
+EngineProtocol EngineClient::negotiated_protocol() const {
+    if (protocol_ != EngineProtocol::Auto) return protocol_;
+    if (frame_refused_round_->load(std::memory_order_relaxed) == balancer_->health_rounds()) return EngineProtocol::Json;
+    return balancer_->all_list_protocol(kEngineFrameProtocol) ? EngineProtocol::Frame : EngineProtocol::Json;
+}
 
+bool EngineClient::await_health(std::chrono::milliseconds timeout) const {
+    return balancer_->await_health(timeout);
+}
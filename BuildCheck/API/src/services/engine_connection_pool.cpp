@@ -0,0 +1,113 @@
+#include "services/engine_connection_pool.h"
+#include "services/engine_client.h"
+#include "utils/api_metrics.h"
+#include "utils/httplib.h"
+
+#include <utility>
+#include <vector>
+
+EngineConnectionPool::Lease::Lease(EngineConnectionPool* pool, std::unique_ptr<httplib::Client> client, bool reused)
+    : pool_(pool), client_(std::move(client)), reused_(reused) {}
+
+EngineConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), client_(std::move(other.client_)),
+      reused_(other.reused_), reusable_(other.reusable_) {
+    other.pool_ = nullptr;
+}
+
+EngineConnectionPool::Lease::~Lease() {
+    if (pool_ && client_) pool_->release(std::move(client_), reusable_);
+}
+
+void EngineConnectionPool::Lease::reconnect() {
+    client_ = pool_->make_client();
+    reused_ = false;
+    reusable_ = true;
+}
+
+EngineConnectionPool::EngineConnectionPool(std::string host, int port, EnginePoolOptions options)
+    : host_(std::move(host)), port_(port), options_(options) {
+    if (options_.max_size == 0) options_.max_size = 1;
+}
+
+EngineConnectionPool::~EngineConnectionPool() = default;
+
+std::unique_ptr<httplib::Client> EngineConnectionPool::make_client() const {
+    auto cli = std::make_unique<httplib::Client>(host_, port_);
+    cli->set_keep_alive(true);
+    cli->set_tcp_nodelay(true);
+    cli->set_connection_timeout(std::chrono::milliseconds(options_.connect_timeout_ms));
+    cli->set_write_timeout(std::chrono::milliseconds(options_.write_timeout_ms));
+    cli->set_read_timeout(std::chrono::milliseconds(options_.read_timeout_ms));
+    return cli;
+}
+
+bool EngineConnectionPool::probe(httplib::Client& client) const {
+    auto r = client.Get("/engine/health");
+    return r && r->status == 200;
+}
+
+EngineConnectionPool::Lease EngineConnectionPool::acquire() {
+    std::vector<std::unique_ptr<httplib::Client>> evicted;
+    std::unique_ptr<httplib::Client> client;
+    Clock::time_point last_used{};
+    bool reused = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto deadline = Clock::now() + std::chrono::milliseconds(options_.acquire_timeout_ms);
+        for (;;) {
+            const auto now = Clock::now();
+            const auto idle_limit = std::chrono::milliseconds(options_.idle_timeout_ms);
+            while (!idle_.empty() && now - idle_.front().last_used > idle_limit) {
+                evicted.push_back(std::move(idle_.front().client));
+                idle_.pop_front();
+                --open_;
+            }
+            if (!idle_.empty()) {
+                client = std::move(idle_.back().client);
+                last_used = idle_.back().last_used;
+                idle_.pop_back();
+                reused = true;
+                break;
+            }
+            if (open_ < options_.max_size) {
+                ++open_;
+                break;
+            }
+            if (cond_.wait_until(lock, deadline) == std::cv_status::timeout &&
+                idle_.empty() && open_ >= options_.max_size) {
+                api_metrics().count_engine_error(EngineErrorKind::PoolExhausted);
+                throw EngineClientError("ENGINE_POOL_EXHAUSTED", 503);
+            }
+        }
+    }
+    evicted.clear(); // close sockets outside the lock
+
+    if (reused && options_.probe_after_ms > 0 &&
+        Clock::now() - last_used > std::chrono::milliseconds(options_.probe_after_ms) &&
+        !probe(*client)) {
+        // Stale or unhealthy connection: replace it with a fresh one on the same slot.
+        client = make_client();
+        reused = false;
+    }
+    if (!client) client = make_client();
+    return Lease(this, std::move(client), reused);
+}
+
+void EngineConnectionPool::release(std::unique_ptr<httplib::Client> client, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (reusable && client->is_socket_open()) {
+            idle_.push_back({std::move(client), Clock::now()});
+        } else {
+            --open_;
+        }
+    }
+    cond_.notify_one();
+    // a non-reusable client (if any) is destroyed here, outside the lock
+}
+
+std::size_t EngineConnectionPool::idle_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
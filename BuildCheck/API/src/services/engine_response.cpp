@@ -0,0 +1,242 @@
+#include "services/engine_response.h"
+#include "utils/engine_frame.h"
+#include "third_party/json.hpp"
+
+#include <cstdint>
+
+namespace {
+
+constexpr const char* kDefaultImageError = "Engine failed to analyze image";
+
+// What the container being parsed is, as far as the API cares.
+enum class Frame { TopObject, Results, Item, DamageTypes, ErrorObject, Skip };
+
+// Keys the API reads, classified once per key event instead of string-compared at
+// every value. The lexer's key buffer is only inspected, never moved out, so it keeps
+// its capacity across tokens.
+enum class Field { Other, Results, Error, Message, Path, Shm, Ok, InferenceMode, DamageTypes };
+
+Field classify(const std::string& k) {
+    switch (k.size()) {
+        case 2: return k == "ok" ? Field::Ok : Field::Other;
+        case 3: return k == "shm" ? Field::Shm : Field::Other;
+        case 4: return k == "path" ? Field::Path : Field::Other;
+        case 5: return k == "error" ? Field::Error : Field::Other;
+        case 7: return k == "results" ? Field::Results : k == "message" ? Field::Message : Field::Other;
+        case 12: return k == "damage_types" ? Field::DamageTypes : Field::Other;
+        case 14: return k == "inference_mode" ? Field::InferenceMode : Field::Other;
+        default: return Field::Other;
+    }
+}
+
+class EngineResponseSax {
+public:
+    using json = nlohmann::json;
+    using number_integer_t = json::number_integer_t;
+    using number_unsigned_t = json::number_unsigned_t;
+    using number_float_t = json::number_float_t;
+    using string_t = json::string_t;
+    using binary_t = json::binary_t;
+
+    explicit EngineResponseSax(ParsedEngineResponse& out) : out_(out) {}
+
+    bool null() { return scalar(); }
+    bool boolean(bool v) {
+        if (in(Frame::Item) && field_ == Field::Ok) {
+            item().verdict.ok = v;
+            return true;
+        }
+        return scalar();
+    }
+    bool number_integer(number_integer_t) { return scalar(); }
+    bool number_unsigned(number_unsigned_t) { return scalar(); }
+    bool number_float(number_float_t, const string_t&) { return scalar(); }
+    bool binary(binary_t&) { return scalar(); }
+
+    bool string(string_t& v) {
+        if (stack_.empty()) return true;
+        switch (stack_.back()) {
+            case Frame::TopObject:
+                if (field_ == Field::Error) set_error(v);
+                break;
+            case Frame::ErrorObject:
+                if (field_ == Field::Message) set_error(v);
+                break;
+            case Frame::Results:
+                add_item();
+                finish_item();
+                break;
+            case Frame::Item: {
+                EngineResultItem& it = item();
+                switch (field_) {
+                    case Field::Path: it.path = std::move(v); break;
+                    case Field::Shm: it.shm = std::move(v); break;
+                    case Field::InferenceMode: it.verdict.inference_mode = std::move(v); break;
+                    case Field::Error:
+                        it.verdict.error = std::move(v);
+                        item_error_set_ = true;
+                        break;
+                    default: break;
+                }
+                break;
+            }
+            case Frame::DamageTypes:
+                item().verdict.damage_types.push_back(std::move(v));
+                break;
+            case Frame::Skip:
+                break;
+        }
+        return true;
+    }
+
+    bool key(string_t& k) {
+        field_ = classify(k);
+        if (field_ == Field::Other) return true;
+        if (in(Frame::TopObject)) {
+            if (field_ == Field::Error) {
+                out_.has_error = false;
+                out_.error.clear();
+            } else if (field_ == Field::Results) {
+                out_.has_results = false;
+                out_.results.clear();
+            }
+        } else if (in(Frame::ErrorObject)) {
+            if (field_ == Field::Message) {
+                out_.has_error = false;
+                out_.error.clear();
+            }
+        } else if (in(Frame::Item)) {
+            // A repeated key replaces the earlier value, even with one of the wrong type.
+            EngineResultItem& it = item();
+            switch (field_) {
+                case Field::Path: it.path.clear(); break;
+                case Field::Shm: it.shm.clear(); break;
+                case Field::Ok: it.verdict.ok = false; break;
+                case Field::InferenceMode: it.verdict.inference_mode.clear(); break;
+                case Field::Error:
+                    it.verdict.error.clear();
+                    item_error_set_ = false;
+                    break;
+                case Field::DamageTypes: it.verdict.damage_types.clear(); break;
+                default: break;
+            }
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (stack_.empty()) {
+            stack_.push_back(Frame::TopObject);
+        } else if (in(Frame::TopObject) && field_ == Field::Error) {
+            stack_.push_back(Frame::ErrorObject);
+        } else if (in(Frame::Results)) {
+            add_item();
+            stack_.push_back(Frame::Item);
+        } else {
+            stack_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (!stack_.empty()) {
+            if (stack_.back() == Frame::Item) finish_item();
+            stack_.pop_back();
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (in(Frame::TopObject) && field_ == Field::Results) {
+            out_.has_results = true;
+            stack_.push_back(Frame::Results);
+        } else if (in(Frame::Item) && field_ == Field::DamageTypes) {
+            stack_.push_back(Frame::DamageTypes);
+        } else {
+            if (in(Frame::Results)) {
+                add_item();
+                finish_item();
+            }
+            stack_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    bool end_array() {
+        if (!stack_.empty()) stack_.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+        return false;
+    }
+
+private:
+    bool in(Frame f) const { return !stack_.empty() && stack_.back() == f; }
+    EngineResultItem& item() { return out_.results.back(); }
+
+    // Non-string scalars only matter as bare entries of "results".
+    bool scalar() {
+        if (in(Frame::Results)) {
+            add_item();
+            finish_item();
+        }
+        return true;
+    }
+
+    void set_error(string_t& v) {
+        out_.has_error = true;
+        out_.error = std::move(v);
+    }
+
+    void add_item() {
+        out_.results.emplace_back();
+        item_error_set_ = false;
+    }
+
+    // The error only means something for failed images; the default is filled in
+    // here rather than up front so successful items never allocate it.
+    void finish_item() {
+        EngineResultItem& it = item();
+        if (it.verdict.ok) {
+            it.verdict.error.clear();
+        } else if (!item_error_set_) {
+            it.verdict.error = kDefaultImageError;
+        }
+    }
+
+    ParsedEngineResponse& out_;
+    std::vector<Frame> stack_;
+    Field field_ = Field::Other;
+    bool item_error_set_ = false;   // current item had a string "error"
+};
+
+} // namespace
+
+bool parse_engine_response(std::string_view body, ParsedEngineResponse& out) {
+    out = ParsedEngineResponse{};
+    EngineResponseSax handler(out);
+    const bool ok = nlohmann::json::sax_parse(body.begin(), body.end(), &handler);
+    if (!ok) out = ParsedEngineResponse{};
+    return ok;
+}
+
+bool parse_engine_frame(std::string_view frame, ParsedEngineResponse& out) {
+    out = ParsedEngineResponse{};
+    FrameAnalyzeResponse decoded;
+    std::string error;
+    if (!decode_frame_response(frame, decoded, error)) return false;
+    out.has_results = decoded.has_results;
+    out.results.reserve(decoded.results.size());
+    for (auto& r : decoded.results) {
+        EngineResultItem item;
+        if (r.source == FrameSource::Path) item.path = std::move(r.handle);
+        else if (r.source == FrameSource::Shm) item.shm = std::move(r.handle);
+        item.verdict.ok = r.ok;
+        item.verdict.inference_mode = std::move(r.inference_mode);
+        item.verdict.damage_types = std::move(r.damage_types);
+        if (!r.ok) item.verdict.error = r.error.empty() ? kDefaultImageError : std::move(r.error);
+        out.results.push_back(std::move(item));
+    }
+    return true;
+}
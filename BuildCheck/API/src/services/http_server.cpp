@@ -0,0 +1,136 @@
+#include "services/http_server.h"
+#include "utils/api_metrics.h"
+#include "utils/json.h"
+
+#include <algorithm>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+// Connections waiting for the shedder; beyond this they are closed without a reply.
+constexpr std::size_t kMaxShedBacklog = 64;
+
+thread_local bool t_shedding = false;
+
+void set_flag(socket_t sock, int level, int name) {
+    const int on = 1;
+#if defined(_WIN32)
+    ::setsockopt(sock, level, name, reinterpret_cast<const char*>(&on), sizeof(on));
+#else
+    ::setsockopt(sock, level, name, &on, sizeof(on));
+#endif
+}
+
+} // namespace
+
+SheddingTaskQueue::SheddingTaskQueue(std::size_t workers, std::size_t max_queue)
+    : pool_(workers, max_queue), shedder_([this] { shed_loop(); }) {}
+
+SheddingTaskQueue::~SheddingTaskQueue() {
+    if (shedder_.joinable()) shutdown();
+}
+
+bool SheddingTaskQueue::enqueue(std::function<void()> fn) {
+    if (pool_.enqueue(fn)) return true;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stopping_ || shed_.size() >= kMaxShedBacklog) {
+            api_metrics().connections_dropped.inc();
+            return false;   // httplib closes the socket
+        }
+        shed_.push_back(std::move(fn));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void SheddingTaskQueue::shutdown() {
+    pool_.shutdown();
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (shedder_.joinable()) shedder_.join();
+}
+
+void SheddingTaskQueue::shed_loop() {
+    t_shedding = true;
+    for (;;) {
+        std::function<void()> fn;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopping_ || !shed_.empty(); });
+            if (shed_.empty()) return;
+            fn = std::move(shed_.front());
+            shed_.pop_front();
+        }
+        fn();
+    }
+}
+
+bool is_shedding_connection() noexcept {
+    return t_shedding;
+}
+
+void configure_http_server(httplib::Server& server, const HttpServerOptions& options, AdmissionCheck admit) {
+    const std::size_t acceptors = std::max<std::size_t>(1, options.acceptors);
+    const std::size_t total = options.workers > 0 ? options.workers : CPPHTTPLIB_THREAD_POOL_COUNT;
+    const std::size_t workers = std::max<std::size_t>(1, (total + acceptors - 1) / acceptors);
+    const std::size_t max_queue = std::max<std::size_t>(1, options.max_queue);
+    server.new_task_queue = [workers, max_queue] { return new SheddingTaskQueue(workers, max_queue); };
+
+    server.set_keep_alive_max_count(std::max<std::size_t>(1, options.keep_alive_max));
+    server.set_keep_alive_timeout(std::max(1, options.keep_alive_timeout_sec));
+    server.set_tcp_nodelay(options.tcp_nodelay);
+
+    // httplib's default turns SO_REUSEPORT on unconditionally, which lets a second
+    // api_server bind the same port unnoticed; only do that when asked to.
+    const bool reuse_port = options.reuse_port || acceptors > 1;
+    server.set_socket_options([reuse_port](socket_t sock) {
+        set_flag(sock, SOL_SOCKET, SO_REUSEADDR);
+#ifdef SO_REUSEPORT
+        if (reuse_port) set_flag(sock, SOL_SOCKET, SO_REUSEPORT);
+#else
+        (void)reuse_port;
+#endif
+    });
+
+    if (admit) {
+        // Answering anything but 100 here makes httplib send `res` and close the
+        // connection before the body arrives. Shed connections are left to the handler below.
+        server.set_expect_100_continue_handler([admit](const httplib::Request& req, httplib::Response& res) {
+            if (is_shedding_connection() || admit(req, res)) return 100;
+            return res.status;
+        });
+    }
+
+    server.set_pre_routing_handler([admit](const httplib::Request& req, httplib::Response& res) {
+        if (!is_shedding_connection()) {
+            // Requests with Expect: 100-continue were admitted before the 100 went out.
+            if (!admit || req.get_header_value("Expect") == "100-continue" || admit(req, res)) {
+                return httplib::Server::HandlerResponse::Unhandled;
+            }
+            return httplib::Server::HandlerResponse::Handled;
+        }
+        api_metrics().connections_shed.inc();
+        JsonWriter w;
+        w.begin_object()
+         .kv("ok", false)
+         .key("error").begin_object()
+         .kv("code", "SERVER_BUSY")
+         .kv("message", "Server is at capacity, retry shortly")
+         .end_object()
+         .end_object();
+        res.status = 503;
+        res.set_header("Retry-After", "1");
+        // Keep-alive clients must reconnect, or they stay on the single shedder thread.
+        res.set_header("Connection", "close");
+        res.set_content(w.view().data(), w.view().size(), "application/json");
+        return httplib::Server::HandlerResponse::Handled;
+    });
+}
@@ -0,0 +1,117 @@
+#include "services/job_queue.h"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+JobQueue::JobQueue(JobQueueOptions options) : options_(options) {
+    if (options_.workers == 0) options_.workers = 1;
+    workers_.reserve(options_.workers);
+    for (std::size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+JobQueue::~JobQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+bool JobQueue::submit(const std::string& id, const std::string& owner, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        prune_locked(Clock::now());
+        if (stopping_ || pending_.size() >= options_.max_queue || jobs_.count(id)) {
+            ++rejected_;
+            return false;
+        }
+        Job job;
+        job.task = std::move(task);
+        job.owner = owner;
+        jobs_.emplace(id, std::move(job));
+        pending_.push_back(id);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+bool JobQueue::lookup(const std::string& id, const std::string& owner, JobSnapshot& out) {
+    std::lock_guard<std::mutex> lock(mu_);
+    prune_locked(Clock::now());
+    const auto it = jobs_.find(id);
+    // Someone else's job is reported exactly like an unknown one.
+    if (it == jobs_.end() || it->second.owner != owner) return false;
+    out.state = it->second.state;
+    if (out.state == JobState::Done) out.result = it->second.result;
+    return true;
+}
+
+JobQueueStats JobQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    JobQueueStats s;
+    s.queued = pending_.size();
+    s.running = running_;
+    s.retained = finished_.size();
+    s.completed = completed_;
+    s.rejected = rejected_;
+    return s;
+}
+
+void JobQueue::worker_loop() {
+    for (;;) {
+        std::string id;
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_) return;
+            id = std::move(pending_.front());
+            pending_.pop_front();
+            Job& job = jobs_.at(id);
+            job.state = JobState::Running;
+            task = std::move(job.task);
+            ++running_;
+        }
+
+        JobResult result;
+        try {
+            result = task();
+        } catch (const std::exception& e) {
+            std::cerr << "[JOB " << id << "] failed: " << e.what() << "\n";
+            result = JobResult{500, R"({"ok":false,"error":{"code":"INTERNAL_ERROR","message":"Internal server error"}})"};
+        } catch (...) {
+            result = JobResult{500, R"({"ok":false,"error":{"code":"INTERNAL_ERROR","message":"Unknown error"}})"};
+        }
+        // Drop the task (and whatever uploads it captured) before publishing the result.
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock(mu_);
+        --running_;
+        ++completed_;
+        const auto it = jobs_.find(id);
+        if (it == jobs_.end()) continue;
+        it->second.state = JobState::Done;
+        it->second.result = std::move(result);
+        it->second.finished_at = Clock::now();
+        finished_.push_back(id);
+        prune_locked(it->second.finished_at);
+    }
+}
+
+void JobQueue::prune_locked(Clock::time_point now) {
+    while (!finished_.empty()) {
+        const auto it = jobs_.find(finished_.front());
+        const bool expired = it == jobs_.end() ||
+                             now - it->second.finished_at >= options_.ttl ||
+                             finished_.size() > options_.max_retained;
+        if (!expired) break;
+        if (it != jobs_.end()) jobs_.erase(it);
+        finished_.pop_front();
+    }
+}
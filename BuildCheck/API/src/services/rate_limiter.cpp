@@ -0,0 +1,82 @@
+#include "services/rate_limiter.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+// Shards smaller than this are never swept.
+constexpr std::size_t kMinSweep = 64;
+
+std::int64_t to_ns(RateLimiter::Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(RateLimitOptions options)
+    : max_keys_per_shard_(std::max<std::size_t>(kMinSweep, options.max_keys / kShards)) {
+    if (options.per_minute > 0) {
+        interval_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::minutes(1)).count() /
+                       static_cast<std::int64_t>(options.per_minute);
+        interval_ns_ = std::max<std::int64_t>(1, interval_ns_);
+        tolerance_ns_ = interval_ns_ * static_cast<std::int64_t>(std::max<std::size_t>(1, options.burst) - 1);
+    }
+    for (auto& shard : shards_) shard.sweep_at = kMinSweep;
+}
+
+RateLimiter::Shard& RateLimiter::shard_for(std::string_view key) {
+    return shards_[std::hash<std::string_view>{}(key) % kShards];
+}
+
+RateLimiter::Decision RateLimiter::admit(std::string_view key, Clock::time_point now) {
+    if (!enabled()) return {};
+    const std::int64_t t = to_ns(now);
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+
+    auto it = shard.tat.find(std::string(key));
+    if (it == shard.tat.end()) {
+        const bool full = shard.tat.size() >= max_keys_per_shard_;
+        if (shard.tat.size() >= shard.sweep_at || (full && t >= shard.frees_at)) {
+            std::int64_t earliest = std::numeric_limits<std::int64_t>::max();
+            for (auto e = shard.tat.begin(); e != shard.tat.end();) {
+                if (e->second <= t) {
+                    e = shard.tat.erase(e);
+                } else {
+                    earliest = std::min(earliest, e->second);
+                    ++e;
+                }
+            }
+            shard.sweep_at = std::max(kMinSweep, 2 * shard.tat.size());
+            shard.frees_at = earliest;
+        }
+        // Every tracked key is still inside its window: refuse the newcomer rather than
+        // grow past the cap or let it through unlimited.
+        if (shard.tat.size() >= max_keys_per_shard_) {
+            const std::int64_t wait_ns = std::max<std::int64_t>(1, shard.frees_at - t);
+            return {false, std::chrono::ceil<std::chrono::milliseconds>(std::chrono::nanoseconds(wait_ns))};
+        }
+        shard.tat.emplace(std::string(key), t + interval_ns_);
+        shard.frees_at = std::min(shard.frees_at, t + interval_ns_);
+        return {};
+    }
+
+    const std::int64_t tat = std::max(it->second, t);
+    if (tat - t > tolerance_ns_) {
+        const std::int64_t wait_ns = tat - t - tolerance_ns_;
+        return {false, std::chrono::ceil<std::chrono::milliseconds>(std::chrono::nanoseconds(wait_ns))};
+    }
+    it->second = tat + interval_ns_;
+    return {};
+}
+
+std::size_t RateLimiter::size() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        n += shard.tat.size();
+    }
+    return n;
+}
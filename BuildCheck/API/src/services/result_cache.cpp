@@ -0,0 +1,207 @@
+#include "services/result_cache.h"
+#include "utils/content_hash.h"
+#include "third_party/json.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using nlohmann::json;
+
+namespace {
+
+// Disk prune runs every this many writes rather than on each one: it lists the directory.
+constexpr std::uint64_t kDiskPruneEvery = 256;
+
+std::filesystem::path disk_path_for(const std::string& dir, const std::string& key) {
+    // The key itself is stored inside the file and compared on read, so a name collision
+    // only costs a miss.
+    char name[17];
+    static const char* hex = "0123456789abcdef";
+    const std::uint64_t h = xxh64(key.data(), key.size());
+    for (int i = 0; i < 16; ++i) name[15 - i] = hex[(h >> (i * 4)) & 0xF];
+    name[16] = '\0';
+    return std::filesystem::path(dir) / (std::string(name) + ".json");
+}
+
+} // namespace
+
+ResultCache::ResultCache(ResultCacheOptions options) : options_(std::move(options)) {
+    if (!enabled() || options_.disk_dir.empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(options_.disk_dir, ec);
+    if (ec) {
+        std::cerr << "[CACHE] disk tier disabled, cannot create " << options_.disk_dir
+                  << ": " << ec.message() << "\n";
+        options_.disk_dir.clear();
+    }
+}
+
+std::string ResultCache::make_key(const std::string& content_hash, const std::string& model_fingerprint) {
+    return content_hash + "|" + model_fingerprint;
+}
+
+bool ResultCache::lookup(const std::string& key, CachedAnalysis& out) {
+    if (!enabled()) return false;
+    const auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            if (it->second->expires_at > now) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                out = it->second->value;
+                memory_hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            lru_.erase(it->second);
+            index_.erase(it);
+            expirations_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Clock::time_point expires_at;
+    if (!options_.disk_dir.empty() && disk_lookup(key, out, expires_at)) {
+        std::lock_guard<std::mutex> lock(mu_);
+        insert_locked(key, out, expires_at);
+        disk_hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::store(const std::string& key, const CachedAnalysis& value) {
+    if (!enabled()) return;
+    const auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        insert_locked(key, value, now + options_.ttl);
+    }
+    stores_.fetch_add(1, std::memory_order_relaxed);
+    if (!options_.disk_dir.empty()) disk_store(key, value, now);
+}
+
+ResultCacheStats ResultCache::stats() const {
+    ResultCacheStats s;
+    s.memory_hits = memory_hits_.load(std::memory_order_relaxed);
+    s.disk_hits = disk_hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.stores = stores_.load(std::memory_order_relaxed);
+    s.evictions = evictions_.load(std::memory_order_relaxed);
+    s.expirations = expirations_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mu_);
+    s.entries = index_.size();
+    return s;
+}
+
+void ResultCache::insert_locked(const std::string& key, const CachedAnalysis& value,
+                                Clock::time_point expires_at) {
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->value = value;
+        it->second->expires_at = expires_at;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.push_front(Entry{key, value, expires_at});
+    index_[key] = lru_.begin();
+    while (index_.size() > options_.max_entries) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ResultCache::disk_lookup(const std::string& key, CachedAnalysis& out, Clock::time_point& expires_at) {
+    const auto path = disk_path_for(options_.disk_dir, key);
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    const json doc = json::parse(in, nullptr, false);
+    in.close();
+    if (doc.is_discarded() || !doc.is_object() || doc.value("key", "") != key) return false;
+
+    const auto stored_at = Clock::time_point(std::chrono::seconds(doc.value("stored_at", std::int64_t{0})));
+    expires_at = stored_at + options_.ttl;
+    if (expires_at <= Clock::now()) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        expirations_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    out = CachedAnalysis{};
+    out.ok = doc.value("ok", false);
+    out.inference_mode = doc.value("inference_mode", "");
+    out.error = doc.value("error", "");
+    if (doc.contains("damage_types") && doc["damage_types"].is_array()) {
+        for (const auto& dt : doc["damage_types"]) {
+            if (dt.is_string()) out.damage_types.push_back(dt.get<std::string>());
+        }
+    }
+    return true;
+}
+
+void ResultCache::disk_store(const std::string& key, const CachedAnalysis& value, Clock::time_point stored_at) {
+    const json doc{
+        {"key", key},
+        {"stored_at", std::chrono::duration_cast<std::chrono::seconds>(stored_at.time_since_epoch()).count()},
+        {"ok", value.ok},
+        {"damage_types", value.damage_types},
+        {"inference_mode", value.inference_mode},
+        {"error", value.error}
+    };
+    const auto path = disk_path_for(options_.disk_dir, key);
+    // Write-then-rename so concurrent readers (or other replicas) never see half a file.
+    auto tmp = path;
+    tmp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return;
+        out << doc.dump();
+        if (!out.good()) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return;
+    }
+    if (disk_writes_.fetch_add(1, std::memory_order_relaxed) % kDiskPruneEvery == kDiskPruneEvery - 1) {
+        disk_prune();
+    }
+}
+
+void ResultCache::disk_prune() {
+    std::unique_lock<std::mutex> lock(disk_prune_mu_, std::try_to_lock);
+    if (!lock.owns_lock()) return;   // another request is already pruning
+
+    struct FileAge { std::filesystem::file_time_type mtime; std::filesystem::path path; };
+    std::vector<FileAge> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(options_.disk_dir, ec)) {
+        if (entry.path().extension() != ".json") continue;
+        std::error_code mt_ec;
+        const auto mtime = entry.last_write_time(mt_ec);
+        if (!mt_ec) files.push_back({mtime, entry.path()});
+    }
+    if (files.size() <= options_.max_disk_entries) return;
+
+    // Drop the oldest files down to 90% of the limit so pruning does not run every batch.
+    const std::size_t target = options_.max_disk_entries - options_.max_disk_entries / 10;
+    const std::size_t excess = files.size() - target;
+    std::nth_element(files.begin(), files.begin() + static_cast<std::ptrdiff_t>(excess), files.end(),
+                     [](const FileAge& a, const FileAge& b) { return a.mtime < b.mtime; });
+    for (std::size_t i = 0; i < excess; ++i) {
+        std::error_code rm_ec;
+        std::filesystem::remove(files[i].path, rm_ec);
+    }
+    evictions_.fetch_add(excess, std::memory_order_relaxed);
+}
@@ -0,0 +1,181 @@
+#include "services/session_store.h"
+#include "third_party/json.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using nlohmann::json;
+
+SessionStore::SessionStore(SessionStoreOptions options) : options_(std::move(options)) {
+    const std::size_t n = std::max<std::size_t>(1, options_.shards);
+    shards_.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>());
+    load();
+    if (!options_.path.empty()) flusher_ = std::thread([this] { flusher_loop(); });
+}
+
+SessionStore::~SessionStore() {
+    {
+        std::lock_guard<std::mutex> lock(flusher_mu_);
+        stopping_ = true;
+    }
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+}
+
+SessionStore::Shard& SessionStore::shard_for(const std::string& id) const {
+    return *shards_[std::hash<std::string>{}(id) % shards_.size()];
+}
+
+bool SessionStore::expire_locked(Shard& shard, long long now) {
+    bool removed = false;
+    while (!shard.expiry.empty() && shard.expiry.top().first <= now) {
+        const Expiry top = shard.expiry.top();
+        shard.expiry.pop();
+        const auto it = shard.sessions.find(top.second);
+        if (it != shard.sessions.end() && it->second == top.first) {
+            shard.sessions.erase(it);
+            removed = true;
+        }
+    }
+    return removed;
+}
+
+void SessionStore::create(const std::string& id, long long expires_at) {
+    Shard& shard = shard_for(id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        shard.sessions[id] = expires_at;
+        shard.expiry.emplace(expires_at, id);
+    }
+    dirty_.store(true, std::memory_order_release);
+}
+
+bool SessionStore::validate(const std::string& id, long long now) {
+    Shard& shard = shard_for(id);
+    bool valid = false;
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        removed = expire_locked(shard, now);
+        const auto it = shard.sessions.find(id);
+        valid = it != shard.sessions.end() && it->second > now;
+    }
+    if (removed) dirty_.store(true, std::memory_order_release);
+    return valid;
+}
+
+void SessionStore::revoke(const std::string& id) {
+    Shard& shard = shard_for(id);
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        removed = shard.sessions.erase(id) > 0;
+    }
+    if (removed) dirty_.store(true, std::memory_order_release);
+}
+
+std::size_t SessionStore::size() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        total += shard->sessions.size();
+    }
+    return total;
+}
+
+void SessionStore::load() {
+    if (options_.path.empty()) return;
+    std::ifstream in(options_.path, std::ios::binary);
+    if (!in.is_open()) return;
+    const std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const json payload = json::parse(raw, nullptr, false);
+    if (payload.is_discarded() || !payload.is_object()) return;
+
+    const long long now = static_cast<long long>(std::time(nullptr));
+    for (auto it = payload.begin(); it != payload.end(); ++it) {
+        if (!it.value().is_number_integer()) continue;
+        const long long expires_at = it.value().get<long long>();
+        if (expires_at <= now) continue;
+        Shard& shard = shard_for(it.key());
+        shard.sessions[it.key()] = expires_at;
+        shard.expiry.emplace(expires_at, it.key());
+    }
+}
+
+bool SessionStore::flush() {
+    if (options_.path.empty()) return true;
+    if (!dirty_.exchange(false, std::memory_order_acq_rel)) return true;
+    if (write_snapshot()) return true;
+    dirty_.store(true, std::memory_order_release);
+    return false;
+}
+
+bool SessionStore::write_snapshot() {
+    std::lock_guard<std::mutex> write_lock(write_mu_);
+    const long long now = static_cast<long long>(std::time(nullptr));
+    json payload = json::object();
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        expire_locked(*shard, now);
+        for (const auto& kv : shard->sessions) payload[kv.first] = kv.second;
+    }
+
+    const std::string& path = options_.path;
+    std::filesystem::path p(path);
+    std::error_code ec;
+    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path(), ec);
+
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    const std::string dumped = payload.dump();
+    out.write(dumped.data(), static_cast<std::streamsize>(dumped.size()));
+    out.flush();
+    if (!out.good()) {
+        out.close();
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp_path, rm_ec);
+        return false;
+    }
+    out.close();
+
+    std::error_code mv_ec;
+    std::filesystem::rename(tmp_path, path, mv_ec);
+#if defined(_WIN32)
+    if (mv_ec) {
+        // Replacing a file another process holds open can fail here.
+        std::filesystem::remove(path, mv_ec);
+        mv_ec.clear();
+        std::filesystem::rename(tmp_path, path, mv_ec);
+    }
+#endif
+    if (mv_ec) {
+        // The previous snapshot is still in place; the flusher retries.
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp_path, rm_ec);
+        return false;
+    }
+    return true;
+}
+
+void SessionStore::flusher_loop() {
+    bool last_failed = false;
+    std::unique_lock<std::mutex> lock(flusher_mu_);
+    for (;;) {
+        flusher_cv_.wait_for(lock, options_.flush_interval, [this] { return stopping_; });
+        const bool stopping = stopping_;
+        lock.unlock();
+        const bool ok = flush();
+        if (!ok && !last_failed) {
+            std::cerr << "[SESSION] failed to persist admin sessions to " << options_.path << ", will retry\n";
+        }
+        last_failed = !ok;
+        lock.lock();
+        if (stopping) return;
+    }
+}
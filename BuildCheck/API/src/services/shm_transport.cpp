@@ -0,0 +1,186 @@
+#include "services/shm_transport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ShmSegment::~ShmSegment() {
+    release();
+}
+
+ShmSegment::ShmSegment(ShmSegment&& other) noexcept
+    : name_(std::move(other.name_)), size_(other.size_), fd_(other.fd_) {
+    other.name_.clear();
+    other.size_ = 0;
+    other.fd_ = -1;
+}
+
+ShmSegment& ShmSegment::operator=(ShmSegment&& other) noexcept {
+    if (this != &other) {
+        release();
+        name_ = std::move(other.name_);
+        size_ = other.size_;
+        fd_ = other.fd_;
+        other.name_.clear();
+        other.size_ = 0;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+bool ShmSegment::supported() {
+#if defined(_WIN32)
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool ShmSegment::create(const std::string& name, const char* data, std::size_t size, std::string& error) {
+    if (size == 0) {
+        error = "empty segment";
+        return false;
+    }
+    if (!open(name, error) || !append(data, size, error) || !finish(error)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool ShmSegment::open(const std::string& name, std::string& error) {
+    release();
+#if defined(_WIN32)
+    (void)name;
+    error = "shared memory transport is not supported on this platform";
+    return false;
+#else
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        error = std::string("shm_open failed: ") + std::strerror(errno);
+        return false;
+    }
+    name_ = name;
+    size_ = 0;
+    fd_ = fd;
+    return true;
+#endif
+}
+
+bool ShmSegment::append(const char* data, std::size_t size, std::string& error) {
+#if defined(_WIN32)
+    (void)data; (void)size;
+    error = "shared memory transport is not supported on this platform";
+    return false;
+#else
+    if (fd_ < 0) {
+        error = "segment not open";
+        return false;
+    }
+    // write() on a tmpfs descriptor grows the segment; ENOSPC surfaces here
+    // instead of as SIGBUS on a later touch of an ftruncate'd mapping.
+    while (size > 0) {
+        const ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = std::string("write failed: ") + std::strerror(errno);
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        size_ += static_cast<std::size_t>(n);
+    }
+    return true;
+#endif
+}
+
+bool ShmSegment::finish(std::string& error) {
+#if defined(_WIN32)
+    error = "shared memory transport is not supported on this platform";
+    return false;
+#else
+    if (fd_ < 0) {
+        error = "segment not open";
+        return false;
+    }
+    const int rc = ::close(fd_);
+    fd_ = -1;
+    if (rc != 0) {
+        error = std::string("close failed: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool ShmSegment::copy_to(std::ostream& out) const {
+#if defined(_WIN32)
+    (void)out;
+    return false;
+#else
+    if (fd_ < 0) return false;
+    char buf[64 * 1024];
+    std::size_t off = 0;
+    while (off < size_) {
+        const ssize_t n = ::pread(fd_, buf, std::min(sizeof(buf), size_ - off), static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        out.write(buf, n);
+        off += static_cast<std::size_t>(n);
+    }
+    return out.good();
+#endif
+}
+
+bool ShmSegment::read_all(std::string& out, std::string& error) const {
+#if defined(_WIN32)
+    (void)out;
+    error = "shared memory transport is not supported on this platform";
+    return false;
+#else
+    if (name_.empty()) {
+        error = "segment not open";
+        return false;
+    }
+    const int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = std::string("shm_open failed: ") + std::strerror(errno);
+        return false;
+    }
+    out.resize(size_);
+    std::size_t off = 0;
+    while (off < size_) {
+        const ssize_t n = ::pread(fd, &out[off], size_ - off, static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            error = n < 0 ? std::string("read failed: ") + std::strerror(errno) : "segment shorter than expected";
+            ::close(fd);
+            return false;
+        }
+        off += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    return true;
+#endif
+}
+
+void ShmSegment::release() {
+#if !defined(_WIN32)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+    fd_ = -1;
+    if (name_.empty()) return;
+#if !defined(_WIN32)
+    ::shm_unlink(name_.c_str());
+#endif
+    name_.clear();
+    size_ = 0;
+}
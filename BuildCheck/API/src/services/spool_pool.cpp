@@ -0,0 +1,90 @@
+#include "services/spool_pool.h"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+SpoolPool::SpoolPool(SpoolPoolOptions options) : options_(options) {
+    workers_.reserve(options_.workers);
+    for (std::size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+SpoolPool::~SpoolPool() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void SpoolPool::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!workers_.empty() && !stopping_ && pending_.size() < options_.max_queue) {
+            pending_.push_back(std::move(task));
+            task = nullptr;
+        }
+    }
+    if (!task) {
+        cv_.notify_one();
+        return;
+    }
+    task();
+}
+
+void SpoolPool::worker_loop() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            // Queued tasks still run on shutdown: strands wait for them.
+            if (pending_.empty()) return;
+            task = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        task();
+    }
+}
+
+void SpoolStrand::post(SpoolPool::Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        tasks_.push_back(std::move(task));
+        if (running_) return;
+        running_ = true;
+    }
+    pool_.submit([this] { drain(); });
+}
+
+void SpoolStrand::wait() {
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return !running_; });
+}
+
+void SpoolStrand::drain() {
+    for (;;) {
+        SpoolPool::Task task;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (tasks_.empty()) {
+                running_ = false;
+                idle_cv_.notify_all();
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        // A throwing task must not leave the strand marked running forever.
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "[SPOOL] task failed: " << e.what() << "\n";
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "utils/api_metrics.h"
+
+namespace {
+constexpr std::array<const char*, ApiMetrics::kRoutes> kRouteLabels = {
+    "/api/property/analyze",
+    "/api/property/jobs/{id}",
+    "/health",
+    "/metrics",
+    "/api/contact",
+    "/api/admin/login",
+    "/api/admin/logout",
+    "/api/admin/contact/submissions",
+    "other"
+};
+
+constexpr std::array<const char*, static_cast<std::size_t>(EngineErrorKind::Count)> kEngineErrorLabels = {
+    "unreachable", "bad_status", "pool_exhausted", "invalid_response", "overloaded",
+    "deadline_exceeded"
+};
+} // namespace
+
+ApiMetrics& api_metrics() {
+    static ApiMetrics metrics;
+    return metrics;
+}
+
+ApiRoute ApiMetrics::route_for(const std::string& matched_route) {
+    if (matched_route.empty()) return ApiRoute::Other;
+    if (matched_route.rfind("/api/property/jobs/", 0) == 0) return ApiRoute::AnalyzeJob;
+    for (std::size_t i = 0; i + 1 < kRoutes; ++i) {
+        if (matched_route == kRouteLabels[i]) return static_cast<ApiRoute>(i);
+    }
+    return ApiRoute::Other;
+}
+
+void ApiMetrics::observe_request(const std::string& matched_route, int status,
+                                 std::chrono::steady_clock::duration elapsed) noexcept {
+    const auto route = static_cast<std::size_t>(route_for(matched_route));
+    if (status >= kMinStatus && status <= kMaxStatus) {
+        requests[route][static_cast<std::size_t>(status - kMinStatus)].inc();
+    }
+    request_duration[route].observe(elapsed);
+}
+
+void ApiMetrics::render(PrometheusWriter& out) const {
+    out.family("buildcheck_api_requests_total", "counter", "HTTP requests by route and status.");
+    for (std::size_t r = 0; r < kRoutes; ++r) {
+        for (std::size_t s = 0; s < kStatuses; ++s) {
+            const std::uint64_t n = requests[r][s].value();
+            if (n == 0) continue;
+            out.sample("buildcheck_api_requests_total",
+                       std::string("route=\"") + kRouteLabels[r] + "\",status=\"" +
+                           std::to_string(kMinStatus + static_cast<int>(s)) + "\"",
+                       n);
+        }
+    }
+
+    out.family("buildcheck_api_request_duration_seconds", "histogram",
+               "Time from request line to response headers, by route.");
+    for (std::size_t r = 0; r < kRoutes; ++r) {
+        if (request_duration[r].count() == 0) continue;
+        out.histogram("buildcheck_api_request_duration_seconds",
+                      std::string("route=\"") + kRouteLabels[r] + "\"", request_duration[r]);
+    }
+
+    out.family("buildcheck_api_validation_duration_seconds", "histogram",
+               "Analyze: reading, validating and spooling the multipart body.");
+    out.histogram("buildcheck_api_validation_duration_seconds", "", validation_duration);
+    out.family("buildcheck_api_spool_write_duration_seconds", "histogram",
+               "Analyze: time spent writing one accepted upload to its temp file or shm segment.");
+    out.histogram("buildcheck_api_spool_write_duration_seconds", "", spool_write_duration);
+    out.family("buildcheck_api_engine_call_duration_seconds", "histogram",
+               "Analyze: POST /engine/analyze round trip, including the wait for a pooled connection.");
+    out.histogram("buildcheck_api_engine_call_duration_seconds", "", engine_call_duration);
+
+    out.family("buildcheck_api_analyze_in_flight", "gauge", "Analyze requests currently being handled.");
+    out.sample("buildcheck_api_analyze_in_flight", "", analyze_in_flight.value());
+    out.family("buildcheck_api_engine_calls_in_flight", "gauge", "Engine analyze calls currently outstanding.");
+    out.sample("buildcheck_api_engine_calls_in_flight", "", engine_calls_in_flight.value());
+    out.family("buildcheck_api_engine_concurrency_limit", "gauge",
+               "Adaptive cap on outstanding engine calls (ENGINE_LIMIT_*); 0 when disabled.");
+    out.sample("buildcheck_api_engine_concurrency_limit", "", engine_concurrency_limit.value());
+    out.family("buildcheck_api_engine_endpoints_available", "gauge",
+               "Engine endpoints taking traffic (not ejected by the circuit breaker).");
+    out.sample("buildcheck_api_engine_endpoints_available", "", engine_endpoints_available.value());
+    out.family("buildcheck_api_engine_ejections_total", "counter",
+               "Engine endpoints ejected after consecutive failed calls or health checks.");
+    out.sample("buildcheck_api_engine_ejections_total", "", engine_ejections.value());
+
+    out.family("buildcheck_api_upload_bytes_total", "counter", "Bytes of image parts received by analyze.");
+    out.sample("buildcheck_api_upload_bytes_total", "", upload_bytes.value());
+    out.family("buildcheck_api_uploads_total", "counter", "Image parts by validation outcome.");
+    out.sample("buildcheck_api_uploads_total", "result=\"accepted\"", uploads_accepted.value());
+    out.sample("buildcheck_api_uploads_total", "result=\"rejected\"", uploads_rejected.value());
+
+    out.family("buildcheck_api_connections_shed_total", "counter",
+               "Connections turned away because the HTTP worker queue was full.");
+    out.sample("buildcheck_api_connections_shed_total", "outcome=\"503\"", connections_shed.value());
+    out.sample("buildcheck_api_connections_shed_total", "outcome=\"closed\"", connections_dropped.value());
+    out.family("buildcheck_api_rate_limited_total", "counter",
+               "Analyze requests refused 429 by the edge rate limiter before their body was read.");
+    out.sample("buildcheck_api_rate_limited_total", "", rate_limited.value());
+
+    out.family("buildcheck_api_engine_errors_total", "counter", "Failed engine calls by kind.");
+    for (std::size_t k = 0; k < engine_errors.size(); ++k) {
+        out.sample("buildcheck_api_engine_errors_total",
+                   std::string("kind=\"") + kEngineErrorLabels[k] + "\"", engine_errors[k].value());
+    }
+}
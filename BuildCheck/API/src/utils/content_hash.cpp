@@ -0,0 +1,126 @@
+#include "utils/content_hash.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads; memcpy keeps unaligned reads well-defined.
+inline std::uint64_t read64(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline std::uint64_t merge_round(std::uint64_t acc, std::uint64_t val) {
+    acc ^= round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+Xxh64Stream::Xxh64Stream(std::uint64_t seed)
+    : seed_(seed), acc_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}, buf_{} {}
+
+void Xxh64Stream::update(const void* data, std::size_t size) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + size;
+    total_ += size;
+
+    if (buffered_ + size < 32) {
+        if (size) std::memcpy(buf_ + buffered_, p, size);
+        buffered_ += size;
+        return;
+    }
+    if (buffered_) {
+        const std::size_t fill = 32 - buffered_;
+        std::memcpy(buf_ + buffered_, p, fill);
+        p += fill;
+        for (int i = 0; i < 4; ++i) acc_[i] = round(acc_[i], read64(buf_ + 8 * i));
+        buffered_ = 0;
+    }
+    while (p + 32 <= end) {
+        for (int i = 0; i < 4; ++i) acc_[i] = round(acc_[i], read64(p + 8 * i));
+        p += 32;
+    }
+    buffered_ = static_cast<std::size_t>(end - p);
+    if (buffered_) std::memcpy(buf_, p, buffered_);
+}
+
+std::uint64_t Xxh64Stream::digest() const {
+    std::uint64_t h;
+    if (total_ >= 32) {
+        h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+        for (int i = 0; i < 4; ++i) h = merge_round(h, acc_[i]);
+    } else {
+        h = seed_ + kPrime5;
+    }
+    h += total_;
+
+    const unsigned char* p = buf_;
+    const unsigned char* const end = buf_ + buffered_;
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<std::uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<std::uint64_t>(*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::uint64_t xxh64(const void* data, std::size_t size, std::uint64_t seed) {
+    Xxh64Stream stream(seed);
+    stream.update(data, size);
+    return stream.digest();
+}
+
+std::string content_hash_hex(std::uint64_t hash, std::uint64_t size) {
+    static const char* hex = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 0; i < 16; ++i) {
+        out[15 - i] = hex[(hash >> (i * 4)) & 0xF];
+    }
+    out += '-';
+    out += std::to_string(size);
+    return out;
+}
+
+std::string content_hash_hex(const std::string& data) {
+    return content_hash_hex(xxh64(data.data(), data.size()), data.size());
+}
@@ -0,0 +1,302 @@
+#include "utils/image_downscale.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(BUILDCHECK_HAVE_JPEG)
+#include <jpeglib.h>
+#endif
+#if defined(BUILDCHECK_HAVE_PNG)
+#include <png.h>
+#endif
+
+namespace {
+
+// 8-bit RGB, HWC.
+struct RgbImage {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::uint8_t> rgb;
+};
+
+// Area (box) filter taps for one axis: output i averages source [i*scale, (i+1)*scale),
+// with the partially covered edge pixels weighted by their coverage.
+struct AxisTaps {
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> count;
+    std::vector<float> weights;   // count[i] entries per output, from offset[i]
+    std::vector<std::size_t> offset;
+};
+
+AxisTaps area_taps(std::uint32_t src, std::uint32_t dst) {
+    AxisTaps t;
+    t.first.resize(dst);
+    t.count.resize(dst);
+    t.offset.resize(dst);
+    const double scale = static_cast<double>(src) / dst;
+    for (std::uint32_t i = 0; i < dst; ++i) {
+        const double lo = i * scale;
+        const double hi = std::min<double>(src, lo + scale);
+        const auto i0 = static_cast<std::uint32_t>(lo);
+        const auto i1 = std::min(src, static_cast<std::uint32_t>(std::ceil(hi)));
+        t.first[i] = i0;
+        t.count[i] = i1 - i0;
+        t.offset[i] = t.weights.size();
+        for (std::uint32_t s = i0; s < i1; ++s) {
+            const double cover = std::min<double>(s + 1, hi) - std::max<double>(s, lo);
+            t.weights.push_back(static_cast<float>(cover / scale));
+        }
+    }
+    return t;
+}
+
+// Separable area resample. Each output row pulls its source rows through a
+// horizontally resampled row cache, so every source row is resampled once.
+RgbImage area_resize(const RgbImage& src, std::uint32_t dst_w, std::uint32_t dst_h) {
+    const AxisTaps tx = area_taps(src.width, dst_w);
+    const AxisTaps ty = area_taps(src.height, dst_h);
+    const std::size_t src_stride = static_cast<std::size_t>(src.width) * 3;
+    const std::size_t dst_stride = static_cast<std::size_t>(dst_w) * 3;
+
+    RgbImage out;
+    out.width = dst_w;
+    out.height = dst_h;
+    out.rgb.resize(dst_stride * dst_h);
+
+    std::vector<float> rows[2] = {std::vector<float>(dst_stride), std::vector<float>(dst_stride)};
+    std::int64_t cached[2] = {-1, -1};
+    std::vector<float> acc(dst_stride);
+
+    auto hrow = [&](std::uint32_t y) -> const std::vector<float>& {
+        const int slot = static_cast<int>(y & 1u);
+        if (cached[slot] == y) return rows[slot];
+        const std::uint8_t* in = src.rgb.data() + src_stride * y;
+        float* o = rows[slot].data();
+        for (std::uint32_t x = 0; x < dst_w; ++x) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            const float* w = tx.weights.data() + tx.offset[x];
+            const std::uint8_t* p = in + static_cast<std::size_t>(tx.first[x]) * 3;
+            for (std::uint32_t k = 0; k < tx.count[x]; ++k, p += 3) {
+                r += w[k] * p[0];
+                g += w[k] * p[1];
+                b += w[k] * p[2];
+            }
+            o[3 * x] = r;
+            o[3 * x + 1] = g;
+            o[3 * x + 2] = b;
+        }
+        cached[slot] = y;
+        return rows[slot];
+    };
+
+    for (std::uint32_t y = 0; y < dst_h; ++y) {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        const float* w = ty.weights.data() + ty.offset[y];
+        for (std::uint32_t k = 0; k < ty.count[y]; ++k) {
+            const std::vector<float>& row = hrow(ty.first[y] + k);
+            for (std::size_t i = 0; i < dst_stride; ++i) acc[i] += w[k] * row[i];
+        }
+        std::uint8_t* o = out.rgb.data() + dst_stride * y;
+        for (std::size_t i = 0; i < dst_stride; ++i) {
+            o[i] = static_cast<std::uint8_t>(std::clamp(acc[i] + 0.5f, 0.0f, 255.0f));
+        }
+    }
+    return out;
+}
+
+void fit_within(std::uint32_t w, std::uint32_t h, std::uint32_t max_edge, std::uint32_t& out_w, std::uint32_t& out_h) {
+    if (w >= h) {
+        out_w = max_edge;
+        out_h = std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::lround(static_cast<double>(h) * max_edge / w)));
+    } else {
+        out_h = max_edge;
+        out_w = std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::lround(static_cast<double>(w) * max_edge / h)));
+    }
+}
+
+#if defined(BUILDCHECK_HAVE_JPEG)
+struct JpegErrorMgr {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    auto* err = reinterpret_cast<JpegErrorMgr*>(cinfo->err);
+    std::longjmp(err->jump, 1);
+}
+
+// Decodes at the smallest DCT scale that still covers `max_edge`; copies the first
+// EXIF (APP1) block to `exif`.
+bool decode_jpeg(const std::uint8_t* data, std::size_t size, std::uint32_t max_edge, RgbImage& out,
+                 std::string& exif, std::string& error) {
+    jpeg_decompress_struct cinfo{};
+    JpegErrorMgr jerr{};
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        error = "corrupt jpeg";
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+    jpeg_save_markers(&cinfo, JPEG_APP0 + 1, 0xFFFF);
+    jpeg_read_header(&cinfo, TRUE);
+    for (jpeg_saved_marker_ptr m = cinfo.marker_list; m; m = m->next) {
+        if (m->marker == JPEG_APP0 + 1 && m->data_length >= 6 && std::memcmp(m->data, "Exif\0\0", 6) == 0) {
+            exif.assign(reinterpret_cast<const char*>(m->data), m->data_length);
+            break;
+        }
+    }
+    const JDIMENSION longest = std::max(cinfo.image_width, cinfo.image_height);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1;
+    for (const unsigned denom : {8u, 4u, 2u}) {
+        if (longest / denom >= max_edge) {
+            cinfo.scale_denom = denom;
+            break;
+        }
+    }
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_decompress(&cinfo);
+
+    out.width = cinfo.output_width;
+    out.height = cinfo.output_height;
+    out.rgb.resize(static_cast<std::size_t>(out.width) * out.height * 3);
+    const std::size_t stride = static_cast<std::size_t>(out.width) * 3;
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = out.rgb.data() + stride * cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool encode_jpeg(const RgbImage& img, int quality, const std::string& exif, std::string& out, std::string& error) {
+    jpeg_compress_struct cinfo{};
+    JpegErrorMgr jerr{};
+    unsigned char* buf = nullptr;
+    unsigned long len = 0;
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        std::free(buf);
+        error = "jpeg encode failed";
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buf, &len);
+    cinfo.image_width = img.width;
+    cinfo.image_height = img.height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_compress(&cinfo, TRUE);
+    if (!exif.empty()) {
+        jpeg_write_marker(&cinfo, JPEG_APP0 + 1, reinterpret_cast<const JOCTET*>(exif.data()),
+                          static_cast<unsigned int>(exif.size()));
+    }
+    const std::size_t stride = static_cast<std::size_t>(img.width) * 3;
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<JSAMPLE*>(img.rgb.data() + stride * cinfo.next_scanline);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    out.assign(reinterpret_cast<const char*>(buf), len);
+    jpeg_destroy_compress(&cinfo);
+    std::free(buf);
+    return true;
+}
+#endif
+
+#if defined(BUILDCHECK_HAVE_PNG)
+bool decode_png(const std::uint8_t* data, std::size_t size, RgbImage& out, std::string& error) {
+    png_image image{};
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, data, size)) {
+        error = "corrupt png";
+        return false;
+    }
+    image.format = PNG_FORMAT_RGB;
+    out.width = image.width;
+    out.height = image.height;
+    out.rgb.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, out.rgb.data(), 0, nullptr)) {
+        png_image_free(&image);
+        error = "corrupt png";
+        return false;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+bool image_downscale_supported() noexcept {
+#if defined(BUILDCHECK_HAVE_JPEG)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool should_downscale(const ImageInfo& info, const DownscaleOptions& options) noexcept {
+    if (options.max_edge == 0 || !image_downscale_supported()) return false;
+    if (std::max(info.width, info.height) <= options.max_edge) return false;
+    switch (info.format) {
+        case ImageFormat::Jpeg:
+            return true;
+        case ImageFormat::Png:
+#if defined(BUILDCHECK_HAVE_PNG)
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;   // WebP goes to the engine as uploaded
+    }
+}
+
+bool downscale_to_jpeg(const std::uint8_t* data, std::size_t size, const DownscaleOptions& options,
+                       std::string& out, std::string& error) {
+#if defined(BUILDCHECK_HAVE_JPEG)
+    ImageInfo info;
+    if (!parse_image_header(data, size, info, error)) return false;
+    RgbImage decoded;
+    std::string exif;
+    bool ok = false;
+    if (info.format == ImageFormat::Jpeg) {
+        ok = decode_jpeg(data, size, options.max_edge, decoded, exif, error);
+#if defined(BUILDCHECK_HAVE_PNG)
+    } else if (info.format == ImageFormat::Png) {
+        ok = decode_png(data, size, decoded, error);
+#endif
+    } else {
+        error = std::string("no decoder for ") + image_format_name(info.format);
+    }
+    if (!ok) return false;
+
+    // Target size comes from the full-resolution header, not the DCT-scaled decode.
+    std::uint32_t w = decoded.width;
+    std::uint32_t h = decoded.height;
+    if (std::max(info.width, info.height) > options.max_edge) fit_within(info.width, info.height, options.max_edge, w, h);
+    w = std::min(w, decoded.width);
+    h = std::min(h, decoded.height);
+    if (w == decoded.width && h == decoded.height) return encode_jpeg(decoded, options.jpeg_quality, exif, out, error);
+    return encode_jpeg(area_resize(decoded, w, h), options.jpeg_quality, exif, out, error);
+#else
+    (void)data; (void)size; (void)options; (void)out;
+    error = "built without libjpeg";
+    return false;
+#endif
+}
@@ -0,0 +1,233 @@
+#include "utils/image_header.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+std::uint32_t be16(const unsigned char* p) { return (std::uint32_t{p[0]} << 8) | p[1]; }
+std::uint32_t be32(const unsigned char* p) { return (be16(p) << 16) | be16(p + 2); }
+std::uint32_t le16(const unsigned char* p) { return std::uint32_t{p[0]} | (std::uint32_t{p[1]} << 8); }
+std::uint32_t le24(const unsigned char* p) { return le16(p) | (std::uint32_t{p[2]} << 16); }
+std::uint32_t le32(const unsigned char* p) { return le24(p) | (std::uint32_t{p[3]} << 24); }
+
+constexpr unsigned char kPngSignature[8] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// SOF0..SOF15 except DHT (C4), JPG (C8) and DAC (CC), which share the range.
+bool is_jpeg_frame_marker(std::uint8_t m) {
+    return m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+}
+
+// Markers that stand alone, without a length field: TEM, RST0..7, SOI.
+bool is_jpeg_standalone_marker(std::uint8_t m) {
+    return m == 0x01 || (m >= 0xD0 && m <= 0xD8);
+}
+
+} // namespace
+
+const char* image_format_name(ImageFormat format) noexcept {
+    switch (format) {
+        case ImageFormat::Jpeg: return "jpeg";
+        case ImageFormat::Png: return "png";
+        case ImageFormat::Webp: return "webp";
+        default: return "unknown";
+    }
+}
+
+ImageHeaderParser::State ImageHeaderParser::feed(const void* data, std::size_t size) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (size > 0 && state_ == State::NeedMore) {
+        if (skip_ > 0) {
+            const std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(skip_, size));
+            skip_ -= n;
+            p += n;
+            size -= n;
+            continue;
+        }
+        const std::size_t n = std::min(need_ - have_, size);
+        std::memcpy(buf_ + have_, p, n);
+        have_ += n;
+        p += n;
+        size -= n;
+        if (have_ == need_) step();
+    }
+    return state_;
+}
+
+void ImageHeaderParser::expect(Step next, std::size_t bytes) {
+    step_ = next;
+    have_ = 0;
+    need_ = bytes;
+}
+
+void ImageHeaderParser::fail(const char* why) {
+    state_ = State::Invalid;
+    error_ = why;
+}
+
+void ImageHeaderParser::done(ImageFormat format, std::uint32_t width, std::uint32_t height, std::uint8_t channels) {
+    if (width == 0 || height == 0) {
+        fail("Image has zero width or height");
+        return;
+    }
+    info_.format = format;
+    info_.width = width;
+    info_.height = height;
+    info_.channels = channels;
+    state_ = State::Done;
+}
+
+void ImageHeaderParser::step() {
+    unsigned char b[sizeof(buf_)];
+    std::memcpy(b, buf_, have_);
+    switch (step_) {
+        case Step::Signature:
+            // The 12 signature bytes run into the header proper: hand the tail back to feed().
+            if (b[0] == 0xFF && b[1] == 0xD8) {
+                expect(Step::JpegMarker, 2);
+                feed(b + 2, 10);
+            } else if (std::memcmp(b, kPngSignature, sizeof(kPngSignature)) == 0) {
+                expect(Step::PngHeader, 18);
+                feed(b + 8, 4);
+            } else if (std::memcmp(b, "RIFF", 4) == 0 && std::memcmp(b + 8, "WEBP", 4) == 0) {
+                expect(Step::WebpChunk, 8);
+            } else {
+                fail("Unknown image format");
+            }
+            return;
+
+        case Step::JpegMarker:
+            if (b[0] != 0xFF) {
+                fail("Malformed JPEG marker");
+                return;
+            }
+            jpeg_marker(b[1]);
+            return;
+
+        case Step::JpegFill:
+            jpeg_marker(b[0]);
+            return;
+
+        case Step::JpegLength: {
+            const std::uint32_t len = be16(b);
+            if (is_jpeg_frame_marker(marker_)) {
+                if (len < 8) {
+                    fail("Malformed JPEG frame header");
+                    return;
+                }
+                expect(Step::JpegFrame, 6);
+                return;
+            }
+            if (len < 2) {
+                fail("Malformed JPEG segment");
+                return;
+            }
+            skip_ = len - 2;
+            expect(Step::JpegMarker, 2);
+            return;
+        }
+
+        case Step::JpegFrame: {
+            // precision, height, width, component count
+            const std::uint8_t components = b[5];
+            if (components != 1 && components != 3 && components != 4) {
+                fail("Unsupported JPEG component count");
+                return;
+            }
+            done(ImageFormat::Jpeg, be16(b + 3), be16(b + 1), components);
+            return;
+        }
+
+        case Step::PngHeader: {
+            // IHDR length and type, width, height, bit depth, color type
+            static constexpr std::uint8_t kChannels[7] = {1, 0, 3, 3, 2, 0, 4};
+            if (be32(b) != 13 || std::memcmp(b + 4, "IHDR", 4) != 0) {
+                fail("PNG does not start with IHDR");
+                return;
+            }
+            const std::uint32_t width = be32(b + 8);
+            const std::uint32_t height = be32(b + 12);
+            const std::uint8_t color = b[17];
+            if (width > 0x7FFFFFFFu || height > 0x7FFFFFFFu || color > 6 || kChannels[color] == 0) {
+                fail("Malformed PNG header");
+                return;
+            }
+            done(ImageFormat::Png, width, height, kChannels[color]);
+            return;
+        }
+
+        case Step::WebpChunk:
+            // First chunk fourcc + size; the bitstream header follows.
+            marker_ = b[3];
+            if (std::memcmp(b, "VP8 ", 4) == 0 || std::memcmp(b, "VP8X", 4) == 0) {
+                expect(Step::WebpBitstream, 10);
+            } else if (std::memcmp(b, "VP8L", 4) == 0) {
+                expect(Step::WebpBitstream, 5);
+            } else {
+                fail("Unknown WebP chunk");
+            }
+            return;
+
+        case Step::WebpBitstream:
+            if (marker_ == ' ') {
+                // frame tag (3), start code 9D 01 2A, 14-bit width and height
+                if (b[3] != 0x9D || b[4] != 0x01 || b[5] != 0x2A) {
+                    fail("Malformed WebP VP8 header");
+                    return;
+                }
+                done(ImageFormat::Webp, le16(b + 6) & 0x3FFF, le16(b + 8) & 0x3FFF, 3);
+            } else if (marker_ == 'L') {
+                // signature 0x2F, then 14-bit width-1, 14-bit height-1, alpha hint
+                if (b[0] != 0x2F) {
+                    fail("Malformed WebP VP8L header");
+                    return;
+                }
+                const std::uint32_t bits = le32(b + 1);
+                done(ImageFormat::Webp, (bits & 0x3FFF) + 1, ((bits >> 14) & 0x3FFF) + 1, ((bits >> 28) & 1) ? 4 : 3);
+            } else {
+                // flags (bit 4 alpha), 3 reserved, 24-bit canvas width-1 and height-1
+                done(ImageFormat::Webp, le24(b + 4) + 1, le24(b + 7) + 1, (b[0] & 0x10) ? 4 : 3);
+            }
+            return;
+    }
+}
+
+// `code` follows an 0xFF; more 0xFF bytes are fill before the real code.
+void ImageHeaderParser::jpeg_marker(std::uint8_t code) {
+    if (code == 0xFF) {
+        expect(Step::JpegFill, 1);
+    } else if (is_jpeg_standalone_marker(code)) {
+        expect(Step::JpegMarker, 2);
+    } else if (code == 0xD9 || code == 0xDA) {
+        fail("JPEG has no frame header");
+    } else if (code == 0x00) {
+        fail("Malformed JPEG marker");
+    } else {
+        marker_ = code;
+        expect(Step::JpegLength, 2);
+    }
+}
+
+bool parse_image_header(const void* data, std::size_t size, ImageInfo& info, std::string& error) {
+    ImageHeaderParser parser;
+    switch (parser.feed(data, size)) {
+        case ImageHeaderParser::State::Done:
+            info = parser.info();
+            return true;
+        case ImageHeaderParser::State::Invalid:
+            error = parser.error();
+            return false;
+        default:
+            error = "Truncated image header";
+            return false;
+    }
+}
+
+bool check_image_limits(const ImageInfo& info, const ImageLimits& limits, std::string& error) {
+    if ((limits.max_side > 0 && (info.width > limits.max_side || info.height > limits.max_side)) ||
+        (limits.max_pixels > 0 && info.pixels() > limits.max_pixels)) {
+        error = "Image dimensions too large (" + std::to_string(info.width) + "x" + std::to_string(info.height) + ")";
+        return false;
+    }
+    return true;
+}
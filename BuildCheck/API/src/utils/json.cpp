@@ -0,0 +1,220 @@
+#include "utils/json.h"
+
+#include <cstdio>
+
+// SSE2 is part of the x86-64 baseline and NEON of aarch64, so neither needs a
+// runtime CPU check.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BUILDCHECK_JSON_SSE2 1
+#include <emmintrin.h>
+#else
+#define BUILDCHECK_JSON_SSE2 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define BUILDCHECK_JSON_NEON 1
+#include <arm_neon.h>
+#else
+#define BUILDCHECK_JSON_NEON 0
+#endif
+
+namespace {
+
+bool needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// Index of the first byte in [i, n) that needs escaping, or n.
+std::size_t find_escape(const char* s, std::size_t i, std::size_t n) {
+#if BUILDCHECK_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        const __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(x, ctrl_max), ctrl_max));   // x <= 0x1F unsigned
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long bit = 0;
+            _BitScanForward(&bit, static_cast<unsigned long>(mask));
+            return i + bit;
+#else
+            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+#endif
+        }
+    }
+#elif BUILDCHECK_JSON_NEON
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t ctrl_end = vdupq_n_u8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t x = vld1q_u8(reinterpret_cast<const std::uint8_t*>(s + i));
+        const uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(x, quote), vceqq_u8(x, backslash)),
+                                        vcltq_u8(x, ctrl_end));
+        if (vmaxvq_u8(hit) != 0) break;   // the scalar loop pins down the exact byte
+    }
+#endif
+    for (; i < n; ++i) {
+        if (needs_escape(static_cast<unsigned char>(s[i]))) return i;
+    }
+    return n;
+}
+
+void append_escaped_byte(std::string& out, unsigned char c) {
+    static const char* hex = "0123456789abcdef";
+    switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '"':  out += "\\\""; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default: {
+            const char u[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0x0F], hex[c & 0x0F]};
+            out.append(u, sizeof(u));
+            break;
+        }
+    }
+}
+
+struct ScratchBuffer {
+    std::string buf;
+    bool in_use = false;
+};
+
+// Above this the buffer is released after use instead of pinning a one-off large
+// response's memory to the thread for good.
+constexpr std::size_t kScratchKeepCapacity = 256 * 1024;
+
+ScratchBuffer& thread_scratch() {
+    static thread_local ScratchBuffer scratch;
+    return scratch;
+}
+
+} // namespace
+
+void json_escape_append(std::string& out, std::string_view s) {
+    const char* data = s.data();
+    const std::size_t n = s.size();
+    std::size_t i = 0;
+    while (i < n) {
+        const std::size_t stop = find_escape(data, i, n);
+        out.append(data + i, stop - i);
+        if (stop == n) break;
+        append_escaped_byte(out, static_cast<unsigned char>(data[stop]));
+        i = stop + 1;
+    }
+}
+
+const char* json_escape_kernel_name() {
+#if BUILDCHECK_JSON_SSE2
+    return "sse2";
+#elif BUILDCHECK_JSON_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+JsonWriter::JsonWriter() : out_(&owned_) {
+    ScratchBuffer& scratch = thread_scratch();
+    if (!scratch.in_use) {
+        scratch.in_use = true;
+        scratch.buf.clear();
+        out_ = &scratch.buf;
+        borrowed_ = true;
+    }
+}
+
+JsonWriter::~JsonWriter() {
+    if (!borrowed_) return;
+    ScratchBuffer& scratch = thread_scratch();
+    if (scratch.buf.capacity() > kScratchKeepCapacity) std::string().swap(scratch.buf);
+    scratch.in_use = false;
+}
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (depth_ == 0) return;
+    const std::uint64_t bit = std::uint64_t{1} << ((depth_ - 1) & 63);
+    if (has_member_ & bit) {
+        out_->push_back(',');
+    } else {
+        has_member_ |= bit;
+    }
+}
+
+void JsonWriter::open(char c) {
+    separate();
+    out_->push_back(c);
+    ++depth_;
+    has_member_ &= ~(std::uint64_t{1} << ((depth_ - 1) & 63));
+}
+
+void JsonWriter::close(char c) {
+    if (depth_ > 0) --depth_;
+    out_->push_back(c);
+}
+
+JsonWriter& JsonWriter::key(std::string_view k) {
+    separate();
+    out_->push_back('"');
+    json_escape_append(*out_, k);
+    out_->append("\":", 2);
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view s) {
+    separate();
+    out_->push_back('"');
+    json_escape_append(*out_, s);
+    out_->push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+    separate();
+    if (b) {
+        out_->append("true", 4);
+    } else {
+        out_->append("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double d) {
+    separate();
+    if (d != d || d - d != 0.0) {   // NaN / inf have no JSON spelling
+        out_->append("null", 4);
+        return *this;
+    }
+    char buf[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto r = std::to_chars(buf, buf + sizeof(buf), d);
+    out_->append(buf, static_cast<std::size_t>(r.ptr - buf));
+#else
+    const int len = std::snprintf(buf, sizeof(buf), "%.17g", d);
+    if (len > 0) out_->append(buf, static_cast<std::size_t>(len));
+#endif
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out_->append("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    separate();
+    out_->append(json.data(), json.size());
+    return *this;
+}
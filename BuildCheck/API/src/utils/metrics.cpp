@@ -0,0 +1,95 @@
+#include "utils/metrics.h"
+
+#include <cstdio>
+
+namespace {
+constexpr std::array<std::int64_t, LatencyHistogram::kBuckets> kBoundsNs = {
+    1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000, 100'000'000,
+    250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000,
+    30'000'000'000, 60'000'000'000};
+
+void append_double(std::string& out, double v) {
+    char buf[32];
+    const int n = std::snprintf(buf, sizeof(buf), "%.9g", v);
+    if (n > 0) out.append(buf, static_cast<std::size_t>(n));
+}
+} // namespace
+
+const std::array<double, LatencyHistogram::kBuckets>& LatencyHistogram::bounds_seconds() {
+    static const std::array<double, kBuckets> bounds = [] {
+        std::array<double, kBuckets> b{};
+        for (std::size_t i = 0; i < kBuckets; ++i) b[i] = static_cast<double>(kBoundsNs[i]) / 1e9;
+        return b;
+    }();
+    return bounds;
+}
+
+void LatencyHistogram::observe(std::chrono::steady_clock::duration d) noexcept {
+    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    std::size_t i = 0;
+    while (i < kBuckets && ns > kBoundsNs[i]) ++i;
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns > 0 ? static_cast<std::uint64_t>(ns) : 0, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PrometheusWriter::family(const char* name, const char* type, const char* help) {
+    out_ += "# HELP ";
+    out_ += name;
+    out_ += ' ';
+    out_ += help;
+    out_ += "\n# TYPE ";
+    out_ += name;
+    out_ += ' ';
+    out_ += type;
+    out_ += '\n';
+}
+
+void PrometheusWriter::series(const char* name, const char* suffix, const std::string& labels) {
+    out_ += name;
+    out_ += suffix;
+    if (!labels.empty()) {
+        out_ += '{';
+        out_ += labels;
+        out_ += '}';
+    }
+    out_ += ' ';
+}
+
+void PrometheusWriter::sample(const char* name, const std::string& labels, std::uint64_t value) {
+    series(name, "", labels);
+    out_ += std::to_string(value);
+    out_ += '\n';
+}
+
+void PrometheusWriter::sample(const char* name, const std::string& labels, std::int64_t value) {
+    series(name, "", labels);
+    out_ += std::to_string(value);
+    out_ += '\n';
+}
+
+void PrometheusWriter::histogram(const char* name, const std::string& labels, const LatencyHistogram& h) {
+    const auto& bounds = LatencyHistogram::bounds_seconds();
+    const std::string sep = labels.empty() ? "" : ",";
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i <= LatencyHistogram::kBuckets; ++i) {
+        cumulative += h.bucket(i);
+        std::string le = labels + sep + "le=\"";
+        if (i == LatencyHistogram::kBuckets) {
+            le += "+Inf";
+        } else {
+            append_double(le, bounds[i]);
+        }
+        le += '"';
+        series(name, "_bucket", le);
+        out_ += std::to_string(cumulative);
+        out_ += '\n';
+    }
+    series(name, "_sum", labels);
+    append_double(out_, h.sum_seconds());
+    out_ += '\n';
+    // _count from the buckets, so it always matches the +Inf bucket of this scrape.
+    series(name, "_count", labels);
+    out_ += std::to_string(cumulative);
+    out_ += '\n';
+}
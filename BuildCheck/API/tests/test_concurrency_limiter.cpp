@@ -0,0 +1,95 @@
+// ConcurrencyLimiter: the limit grows while latency holds, shrinks once calls slow
+// down or are dropped, and calls beyond it are refused.
+#include "services/concurrency_limiter.h"
+#include "check.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Takes every permit the limiter will hand out, waits `hold`, then reports success.
+std::size_t saturate(ConcurrencyLimiter& limiter, std::chrono::milliseconds hold) {
+    std::vector<ConcurrencyLimiter::Permit> permits;
+    for (;;) {
+        ConcurrencyLimiter::Permit p = limiter.try_acquire();
+        if (!p) break;
+        permits.push_back(std::move(p));
+    }
+    const std::size_t taken = permits.size();
+    if (hold.count() > 0) std::this_thread::sleep_for(hold);
+    for (auto& p : permits) p.success();
+    return taken;
+}
+
+ConcurrencyLimitOptions options() {
+    ConcurrencyLimitOptions o;
+    o.initial_limit = 8;
+    o.min_limit = 2;
+    o.max_limit = 64;
+    return o;
+}
+
+void test_refuses_over_limit() {
+    ConcurrencyLimiter limiter(options());
+    CHECK(saturate(limiter, std::chrono::milliseconds(0)) == 8);
+    CHECK(limiter.in_flight() == 0);
+
+    ConcurrencyLimitOptions off = options();
+    off.initial_limit = 0;
+    ConcurrencyLimiter disabled(off);
+    CHECK(!disabled.enabled());
+    std::vector<ConcurrencyLimiter::Permit> permits;
+    for (int i = 0; i < 100; ++i) permits.push_back(disabled.try_acquire());
+    CHECK(permits.back());
+}
+
+void test_grows_while_latency_holds() {
+    ConcurrencyLimiter limiter(options());
+    for (int round = 0; round < 20; ++round) saturate(limiter, std::chrono::milliseconds(2));
+    CHECK(limiter.limit() > 8);
+    CHECK(limiter.limit() <= 64);
+
+    // Calls that leave most of the limit unused say nothing about headroom.
+    ConcurrencyLimiter idle(options());
+    for (int i = 0; i < 50; ++i) idle.try_acquire().success();
+    CHECK(idle.limit() == 8);
+}
+
+void test_shrinks_when_latency_rises() {
+    ConcurrencyLimitOptions o = options();
+    o.initial_limit = 32;
+    o.tolerance = 1.5;
+    ConcurrencyLimiter limiter(o);
+    // A fast baseline, one call at a time so the limit is left alone...
+    for (int i = 0; i < 200; ++i) limiter.try_acquire().success();
+    CHECK(limiter.limit() == 32);
+    // ...then the engine starts queueing: every call takes far longer per image.
+    for (int round = 0; round < 10; ++round) saturate(limiter, std::chrono::milliseconds(20));
+    CHECK(limiter.limit() < 32);
+    CHECK(limiter.limit() >= 2);
+}
+
+void test_dropped_calls_back_off() {
+    ConcurrencyLimiter limiter(options());
+    for (int i = 0; i < 3; ++i) limiter.try_acquire().dropped();
+    CHECK(limiter.limit() == 5);   // 8 * 0.9^3 = 5.8
+    for (int i = 0; i < 50; ++i) limiter.try_acquire().dropped();
+    CHECK(limiter.limit() == 2);   // floored at min_limit
+
+    // A permit released without an outcome (a 4xx answer) leaves the limit alone.
+    { ConcurrencyLimiter::Permit ignored = limiter.try_acquire(); }
+    CHECK(limiter.limit() == 2);
+    CHECK(limiter.in_flight() == 0);
+}
+
+} // namespace
+
+int main() {
+    test_refuses_over_limit();
+    test_grows_while_latency_holds();
+    test_shrinks_when_latency_rises();
+    test_dropped_calls_back_off();
+    return check_result("test_concurrency_limiter");
+}
@@ -0,0 +1,180 @@
+// ContactLog recovery: torn tails, corrupt records, the legacy whole-array format and
+// a .tmp left behind by an interrupted compaction.
+#include "services/contact_log.h"
+#include "check.h"
+
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+ContactEntry entry(int i) {
+    return ContactEntry{"name" + std::to_string(i), "050000000" + std::to_string(i), "msg " + std::to_string(i),
+                        "2026-01-0" + std::to_string(i)};
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+void test_append_and_reload(const ScratchDir& dir) {
+    const std::string path = dir.file("append.log");
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        log.load(live);
+        CHECK(live.empty());
+        for (int i = 1; i <= 3; ++i) CHECK(log.append(entry(i)));
+    }
+    ContactLog log(path, 10, 20);
+    std::deque<ContactEntry> live;
+    const ContactLogLoadStats stats = log.load(live);
+    CHECK(stats.records == 3);
+    CHECK(stats.dropped == 0 && !stats.torn_tail && !stats.migrated_legacy);
+    CHECK(live.size() == 3 && live.back().name == "name3" && live.front().message == "msg 1");
+}
+
+void test_torn_tail_is_dropped_and_rewritten(const ScratchDir& dir) {
+    const std::string path = dir.file("torn.log");
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        log.load(live);
+        CHECK(log.append(entry(1)));
+        CHECK(log.append(entry(2)));
+    }
+    // A crash mid-append: half a record with no newline.
+    const std::string whole = read_file(path);
+    write_file(path, whole + whole.substr(0, whole.find('\n') / 2));
+
+    ContactLog log(path, 10, 20);
+    std::deque<ContactEntry> live;
+    const ContactLogLoadStats stats = log.load(live);
+    CHECK(stats.torn_tail);
+    CHECK(stats.records == 2);
+    CHECK(live.size() == 2 && live.back().name == "name2");
+    CHECK(read_file(path) == whole);   // compacted back to the intact records
+
+    // The next record starts on a clean line.
+    CHECK(log.append(entry(3)));
+    ContactLog reopened(path, 10, 20);
+    std::deque<ContactEntry> again;
+    const ContactLogLoadStats again_stats = reopened.load(again);
+    CHECK(again_stats.records == 3 && again_stats.dropped == 0 && !again_stats.torn_tail);
+}
+
+void test_corrupt_record_is_dropped(const ScratchDir& dir) {
+    const std::string path = dir.file("corrupt.log");
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        log.load(live);
+        CHECK(log.append(entry(1)));
+        CHECK(log.append(entry(2)));
+    }
+    std::string raw = read_file(path);
+    raw[raw.find("name1")] = 'N';   // checksum no longer matches
+    write_file(path, raw);
+
+    ContactLog log(path, 10, 20);
+    std::deque<ContactEntry> live;
+    const ContactLogLoadStats stats = log.load(live);
+    CHECK(stats.dropped == 1 && stats.records == 1);
+    CHECK(live.size() == 1 && live.front().name == "name2");
+}
+
+void test_legacy_array_is_migrated(const ScratchDir& dir) {
+    const std::string path = dir.file("legacy.json");
+    write_file(path,
+               "[{\"name\":\"a\",\"phone\":\"1\",\"message\":\"m1\",\"registered_at\":\"t1\"},"
+               " 7,"
+               " {\"name\":\"b\",\"phone\":\"2\",\"message\":\"m2\",\"registered_at\":\"t2\"},"
+               " {\"name\":\"c\",\"phone\":\"3\",\"message\":\"m3\",\"registered_at\":\"t3\"}]");
+    {
+        ContactLog log(path, 2, 20);
+        std::deque<ContactEntry> live;
+        const ContactLogLoadStats stats = log.load(live);
+        CHECK(stats.migrated_legacy);
+        CHECK(stats.records == 3);
+        CHECK(live.size() == 2 && live.front().name == "b" && live.back().name == "c");
+    }
+    ContactLog log(path, 2, 20);
+    std::deque<ContactEntry> live;
+    const ContactLogLoadStats stats = log.load(live);
+    CHECK(!stats.migrated_legacy && stats.records == 2 && stats.dropped == 0);
+    CHECK(live.size() == 2 && live.back().phone == "3");
+}
+
+void test_compaction_keeps_live_entries(const ScratchDir& dir) {
+    const std::string path = dir.file("compact.log");
+    ContactLog log(path, 2, 4);
+    std::deque<ContactEntry> live;
+    log.load(live);
+    for (int i = 1; i <= 4; ++i) {
+        CHECK(log.append(entry(i)));
+        live.push_back(entry(i));
+        while (live.size() > 2) live.pop_front();
+    }
+    CHECK(log.needs_compaction());
+    CHECK(log.compact(live));
+    CHECK(!log.needs_compaction());
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+
+    ContactLog reopened(path, 2, 4);
+    std::deque<ContactEntry> loaded;
+    CHECK(reopened.load(loaded).records == 2);
+    CHECK(loaded.size() == 2 && loaded.front().name == "name3");
+}
+
+void test_leftover_tmp(const ScratchDir& dir) {
+    // Next to an intact log the .tmp is stale and discarded.
+    const std::string path = dir.file("tmp.log");
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        log.load(live);
+        CHECK(log.append(entry(1)));
+    }
+    const std::string one = read_file(path);
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        log.load(live);
+        CHECK(log.append(entry(2)));
+    }
+    write_file(path + ".tmp", one);
+    {
+        ContactLog log(path, 10, 20);
+        std::deque<ContactEntry> live;
+        CHECK(log.load(live).records == 2);
+        CHECK(!std::filesystem::exists(path + ".tmp"));
+    }
+
+    // With the log gone, the .tmp is the only copy and is promoted.
+    std::filesystem::rename(path, path + ".tmp");
+    ContactLog log(path, 10, 20);
+    std::deque<ContactEntry> live;
+    CHECK(log.load(live).records == 2);
+    CHECK(std::filesystem::exists(path) && !std::filesystem::exists(path + ".tmp"));
+}
+
+} // namespace
+
+int main() {
+    ScratchDir dir("buildcheck_contact_log");
+    test_append_and_reload(dir);
+    test_torn_tail_is_dropped_and_rewritten(dir);
+    test_corrupt_record_is_dropped(dir);
+    test_legacy_array_is_migrated(dir);
+    test_compaction_keeps_live_entries(dir);
+    test_leftover_tmp(dir);
+    return check_result("test_contact_log");
+}
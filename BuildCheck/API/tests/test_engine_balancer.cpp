@@ -0,0 +1,187 @@
+// EngineBalancer: ejection after consecutive failed calls (which passing health checks
+// must not reset), return through the health checker, slow start afterwards, and the
+// model fingerprint taken from the health answers of the endpoints in service.
+// The endpoints are local httplib servers answering GET /engine/health.
+#include "services/engine_balancer.h"
+#include "utils/httplib.h"
+#include "check.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using std::chrono::milliseconds;
+
+class HealthServer {
+public:
+    explicit HealthServer(std::string body = "{\"ok\":true}") : body_(std::move(body)) {
+        server_.Get("/engine/health", [this](const httplib::Request&, httplib::Response& res) {
+            res.set_content(body_, "application/json");
+        });
+        port_ = server_.bind_to_any_port("127.0.0.1");
+        thread_ = std::thread([this] { server_.listen_after_bind(); });
+        server_.wait_until_ready();
+    }
+    ~HealthServer() {
+        server_.stop();
+        thread_.join();
+    }
+
+    EngineEndpoint endpoint() const { return EngineEndpoint{"127.0.0.1", port_}; }
+
+private:
+    const std::string body_;
+    httplib::Server server_;
+    int port_ = 0;
+    std::thread thread_;
+};
+
+// Fails the next call that lands on `name`.
+void fail_one_call(EngineBalancer& balancer, const std::string& name) {
+    for (int i = 0; i < 1000; ++i) {
+        EngineBalancer::Pick pick = balancer.pick();
+        if (pick.name() == name) {
+            pick.failed();
+            return;
+        }
+    }
+    CHECK(!"no pick landed on the endpoint");
+}
+
+// How many of `n` simultaneously outstanding calls go to `name`.
+int share_of(EngineBalancer& balancer, const std::string& name, int n) {
+    std::vector<EngineBalancer::Pick> held;
+    int hits = 0;
+    for (int i = 0; i < n; ++i) {
+        held.push_back(balancer.pick());
+        if (held.back().name() == name) ++hits;
+    }
+    return hits;
+}
+
+std::string name_of(const EngineEndpoint& ep) {
+    return ep.host + ":" + std::to_string(ep.port);
+}
+
+void test_call_failures_eject(const HealthServer& a, const HealthServer& b) {
+    EngineBalancerOptions options;
+    options.health_interval_ms = 100;
+    options.eject_after_failures = 3;
+    options.eject_ms = 60000;
+    EngineBalancer balancer({a.endpoint(), b.endpoint()}, EnginePoolOptions{}, options);
+    const std::string target = name_of(a.endpoint());
+
+    // A success in between starts the count over.
+    fail_one_call(balancer, target);
+    fail_one_call(balancer, target);
+    for (int i = 0; i < 1000; ++i) {
+        EngineBalancer::Pick pick = balancer.pick();
+        if (pick.name() != target) continue;
+        pick.succeeded();
+        break;
+    }
+    fail_one_call(balancer, target);
+    fail_one_call(balancer, target);
+    CHECK(share_of(balancer, target, 20) > 0);
+
+    // Failed calls spread over several health-check rounds, all of which pass, still
+    // add up to an ejection.
+    std::this_thread::sleep_for(milliseconds(250));
+    fail_one_call(balancer, target);
+    CHECK(share_of(balancer, target, 20) == 0);
+
+    // `avoid` is still honoured when the other endpoint is the only one left.
+    EngineBalancer::Pick first = balancer.pick();
+    EngineBalancer::Pick retry = balancer.pick(&first);
+    CHECK(first.name() == retry.name());
+}
+
+void test_return_and_slow_start(const HealthServer& a, const HealthServer& b) {
+    EngineBalancerOptions options;
+    options.health_interval_ms = 100;
+    options.eject_after_failures = 2;
+    options.eject_ms = 300;
+    options.slow_start_ms = 1500;
+    EngineBalancer balancer({a.endpoint(), b.endpoint()}, EnginePoolOptions{}, options);
+    const std::string target = name_of(a.endpoint());
+
+    fail_one_call(balancer, target);
+    fail_one_call(balancer, target);
+    CHECK(share_of(balancer, target, 20) == 0);
+
+    // Back once eject_ms has passed and a check answers. At 10% weight the endpoint
+    // gets one call once the other has ten outstanding, so probe with twelve.
+    const auto ejected_at = std::chrono::steady_clock::now();
+    auto back_at = ejected_at;
+    while (std::chrono::steady_clock::now() - ejected_at < std::chrono::seconds(5)) {
+        if (share_of(balancer, target, 12) > 0) {
+            back_at = std::chrono::steady_clock::now();
+            break;
+        }
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    CHECK(back_at - ejected_at >= milliseconds(250));
+    CHECK(back_at - ejected_at < std::chrono::seconds(5));
+
+    // Ramping from 10%: a small share of outstanding calls at first...
+    CHECK(share_of(balancer, target, 40) <= 10);
+    // ...an even split once slow start is over.
+    std::this_thread::sleep_for(milliseconds(options.slow_start_ms));
+    const int settled = share_of(balancer, target, 40);
+    CHECK(settled >= 19 && settled <= 21);
+}
+
+void test_fingerprint_from_endpoints_in_service() {
+    const std::string v1 = "{\"ok\":true,\"model_version\":\"m1\",\"conf\":0.25,\"protocols\":[\"json\",\"frame/1\"]}";
+    const std::string v2 = "{\"ok\":true,\"model_version\":\"m2\",\"conf\":0.25,\"protocols\":[\"json\"]}";
+    HealthServer a(v1);
+    HealthServer b(v1);
+    HealthServer other(v2);
+
+    {
+        EngineBalancer single({a.endpoint()}, EnginePoolOptions{}, EngineBalancerOptions{});
+        CHECK(single.await_health(std::chrono::seconds(5)));
+        CHECK(single.model_fingerprint() == "m1|conf=0.25");
+        CHECK(single.all_list_protocol("frame/1"));
+    }
+
+    // An endpoint that never answers does not hold the others' fingerprint back.
+    {
+        EngineBalancerOptions options;
+        options.health_timeout_ms = 200;
+        EngineBalancer balancer({a.endpoint(), b.endpoint(), EngineEndpoint{"127.0.0.1", 1}}, EnginePoolOptions{},
+                                options);
+        CHECK(balancer.await_health(std::chrono::seconds(5)));
+        CHECK(balancer.model_fingerprint() == "m1|conf=0.25");
+        CHECK(balancer.all_list_protocol("frame/1"));
+    }
+
+    // Disagreement pauses the fingerprint until the odd one out is ejected.
+    EngineBalancerOptions options;
+    options.health_interval_ms = 60000;
+    options.eject_after_failures = 1;
+    options.eject_ms = 60000;
+    EngineBalancer balancer({a.endpoint(), other.endpoint()}, EnginePoolOptions{}, options);
+    CHECK(balancer.await_health(std::chrono::seconds(5)));
+    CHECK(balancer.model_fingerprint().empty());
+    CHECK(!balancer.all_list_protocol("frame/1"));
+    fail_one_call(balancer, name_of(other.endpoint()));
+    CHECK(balancer.model_fingerprint() == "m1|conf=0.25");
+    CHECK(balancer.all_list_protocol("frame/1"));
+}
+
+} // namespace
+
+int main() {
+    HealthServer a;
+    HealthServer b;
+    test_call_failures_eject(a, b);
+    test_return_and_slow_start(a, b);
+    test_fingerprint_from_endpoints_in_service();
+    return check_result("test_engine_balancer");
+}
@@ -0,0 +1,149 @@
+// parse_engine_response / parse_engine_frame: the SAX mapping of engine answers onto
+// per-image verdicts, including the defaults for missing or mistyped fields, repeated
+// keys, skipped unknown keys, and rejection of malformed bodies and frames.
+#include "services/engine_response.h"
+#include "utils/engine_frame.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using Strings = std::vector<std::string>;
+
+const char* kDefaultError = "Engine failed to analyze image";
+
+void test_contract_example() {
+    const std::string body = R"({
+      "ok": true,
+      "results": [
+        {"ok": true, "path": "tmp/req_demo_001_0_front.jpg", "damage_types": ["crack"], "inference_mode": "model"},
+        {"ok": false, "shm": "/buildcheck_req_1", "error": "inference failed", "damage_types": []}
+      ]
+    })";
+    ParsedEngineResponse r;
+    CHECK(parse_engine_response(body, r));
+    CHECK(r.has_results && !r.has_error);
+    CHECK(r.results.size() == 2);
+    if (r.results.size() != 2) return;
+    CHECK(r.results[0].path == "tmp/req_demo_001_0_front.jpg" && r.results[0].shm.empty());
+    CHECK(r.results[0].verdict.ok);
+    CHECK(r.results[0].verdict.damage_types == Strings{"crack"});
+    CHECK(r.results[0].verdict.inference_mode == "model");
+    CHECK(r.results[0].verdict.error.empty());
+    CHECK(r.results[1].shm == "/buildcheck_req_1" && r.results[1].path.empty());
+    CHECK(!r.results[1].verdict.ok);
+    CHECK(r.results[1].verdict.error == "inference failed");
+}
+
+void test_mistyped_fields_fall_back_to_defaults() {
+    const std::string body = R"({"results": [
+        {"ok": "yes", "path": 5, "damage_types": ["a", 1, {"x": "y"}, "b"], "error": 7},
+        3, "x", [1, 2], null,
+        {"ok": true, "error": "ignored for a successful image", "extra": {"results": [1]}}
+    ]})";
+    ParsedEngineResponse r;
+    CHECK(parse_engine_response(body, r));
+    CHECK(r.results.size() == 6);
+    if (r.results.size() != 6) return;
+    const CachedAnalysis& first = r.results[0].verdict;
+    CHECK(!first.ok);
+    CHECK(r.results[0].path.empty());
+    CHECK(first.damage_types == (Strings{"a", "b"}));
+    CHECK(first.error == kDefaultError);
+    for (std::size_t i = 1; i <= 4; ++i) {
+        CHECK(!r.results[i].verdict.ok);
+        CHECK(r.results[i].verdict.error == kDefaultError);
+    }
+    CHECK(r.results[5].verdict.ok);
+    CHECK(r.results[5].verdict.error.empty());
+}
+
+void test_repeated_and_unknown_keys() {
+    ParsedEngineResponse r;
+    // The last occurrence wins, even when it has the wrong type.
+    CHECK(parse_engine_response(R"({"results": [{"ok": true, "path": "a", "ok": "no", "path": "b"}]})", r));
+    CHECK(r.results.size() == 1 && !r.results[0].verdict.ok && r.results[0].path == "b");
+    CHECK(parse_engine_response(R"({"results": [{"ok": true}], "results": 5})", r));
+    CHECK(!r.has_results && r.results.empty());
+    CHECK(parse_engine_response(R"({"error": "first", "error": {"message": "second"}})", r));
+    CHECK(r.has_error && r.error == "second");
+    CHECK(parse_engine_response(R"({"error": "first", "error": {"code": 3}})", r));
+    CHECK(!r.has_error && r.error.empty());
+
+    // Keys the API does not read are skipped whatever they hold.
+    CHECK(parse_engine_response(R"({"meta": {"results": [{"ok": true}], "error": "x"}, "results": []})", r));
+    CHECK(r.has_results && r.results.empty() && !r.has_error);
+}
+
+void test_errors_and_invalid_bodies() {
+    ParsedEngineResponse r;
+    CHECK(parse_engine_response(R"({"ok": false, "error": "path not allowed"})", r));
+    CHECK(r.has_error && r.error == "path not allowed" && !r.has_results);
+    CHECK(parse_engine_response(R"({"error": {"code": "UNAUTHORIZED", "message": "bad key"}})", r));
+    CHECK(r.has_error && r.error == "bad key");
+
+    // Valid JSON that is not an object carries nothing.
+    CHECK(parse_engine_response("[1, 2]", r));
+    CHECK(!r.has_results && !r.has_error);
+
+    // Every truncation of a valid body is rejected, and leaves nothing half-filled.
+    const std::string body = R"({"results": [{"ok": true, "path": "p", "damage_types": ["crack"]}], "error": "e"})";
+    for (std::size_t cut = 0; cut < body.size(); ++cut) {
+        ParsedEngineResponse partial;
+        if (parse_engine_response(std::string_view(body).substr(0, cut), partial)) {
+            CHECK(!"truncated body parsed");
+            break;
+        }
+        CHECK(!partial.has_results && partial.results.empty() && !partial.has_error);
+    }
+    CHECK(!parse_engine_response("", r));
+    CHECK(!parse_engine_response("{\"results\": [}", r));
+}
+
+void test_frame_mapping() {
+    FrameAnalyzeResponse res;
+    res.ok = true;
+    res.has_results = true;
+    FrameImageResult path;
+    path.ok = true;
+    path.source = FrameSource::Path;
+    path.handle = "/tmp/a.jpg";
+    path.inference_mode = "model";
+    path.damage_types = {"crack", "mold"};
+    FrameImageResult shm;
+    shm.source = FrameSource::Shm;
+    shm.handle = "/buildcheck_x_0";
+    FrameImageResult image;
+    image.source = FrameSource::Image;
+    image.handle = "0";
+    image.error = "deadline exceeded";
+    res.results = {path, shm, image};
+    const std::string frame = encode_frame_response(res);
+
+    ParsedEngineResponse r;
+    CHECK(parse_engine_frame(frame, r));
+    CHECK(r.has_results && r.results.size() == 3);
+    if (r.results.size() == 3) {
+        CHECK(r.results[0].path == "/tmp/a.jpg" && r.results[0].verdict.ok);
+        CHECK(r.results[0].verdict.damage_types == (Strings{"crack", "mold"}));
+        CHECK(r.results[1].shm == "/buildcheck_x_0" && r.results[1].verdict.error == kDefaultError);
+        CHECK(r.results[2].path.empty() && r.results[2].shm.empty());
+        CHECK(r.results[2].verdict.error == "deadline exceeded");
+    }
+
+    CHECK(!parse_engine_frame(std::string_view(frame).substr(0, frame.size() - 1), r));
+    CHECK(!parse_engine_frame("{\"results\": []}", r));
+}
+
+} // namespace
+
+int main() {
+    test_contract_example();
+    test_mistyped_fields_fall_back_to_defaults();
+    test_repeated_and_unknown_keys();
+    test_errors_and_invalid_bodies();
+    test_frame_mapping();
+    return check_result("test_engine_response");
+}
@@ -0,0 +1,139 @@
+// configure_http_server: connections beyond the workers and their queue are answered
+// 503 by the shedder instead of being reset, and told to reconnect; the admission
+// check refuses a request before its handler (and its body) is reached.
+#include "services/http_server.h"
+#include "check.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+using std::chrono::milliseconds;
+
+class TestServer {
+public:
+    TestServer(const HttpServerOptions& options, AdmissionCheck admit = {}) {
+        configure_http_server(server_, options, std::move(admit));
+        server_.Get("/slow", [this](const httplib::Request&, httplib::Response& res) {
+            std::unique_lock<std::mutex> lock(mu_);
+            ++slow_started_;
+            cv_.notify_all();
+            cv_.wait(lock, [this] { return released_; });
+            res.set_content("slow", "text/plain");
+        });
+        server_.Get("/fast", [](const httplib::Request&, httplib::Response& res) {
+            res.set_content("fast", "text/plain");
+        });
+        port_ = server_.bind_to_any_port("127.0.0.1");
+        thread_ = std::thread([this] { server_.listen_after_bind(); });
+        server_.wait_until_ready();
+    }
+    ~TestServer() {
+        release();
+        server_.stop();
+        thread_.join();
+    }
+
+    httplib::Server& server() { return server_; }
+    int port() const { return port_; }
+
+    bool wait_slow_started(int n) {
+        std::unique_lock<std::mutex> lock(mu_);
+        return cv_.wait_for(lock, std::chrono::seconds(5), [&] { return slow_started_ >= n; });
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mu_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    httplib::Server server_;
+    int port_ = 0;
+    std::thread thread_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    int slow_started_ = 0;
+    bool released_ = false;
+};
+
+void test_overflow_is_shed_with_503() {
+    HttpServerOptions options;
+    options.workers = 1;
+    options.max_queue = 1;
+    TestServer ts(options);
+
+    int busy_status = 0;
+    int queued_status = 0;
+    std::thread busy([&] {
+        httplib::Client c("127.0.0.1", ts.port());
+        if (auto r = c.Get("/slow")) busy_status = r->status;
+    });
+    CHECK(ts.wait_slow_started(1));   // the only worker is taken
+    std::thread queued([&] {
+        httplib::Client c("127.0.0.1", ts.port());
+        if (auto r = c.Get("/fast")) queued_status = r->status;
+    });
+    std::this_thread::sleep_for(milliseconds(200));   // ...and the one queue slot
+
+    httplib::Client shed("127.0.0.1", ts.port());
+    shed.set_keep_alive(true);
+    const auto r = shed.Get("/fast");
+    CHECK(r);
+    if (r) {
+        CHECK(r->status == 503);
+        CHECK(r->get_header_value("Retry-After") == "1");
+        CHECK(r->get_header_value("Connection") == "close");
+        CHECK(r->body.find("\"SERVER_BUSY\"") != std::string::npos);
+    }
+
+    ts.release();
+    busy.join();
+    queued.join();
+    CHECK(busy_status == 200);
+    CHECK(queued_status == 200);
+
+    // With the worker free again the same client is served normally.
+    const auto again = shed.Get("/fast");
+    CHECK(again && again->status == 200);
+}
+
+void test_admission_refuses_before_the_handler() {
+    HttpServerOptions options;
+    options.workers = 2;
+    TestServer ts(options, [](const httplib::Request& req, httplib::Response& res) {
+        if (req.path != "/upload" || !req.has_header("X-Deny")) return true;
+        res.status = 429;
+        res.set_header("Retry-After", "3");
+        res.set_header("Connection", "close");   // as admit_analyze_request does: the body is never read
+        return false;
+    });
+    int uploads = 0;
+    ts.server().Post("/upload", [&uploads](const httplib::Request&, httplib::Response& res) {
+        ++uploads;
+        res.set_content("stored", "text/plain");
+    });
+
+    const std::string body(256 * 1024, 'x');
+    httplib::Client c("127.0.0.1", ts.port());
+    const auto refused = c.Post("/upload", httplib::Headers{{"X-Deny", "1"}}, body, "application/octet-stream");
+    CHECK(refused && refused->status == 429);
+    if (refused) CHECK(refused->get_header_value("Retry-After") == "3");
+    CHECK(uploads == 0);
+
+    const auto admitted = c.Post("/upload", body, "application/octet-stream");
+    CHECK(admitted && admitted->status == 200 && admitted->body == "stored");
+    CHECK(uploads == 1);
+}
+
+} // namespace
+
+int main() {
+    test_overflow_is_shed_with_503();
+    test_admission_refuses_before_the_handler();
+    return check_result("test_http_server");
+}
@@ -0,0 +1,207 @@
+// ImageHeaderParser: dimensions and channels from JPEG, PNG and WebP headers, the
+// same answer whether the bytes arrive at once or one by one, JPEG segments skipped
+// without buffering, malformed headers rejected, and the dimension limits.
+#include "utils/image_header.h"
+#include "check.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+void put_be16(Bytes& b, std::uint32_t v) {
+    b.push_back(static_cast<std::uint8_t>(v >> 8));
+    b.push_back(static_cast<std::uint8_t>(v));
+}
+void put_be32(Bytes& b, std::uint32_t v) {
+    put_be16(b, v >> 16);
+    put_be16(b, v & 0xFFFF);
+}
+void put_le(Bytes& b, std::uint32_t v, int n) {
+    for (int i = 0; i < n; ++i) b.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+}
+void put(Bytes& b, const char* s) {
+    while (*s) b.push_back(static_cast<std::uint8_t>(*s++));
+}
+
+// SOI, an APP0 and a large APP1 (EXIF-sized), a DHT, fill bytes, then SOFn.
+Bytes jpeg(std::uint32_t width, std::uint32_t height, std::uint8_t components, std::uint8_t sof = 0xC0) {
+    Bytes b = {0xFF, 0xD8, 0xFF, 0xE0};
+    put_be16(b, 16);
+    put(b, "JFIF");
+    b.resize(b.size() + 10, 0);
+    b.insert(b.end(), {0xFF, 0xE1});
+    put_be16(b, 60000);
+    b.resize(b.size() + 59998, 0xAB);
+    b.insert(b.end(), {0xFF, 0xC4});   // DHT shares the SOF range but is a plain segment
+    put_be16(b, 4);
+    b.insert(b.end(), {0x00, 0x00});
+    b.insert(b.end(), {0xFF, 0xFF, 0xFF, sof});
+    put_be16(b, 8 + 3 * components);
+    b.push_back(8);
+    put_be16(b, height);
+    put_be16(b, width);
+    b.push_back(components);
+    b.resize(b.size() + 3 * components + 100, 0);   // component specs and scan data
+    return b;
+}
+
+Bytes png(std::uint32_t width, std::uint32_t height, std::uint8_t color) {
+    Bytes b = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+    put_be32(b, 13);
+    put(b, "IHDR");
+    put_be32(b, width);
+    put_be32(b, height);
+    b.push_back(8);
+    b.push_back(color);
+    b.resize(b.size() + 7, 0);
+    return b;
+}
+
+Bytes riff(const char* fourcc, const Bytes& payload) {
+    Bytes b;
+    put(b, "RIFF");
+    put_le(b, static_cast<std::uint32_t>(12 + payload.size()), 4);
+    put(b, "WEBP");
+    put(b, fourcc);
+    put_le(b, static_cast<std::uint32_t>(payload.size()), 4);
+    b.insert(b.end(), payload.begin(), payload.end());
+    return b;
+}
+
+Bytes webp_lossy(std::uint32_t width, std::uint32_t height) {
+    Bytes p = {0x30, 0x01, 0x00, 0x9D, 0x01, 0x2A};
+    put_le(p, width, 2);
+    put_le(p, height, 2);
+    return riff("VP8 ", p);
+}
+
+Bytes webp_lossless(std::uint32_t width, std::uint32_t height, bool alpha) {
+    Bytes p = {0x2F};
+    put_le(p, (width - 1) | ((height - 1) << 14) | (alpha ? 1u << 28 : 0u), 4);
+    return riff("VP8L", p);
+}
+
+Bytes webp_extended(std::uint32_t width, std::uint32_t height, bool alpha) {
+    Bytes p = {static_cast<std::uint8_t>(alpha ? 0x10 : 0x00), 0, 0, 0};
+    put_le(p, width - 1, 3);
+    put_le(p, height - 1, 3);
+    return riff("VP8X", p);
+}
+
+// Parses `b` whole and one byte at a time; both must agree.
+bool parse(const Bytes& b, ImageInfo& info, std::string& error) {
+    const bool whole = parse_image_header(b.data(), b.size(), info, error);
+    ImageHeaderParser parser;
+    for (std::uint8_t byte : b) {
+        if (parser.feed(&byte, 1) != ImageHeaderParser::State::NeedMore) break;
+    }
+    if (whole) {
+        CHECK(parser.state() == ImageHeaderParser::State::Done);
+        CHECK(parser.info().width == info.width && parser.info().height == info.height);
+        CHECK(parser.info().channels == info.channels && parser.info().format == info.format);
+    } else {
+        CHECK(parser.state() != ImageHeaderParser::State::Done);
+    }
+    return whole;
+}
+
+bool is(const Bytes& b, ImageFormat format, std::uint32_t width, std::uint32_t height, std::uint8_t channels) {
+    ImageInfo info;
+    std::string error;
+    return parse(b, info, error) && info.format == format && info.width == width && info.height == height &&
+           info.channels == channels;
+}
+
+std::string rejection(const Bytes& b) {
+    ImageInfo info;
+    std::string error;
+    return parse(b, info, error) ? std::string() : error;
+}
+
+void test_formats() {
+    CHECK(is(jpeg(4032, 3024, 3), ImageFormat::Jpeg, 4032, 3024, 3));
+    CHECK(is(jpeg(640, 480, 1, 0xC2), ImageFormat::Jpeg, 640, 480, 1));   // progressive
+    CHECK(is(png(1920, 1080, 2), ImageFormat::Png, 1920, 1080, 3));
+    CHECK(is(png(16, 16, 6), ImageFormat::Png, 16, 16, 4));
+    CHECK(is(png(16, 16, 4), ImageFormat::Png, 16, 16, 2));
+    CHECK(is(webp_lossy(1024, 768), ImageFormat::Webp, 1024, 768, 3));
+    CHECK(is(webp_lossless(16383, 1, true), ImageFormat::Webp, 16383, 1, 4));
+    CHECK(is(webp_extended(100000, 200000, false), ImageFormat::Webp, 100000, 200000, 3));
+    CHECK(std::string(image_format_name(ImageFormat::Webp)) == "webp");
+}
+
+void test_jpeg_segments_are_skipped_not_buffered() {
+    // A header past 60 KB of EXIF is found, and nothing after the frame header is read.
+    const Bytes b = jpeg(800, 600, 3);
+    ImageHeaderParser parser;
+    CHECK(parser.feed(b.data(), b.size() - 50) == ImageHeaderParser::State::Done);
+    CHECK(parser.info().width == 800);
+    CHECK(parser.feed("garbage", 7) == ImageHeaderParser::State::Done);
+}
+
+void test_malformed_headers() {
+    CHECK(rejection(Bytes(20, 0x42)) == "Unknown image format");
+    CHECK(rejection(jpeg(0, 600, 3)) == "Image has zero width or height");
+    CHECK(rejection(jpeg(800, 600, 2)) == "Unsupported JPEG component count");
+    CHECK(rejection(png(0x80000000u, 1, 2)) == "Malformed PNG header");
+    CHECK(rejection(png(1, 1, 5)) == "Malformed PNG header");
+
+    Bytes no_frame = {0xFF, 0xD8, 0xFF, 0xDA, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0};
+    CHECK(rejection(no_frame) == "JPEG has no frame header");
+    Bytes bad_marker = {0xFF, 0xD8, 0x12, 0x34, 0, 0, 0, 0, 0, 0, 0, 0};
+    CHECK(rejection(bad_marker) == "Malformed JPEG marker");
+
+    Bytes bad_ihdr = png(10, 10, 2);
+    bad_ihdr[12] = 'X';
+    CHECK(rejection(bad_ihdr) == "PNG does not start with IHDR");
+
+    Bytes bad_vp8 = webp_lossy(10, 10);
+    bad_vp8[23] = 0x00;
+    CHECK(rejection(bad_vp8) == "Malformed WebP VP8 header");
+    CHECK(rejection(riff("ALPH", Bytes(10, 0))) == "Unknown WebP chunk");
+
+    // Cut short anywhere before the dimensions: truncated, never a guess.
+    const Bytes whole = png(10, 10, 2);
+    for (std::size_t cut = 0; cut < 24; ++cut) {
+        ImageInfo info;
+        std::string error;
+        CHECK(!parse_image_header(whole.data(), cut, info, error));
+        CHECK(error == "Truncated image header");
+    }
+}
+
+void test_limits() {
+    const ImageLimits limits;   // 50 MP, 20000 px per side
+    ImageInfo info;
+    std::string error;
+    info.width = 8000;
+    info.height = 6000;
+    CHECK(check_image_limits(info, limits, error));
+    info.width = 20001;
+    info.height = 10;
+    CHECK(!check_image_limits(info, limits, error));
+    CHECK(error == "Image dimensions too large (20001x10)");
+    info.width = 10000;
+    info.height = 5001;   // 50.01 MP
+    CHECK(!check_image_limits(info, limits, error));
+
+    // Zero disables a limit.
+    CHECK(check_image_limits(info, ImageLimits{0, 20'000}, error));
+    info.width = 65535;
+    info.height = 1;
+    CHECK(check_image_limits(info, ImageLimits{50'000'000, 0}, error));
+}
+
+} // namespace
+
+int main() {
+    test_formats();
+    test_jpeg_segments_are_skipped_not_buffered();
+    test_malformed_headers();
+    test_limits();
+    return check_result("test_image_header");
+}
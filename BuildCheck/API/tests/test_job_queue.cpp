@@ -0,0 +1,73 @@
+// JobQueue: results are pollable only by the client that submitted the job, and the
+// queue refuses work beyond max_queue.
+#include "services/job_queue.h"
+#include "check.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+bool wait_done(JobQueue& jobs, const std::string& id, const std::string& owner, JobSnapshot& out) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (jobs.lookup(id, owner, out) && out.state == JobState::Done) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+void test_lookup_is_scoped_to_the_owner() {
+    JobQueue jobs(JobQueueOptions{1, 4, std::chrono::seconds(60), 16});
+    CHECK(jobs.submit("job1", "10.0.0.1", [] { return JobResult{200, "{\"ok\":true}"}; }));
+    CHECK(!jobs.submit("job1", "10.0.0.1", [] { return JobResult{}; }));   // ids are unique
+
+    JobSnapshot snapshot;
+    CHECK(wait_done(jobs, "job1", "10.0.0.1", snapshot));
+    CHECK(snapshot.result.status == 200);
+    CHECK(snapshot.result.body == "{\"ok\":true}");
+
+    JobSnapshot other;
+    CHECK(!jobs.lookup("job1", "10.0.0.2", other));
+    CHECK(!jobs.lookup("job1", "", other));
+    CHECK(!jobs.lookup("job2", "10.0.0.1", other));
+}
+
+void test_queue_is_bounded() {
+    JobQueue jobs(JobQueueOptions{1, 1, std::chrono::seconds(60), 16});
+    std::mutex mu;
+    std::condition_variable cv;
+    bool started = false;
+    bool release = false;
+    CHECK(jobs.submit("busy", "k", [&] {
+        std::unique_lock<std::mutex> lock(mu);
+        started = true;
+        cv.notify_all();
+        cv.wait(lock, [&] { return release; });
+        return JobResult{200, ""};
+    }));
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        CHECK(cv.wait_for(lock, std::chrono::seconds(5), [&] { return started; }));
+    }
+    CHECK(jobs.submit("queued", "k", [] { return JobResult{200, ""}; }));
+    CHECK(!jobs.submit("refused", "k", [] { return JobResult{200, ""}; }));
+    CHECK(jobs.stats().rejected == 1);
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        release = true;
+    }
+    cv.notify_all();
+    JobSnapshot snapshot;
+    CHECK(wait_done(jobs, "queued", "k", snapshot));
+}
+
+} // namespace
+
+int main() {
+    test_lookup_is_scoped_to_the_owner();
+    test_queue_is_bounded();
+    return check_result("test_job_queue");
+}
@@ -0,0 +1,88 @@
+// RateLimiter (GCRA): a fresh key gets its burst, then one request per interval, and
+// a refusal says how long until the next one would be admitted. New keys beyond the
+// cap are refused too.
+#include "services/rate_limiter.h"
+#include "check.h"
+
+#include <chrono>
+#include <string>
+
+namespace {
+
+using std::chrono::milliseconds;
+
+void test_burst_then_retry_after() {
+    RateLimiter limiter(RateLimitOptions{60, 5, 1000});   // one per second, bursts of 5
+    const auto t0 = RateLimiter::Clock::now();
+
+    for (int i = 0; i < 5; ++i) CHECK(limiter.admit("k", t0).allowed);
+    const RateLimiter::Decision refused = limiter.admit("k", t0);
+    CHECK(!refused.allowed);
+    CHECK(refused.retry_after == milliseconds(1000));
+
+    // Refusals do not push the window out.
+    const RateLimiter::Decision later = limiter.admit("k", t0 + milliseconds(400));
+    CHECK(!later.allowed);
+    CHECK(later.retry_after == milliseconds(600));
+
+    CHECK(limiter.admit("k", t0 + milliseconds(1000)).allowed);
+    CHECK(!limiter.admit("k", t0 + milliseconds(1000)).allowed);
+
+    // Other keys have their own budget.
+    CHECK(limiter.admit("other", t0).allowed);
+
+    // A key left alone long enough gets its whole burst back.
+    const auto idle = t0 + std::chrono::seconds(10);
+    for (int i = 0; i < 5; ++i) CHECK(limiter.admit("k", idle).allowed);
+    CHECK(!limiter.admit("k", idle).allowed);
+}
+
+void test_retry_after_rounds_up() {
+    RateLimiter limiter(RateLimitOptions{7, 1, 1000});   // 60s / 7 = 8571.4ms
+    const auto t0 = RateLimiter::Clock::now();
+    CHECK(limiter.admit("k", t0).allowed);
+    const RateLimiter::Decision refused = limiter.admit("k", t0);
+    CHECK(!refused.allowed);
+    CHECK(refused.retry_after == milliseconds(8572));
+}
+
+void test_disabled_and_key_cap() {
+    RateLimiter off(RateLimitOptions{0, 5, 1000});
+    CHECK(!off.enabled());
+    const auto t0 = RateLimiter::Clock::now();
+    for (int i = 0; i < 100; ++i) CHECK(off.admit("k", t0).allowed);
+    CHECK(off.size() == 0);
+
+    // Past the cap newcomers are refused until the earliest tracked window ends,
+    // rather than growing the table or going unlimited.
+    RateLimiter capped(RateLimitOptions{1, 1, 1});   // one per minute; 64 keys per shard
+    int admitted = 0;
+    int refused = 0;
+    for (int i = 0; i < 10000; ++i) {
+        const RateLimiter::Decision d = capped.admit("key" + std::to_string(i), t0 + milliseconds(i));
+        if (d.allowed) {
+            ++admitted;
+            continue;
+        }
+        ++refused;
+        CHECK(d.retry_after > milliseconds(0));
+        CHECK(d.retry_after <= std::chrono::minutes(1));
+    }
+    CHECK(admitted == 64 * 64);
+    CHECK(refused == 10000 - 64 * 64);
+    CHECK(capped.size() == 64 * 64);
+
+    // Tracked keys keep their own budget meanwhile...
+    CHECK(!capped.admit("key0", t0 + std::chrono::seconds(1)).allowed);
+    // ...and newcomers get in once the windows of the first keys have ended.
+    CHECK(capped.admit("late", t0 + std::chrono::seconds(70)).allowed);
+}
+
+} // namespace
+
+int main() {
+    test_burst_then_retry_after();
+    test_retry_after_rounds_up();
+    test_disabled_and_key_cap();
+    return check_result("test_rate_limiter");
+}
@@ -0,0 +1,96 @@
+// SessionStore: expiry through the per-shard heaps, revocation, and the write-behind
+// flusher persisting the set for the next process.
+#include "services/session_store.h"
+#include "check.h"
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+long long unix_now() {
+    return static_cast<long long>(std::time(nullptr));
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void test_expiry_and_revoke() {
+    SessionStore store(SessionStoreOptions{"", std::chrono::milliseconds(250), 4});
+    const long long now = 1'000'000;
+    store.create("short", now + 10);
+    store.create("long", now + 100);
+    store.create("gone", now + 100);
+    CHECK(store.size() == 3);
+
+    CHECK(store.validate("short", now + 9));
+    CHECK(!store.validate("short", now + 10));
+    CHECK(store.size() == 2);   // dropped by the heap, not just reported invalid
+    CHECK(!store.validate("unknown", now));
+
+    store.revoke("gone");
+    CHECK(!store.validate("gone", now));
+    CHECK(store.size() == 1);
+
+    // Re-creating an id pushes its expiry out; the stale heap entry must not evict it.
+    store.create("long", now + 200);
+    CHECK(store.validate("long", now + 150));
+    CHECK(!store.validate("long", now + 200));
+    CHECK(store.size() == 0);
+}
+
+void test_write_behind_flush(const ScratchDir& dir) {
+    const std::string path = dir.file("sessions.json");
+    const long long now = unix_now();
+    {
+        SessionStore store(SessionStoreOptions{path, std::chrono::milliseconds(20), 4});
+        store.create("alive", now + 3600);
+        store.create("revoked", now + 3600);
+        store.revoke("revoked");
+
+        // The flusher writes without anyone calling flush().
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (read_file(path).find("alive") == std::string::npos && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        const std::string snapshot = read_file(path);
+        CHECK(snapshot.find("alive") != std::string::npos);
+        CHECK(snapshot.find("revoked") == std::string::npos);
+
+        store.create("late", now + 3600);   // flushed on shutdown at the latest
+    }
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+
+    SessionStore reloaded(SessionStoreOptions{path, std::chrono::milliseconds(20), 4});
+    CHECK(reloaded.size() == 2);
+    CHECK(reloaded.validate("alive", now));
+    CHECK(reloaded.validate("late", now));
+    CHECK(!reloaded.validate("revoked", now));
+}
+
+void test_expired_sessions_are_not_loaded(const ScratchDir& dir) {
+    const std::string path = dir.file("expired.json");
+    const long long now = unix_now();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "{\"old\":" << (now - 5) << ",\"new\":" << (now + 3600) << ",\"bad\":\"x\"}";
+    }
+    SessionStore store(SessionStoreOptions{path, std::chrono::milliseconds(20), 4});
+    CHECK(store.size() == 1);
+    CHECK(store.validate("new", now));
+}
+
+} // namespace
+
+int main() {
+    ScratchDir dir("buildcheck_session_store");
+    test_expiry_and_revoke();
+    test_write_behind_flush(dir);
+    test_expired_sessions_are_not_loaded(dir);
+    return check_result("test_session_store");
+}
@@ -139,6 +139,7 @@ async function callAnalyzeApi(file) {
   try {
     res = await fetch(ANALYZE_API_URL, {
       method: "POST",
+      headers: { "X-Request-Timeout-Ms": String(REQUEST_TIMEOUT_MS) },
       body: fd,
       signal: ctrl.signal,
     });
@@ -0,0 +1,148 @@
+// Times postprocess_yolo on a synthetic YOLOv8 head output and prints one JSON line.
+//
+//   bench_postprocess [--classes N] [--anchors N] [--objects N] [--iterations N]
+//                     [--conf F] [--seed N] [--dump tensor.f32]
+//
+// --dump writes the tensor (int32 channels, int32 anchors, float32 data) so
+// bench_postprocess.py can time the Python path on identical input.
+#include "postprocessing/result_postprocess.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Args {
+    int classes = 6;
+    int anchors = 8400;
+    int objects = 40;
+    int iterations = 2000;
+    float conf = 0.25f;
+    unsigned seed = 7;
+    std::string dump;
+};
+
+bool parse_args(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (flag == "--classes") args.classes = std::max(1, std::atoi(value));
+        else if (flag == "--anchors") args.anchors = std::max(1, std::atoi(value));
+        else if (flag == "--objects") args.objects = std::max(0, std::atoi(value));
+        else if (flag == "--iterations") args.iterations = std::max(1, std::atoi(value));
+        else if (flag == "--conf") args.conf = static_cast<float>(std::atof(value));
+        else if (flag == "--seed") args.seed = static_cast<unsigned>(std::atoi(value));
+        else if (flag == "--dump") args.dump = value;
+        else return false;
+    }
+    return true;
+}
+
+// Mimics a real head: most anchors are background noise, a few objects are each
+// hit by a cluster of overlapping anchors with high scores for one class.
+std::vector<float> make_tensor(const Args& args) {
+    const int channels = 4 + args.classes;
+    const int anchors = args.anchors;
+    std::vector<float> t(static_cast<std::size_t>(channels) * anchors);
+    std::mt19937 rng(args.seed);
+    std::uniform_real_distribution<float> pos(0.0f, 640.0f);
+    std::uniform_real_distribution<float> size(8.0f, 200.0f);
+    std::uniform_real_distribution<float> noise(0.0f, 0.05f);
+    std::uniform_real_distribution<float> jitter(-6.0f, 6.0f);
+    std::uniform_real_distribution<float> strong(0.3f, 0.95f);
+    std::uniform_int_distribution<int> cls(0, args.classes - 1);
+
+    for (int a = 0; a < anchors; ++a) {
+        t[a] = pos(rng);
+        t[anchors + a] = pos(rng);
+        t[2 * anchors + a] = size(rng);
+        t[3 * anchors + a] = size(rng);
+        for (int c = 0; c < args.classes; ++c) t[(4 + c) * anchors + a] = noise(rng);
+    }
+    std::uniform_int_distribution<int> anchor(0, anchors - 1);
+    for (int o = 0; o < args.objects; ++o) {
+        const float cx = pos(rng), cy = pos(rng), w = size(rng), h = size(rng);
+        const int c = cls(rng);
+        for (int k = 0; k < 25; ++k) {
+            const int a = anchor(rng);
+            t[a] = cx + jitter(rng);
+            t[anchors + a] = cy + jitter(rng);
+            t[2 * anchors + a] = w + jitter(rng);
+            t[3 * anchors + a] = h + jitter(rng);
+            t[(4 + c) * anchors + a] = strong(rng);
+        }
+    }
+    return t;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse_args(argc, argv, args)) {
+        std::cerr << "usage: bench_postprocess [--classes N] [--anchors N] [--objects N] "
+                     "[--iterations N] [--conf F] [--seed N] [--dump tensor.f32]\n";
+        return 2;
+    }
+    const int channels = 4 + args.classes;
+    const std::vector<float> tensor = make_tensor(args);
+
+    if (!args.dump.empty()) {
+        std::ofstream out(args.dump, std::ios::binary);
+        const std::int32_t header[2] = {channels, args.anchors};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(tensor.data()),
+                  static_cast<std::streamsize>(tensor.size() * sizeof(float)));
+        if (!out) {
+            std::cerr << "failed to write " << args.dump << "\n";
+            return 1;
+        }
+    }
+
+    LetterboxInfo lb;
+    lb.src_width = 640;
+    lb.src_height = 640;
+    PostprocessOptions options;
+    options.conf_threshold = args.conf;
+
+    std::vector<std::string> names;
+    for (int c = 0; c < args.classes; ++c) names.push_back("class_" + std::to_string(c));
+
+    std::vector<Detection> detections;
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(args.iterations));
+    for (int i = 0; i < args.iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        detections = postprocess_yolo(tensor.data(), channels, args.anchors, lb, options);
+        const auto labels = damage_types_from_detections(detections, names);
+        const auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        if (labels.size() > names.size()) return 1;   // keeps the call observable
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto pct = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+    };
+
+    std::cout << "{\"path\":\"cpp\",\"kernel\":\"" << postprocess_kernel_name() << "\""
+              << ",\"channels\":" << channels << ",\"anchors\":" << args.anchors
+              << ",\"iterations\":" << args.iterations
+              << ",\"detections\":" << detections.size()
+              << ",\"p50_us\":" << pct(0.50) << ",\"p99_us\":" << pct(0.99)
+              << ",\"damage_types\":[";
+    const auto labels = damage_types_from_detections(detections, names);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        std::cout << (i ? "," : "") << "\"" << labels[i] << "\"";
+    }
+    std::cout << "]}\n";
+    return 0;
+}
@@ -0,0 +1,109 @@
+"""Times the Python detection path on a tensor dumped by bench_postprocess.
+
+    ./bench_postprocess --dump /tmp/yolo_head.f32
+    python3 bench/bench_postprocess.py /tmp/yolo_head.f32
+
+The Python side is what engine_service.py pays per image after the forward pass:
+Ultralytics-style decode + class-offset NMS (torchvision.ops.nms when available,
+numpy otherwise) followed by _extract_damage_types. _extract_damage_types and
+_label_for_class_id are loaded from engine_service.py itself, so the benchmark
+needs neither FastAPI nor Ultralytics installed.
+"""
+from __future__ import annotations
+
+import argparse
+import ast
+import json
+import time
+from pathlib import Path
+from types import SimpleNamespace
+from typing import Any
+
+import numpy as np
+
+ENGINE_SERVICE = Path(__file__).resolve().parents[1] / "engine_service.py"
+MAX_WH = 7680.0
+
+
+def _load_engine_functions() -> dict[str, Any]:
+    tree = ast.parse(ENGINE_SERVICE.read_text(encoding="utf-8"))
+    wanted = {"_label_for_class_id", "_extract_damage_types"}
+    module = ast.Module(body=[n for n in tree.body if isinstance(n, ast.FunctionDef) and n.name in wanted], type_ignores=[])
+    namespace: dict[str, Any] = {"Any": Any}
+    exec(compile(module, str(ENGINE_SERVICE), "exec"), namespace)
+    return namespace
+
+
+def _nms_numpy(boxes: np.ndarray, scores: np.ndarray, iou: float) -> np.ndarray:
+    order = np.argsort(-scores, kind="stable")
+    areas = (boxes[:, 2] - boxes[:, 0]) * (boxes[:, 3] - boxes[:, 1])
+    keep: list[int] = []
+    while order.size:
+        i = order[0]
+        keep.append(int(i))
+        rest = order[1:]
+        iw = np.clip(np.minimum(boxes[i, 2], boxes[rest, 2]) - np.maximum(boxes[i, 0], boxes[rest, 0]), 0, None)
+        ih = np.clip(np.minimum(boxes[i, 3], boxes[rest, 3]) - np.maximum(boxes[i, 1], boxes[rest, 1]), 0, None)
+        inter = iw * ih
+        union = areas[i] + areas[rest] - inter
+        order = rest[~((union > 0) & (inter > iou * union))]
+    return np.asarray(keep, dtype=np.int64)
+
+
+def _nms(boxes: np.ndarray, scores: np.ndarray, iou: float) -> np.ndarray:
+    try:
+        import torch  # type: ignore
+        import torchvision  # type: ignore
+    except Exception:
+        return _nms_numpy(boxes, scores, iou)
+    return torchvision.ops.nms(torch.from_numpy(boxes), torch.from_numpy(scores), iou).numpy()
+
+
+def postprocess(head: np.ndarray, conf: float, iou: float, max_det: int) -> SimpleNamespace:
+    x = head.T                                   # [anchors, 4 + classes]
+    cls_scores = x[:, 4:]
+    best = cls_scores.max(axis=1)
+    keep = best > conf
+    x, best = x[keep], best[keep]
+    cls = cls_scores[keep].argmax(axis=1).astype(np.float32)
+    xy, wh = x[:, :2], x[:, 2:4]
+    boxes = np.concatenate([xy - wh / 2, xy + wh / 2], axis=1)
+    idx = _nms(boxes + cls[:, None] * MAX_WH, best, iou)[:max_det]
+    return SimpleNamespace(boxes=SimpleNamespace(xyxy=boxes[idx], conf=best[idx], cls=cls[idx]))
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser()
+    parser.add_argument("tensor", type=Path)
+    parser.add_argument("--iterations", type=int, default=500)
+    parser.add_argument("--conf", type=float, default=0.25)
+    parser.add_argument("--iou", type=float, default=0.7)
+    args = parser.parse_args()
+
+    raw = args.tensor.read_bytes()
+    channels, anchors = np.frombuffer(raw[:8], dtype=np.int32)
+    head = np.frombuffer(raw[8:], dtype=np.float32).reshape(channels, anchors)
+    names = {c: f"class_{c}" for c in range(int(channels) - 4)}
+    extract = _load_engine_functions()["_extract_damage_types"]
+
+    samples = []
+    for _ in range(max(1, args.iterations)):
+        start = time.perf_counter()
+        result = postprocess(head, args.conf, args.iou, 300)
+        damage_types = extract(result, names)
+        samples.append((time.perf_counter() - start) * 1e6)
+    samples.sort()
+    print(json.dumps({
+        "path": "python",
+        "channels": int(channels),
+        "anchors": int(anchors),
+        "iterations": len(samples),
+        "detections": int(result.boxes.cls.shape[0]),
+        "p50_us": round(samples[len(samples) // 2], 1),
+        "p99_us": round(samples[min(len(samples) - 1, int(len(samples) * 0.99))], 1),
+        "damage_types": damage_types,
+    }))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,191 @@
+"""Binary body for POST /engine/analyze/frame.
+
+Python copy of utils/engine_frame.h (API and C++ engine); the layout is documented
+there and in contracts/engine_api.json. All integers are little-endian.
+"""
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass, field
+from typing import Any
+
+CONTENT_TYPE = "application/x-buildcheck-frame"
+PROTOCOL = "frame/1"
+PATH = "/engine/analyze/frame"
+
+MAGIC = b"BCF1"
+VERSION = 1
+KIND_REQUEST = 1
+KIND_RESPONSE = 2
+
+REC_REQUEST_ID = 1
+REC_PATH = 2
+REC_SHM = 3
+REC_IMAGE = 4
+REC_STATUS = 16
+REC_RESULT = 17
+
+SOURCE_PATH = 1
+SOURCE_SHM = 2
+SOURCE_IMAGE = 3
+
+_HEADER = struct.Struct("<4sBBHI")
+_RECORD = struct.Struct("<BI")
+_U16 = struct.Struct("<H")
+_U64 = struct.Struct("<Q")
+_DETECTION = struct.Struct("<if4f")
+
+
+class FrameError(ValueError):
+    pass
+
+
+@dataclass
+class FrameRequest:
+    request_id: str = ""
+    paths: list[str] = field(default_factory=list)
+    shm: list[tuple[str, int]] = field(default_factory=list)       # (name, size)
+    images: list[memoryview] = field(default_factory=list)         # views into the body
+
+
+def _records(data: bytes, kind: int):
+    view = memoryview(data)
+    if len(view) < _HEADER.size:
+        raise FrameError("truncated frame header")
+    magic, version, got_kind, _reserved, count = _HEADER.unpack_from(view, 0)
+    if magic != MAGIC:
+        raise FrameError("bad frame magic")
+    if version != VERSION:
+        raise FrameError(f"unsupported frame version {version}")
+    if got_kind != kind:
+        raise FrameError("unexpected frame kind")
+    pos = _HEADER.size
+    if count > (len(view) - pos) // _RECORD.size:
+        raise FrameError("record count exceeds frame size")
+    for _ in range(count):
+        if len(view) - pos < _RECORD.size:
+            raise FrameError("truncated record")
+        rtype, length = _RECORD.unpack_from(view, pos)
+        pos += _RECORD.size
+        if len(view) - pos < length:
+            raise FrameError("truncated record")
+        yield rtype, view[pos:pos + length]
+        pos += length
+    if pos != len(view):
+        raise FrameError("trailing bytes after last record")
+
+
+def _str16(value: str) -> bytes:
+    raw = value.encode("utf-8")[:0xFFFF]
+    return _U16.pack(len(raw)) + raw
+
+
+def _record(rtype: int, payload: bytes | memoryview) -> bytes:
+    return _RECORD.pack(rtype, len(payload)) + bytes(payload)
+
+
+def _frame(kind: int, records: list[bytes]) -> bytes:
+    return b"".join([_HEADER.pack(MAGIC, VERSION, kind, 0, len(records)), *records])
+
+
+def decode_request(data: bytes) -> FrameRequest:
+    req = FrameRequest()
+    for rtype, payload in _records(data, KIND_REQUEST):
+        if rtype == REC_REQUEST_ID:
+            req.request_id = bytes(payload).decode("utf-8", "replace")
+        elif rtype == REC_PATH:
+            req.paths.append(bytes(payload).decode("utf-8", "replace"))
+        elif rtype == REC_SHM:
+            if len(payload) < _U64.size:
+                raise FrameError(f"malformed record type {rtype}")
+            (size,) = _U64.unpack_from(payload, 0)
+            req.shm.append((bytes(payload[_U64.size:]).decode("utf-8", "replace"), size))
+        elif rtype == REC_IMAGE:
+            req.images.append(payload)
+    return req
+
+
+def encode_request(req: FrameRequest) -> bytes:
+    records = [_record(REC_REQUEST_ID, req.request_id.encode("utf-8"))]
+    records += [_record(REC_PATH, p.encode("utf-8")) for p in req.paths]
+    records += [_record(REC_SHM, _U64.pack(size) + name.encode("utf-8")) for name, size in req.shm]
+    records += [_record(REC_IMAGE, img) for img in req.images]
+    return _frame(KIND_REQUEST, records)
+
+
+def encode_response(ok: bool, results: list[dict[str, Any]]) -> bytes:
+    """`results` are the dicts /engine/analyze returns; "image" holds an inline index."""
+    records = [_record(REC_STATUS, bytes([(1 if ok else 0) | 2]))]
+    for r in results:
+        if "image" in r:
+            source, handle = SOURCE_IMAGE, str(r["image"])
+        elif "shm" in r:
+            source, handle = SOURCE_SHM, r["shm"]
+        else:
+            source, handle = SOURCE_PATH, r.get("path", "")
+        damage = r.get("damage_types", [])[:0xFFFF]
+        detections = r.get("detections", [])[:0xFFFF]
+        parts = [
+            bytes([1 if r.get("ok") else 0, source]),
+            _str16(handle),
+            _str16(r.get("inference_mode", "")),
+            _str16(r.get("error", "")),
+            _U16.pack(len(damage)),
+            *(_str16(d) for d in damage),
+            _U16.pack(len(detections)),
+        ]
+        for d in detections:
+            parts.append(_DETECTION.pack(int(d.get("class_id", -1)), float(d.get("score", 0.0)), *d.get("box", (0, 0, 0, 0))))
+            parts.append(_str16(d.get("label", "")))
+        records.append(_record(REC_RESULT, b"".join(parts)))
+    return _frame(KIND_RESPONSE, records)
+
+
+def decode_response(data: bytes) -> dict[str, Any]:
+    """Inverse of encode_response, in the /engine/analyze JSON shape."""
+    out: dict[str, Any] = {"ok": False, "results": []}
+    for rtype, payload in _records(data, KIND_RESPONSE):
+        if rtype == REC_STATUS:
+            if not payload:
+                raise FrameError(f"malformed record type {rtype}")
+            out["ok"] = bool(payload[0] & 1)
+        elif rtype == REC_RESULT:
+            out["results"].append(_decode_result(bytes(payload)))
+    return out
+
+
+def _decode_result(buf: bytes) -> dict[str, Any]:
+    pos = 0
+
+    def take(n: int) -> bytes:
+        nonlocal pos
+        if len(buf) - pos < n:
+            raise FrameError(f"malformed record type {REC_RESULT}")
+        chunk = buf[pos:pos + n]
+        pos += n
+        return chunk
+
+    def str16() -> str:
+        (n,) = _U16.unpack(take(2))
+        return take(n).decode("utf-8", "replace")
+
+    flags, source = take(2)
+    key = {SOURCE_PATH: "path", SOURCE_SHM: "shm", SOURCE_IMAGE: "image"}.get(source)
+    if key is None:
+        raise FrameError(f"malformed record type {REC_RESULT}")
+    handle = str16()
+    item: dict[str, Any] = {"ok": bool(flags & 1), key: int(handle) if key == "image" else handle}
+    item["inference_mode"] = str16()
+    error = str16()
+    if error:
+        item["error"] = error
+    (n,) = _U16.unpack(take(2))
+    item["damage_types"] = [str16() for _ in range(n)]
+    (n,) = _U16.unpack(take(2))
+    detections = []
+    for _ in range(n):
+        class_id, score, x1, y1, x2, y2 = _DETECTION.unpack(take(_DETECTION.size))
+        detections.append({"label": str16(), "class_id": class_id, "score": score, "box": [x1, y1, x2, y2]})
+    if detections:
+        item["detections"] = detections
+    return item
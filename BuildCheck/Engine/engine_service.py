@@ -1,10 +1,13 @@
 from __future__ import annotations
 
+import mmap
 import os
+import re
 import tempfile
 import threading
 import time
 from collections import deque
+from concurrent.futures import Future
 from pathlib import Path
 from typing import Any
 
@@ -12,13 +15,25 @@ from fastapi import FastAPI
 from fastapi import Header
 from fastapi import Request
 from fastapi.responses import JSONResponse
+from fastapi.responses import PlainTextResponse
+from fastapi.responses import Response
 from pydantic import BaseModel, Field
+from starlette.concurrency import run_in_threadpool
 from ultralytics import YOLO
 
+import engine_frame
+import rate_limit
+
+
+class ShmImage(BaseModel):
+    name: str
+    size: int = 0
+
 
 class AnalyzeRequest(BaseModel):
     request_id: str = ""
     paths: list[str] = Field(default_factory=list)
+    shm: list[ShmImage] = Field(default_factory=list)
 
 
 def _env_int(name: str, default: int, minimum: int | None = None, maximum: int | None = None) -> int:
@@ -93,6 +108,26 @@ def _is_path_within_allowed_roots(path: Path, allowed_roots: list[Path]) -> bool
     return False
 
 
+def _is_allowed_shm_name(name: str) -> bool:
+    # API creates segments as /buildcheck_<request_id>_<n>; never map anything else.
+    return bool(SHM_NAME_RE.match(name))
+
+
+def _load_shm_image(ref: ShmImage) -> Any | None:
+    import cv2  # type: ignore
+    import numpy as np  # type: ignore
+
+    path = SHM_ROOT / ref.name.lstrip("/")
+    with open(path, "rb") as fh:
+        with mmap.mmap(fh.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            if ref.size and len(mm) != ref.size:
+                return None
+            buf = np.frombuffer(mm, dtype=np.uint8)
+            img = cv2.imdecode(buf, cv2.IMREAD_COLOR)
+            del buf
+    return img
+
+
 def _resolve_model_path() -> Path:
     env_path = os.getenv("MODEL_PATH", "").strip()
     if env_path:
@@ -146,7 +181,15 @@ def _heuristic_damage_types(path: Path) -> list[str]:
     except Exception:
         return []
 
-    img = cv2.imread(str(path))
+    return _heuristic_damage_types_img(cv2.imread(str(path)))
+
+
+def _heuristic_damage_types_img(img: Any) -> list[str]:
+    try:
+        import cv2  # type: ignore
+    except Exception:
+        return []
+
     if img is None:
         return []
 
@@ -177,10 +220,207 @@ def _heuristic_damage_types(path: Path) -> list[str]:
     return labels[:2]
 
 
+def _model_version(model_path: str) -> str:
+    # Changes whenever the weights file is replaced; the API keys its result cache on it.
+    path = Path(model_path)
+    try:
+        st = path.stat()
+    except OSError:
+        return path.name
+    return f"{path.name}:{st.st_size}:{int(st.st_mtime)}"
+
+
+_LATENCY_BUCKETS = (0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0)
+
+
+class _Metrics:
+    """Counters, gauges and latency histograms for GET /metrics (Prometheus text format).
+
+    Metric names match the C++ engine_server so dashboards work against either runtime.
+    """
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._meta: dict[str, tuple[str, str]] = {}
+        self._values: dict[str, dict[tuple[tuple[str, str], ...], float]] = {}
+        self._hists: dict[str, dict[tuple[tuple[str, str], ...], list[float]]] = {}
+
+    def describe(self, name: str, kind: str, help_text: str) -> None:
+        self._meta[name] = (kind, help_text)
+        if kind == "histogram":
+            self._hists.setdefault(name, {})
+        else:
+            self._values.setdefault(name, {})
+
+    def inc(self, name: str, value: float = 1.0, **labels: str) -> None:
+        key = tuple(sorted(labels.items()))
+        with self._lock:
+            series = self._values[name]
+            series[key] = series.get(key, 0.0) + value
+
+    def observe(self, name: str, seconds: float, **labels: str) -> None:
+        key = tuple(sorted(labels.items()))
+        with self._lock:
+            # per bucket counts (non-cumulative), then +Inf, sum, count
+            series = self._hists[name].setdefault(key, [0.0] * (len(_LATENCY_BUCKETS) + 3))
+            i = 0
+            while i < len(_LATENCY_BUCKETS) and seconds > _LATENCY_BUCKETS[i]:
+                i += 1
+            series[i] += 1
+            series[-2] += seconds
+            series[-1] += 1
+
+    def render(self) -> str:
+        def fmt(labels: tuple[tuple[str, str], ...]) -> str:
+            return "{" + ",".join(f'{k}="{v}"' for k, v in labels) + "}" if labels else ""
+
+        lines: list[str] = []
+        with self._lock:
+            for name, (kind, help_text) in self._meta.items():
+                lines.append(f"# HELP {name} {help_text}")
+                lines.append(f"# TYPE {name} {kind}")
+                if kind != "histogram":
+                    for labels, value in self._values[name].items():
+                        lines.append(f"{name}{fmt(labels)} {value:g}")
+                    continue
+                for labels, series in self._hists[name].items():
+                    cumulative = 0.0
+                    for bound, count in zip(list(_LATENCY_BUCKETS) + ["+Inf"], series[:-2]):
+                        cumulative += count
+                        le = bound if isinstance(bound, str) else f"{bound:g}"
+                        lines.append(f"{name}_bucket{fmt(labels + (('le', le),))} {cumulative:g}")
+                    lines.append(f"{name}_sum{fmt(labels)} {series[-2]:.9g}")
+                    lines.append(f"{name}_count{fmt(labels)} {series[-1]:g}")
+        return "\n".join(lines) + "\n"
+
+
+METRICS = _Metrics()
+METRICS.describe("buildcheck_engine_requests_total", "counter", "HTTP requests by route and status.")
+METRICS.describe("buildcheck_engine_request_duration_seconds", "histogram", "Request handling time, by route.")
+METRICS.describe("buildcheck_engine_analyze_in_flight", "gauge", "Analyze requests currently being handled.")
+METRICS.describe("buildcheck_engine_forward_duration_seconds", "histogram", "One batched forward pass.")
+METRICS.describe("buildcheck_engine_batch_wait_duration_seconds", "histogram", "Time an image waited in the batch queue.")
+METRICS.describe("buildcheck_engine_batches_total", "counter", "Forward passes run by the batch scheduler.")
+METRICS.describe("buildcheck_engine_batched_images_total", "counter", "Images run through forward passes.")
+METRICS.describe("buildcheck_engine_images_total", "counter", "Analyzed images by outcome.")
+METRICS.describe("buildcheck_engine_image_errors_total", "counter", "Images that could not be analyzed, by kind.")
+METRICS.describe("buildcheck_engine_rate_limit_store_calls_total", "counter", "Redis rate limit scripts run, by kind (lease, refill, return).")
+METRICS_ROUTES = {"/engine/analyze", "/engine/health", "/metrics"}
+IMAGE_ERROR_KINDS = {
+    "path not allowed": "path_not_allowed",
+    "file not found": "file_not_found",
+    "shm segment not allowed": "shm_rejected",
+    "shm segment unreadable": "shm_rejected",
+    "engine busy": "engine_busy",
+    "inference failed": "inference_failed",
+    "deadline exceeded": "deadline_exceeded",
+}
+# Remaining budget of the caller in ms; inputs not started before it runs out are
+# answered with DEADLINE_ERROR instead of being read and inferred.
+REQUEST_TIMEOUT_HEADER = "X-Request-Timeout-Ms"
+DEADLINE_ERROR = "deadline exceeded"
+
+
+def _request_deadline(request: Request) -> float | None:
+    raw = request.headers.get(REQUEST_TIMEOUT_HEADER, "").strip()
+    if not raw.isdigit() or len(raw) > 9 or int(raw) <= 0:
+        return None
+    return time.monotonic() + int(raw) / 1000.0
+
+
+def _past_deadline(deadline: float | None) -> bool:
+    return deadline is not None and time.monotonic() >= deadline
+
+
+def _record_image_outcomes(results: list[dict[str, Any]]) -> None:
+    for item in results:
+        if item.get("ok"):
+            METRICS.inc("buildcheck_engine_images_total", result="damage")
+        elif item.get("error") == "no damage detected":
+            METRICS.inc("buildcheck_engine_images_total", result="no_damage")
+        else:
+            kind = IMAGE_ERROR_KINDS.get(str(item.get("error", "")), "inference_failed")
+            METRICS.inc("buildcheck_engine_image_errors_total", kind=kind)
+
+
+class _PredictBatcher:
+    """Coalesces MODEL.predict calls from concurrent requests into one forward pass.
+
+    A batch is flushed once max_batch sources are queued or the oldest has waited
+    max_wait_sec; each caller gets a Future resolving to its own Results object.
+    """
+
+    def __init__(self, model: Any, max_batch: int, max_wait_sec: float, max_queue: int) -> None:
+        self._model = model
+        self._max_batch = max(1, max_batch)
+        self._max_wait_sec = max(0.0, max_wait_sec)
+        self._max_queue = max(self._max_batch, max_queue)
+        self._queue: deque[tuple[Any, Future, float, float | None]] = deque()
+        self._cond = threading.Condition()
+        self._thread = threading.Thread(target=self._loop, name="predict-batcher", daemon=True)
+        self._thread.start()
+
+    def submit(self, source: Any, deadline: float | None = None) -> Future:
+        fut: Future = Future()
+        with self._cond:
+            if len(self._queue) >= self._max_queue:
+                fut.set_exception(RuntimeError("inference queue full"))
+                return fut
+            self._queue.append((source, fut, time.monotonic(), deadline))
+            self._cond.notify()
+        return fut
+
+    def _loop(self) -> None:
+        while True:
+            with self._cond:
+                while not self._queue:
+                    self._cond.wait()
+                flush_at = self._queue[0][2] + self._max_wait_sec
+                while len(self._queue) < self._max_batch:
+                    remaining = flush_at - time.monotonic()
+                    if remaining <= 0:
+                        break
+                    self._cond.wait(remaining)
+                batch = []
+                while self._queue and len(batch) < self._max_batch:
+                    item = self._queue.popleft()
+                    if _past_deadline(item[3]):
+                        # Nobody will read this answer any more; keep the pass for live requests.
+                        item[1].set_exception(TimeoutError(DEADLINE_ERROR))
+                        continue
+                    batch.append(item)
+            if not batch:
+                continue
+
+            started = time.monotonic()
+            for _, _, enqueued, _ in batch:
+                METRICS.observe("buildcheck_engine_batch_wait_duration_seconds", started - enqueued)
+            METRICS.inc("buildcheck_engine_batches_total")
+            METRICS.inc("buildcheck_engine_batched_images_total", len(batch))
+            try:
+                preds = self._model.predict(source=[item[0] for item in batch], conf=CONF, verbose=False)
+                METRICS.observe("buildcheck_engine_forward_duration_seconds", time.monotonic() - started)
+                if len(preds) != len(batch):
+                    raise RuntimeError("unexpected batch size in predict output")
+                for (_, fut, _, _), pred in zip(batch, preds):
+                    fut.set_result(pred)
+            except Exception as exc:  # pragma: no cover - runtime dependency
+                for _, fut, _, _ in batch:
+                    fut.set_exception(exc)
+
+
 MODEL, MODEL_PATH_STR, MODEL_ERROR = _load_model()
 CONF = _env_float("YOLO_CONF", 0.25, minimum=0.0, maximum=1.0)
+MAX_BATCH = _env_int("ENGINE_MAX_BATCH", 8, minimum=1, maximum=64)
+BATCH_WAIT_MS = _env_float("ENGINE_BATCH_WAIT_MS", 4.0, minimum=0.0, maximum=1000.0)
 MAX_PATHS = _env_int("ENGINE_MAX_PATHS", 20, minimum=1, maximum=200)
+# Requests queue all their images before waiting: room for 8 concurrent calls (the API's
+# ENGINE_LIMIT_INITIAL) of MAX_PATHS images each.
+BATCH_QUEUE = _env_int("ENGINE_BATCH_QUEUE", max(MAX_BATCH, 8 * MAX_PATHS), minimum=1, maximum=4096)
+BATCHER = _PredictBatcher(MODEL, MAX_BATCH, BATCH_WAIT_MS / 1000.0, BATCH_QUEUE) if MODEL is not None else None
 ALLOWED_ROOTS = _resolve_allowed_roots()
+SHM_ROOT = Path("/dev/shm")
+SHM_NAME_RE = re.compile(r"^/?buildcheck_[A-Za-z0-9_\-]{1,200}$")
 ENGINE_API_KEY = os.getenv("ENGINE_API_KEY", "").strip()
 RATE_LIMIT_RPM = _env_int("ENGINE_RATE_LIMIT_RPM", 60, minimum=0, maximum=10000)
 RATE_LIMIT_WINDOW_SEC = 60.0
@@ -191,9 +431,12 @@ RATE_LIMIT_BUCKETS: dict[str, deque[float]] = {}
 RATE_LIMIT_LOCK = threading.Lock()
 RATE_LIMIT_CLEANUP_INTERVAL_SEC = 120.0
 RATE_LIMIT_LAST_CLEANUP = 0.0
-RATE_LIMIT_REDIS_CLIENT: Any | None = None
+RATE_LIMIT_LEASE = _env_int("ENGINE_RATE_LIMIT_LEASE", 16, minimum=1, maximum=1000)
+RATE_LIMIT_LEASE_MS = _env_int("ENGINE_RATE_LIMIT_LEASE_MS", 1000, minimum=50, maximum=60000)
+RATE_LIMITER: rate_limit.LeasedRateLimiter | None = None
 RATE_LIMIT_REDIS_LOCK = threading.Lock()
 ENGINE_ALLOW_HEURISTIC_FALLBACK = _env_bool("ENGINE_ALLOW_HEURISTIC_FALLBACK", True)
+MODEL_VERSION = _model_version(MODEL_PATH_STR) if MODEL is not None else ("heuristic" if ENGINE_ALLOW_HEURISTIC_FALLBACK else "")
 
 MIN_ENGINE_KEY_LEN = _env_int("ENGINE_MIN_KEY_LEN", 24, minimum=8, maximum=256)
 WEAK_ENGINE_KEYS = {"", "change-me", "changeme", "default", "password", "123456"}
@@ -201,6 +444,25 @@ WEAK_ENGINE_KEYS = {"", "change-me", "changeme", "default", "password", "123456"
 app = FastAPI(title="BuildCheck Engine", version="1.0.0")
 
 
+@app.middleware("http")
+async def _metrics_middleware(request: Request, call_next: Any) -> Any:
+    route = request.url.path if request.url.path in METRICS_ROUTES else "other"
+    analyze = route == "/engine/analyze"
+    started = time.monotonic()
+    if analyze:
+        METRICS.inc("buildcheck_engine_analyze_in_flight", 1)
+    status = 500
+    try:
+        response = await call_next(request)
+        status = response.status_code
+        return response
+    finally:
+        if analyze:
+            METRICS.inc("buildcheck_engine_analyze_in_flight", -1)
+        METRICS.inc("buildcheck_engine_requests_total", route=route, status=str(status))
+        METRICS.observe("buildcheck_engine_request_duration_seconds", time.monotonic() - started, route=route)
+
+
 def _rate_limit_ok(client_key: str) -> bool:
     if RATE_LIMIT_RPM <= 0:
         return True
@@ -240,34 +502,37 @@ def _memory_rate_limit_ok(client_key: str) -> bool:
         return True
 
 
-def _get_redis_client() -> Any | None:
-    global RATE_LIMIT_REDIS_CLIENT
-    if RATE_LIMIT_REDIS_CLIENT is not None:
-        return RATE_LIMIT_REDIS_CLIENT
+def _get_redis_limiter() -> rate_limit.LeasedRateLimiter | None:
+    global RATE_LIMITER
+    if RATE_LIMITER is not None:
+        return RATE_LIMITER
 
     with RATE_LIMIT_REDIS_LOCK:
-        if RATE_LIMIT_REDIS_CLIENT is not None:
-            return RATE_LIMIT_REDIS_CLIENT
+        if RATE_LIMITER is not None:
+            return RATE_LIMITER
         try:
             import redis  # type: ignore
-            RATE_LIMIT_REDIS_CLIENT = redis.from_url(RATE_LIMIT_REDIS_URL, decode_responses=True)
-            return RATE_LIMIT_REDIS_CLIENT
+            client = redis.from_url(RATE_LIMIT_REDIS_URL)
+            RATE_LIMITER = rate_limit.LeasedRateLimiter(
+                client,
+                RATE_LIMIT_REDIS_PREFIX,
+                RATE_LIMIT_RPM,
+                lease=RATE_LIMIT_LEASE,
+                lease_ms=RATE_LIMIT_LEASE_MS,
+                on_store_call=lambda kind: METRICS.inc("buildcheck_engine_rate_limit_store_calls_total", kind=kind),
+            )
+            return RATE_LIMITER
         except Exception:
             return None
 
 
 def _redis_rate_limit_ok(client_key: str) -> bool:
-    client = _get_redis_client()
-    if client is None:
+    limiter = _get_redis_limiter()
+    if limiter is None:
         # fallback if redis is not available/misconfigured
         return _memory_rate_limit_ok(client_key)
-
-    key = f"{RATE_LIMIT_REDIS_PREFIX}:{client_key}"
     try:
-        current = int(client.incr(key))
-        if current == 1:
-            client.expire(key, int(RATE_LIMIT_WINDOW_SEC) + 1)
-        return current <= RATE_LIMIT_RPM
+        return limiter.allow(client_key)
     except Exception:
         return _memory_rate_limit_ok(client_key)
 
@@ -295,7 +560,13 @@ def health() -> dict[str, Any]:
         "auth_strong": auth_strong,
         "rate_limit_rpm": RATE_LIMIT_RPM,
         "rate_limit_backend": RATE_LIMIT_BACKEND,
+        "transports": ["file", "shm"] if SHM_ROOT.is_dir() else ["file"],
+        "protocols": ["json", engine_frame.PROTOCOL],
+        "batching": {"max_batch": MAX_BATCH, "max_wait_ms": BATCH_WAIT_MS},
     }
+    if MODEL_VERSION:
+        payload["model_version"] = MODEL_VERSION
+        payload["conf"] = CONF
     if auth_configured and not auth_strong:
         errors.append(f"ENGINE_API_KEY is weak; must be at least {MIN_ENGINE_KEY_LEN} chars")
     if MODEL_ERROR and not fallback_mode:
@@ -307,8 +578,13 @@ def health() -> dict[str, Any]:
     return payload
 
 
-@app.post("/engine/analyze")
-def analyze(req: AnalyzeRequest, request: Request, x_engine_key: str | None = Header(default=None)) -> JSONResponse:
+@app.get("/metrics")
+def metrics() -> PlainTextResponse:
+    return PlainTextResponse(METRICS.render(), media_type="text/plain; version=0.0.4; charset=utf-8")
+
+
+def _admit(request: Request, x_engine_key: str | None) -> JSONResponse | None:
+    """Key, rate-limit and model checks shared by both analyze routes."""
     if not ENGINE_API_KEY:
         return JSONResponse(status_code=503, content={"ok": False, "error": "engine auth not configured"})
     if not _is_engine_key_strong(ENGINE_API_KEY):
@@ -325,17 +601,41 @@ def analyze(req: AnalyzeRequest, request: Request, x_engine_key: str | None = He
 
     if MODEL is None and not ENGINE_ALLOW_HEURISTIC_FALLBACK:
         return JSONResponse(status_code=500, content={"ok": False, "error": MODEL_ERROR or "model unavailable"})
+    return None
 
-    if not req.paths:
+
+def _check_input_count(count: int) -> JSONResponse | None:
+    if count == 0:
         return JSONResponse(status_code=400, content={"ok": False, "error": "missing paths array"})
-    if len(req.paths) > MAX_PATHS:
+    if count > MAX_PATHS:
         return JSONResponse(status_code=400, content={"ok": False, "error": f"too many paths (max {MAX_PATHS})"})
+    return None
+
+
+def _decode_image_bytes(data: memoryview) -> Any | None:
+    import cv2  # type: ignore
+    import numpy as np  # type: ignore
+
+    return cv2.imdecode(np.frombuffer(data, dtype=np.uint8), cv2.IMREAD_COLOR)
+
 
+def _analyze_inputs(paths: list[str], shm: list[ShmImage], images: list[memoryview],
+                    deadline: float | None = None) -> list[dict[str, Any]]:
+    """Results in input order: paths, shm segments, inline images (frame only).
+
+    Inputs reached after `deadline` are not read or inferred; they come back as
+    DEADLINE_ERROR next to the results that were finished in time.
+    """
     results: list[dict[str, Any]] = []
+    pending: list[tuple[int, Future]] = []
     names = MODEL.names if MODEL is not None else {}
 
-    for raw_path in req.paths:
+    for raw_path in paths:
         path = Path(raw_path).expanduser()
+        if _past_deadline(deadline):
+            results.append({"ok": False, "path": str(path), "damage_types": [], "error": DEADLINE_ERROR,
+                            "inference_mode": "heuristic_fallback" if MODEL is None else "model"})
+            continue
         if not _is_path_within_allowed_roots(path, ALLOWED_ROOTS):
             results.append({
                 "ok": False,
@@ -355,18 +655,19 @@ def analyze(req: AnalyzeRequest, request: Request, x_engine_key: str | None = He
             })
             continue
 
+        mode = "heuristic_fallback" if MODEL is None else "model"
+        if BATCHER is not None:
+            pending.append((len(results), BATCHER.submit(str(path), deadline)))
+            results.append({"ok": False, "path": str(path), "damage_types": [], "inference_mode": mode})
+            continue
         try:
-            if MODEL is None:
-                damage_types = _heuristic_damage_types(path)
-            else:
-                pred = MODEL.predict(source=str(path), conf=CONF, verbose=False)
-                damage_types = _extract_damage_types(pred[0], names) if pred else []
+            damage_types = _heuristic_damage_types(path)
             ok = len(damage_types) > 0
             item: dict[str, Any] = {
                 "ok": ok,
                 "path": str(path),
                 "damage_types": damage_types,
-                "inference_mode": "heuristic_fallback" if MODEL is None else "model",
+                "inference_mode": mode,
             }
             if not ok:
                 item["error"] = "no damage detected"
@@ -377,7 +678,94 @@ def analyze(req: AnalyzeRequest, request: Request, x_engine_key: str | None = He
                 "path": str(path),
                 "damage_types": [],
                 "error": "inference failed",
-                "inference_mode": "heuristic_fallback" if MODEL is None else "model",
+                "inference_mode": mode,
             })
 
+    # shm segments and inline images are both decoded in memory; only the handle differs.
+    sources: list[tuple[str, Any, Any]] = [("shm", ref.name, ref) for ref in shm]
+    sources += [("image", index, data) for index, data in enumerate(images)]
+    for key, handle, source in sources:
+        mode = "heuristic_fallback" if MODEL is None else "model"
+        if _past_deadline(deadline):
+            results.append({"ok": False, key: handle, "damage_types": [], "error": DEADLINE_ERROR, "inference_mode": mode})
+            continue
+        if key == "shm" and not _is_allowed_shm_name(handle):
+            results.append({"ok": False, key: handle, "damage_types": [], "error": "shm segment not allowed", "inference_mode": mode})
+            continue
+        try:
+            img = _load_shm_image(source) if key == "shm" else _decode_image_bytes(source)
+        except Exception:
+            img = None
+        if img is None:
+            error = "shm segment unreadable" if key == "shm" else "inference failed"
+            results.append({"ok": False, key: handle, "damage_types": [], "error": error, "inference_mode": mode})
+            continue
+
+        if BATCHER is not None:
+            pending.append((len(results), BATCHER.submit(img, deadline)))
+            results.append({"ok": False, key: handle, "damage_types": [], "inference_mode": mode})
+            continue
+        try:
+            damage_types = _heuristic_damage_types_img(img)
+            ok = len(damage_types) > 0
+            item = {"ok": ok, key: handle, "damage_types": damage_types, "inference_mode": mode}
+            if not ok:
+                item["error"] = "no damage detected"
+            results.append(item)
+        except Exception:  # pragma: no cover - runtime dependency
+            results.append({"ok": False, key: handle, "damage_types": [], "error": "inference failed", "inference_mode": mode})
+
+    # Every image is queued before any is awaited, so one request's images share forward passes too.
+    for index, fut in pending:
+        item = results[index]
+        try:
+            item["damage_types"] = _extract_damage_types(fut.result(), names)
+        except TimeoutError:
+            item["error"] = DEADLINE_ERROR
+            continue
+        except Exception as exc:  # pragma: no cover - runtime dependency
+            item["error"] = "engine busy" if str(exc) == "inference queue full" else "inference failed"
+            continue
+        item["ok"] = len(item["damage_types"]) > 0
+        if not item["ok"]:
+            item["error"] = "no damage detected"
+
+    _record_image_outcomes(results)
+    return results
+
+
+@app.post("/engine/analyze")
+def analyze(req: AnalyzeRequest, request: Request, x_engine_key: str | None = Header(default=None)) -> JSONResponse:
+    deadline = _request_deadline(request)
+    rejected = _admit(request, x_engine_key) or _check_input_count(len(req.paths) + len(req.shm))
+    if rejected is not None:
+        return rejected
+    results = _analyze_inputs(req.paths, req.shm, [], deadline)
     return JSONResponse(status_code=200, content={"ok": any(r.get("ok", False) for r in results), "results": results})
+
+
+def _analyze_frame(body: bytes, request: Request, x_engine_key: str | None, deadline: float | None) -> Response:
+    rejected = _admit(request, x_engine_key)
+    if rejected is not None:
+        return rejected
+    if request.headers.get("content-type", "") != engine_frame.CONTENT_TYPE:
+        return JSONResponse(status_code=415, content={"ok": False, "error": f"expected {engine_frame.CONTENT_TYPE}"})
+    try:
+        frame = engine_frame.decode_request(body)
+    except engine_frame.FrameError as exc:
+        return JSONResponse(status_code=400, content={"ok": False, "error": f"invalid frame: {exc}"})
+    rejected = _check_input_count(len(frame.paths) + len(frame.shm) + len(frame.images))
+    if rejected is not None:
+        return rejected
+    shm = [ShmImage(name=name, size=size) for name, size in frame.shm]
+    results = _analyze_inputs(frame.paths, shm, frame.images, deadline)
+    ok = any(r.get("ok", False) for r in results)
+    return Response(content=engine_frame.encode_response(ok, results), media_type=engine_frame.CONTENT_TYPE)
+
+
+@app.post(engine_frame.PATH)
+async def analyze_frame(request: Request, x_engine_key: str | None = Header(default=None)) -> Response:
+    # Raw body needs an async handler; the work itself stays off the event loop like /engine/analyze.
+    deadline = _request_deadline(request)
+    body = await request.body()
+    return await run_in_threadpool(_analyze_frame, body, request, x_engine_key, deadline)
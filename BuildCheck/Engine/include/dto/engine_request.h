@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Shared-memory segment created by the API (BUILDCHECK_ENGINE_TRANSPORT=shm).
+struct EngineShmRef {
+    std::string name;
+    std::size_t size = 0;
+};
+
+// Caller's remaining budget in ms. Inputs not started before it is spent are answered
+// with kDeadlineExceededError instead of being read and inferred.
+constexpr const char* kRequestTimeoutHeader = "X-Request-Timeout-Ms";
+constexpr const char* kDeadlineExceededError = "deadline exceeded";
+
+// Body of POST /engine/analyze (contracts/engine_api.json) or /engine/analyze/frame.
+struct EngineRequest {
+    std::string request_id;
+    std::vector<std::string> paths;
+    std::vector<EngineShmRef> shm;
+    std::vector<std::string_view> images;   // frame only: encoded bytes inside the request body
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Post-NMS box in source-image pixels.
+struct EngineDetection {
+    std::string label;
+    int class_id = -1;
+    float score = 0.0f;
+    float box[4] = {0.0f, 0.0f, 0.0f, 0.0f};   // x1, y1, x2, y2
+};
+
+struct EngineImageResult {
+    bool ok = false;
+    std::string path;      // set for path inputs
+    std::string shm;       // set for shm inputs
+    int image = -1;        // index into EngineRequest::images for inline inputs
+    std::vector<std::string> damage_types;
+    std::vector<EngineDetection> detections;
+    std::string error;
+    std::string inference_mode = "model";
+};
+
+struct EngineResponse {
+    bool ok = false;
+    std::vector<EngineImageResult> results;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inference/yolo_runner.h"
+
+struct BatchSchedulerOptions {
+    std::size_t max_batch = 8;                              // ENGINE_MAX_BATCH
+    std::chrono::microseconds max_wait{4000};               // ENGINE_BATCH_WAIT_MS
+    // ENGINE_BATCH_QUEUE. A request queues all of its images before waiting, so this must
+    // hold the images of every concurrent call: main defaults it to 8 calls (the API's
+    // ENGINE_LIMIT_INITIAL) of ENGINE_MAX_PATHS images each.
+    std::size_t max_queue = 160;
+};
+
+// Head output for one submitted image, [channels, anchors].
+struct BatchOutput {
+    bool ok = false;
+    std::string error;
+    std::vector<float> head;
+    std::int64_t channels = 0;
+    std::int64_t anchors = 0;
+    std::size_t batch_size = 0;   // images in the forward pass that produced it
+};
+
+// Collects preprocessed images from concurrent requests and runs them through
+// YoloRunner as one batch once `max_batch` images are queued or the oldest has
+// waited `max_wait`. A single dispatcher thread owns the forward pass, so the
+// runtime's intra-op threads are never oversubscribed by parallel sessions.
+class BatchScheduler {
+public:
+    BatchScheduler(const YoloRunner& runner, BatchSchedulerOptions options);
+    ~BatchScheduler();
+
+    BatchScheduler(const BatchScheduler&) = delete;
+    BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+    // `input` is one normalized CHW image at runner().input_size(). The future is
+    // ready immediately with an error when the queue is full or the scheduler stops.
+    // An image still queued at `deadline` is dropped before its batch runs, with
+    // the error "deadline exceeded".
+    std::future<BatchOutput> submit(std::vector<float> input,
+                                    std::chrono::steady_clock::time_point deadline =
+                                        std::chrono::steady_clock::time_point::max());
+
+    const YoloRunner& runner() const noexcept { return runner_; }
+    std::size_t max_batch() const noexcept { return options_.max_batch; }
+    std::chrono::microseconds max_wait() const noexcept { return options_.max_wait; }
+
+private:
+    struct Job {
+        std::vector<float> input;
+        std::promise<BatchOutput> promise;
+        std::chrono::steady_clock::time_point enqueued;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void dispatch_loop();
+    void run_batch(std::vector<Job>& jobs);
+
+    const YoloRunner& runner_;
+    BatchSchedulerOptions options_;
+    std::vector<float> batch_input_;   // dispatcher thread only
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    std::thread dispatcher_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct YoloRunnerOptions {
+    std::string model_path;
+    int intra_op_threads = 0;   // 0 lets the runtime pick
+    int input_size = 640;       // used when the model input has dynamic spatial dims
+};
+
+// Raw head output for a batch: [batch, channels, anchors], channels = 4 + num_classes.
+struct YoloTensor {
+    std::vector<float> data;
+    std::int64_t batch = 0;
+    std::int64_t channels = 0;
+    std::int64_t anchors = 0;
+
+    const float* image(std::size_t i) const {
+        return data.data() + i * static_cast<std::size_t>(channels * anchors);
+    }
+};
+
+// Owns a warm ONNX Runtime session for the exported YOLO model.
+// run() is safe to call from several threads at once.
+class YoloRunner {
+public:
+    explicit YoloRunner(YoloRunnerOptions options);
+    ~YoloRunner();
+
+    YoloRunner(const YoloRunner&) = delete;
+    YoloRunner& operator=(const YoloRunner&) = delete;
+
+    // false when built without ONNX Runtime or the model cannot be loaded
+    static bool available();
+
+    bool load(std::string& error);
+    bool loaded() const noexcept;
+
+    int input_size() const noexcept { return input_size_; }
+    // Largest batch run() accepts: 0 when the model has a dynamic batch axis.
+    std::size_t max_batch() const noexcept { return max_batch_; }
+    const std::string& model_path() const noexcept { return options_.model_path; }
+    // Class names embedded by the Ultralytics exporter (empty if absent).
+    const std::vector<std::string>& class_names() const noexcept { return class_names_; }
+
+    // `input` is a normalized float32 NCHW batch of `batch` images at input_size().
+    bool run(const float* input, std::size_t batch, YoloTensor& out, std::string& error) const;
+
+private:
+    struct Impl;
+
+    YoloRunnerOptions options_;
+    int input_size_;
+    std::size_t max_batch_ = 0;
+    std::vector<std::string> class_names_;
+    std::unique_ptr<Impl> impl_;
+};
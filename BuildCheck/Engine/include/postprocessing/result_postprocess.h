@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "preprocessing/image_preprocess.h"
+
+// One detection in source-image pixel coordinates.
+struct Detection {
+    float x1 = 0.0f;
+    float y1 = 0.0f;
+    float x2 = 0.0f;
+    float y2 = 0.0f;
+    float score = 0.0f;
+    int class_id = -1;
+};
+
+struct PostprocessOptions {
+    float conf_threshold = 0.25f;   // YOLO_CONF
+    float iou_threshold = 0.7f;     // Ultralytics predict default
+    std::size_t max_detections = 300;
+};
+
+// Decodes one image of a raw YOLOv8 head output laid out as [4 + num_classes, anchors]
+// (cx, cy, w, h in model-input pixels, then per-class scores), keeps anchors whose best
+// class score is > conf_threshold (YOLO_CONF), runs class-aware NMS and maps boxes back
+// through `letterbox`. Result is sorted by descending score.
+// The IoU sweep uses AVX2 or NEON when available (ENGINE_DISABLE_SIMD=1 forces scalar).
+std::vector<Detection> postprocess_yolo(const float* output, int channels, int anchors,
+                                        const LetterboxInfo& letterbox,
+                                        const PostprocessOptions& options);
+
+// "avx2", "neon" or "scalar": the kernel the NMS IoU sweep dispatches to.
+const char* postprocess_kernel_name();
+
+// Reads class names from a labels.json written by training/scripts/export_onnx.py:
+// either a list (`["crack", ...]`) or an id map (`{"0": "crack", ...}`).
+// Returns false with a short reason when the file is missing, empty or malformed.
+bool load_labels_file(const std::string& path, std::vector<std::string>& names, std::string& error);
+
+// Label for a class id, falling back to the numeric id like engine_service.py.
+std::string label_for_class(const std::vector<std::string>& names, int class_id);
+
+// Ordered unique labels of `detections` (same semantics as _extract_damage_types).
+std::vector<std::string> damage_types_from_detections(const std::vector<Detection>& detections,
+                                                      const std::vector<std::string>& names);
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decoded 8-bit RGB image, HWC layout.
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> rgb;
+};
+
+// Mapping from model input coordinates back to the source image.
+struct LetterboxInfo {
+    float scale = 1.0f;
+    int pad_x = 0;
+    int pad_y = 0;
+    int src_width = 0;
+    int src_height = 0;
+};
+
+// Decodes JPEG/PNG/WebP by signature. Returns false with a short reason when the
+// format is unknown, its decoder was not compiled in, or the data is corrupt.
+bool decode_image(const std::uint8_t* data, std::size_t size, DecodedImage& out, std::string& error);
+bool decode_image_file(const std::string& path, DecodedImage& out, std::string& error);
+
+// Letterboxes `img` into a `target` x `target` square (Ultralytics layout:
+// aspect-preserving bilinear resize, centered, pad value 114) and writes
+// normalized RGB CHW float32 to `out`, which must hold 3 * target * target floats.
+// Resize, HWC->CHW and /255 happen in one pass using AVX2 or NEON kernels when
+// available (ENGINE_DISABLE_SIMD=1 forces the scalar path).
+LetterboxInfo letterbox_to_chw(const DecodedImage& img, int target, float* out);
+
+// "avx2", "neon" or "scalar": the kernel set letterbox_to_chw dispatches to.
+const char* preprocess_kernel_name();
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "utils/httplib.h"
+#include "inference/batch_scheduler.h"
+#include "postprocessing/result_postprocess.h"
+
+struct AnalyzeRouteConfig {
+    std::string api_key;
+    std::size_t min_key_len = 24;
+    std::size_t max_paths = 20;                          // ENGINE_MAX_PATHS
+    std::vector<std::filesystem::path> allowed_roots;    // ENGINE_ALLOWED_ROOTS
+    PostprocessOptions postprocess;                      // YOLO_CONF
+    std::vector<std::string> class_names;                // labels.json, else ONNX metadata
+};
+
+void register_analyze_route(httplib::Server& server, BatchScheduler& scheduler, const AnalyzeRouteConfig& config);
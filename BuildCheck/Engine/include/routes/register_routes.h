@@ -0,0 +1,5 @@
+#pragma once
+#include "utils/httplib.h"
+#include "routes/analyze_route.h"
+
+void register_engine_routes(httplib::Server& server, BatchScheduler& scheduler, const AnalyzeRouteConfig& config);
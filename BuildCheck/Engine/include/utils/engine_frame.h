@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary body for POST /engine/analyze/frame, offered by engines that list
+// kEngineFrameProtocol under "protocols" in /engine/health. Same file in API and
+// Engine; engine_frame.py is the Python runtime's copy. Layout (little-endian):
+//
+//   header  u8[4] "BCF1" | u8 version | u8 kind | u16 reserved | u32 record_count
+//   record  u8 type | u32 length | length bytes
+//
+// Readers skip record types they do not know, so fields can be added without a
+// version bump. Request records: RequestId (utf-8), Path (utf-8), Shm (u64 size +
+// name), Image (encoded image bytes). Response records: Status (u8 flags: bit0 ok,
+// bit1 has results), Result (u8 flags, u8 source, str handle, str inference_mode,
+// str error, u16 n + str damage types, u16 n + detections {i32 class_id, f32 score,
+// f32 x1 y1 x2 y2, str label}), where str = u16 length + bytes. Only 200 answers are
+// frames; errors stay JSON like on /engine/analyze.
+
+constexpr const char* kEngineFrameContentType = "application/x-buildcheck-frame";
+constexpr const char* kEngineFrameProtocol = "frame/1";
+constexpr const char* kEngineFramePath = "/engine/analyze/frame";
+
+enum class FrameSource : std::uint8_t { Path = 1, Shm = 2, Image = 3 };
+
+struct FrameShmRef {
+    std::string name;
+    std::uint64_t size = 0;
+};
+
+struct FrameAnalyzeRequest {
+    std::string request_id;
+    std::vector<std::string> paths;
+    std::vector<FrameShmRef> shm;
+    std::vector<std::string_view> images;   // decoded: views into the frame buffer
+};
+
+struct FrameDetection {
+    std::string label;
+    std::int32_t class_id = -1;
+    float score = 0.0f;
+    float box[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+struct FrameImageResult {
+    bool ok = false;
+    FrameSource source = FrameSource::Path;
+    std::string handle;                       // path, shm name, or image index in decimal
+    std::string inference_mode;
+    std::string error;
+    std::vector<std::string> damage_types;
+    std::vector<FrameDetection> detections;
+};
+
+struct FrameAnalyzeResponse {
+    bool ok = false;
+    bool has_results = false;
+    std::vector<FrameImageResult> results;
+};
+
+std::string encode_frame_request(const FrameAnalyzeRequest& req);
+// `req.images` point into `frame`, which must outlive them.
+bool decode_frame_request(std::string_view frame, FrameAnalyzeRequest& req, std::string& error);
+
+std::string encode_frame_response(const FrameAnalyzeResponse& res);
+bool decode_frame_response(std::string_view frame, FrameAnalyzeResponse& res, std::string& error);
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "utils/metrics.h"
+
+enum class EngineRoute : std::size_t { Analyze, Health, Metrics, Other, Count };
+
+// Per-image failures, matching the "error" strings of /engine/analyze results.
+enum class ImageErrorKind : std::size_t {
+    PathNotAllowed,
+    FileNotFound,
+    ShmRejected,       // name not allowed or segment unreadable
+    DecodeFailed,
+    EngineBusy,        // batch queue full
+    InferenceFailed,
+    DeadlineExceeded,  // not started before the caller's X-Request-Timeout-Ms ran out
+    Count
+};
+
+// Process-wide instrumentation for engine_server, exposed on GET /metrics.
+struct EngineMetrics {
+    static constexpr int kMinStatus = 100;
+    static constexpr int kMaxStatus = 599;
+    static constexpr std::size_t kRoutes = static_cast<std::size_t>(EngineRoute::Count);
+    static constexpr std::size_t kStatuses = kMaxStatus - kMinStatus + 1;
+
+    std::array<std::array<MetricCounter, kStatuses>, kRoutes> requests;
+    std::array<LatencyHistogram, kRoutes> request_duration;
+
+    // per-image phases of /engine/analyze
+    LatencyHistogram read_decode_duration;   // file/shm read + image decode
+    LatencyHistogram preprocess_duration;    // letterbox + normalize to CHW
+    LatencyHistogram inference_duration;     // submit -> head output, incl. batch wait
+    LatencyHistogram postprocess_duration;   // decode + NMS
+    // batch scheduler
+    LatencyHistogram batch_wait_duration;    // time an image sat in the queue
+    LatencyHistogram forward_duration;       // one runner.run() call
+    MetricCounter batches;
+    MetricCounter batched_images;
+
+    MetricGauge analyze_in_flight;
+    MetricCounter bytes_read;
+    MetricCounter images_ok;
+    MetricCounter images_no_damage;
+    std::array<MetricCounter, static_cast<std::size_t>(ImageErrorKind::Count)> image_errors;
+
+    void observe_request(const std::string& matched_route, int status,
+                         std::chrono::steady_clock::duration elapsed) noexcept;
+    void count_image_error(ImageErrorKind kind) noexcept {
+        image_errors[static_cast<std::size_t>(kind)].inc();
+    }
+
+    void render(PrometheusWriter& out) const;
+};
+
+EngineMetrics& engine_metrics();
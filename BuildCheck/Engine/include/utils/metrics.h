@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lock-free metric primitives rendered in the Prometheus text format. Every update is
+// one relaxed atomic RMW; a scrape may observe a histogram mid-update (count and sum a
+// sample apart), which Prometheus tolerates. Same file (and metrics.cpp) in API and
+// Engine; tests/contracts fails when the copies drift.
+
+class MetricCounter {
+public:
+    void inc(std::uint64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+class MetricGauge {
+public:
+    void add(std::int64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(std::int64_t n = 1) noexcept { value_.fetch_sub(n, std::memory_order_relaxed); }
+    void set(std::int64_t n) noexcept { value_.store(n, std::memory_order_relaxed); }
+    std::int64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> value_{0};
+};
+
+// +1 on construction, -1 on destruction: in-flight gauges that survive early returns.
+class GaugeGuard {
+public:
+    explicit GaugeGuard(MetricGauge& gauge) noexcept : gauge_(gauge) { gauge_.add(); }
+    ~GaugeGuard() { gauge_.sub(); }
+    GaugeGuard(const GaugeGuard&) = delete;
+    GaugeGuard& operator=(const GaugeGuard&) = delete;
+
+private:
+    MetricGauge& gauge_;
+};
+
+// Duration histogram with one fixed bucket layout (1 ms .. 60 s) shared by every phase,
+// so phases can be compared bucket for bucket on a dashboard.
+class LatencyHistogram {
+public:
+    static constexpr std::size_t kBuckets = 15;
+    static const std::array<double, kBuckets>& bounds_seconds();
+
+    void observe(std::chrono::steady_clock::duration d) noexcept;
+
+    // Non-cumulative count of bucket `i`; i == kBuckets is the +Inf overflow bucket.
+    std::uint64_t bucket(std::size_t i) const noexcept { return buckets_[i].load(std::memory_order_relaxed); }
+    std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    double sum_seconds() const noexcept {
+        return static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / 1e9;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBuckets + 1> buckets_{};
+    std::atomic<std::uint64_t> sum_ns_{0};
+    std::atomic<std::uint64_t> count_{0};
+};
+
+// Builds a text exposition (format 0.0.4). `labels` is the inside of the braces,
+// e.g. `route="/health",status="200"`, or empty.
+class PrometheusWriter {
+public:
+    void family(const char* name, const char* type, const char* help);
+    void sample(const char* name, const std::string& labels, std::uint64_t value);
+    void sample(const char* name, const std::string& labels, std::int64_t value);
+    void histogram(const char* name, const std::string& labels, const LatencyHistogram& h);
+
+    const std::string& str() const noexcept { return out_; }
+
+private:
+    void series(const char* name, const char* suffix, const std::string& labels);
+
+    std::string out_;
+};
+
+// Content-Type of the text exposition format.
+inline constexpr const char* kPrometheusContentType = "text/plain; version=0.0.4; charset=utf-8";
@@ -0,0 +1,167 @@
+"""Per-key rate limit shared by several engine replicas through Redis.
+
+The shared state is one token bucket per key (capacity `per_minute`, refilled at
+`per_minute` tokens a minute), changed only by LEASE_SCRIPT so every read-modify-write
+is atomic and uses the server's clock. Each node does not spend those tokens one at a
+time: it leases a batch, answers from the batch locally, and tops it up from a
+background thread once it runs low. Tokens still unspent when a lease expires are
+handed back, so a node that went quiet does not sit on a client's budget. A key the
+store reported empty is refused locally until its next token is due.
+
+With a lease of L tokens a busy key costs about one store round trip per 3L/4
+requests instead of one or two per request. The price is that up to L tokens per key
+and node may be held out of the other nodes' reach for `lease_ms`.
+"""
+from __future__ import annotations
+
+import threading
+import time
+from dataclasses import dataclass
+from typing import Any, Callable
+
+# KEYS[1] bucket hash; ARGV capacity, tokens per ms, wanted, returned.
+# Returns {granted, ms until a token is available (0 unless nothing was granted)}.
+LEASE_SCRIPT = """
+local capacity = tonumber(ARGV[1])
+local rate = tonumber(ARGV[2])
+local want = tonumber(ARGV[3])
+local returned = tonumber(ARGV[4])
+local t = redis.call('TIME')
+local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000)
+local state = redis.call('HMGET', KEYS[1], 'tokens', 'ts')
+local tokens = tonumber(state[1])
+local ts = tonumber(state[2])
+if tokens == nil or ts == nil then
+  tokens = capacity
+  ts = now
+end
+tokens = math.min(capacity, tokens + math.max(0, now - ts) * rate + returned)
+local granted = math.min(want, math.floor(tokens))
+tokens = tokens - granted
+redis.call('HSET', KEYS[1], 'tokens', tostring(tokens), 'ts', tostring(now))
+redis.call('PEXPIRE', KEYS[1], math.ceil((capacity - tokens) / rate) + 1000)
+local wait = 0
+if granted == 0 then
+  wait = math.ceil((1 - tokens) / rate)
+end
+return {granted, wait}
+"""
+
+
+@dataclass
+class _Lease:
+    tokens: int = 0
+    expires: float = 0.0
+    denied_until: float = 0.0
+    refilling: bool = False
+
+
+class LeasedRateLimiter:
+    def __init__(
+        self,
+        client: Any,
+        prefix: str,
+        per_minute: int,
+        lease: int = 16,
+        lease_ms: int = 1000,
+        on_store_call: Callable[[str], None] | None = None,
+    ) -> None:
+        self._script = client.register_script(LEASE_SCRIPT)
+        self._prefix = prefix
+        self._capacity = max(1, per_minute)
+        self._rate = self._capacity / 60000.0
+        # A lease above a quarter of the bucket would let one node starve the others.
+        self._lease = max(1, min(lease, self._capacity // 4))
+        self._lease_sec = max(0.05, lease_ms / 1000.0)
+        self._on_store_call = on_store_call
+        self._leases: dict[str, _Lease] = {}
+        self._refills: list[str] = []
+        self._lock = threading.Lock()
+        self._wake = threading.Condition(self._lock)
+        self._closed = False
+        self._worker = threading.Thread(target=self._reconcile_loop, name="rate-limit-lease", daemon=True)
+        self._worker.start()
+
+    def allow(self, key: str) -> bool:
+        """One request for `key`. Raises whatever the Redis client raises when the store
+        is needed and unreachable; callers decide how to fail."""
+        now = time.monotonic()
+        with self._lock:
+            lease = self._leases.setdefault(key, _Lease())
+            if lease.tokens > 0 and now < lease.expires:
+                lease.tokens -= 1
+                if lease.tokens <= self._lease // 4 and not lease.refilling:
+                    lease.refilling = True
+                    self._refills.append(key)
+                    self._wake.notify()
+                return True
+            if now < lease.denied_until:
+                return False
+            returned, lease.tokens = lease.tokens, 0
+
+        granted, wait_ms = self._call(key, self._lease, returned, "lease")
+        now = time.monotonic()
+        with self._lock:
+            lease = self._leases.setdefault(key, _Lease())
+            lease.tokens += granted
+            lease.expires = now + self._lease_sec
+            if lease.tokens <= 0:
+                lease.denied_until = now + wait_ms / 1000.0
+                return False
+            lease.tokens -= 1
+            return True
+
+    def close(self) -> None:
+        """Stops the background thread and hands unspent tokens back to the store."""
+        with self._lock:
+            self._closed = True
+            self._wake.notify()
+        self._worker.join()
+
+    def _call(self, key: str, want: int, returned: int, kind: str) -> tuple[int, int]:
+        if self._on_store_call is not None:
+            self._on_store_call(kind)
+        granted, wait_ms = self._script(
+            keys=[f"{self._prefix}:{key}"], args=[self._capacity, repr(self._rate), want, returned]
+        )
+        return int(granted), int(wait_ms)
+
+    def _reconcile_loop(self) -> None:
+        while True:
+            with self._lock:
+                if not self._refills and not self._closed:
+                    self._wake.wait(self._lease_sec)
+                closed = self._closed
+                refills, self._refills = self._refills, []
+                top_ups = [(key, self._lease - self._leases[key].tokens) for key in refills if key in self._leases]
+
+            for key, want in top_ups:
+                try:
+                    granted, _ = self._call(key, max(0, want), 0, "refill")
+                except Exception:
+                    granted = 0
+                with self._lock:
+                    lease = self._leases.setdefault(key, _Lease())
+                    lease.tokens += granted
+                    lease.expires = time.monotonic() + self._lease_sec
+                    lease.refilling = False
+
+            # Expired leases: give unspent tokens back and forget keys with nothing left.
+            now = time.monotonic()
+            with self._lock:
+                stale = [
+                    (key, lease.tokens)
+                    for key, lease in self._leases.items()
+                    if not lease.refilling and (closed or (now >= lease.expires and now >= lease.denied_until))
+                ]
+                for key, _ in stale:
+                    del self._leases[key]
+            for key, tokens in stale:
+                if tokens <= 0:
+                    continue
+                try:
+                    self._call(key, 0, tokens, "return")
+                except Exception:
+                    pass
+            if closed:
+                return
@@ -0,0 +1,141 @@
+#include "inference/batch_scheduler.h"
+#include "utils/engine_metrics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+std::future<BatchOutput> ready_error(const std::string& error) {
+    std::promise<BatchOutput> p;
+    BatchOutput out;
+    out.error = error;
+    p.set_value(std::move(out));
+    return p.get_future();
+}
+
+} // namespace
+
+BatchScheduler::BatchScheduler(const YoloRunner& runner, BatchSchedulerOptions options)
+    : runner_(runner), options_(options) {
+    options_.max_batch = std::max<std::size_t>(1, options_.max_batch);
+    if (runner_.max_batch() > 0) options_.max_batch = std::min(options_.max_batch, runner_.max_batch());
+    options_.max_queue = std::max(options_.max_queue, options_.max_batch);
+    dispatcher_ = std::thread([this] { dispatch_loop(); });
+}
+
+BatchScheduler::~BatchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (dispatcher_.joinable()) dispatcher_.join();
+}
+
+std::future<BatchOutput> BatchScheduler::submit(std::vector<float> input,
+                                               std::chrono::steady_clock::time_point deadline) {
+    const int size = runner_.input_size();
+    if (input.size() != static_cast<std::size_t>(3) * size * size) {
+        return ready_error("bad input size");
+    }
+    std::future<BatchOutput> future;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stopping_) return ready_error("engine shutting down");
+        if (queue_.size() >= options_.max_queue) return ready_error("inference queue full");
+        Job job;
+        job.input = std::move(input);
+        job.enqueued = std::chrono::steady_clock::now();
+        job.deadline = deadline;
+        future = job.promise.get_future();
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return future;
+}
+
+void BatchScheduler::dispatch_loop() {
+    std::vector<Job> jobs;
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;   // stopping with nothing left to drain
+
+        // Hold the batch open until it fills or its oldest image has waited long enough.
+        const auto flush_at = queue_.front().enqueued + options_.max_wait;
+        cv_.wait_until(lock, flush_at, [this] {
+            return stopping_ || queue_.size() >= options_.max_batch;
+        });
+
+        // Images whose caller has run out of time are answered, not run: nobody reads them.
+        const auto now = std::chrono::steady_clock::now();
+        jobs.clear();
+        std::vector<Job> expired;
+        while (!queue_.empty() && jobs.size() < options_.max_batch) {
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            (now >= job.deadline ? expired : jobs).push_back(std::move(job));
+        }
+        lock.unlock();
+        for (auto& job : expired) {
+            BatchOutput out;
+            out.error = "deadline exceeded";
+            job.promise.set_value(std::move(out));
+        }
+        if (jobs.empty()) {
+            lock.lock();
+            continue;
+        }
+        run_batch(jobs);
+        jobs.clear();
+        lock.lock();
+    }
+}
+
+void BatchScheduler::run_batch(std::vector<Job>& jobs) {
+    const std::size_t n = jobs.size();
+    const std::size_t image_floats = jobs.front().input.size();
+
+    // A lone image runs from its own buffer; larger batches are packed NCHW.
+    const float* input = jobs.front().input.data();
+    if (n > 1) {
+        batch_input_.resize(n * image_floats);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::memcpy(batch_input_.data() + i * image_floats, jobs[i].input.data(), image_floats * sizeof(float));
+        }
+        input = batch_input_.data();
+    }
+
+    EngineMetrics& metrics = engine_metrics();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto& job : jobs) metrics.batch_wait_duration.observe(t0 - job.enqueued);
+
+    YoloTensor tensor;
+    std::string error;
+    const bool ok = runner_.run(input, n, tensor, error) && tensor.batch == static_cast<std::int64_t>(n);
+    metrics.forward_duration.observe(std::chrono::steady_clock::now() - t0);
+    metrics.batches.inc();
+    metrics.batched_images.inc(n);
+    if (ok) {
+        const std::size_t per_image = static_cast<std::size_t>(tensor.channels * tensor.anchors);
+        for (std::size_t i = 0; i < n; ++i) {
+            BatchOutput out;
+            out.ok = true;
+            out.channels = tensor.channels;
+            out.anchors = tensor.anchors;
+            out.batch_size = n;
+            out.head.assign(tensor.image(i), tensor.image(i) + per_image);
+            jobs[i].promise.set_value(std::move(out));
+        }
+        return;
+    }
+    if (error.empty()) error = "unexpected batch size in model output";
+    for (auto& job : jobs) {
+        BatchOutput out;
+        out.error = error;
+        out.batch_size = n;
+        job.promise.set_value(std::move(out));
+    }
+}
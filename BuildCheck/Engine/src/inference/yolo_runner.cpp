@@ -0,0 +1,168 @@
+#include "inference/yolo_runner.h"
+
+#include <array>
+#include <cctype>
+#include <utility>
+
+#if defined(BUILDCHECK_HAVE_ONNXRUNTIME)
+#include <onnxruntime_cxx_api.h>
+
+namespace {
+
+// Ultralytics stores names as a Python dict literal: "{0: 'crack', 1: 'leakage'}".
+std::vector<std::string> parse_names_metadata(const std::string& raw) {
+    std::vector<std::string> names;
+    std::size_t i = 0;
+    while (i < raw.size()) {
+        while (i < raw.size() && !std::isdigit(static_cast<unsigned char>(raw[i]))) ++i;
+        if (i >= raw.size()) break;
+        std::size_t id = 0;
+        while (i < raw.size() && std::isdigit(static_cast<unsigned char>(raw[i]))) {
+            id = id * 10 + static_cast<std::size_t>(raw[i] - '0');
+            ++i;
+        }
+        while (i < raw.size() && raw[i] != '\'' && raw[i] != '"') ++i;
+        if (i >= raw.size()) break;
+        const char quote = raw[i++];
+        std::string label;
+        while (i < raw.size() && raw[i] != quote) label.push_back(raw[i++]);
+        ++i;
+        if (id > 4096) break;
+        if (names.size() <= id) names.resize(id + 1);
+        names[id] = label;
+    }
+    return names;
+}
+
+} // namespace
+
+struct YoloRunner::Impl {
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "buildcheck-engine"};
+    Ort::SessionOptions session_options;
+    std::unique_ptr<Ort::Session> session;
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::string input_name;
+    std::string output_name;
+};
+
+bool YoloRunner::available() {
+    return true;
+}
+
+YoloRunner::YoloRunner(YoloRunnerOptions options)
+    : options_(std::move(options)), input_size_(options_.input_size) {}
+
+YoloRunner::~YoloRunner() = default;
+
+bool YoloRunner::loaded() const noexcept {
+    return impl_ && impl_->session;
+}
+
+bool YoloRunner::load(std::string& error) {
+    try {
+        auto impl = std::make_unique<Impl>();
+        if (options_.intra_op_threads > 0) {
+            impl->session_options.SetIntraOpNumThreads(options_.intra_op_threads);
+        }
+        impl->session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+#if defined(_WIN32)
+        const std::wstring wpath(options_.model_path.begin(), options_.model_path.end());
+        impl->session = std::make_unique<Ort::Session>(impl->env, wpath.c_str(), impl->session_options);
+#else
+        impl->session = std::make_unique<Ort::Session>(impl->env, options_.model_path.c_str(), impl->session_options);
+#endif
+
+        Ort::AllocatorWithDefaultOptions alloc;
+        impl->input_name = impl->session->GetInputNameAllocated(0, alloc).get();
+        impl->output_name = impl->session->GetOutputNameAllocated(0, alloc).get();
+
+        const auto shape = impl->session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.size() != 4 || (shape[1] > 0 && shape[1] != 3)) {
+            error = "unexpected model input shape";
+            return false;
+        }
+        if (shape[2] > 0) input_size_ = static_cast<int>(shape[2]);
+        // Exports without dynamic=True pin the batch axis (usually to 1).
+        if (shape[0] > 0) max_batch_ = static_cast<std::size_t>(shape[0]);
+
+        const Ort::ModelMetadata meta = impl->session->GetModelMetadata();
+        auto names = meta.LookupCustomMetadataMapAllocated("names", alloc);
+        if (names) class_names_ = parse_names_metadata(names.get());
+
+        impl_ = std::move(impl);
+    } catch (const Ort::Exception& e) {
+        error = std::string("Failed to load model: ") + e.what();
+        impl_.reset();
+        return false;
+    }
+
+    // Warm-up pass so the first real request does not pay allocator/kernel setup.
+    std::vector<float> zeros(static_cast<std::size_t>(3) * input_size_ * input_size_, 0.0f);
+    YoloTensor scratch;
+    if (!run(zeros.data(), 1, scratch, error)) {
+        impl_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool YoloRunner::run(const float* input, std::size_t batch, YoloTensor& out, std::string& error) const {
+    if (!loaded()) {
+        error = "model not loaded";
+        return false;
+    }
+    try {
+        const std::array<std::int64_t, 4> shape{static_cast<std::int64_t>(batch), 3, input_size_, input_size_};
+        const std::size_t count = batch * 3 * static_cast<std::size_t>(input_size_) * input_size_;
+        Ort::Value tensor = Ort::Value::CreateTensor<float>(
+            impl_->memory_info, const_cast<float*>(input), count, shape.data(), shape.size());
+
+        const char* input_names[] = {impl_->input_name.c_str()};
+        const char* output_names[] = {impl_->output_name.c_str()};
+        auto outputs = impl_->session->Run(Ort::RunOptions{nullptr}, input_names, &tensor, 1, output_names, 1);
+
+        const auto out_shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+        if (out_shape.size() != 3) {
+            error = "unexpected model output shape";
+            return false;
+        }
+        out.batch = out_shape[0];
+        out.channels = out_shape[1];
+        out.anchors = out_shape[2];
+        const float* data = outputs[0].GetTensorData<float>();
+        out.data.assign(data, data + out.batch * out.channels * out.anchors);
+        return true;
+    } catch (const Ort::Exception& e) {
+        error = std::string("inference failed: ") + e.what();
+        return false;
+    }
+}
+
+#else // !BUILDCHECK_HAVE_ONNXRUNTIME
+
+struct YoloRunner::Impl {};
+
+bool YoloRunner::available() {
+    return false;
+}
+
+YoloRunner::YoloRunner(YoloRunnerOptions options)
+    : options_(std::move(options)), input_size_(options_.input_size) {}
+
+YoloRunner::~YoloRunner() = default;
+
+bool YoloRunner::loaded() const noexcept {
+    return false;
+}
+
+bool YoloRunner::load(std::string& error) {
+    error = "engine_server was built without ONNX Runtime";
+    return false;
+}
+
+bool YoloRunner::run(const float*, std::size_t, YoloTensor&, std::string& error) const {
+    error = "engine_server was built without ONNX Runtime";
+    return false;
+}
+
+#endif
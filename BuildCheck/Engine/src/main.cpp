@@ -1,31 +1,198 @@
 #include "utils/httplib.h"
+#include "routes/register_routes.h"
+#include "inference/batch_scheduler.h"
+#include "inference/yolo_runner.h"
+#include "postprocessing/result_postprocess.h"
+#include "preprocessing/image_preprocess.h"
+#include "utils/engine_frame.h"
+#include "utils/engine_metrics.h"
+#include "../third_party/json.hpp"
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
+#include <filesystem>
 #include <string>
+#include <vector>
+
+namespace {
+std::string env_string(const char* name) {
+    const char* raw = std::getenv(name);
+    return (raw && *raw) ? std::string(raw) : std::string();
+}
 
-void register_engine_routes(httplib::Server& server);
+int env_int(const char* name, int fallback, int minimum, int maximum) {
+    const std::string raw = env_string(name);
+    int value = fallback;
+    if (!raw.empty()) {
+        try {
+            value = std::stoi(raw);
+        } catch (...) {
+            value = fallback;
+        }
+    }
+    return std::clamp(value, minimum, maximum);
+}
+
+float env_float(const char* name, float fallback, float minimum, float maximum) {
+    const std::string raw = env_string(name);
+    float value = fallback;
+    if (!raw.empty()) {
+        try {
+            value = std::stof(raw);
+        } catch (...) {
+            value = fallback;
+        }
+    }
+    return std::clamp(value, minimum, maximum);
+}
+
+// Same defaults as engine_service.py: docker shared volume + local API temp dir.
+std::vector<std::filesystem::path> resolve_allowed_roots() {
+    std::vector<std::filesystem::path> roots;
+    const std::string raw = env_string("ENGINE_ALLOWED_ROOTS");
+#if defined(_WIN32)
+    const char sep = ';';
+#else
+    const char sep = ':';
+#endif
+    if (raw.empty()) {
+        roots.emplace_back("/shared-tmp");
+        std::error_code ec;
+        const auto tmp = std::filesystem::temp_directory_path(ec);
+        if (!ec) roots.push_back(tmp / "buildcheck_api");
+    } else {
+        std::size_t start = 0;
+        while (start <= raw.size()) {
+            std::size_t end = raw.find(sep, start);
+            if (end == std::string::npos) end = raw.size();
+            if (end > start) roots.emplace_back(raw.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+    for (auto& r : roots) {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(r, ec);
+        if (!ec) r = canonical;
+    }
+    return roots;
+}
+// "<file name>:<size>:<mtime>", changes whenever the weights are replaced; the API
+// keys its result cache on it.
+std::string model_version(const std::string& model_path) {
+    const std::filesystem::path path(model_path);
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) return path.filename().string();
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    const auto mtime_s = ec ? 0 : std::chrono::duration_cast<std::chrono::seconds>(mtime.time_since_epoch()).count();
+    return path.filename().string() + ":" + std::to_string(size) + ":" + std::to_string(mtime_s);
+}
+} // namespace
 
 int main() {
-    const char* allow_stub_env = std::getenv("ALLOW_CPP_ENGINE_STUB");
-    const std::string allow_stub = (allow_stub_env && *allow_stub_env) ? allow_stub_env : "";
-    if (!(allow_stub == "1" || allow_stub == "true" || allow_stub == "TRUE")) {
-        std::cerr << "[ENGINE] C++ stub runtime is disabled by default.\n";
+    const std::string allow_stub = env_string("ALLOW_CPP_ENGINE_STUB");
+    const bool stub_allowed = (allow_stub == "1" || allow_stub == "true" || allow_stub == "TRUE");
+    if (!YoloRunner::available() && !stub_allowed) {
+        std::cerr << "[ENGINE] Built without ONNX Runtime; C++ stub runtime is disabled by default.\n";
         std::cerr << "[ENGINE] Use Python runtime: BuildCheck/Engine/engine_service.py\n";
         std::cerr << "[ENGINE] Set ALLOW_CPP_ENGINE_STUB=1 only for explicit stub testing.\n";
         return 1;
     }
 
+    YoloRunnerOptions runner_options;
+    runner_options.model_path = env_string("MODEL_PATH");
+    if (runner_options.model_path.empty()) {
+        runner_options.model_path = "models/mbdd2025/best_mbdd_yolo.onnx";
+    }
+    runner_options.intra_op_threads = env_int("ENGINE_INTRA_OP_THREADS", 0, 0, 256);
+    runner_options.input_size = env_int("ENGINE_INPUT_SIZE", 640, 32, 4096);
+
+    YoloRunner runner(runner_options);
+    std::string model_error;
+    if (YoloRunner::available()) {
+        if (!runner.load(model_error)) {
+            std::cerr << "[ENGINE] " << model_error << " (" << runner_options.model_path << ")\n";
+            if (!stub_allowed) return 1;
+        } else {
+            std::cout << "[ENGINE] model loaded: " << runner.model_path()
+                      << " input=" << runner.input_size() << "\n";
+        }
+    }
+
+    AnalyzeRouteConfig config;
+    config.api_key = env_string("ENGINE_API_KEY");
+    config.min_key_len = static_cast<std::size_t>(env_int("ENGINE_MIN_KEY_LEN", 24, 8, 256));
+    config.max_paths = static_cast<std::size_t>(env_int("ENGINE_MAX_PATHS", 20, 1, 200));
+    config.allowed_roots = resolve_allowed_roots();
+    config.postprocess.conf_threshold = env_float("YOLO_CONF", 0.25f, 0.0f, 1.0f);
+
+    // labels.json next to the model (written by export_onnx.py) wins over the
+    // names embedded in the ONNX metadata.
+    std::string labels_path = env_string("LABELS_PATH");
+    if (labels_path.empty()) {
+        labels_path = (std::filesystem::path(runner_options.model_path).parent_path() / "labels.json").string();
+    }
+    std::string labels_error;
+    if (load_labels_file(labels_path, config.class_names, labels_error)) {
+        std::cout << "[ENGINE] labels: " << labels_path << " (" << config.class_names.size() << " classes)\n";
+    } else {
+        config.class_names = runner.class_names();
+        if (runner.loaded()) {
+            std::cout << "[ENGINE] " << labels_error << " (" << labels_path << "), using model metadata names\n";
+        }
+    }
+
+    BatchSchedulerOptions batch_options;
+    batch_options.max_batch = static_cast<std::size_t>(env_int("ENGINE_MAX_BATCH", 8, 1, 64));
+    batch_options.max_wait = std::chrono::milliseconds(env_int("ENGINE_BATCH_WAIT_MS", 4, 0, 1000));
+    const int default_queue = static_cast<int>(std::max<std::size_t>(batch_options.max_batch, 8 * config.max_paths));
+    batch_options.max_queue = static_cast<std::size_t>(env_int("ENGINE_BATCH_QUEUE", default_queue, 1, 4096));
+    BatchScheduler scheduler(runner, batch_options);
+
     httplib::Server server;
 
     // Health
-    server.Get("/engine/health", [](const httplib::Request&, httplib::Response& res) {
-        res.set_header("Content-Type", "application/json");
-        res.set_content(R"({"ok":true,"service":"engine"})", "application/json");
+    const std::string version = runner.loaded() ? model_version(runner.model_path()) : std::string();
+    const float conf = config.postprocess.conf_threshold;
+    server.Get("/engine/health", [&runner, &scheduler, &model_error, &version, conf](const httplib::Request&, httplib::Response& res) {
+        nlohmann::json payload{
+            {"ok", runner.loaded()},
+            {"service", "engine"},
+            {"runtime", "cpp"},
+            {"model_loaded", runner.loaded()},
+            {"inference_mode", runner.loaded() ? "model" : "unavailable"},
+            {"kernels", {{"preprocess", preprocess_kernel_name()}, {"postprocess", postprocess_kernel_name()}}},
+            {"transports", {"file", "shm"}},
+            {"protocols", {"json", kEngineFrameProtocol}},
+            {"batching", {
+                {"max_batch", scheduler.max_batch()},
+                {"max_wait_ms", std::chrono::duration<double, std::milli>(scheduler.max_wait()).count()}
+            }}
+        };
+        if (!version.empty()) {
+            payload["model_version"] = version;
+            payload["conf"] = conf;
+        }
+        if (!model_error.empty()) payload["error"] = model_error;
+        res.set_content(payload.dump(), "application/json");
+    });
+
+    server.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        PrometheusWriter out;
+        engine_metrics().render(out);
+        res.set_content(out.str(), kPrometheusContentType);
     });
 
-    register_engine_routes(server);
+    register_engine_routes(server, scheduler, config);
+
+    server.set_post_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        engine_metrics().observe_request(req.matched_route, res.status,
+                                         std::chrono::steady_clock::now() - req.start_time_);
+    });
 
-    const int port = 9090;
+    const int port = env_int("ENGINE_PORT", 9090, 1, 65535);
     std::cout << "[ENGINE] listening on http://0.0.0.0:" << port << "\n";
     if (!server.listen("0.0.0.0", port)) {
         std::cerr << "[ENGINE] failed to listen on port " << port << "\n";
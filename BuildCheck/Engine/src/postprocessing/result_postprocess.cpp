@@ -0,0 +1,328 @@
+#include "postprocessing/result_postprocess.h"
+#include "../../third_party/json.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+// Same dispatch scheme as image_preprocess.cpp: AVX2 behind target attributes and a
+// runtime CPU check, NEON as the aarch64 baseline.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BUILDCHECK_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define BUILDCHECK_X86_SIMD 0
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define BUILDCHECK_NEON_SIMD 1
+#include <arm_neon.h>
+#else
+#define BUILDCHECK_NEON_SIMD 0
+#endif
+
+namespace {
+
+// Ultralytics offsets boxes by class_id * max_wh so one IoU sweep never
+// suppresses across classes; same constant here.
+constexpr float kClassOffset = 7680.0f;
+
+// Score-sorted candidates, structure-of-arrays so the IoU sweep loads 8/4 boxes at once.
+struct Boxes {
+    std::vector<float> x1, y1, x2, y2, area;
+};
+
+// Marks every j in [begin, end) whose IoU with box i exceeds `thr`.
+// IoU > thr is tested as inter > thr * union to keep the division out of the loop.
+using SuppressFn = void (*)(const Boxes& b, int i, int begin, int end, float thr, std::uint8_t* removed);
+
+// Per-anchor best score and class over `classes` score rows of `anchors` floats each.
+using ArgmaxFn = void (*)(const float* scores, int classes, int anchors, float* best, int* best_class);
+
+// Anchors [begin, anchors); the SIMD kernels finish their tails here.
+void argmax_range(const float* scores, int classes, int anchors, int begin, float* best, int* best_class) {
+    for (int a = begin; a < anchors; ++a) {
+        float b = scores[a];
+        int bc = 0;
+        for (int c = 1; c < classes; ++c) {
+            const float s = scores[static_cast<std::size_t>(c) * anchors + a];
+            if (s > b) {
+                b = s;
+                bc = c;
+            }
+        }
+        best[a] = b;
+        best_class[a] = bc;
+    }
+}
+
+void argmax_scalar(const float* scores, int classes, int anchors, float* best, int* best_class) {
+    argmax_range(scores, classes, anchors, 0, best, best_class);
+}
+
+inline float intersection(const Boxes& b, int i, int j) {
+    const float iw = std::max(0.0f, std::min(b.x2[i], b.x2[j]) - std::max(b.x1[i], b.x1[j]));
+    const float ih = std::max(0.0f, std::min(b.y2[i], b.y2[j]) - std::max(b.y1[i], b.y1[j]));
+    return iw * ih;
+}
+
+void suppress_scalar(const Boxes& b, int i, int begin, int end, float thr, std::uint8_t* removed) {
+    for (int j = begin; j < end; ++j) {
+        const float inter = intersection(b, i, j);
+        const float uni = b.area[i] + b.area[j] - inter;
+        if (uni > 0.0f && inter > thr * uni) removed[j] = 1;
+    }
+}
+
+#if BUILDCHECK_X86_SIMD
+__attribute__((target("avx2,fma")))
+void argmax_avx2(const float* scores, int classes, int anchors, float* best, int* best_class) {
+    int a = 0;
+    for (; a + 8 <= anchors; a += 8) {
+        __m256 b = _mm256_loadu_ps(scores + a);
+        __m256i bc = _mm256_setzero_si256();
+        for (int c = 1; c < classes; ++c) {
+            const __m256 s = _mm256_loadu_ps(scores + static_cast<std::size_t>(c) * anchors + a);
+            const __m256 higher = _mm256_cmp_ps(s, b, _CMP_GT_OQ);
+            b = _mm256_blendv_ps(b, s, higher);
+            bc = _mm256_blendv_epi8(bc, _mm256_set1_epi32(c), _mm256_castps_si256(higher));
+        }
+        _mm256_storeu_ps(best + a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(best_class + a), bc);
+    }
+    argmax_range(scores, classes, anchors, a, best, best_class);
+}
+
+__attribute__((target("avx2,fma")))
+void suppress_avx2(const Boxes& b, int i, int begin, int end, float thr, std::uint8_t* removed) {
+    const __m256 bx1 = _mm256_set1_ps(b.x1[i]);
+    const __m256 by1 = _mm256_set1_ps(b.y1[i]);
+    const __m256 bx2 = _mm256_set1_ps(b.x2[i]);
+    const __m256 by2 = _mm256_set1_ps(b.y2[i]);
+    const __m256 barea = _mm256_set1_ps(b.area[i]);
+    const __m256 vthr = _mm256_set1_ps(thr);
+    const __m256 zero = _mm256_setzero_ps();
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        const __m256 iw = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(bx2, _mm256_loadu_ps(&b.x2[j])),
+                                                            _mm256_max_ps(bx1, _mm256_loadu_ps(&b.x1[j]))));
+        const __m256 ih = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(by2, _mm256_loadu_ps(&b.y2[j])),
+                                                            _mm256_max_ps(by1, _mm256_loadu_ps(&b.y1[j]))));
+        const __m256 inter = _mm256_mul_ps(iw, ih);
+        const __m256 uni = _mm256_sub_ps(_mm256_add_ps(barea, _mm256_loadu_ps(&b.area[j])), inter);
+        const __m256 hit = _mm256_and_ps(_mm256_cmp_ps(uni, zero, _CMP_GT_OQ),
+                                         _mm256_cmp_ps(inter, _mm256_mul_ps(vthr, uni), _CMP_GT_OQ));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_ps(hit));
+        while (bits) {
+            removed[j + __builtin_ctz(bits)] = 1;
+            bits &= bits - 1;
+        }
+    }
+    suppress_scalar(b, i, j, end, thr, removed);
+}
+#endif
+
+#if BUILDCHECK_NEON_SIMD
+void argmax_neon(const float* scores, int classes, int anchors, float* best, int* best_class) {
+    int a = 0;
+    for (; a + 4 <= anchors; a += 4) {
+        float32x4_t b = vld1q_f32(scores + a);
+        int32x4_t bc = vdupq_n_s32(0);
+        for (int c = 1; c < classes; ++c) {
+            const float32x4_t s = vld1q_f32(scores + static_cast<std::size_t>(c) * anchors + a);
+            const uint32x4_t higher = vcgtq_f32(s, b);
+            b = vbslq_f32(higher, s, b);
+            bc = vbslq_s32(higher, vdupq_n_s32(c), bc);
+        }
+        vst1q_f32(best + a, b);
+        vst1q_s32(best_class + a, bc);
+    }
+    argmax_range(scores, classes, anchors, a, best, best_class);
+}
+
+void suppress_neon(const Boxes& b, int i, int begin, int end, float thr, std::uint8_t* removed) {
+    const float32x4_t bx1 = vdupq_n_f32(b.x1[i]);
+    const float32x4_t by1 = vdupq_n_f32(b.y1[i]);
+    const float32x4_t bx2 = vdupq_n_f32(b.x2[i]);
+    const float32x4_t by2 = vdupq_n_f32(b.y2[i]);
+    const float32x4_t barea = vdupq_n_f32(b.area[i]);
+    const float32x4_t vthr = vdupq_n_f32(thr);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        const float32x4_t iw = vmaxq_f32(zero, vsubq_f32(vminq_f32(bx2, vld1q_f32(&b.x2[j])),
+                                                         vmaxq_f32(bx1, vld1q_f32(&b.x1[j]))));
+        const float32x4_t ih = vmaxq_f32(zero, vsubq_f32(vminq_f32(by2, vld1q_f32(&b.y2[j])),
+                                                         vmaxq_f32(by1, vld1q_f32(&b.y1[j]))));
+        const float32x4_t inter = vmulq_f32(iw, ih);
+        const float32x4_t uni = vsubq_f32(vaddq_f32(barea, vld1q_f32(&b.area[j])), inter);
+        const uint32x4_t hit = vandq_u32(vcgtq_f32(uni, zero), vcgtq_f32(inter, vmulq_f32(vthr, uni)));
+        std::uint32_t lanes[4];
+        vst1q_u32(lanes, hit);
+        for (int k = 0; k < 4; ++k) {
+            if (lanes[k]) removed[j + k] = 1;
+        }
+    }
+    suppress_scalar(b, i, j, end, thr, removed);
+}
+#endif
+
+struct Kernel {
+    ArgmaxFn argmax;
+    SuppressFn suppress;
+    const char* name;
+};
+
+bool simd_disabled_by_env() {
+    const char* env = std::getenv("ENGINE_DISABLE_SIMD");
+    return env && (std::strcmp(env, "1") == 0 || std::strcmp(env, "true") == 0);
+}
+
+const Kernel& kernel() {
+    static const Kernel selected = [] {
+        if (!simd_disabled_by_env()) {
+#if BUILDCHECK_X86_SIMD
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return Kernel{argmax_avx2, suppress_avx2, "avx2"};
+            }
+#endif
+#if BUILDCHECK_NEON_SIMD
+            return Kernel{argmax_neon, suppress_neon, "neon"};
+#endif
+        }
+        return Kernel{argmax_scalar, suppress_scalar, "scalar"};
+    }();
+    return selected;
+}
+
+} // namespace
+
+std::vector<Detection> postprocess_yolo(const float* output, int channels, int anchors,
+                                        const LetterboxInfo& letterbox,
+                                        const PostprocessOptions& options) {
+    std::vector<Detection> kept;
+    const int num_classes = channels - 4;
+    if (num_classes <= 0 || anchors <= 0) return kept;
+
+    // Best class per anchor. Class rows are contiguous over anchors, so the sweep
+    // runs class-major, several anchors per instruction.
+    std::vector<float> best(static_cast<std::size_t>(anchors));
+    std::vector<int> best_class(static_cast<std::size_t>(anchors));
+    kernel().argmax(output + 4 * static_cast<std::size_t>(anchors), num_classes, anchors,
+                    best.data(), best_class.data());
+
+    // Ultralytics keeps scores strictly above conf, which is what YOLO_CONF means there.
+    std::vector<int> order;
+    for (int a = 0; a < anchors; ++a) {
+        if (best[a] > options.conf_threshold) order.push_back(a);
+    }
+    if (order.empty()) return kept;
+    std::stable_sort(order.begin(), order.end(), [&best](int l, int r) { return best[l] > best[r]; });
+
+    const int n = static_cast<int>(order.size());
+    Boxes boxes;
+    for (auto* v : {&boxes.x1, &boxes.y1, &boxes.x2, &boxes.y2, &boxes.area}) v->resize(order.size());
+    for (int k = 0; k < n; ++k) {
+        const int a = order[k];
+        const float cx = output[a];
+        const float cy = output[anchors + a];
+        const float w = output[2 * anchors + a];
+        const float h = output[3 * anchors + a];
+        const float offset = static_cast<float>(best_class[a]) * kClassOffset;
+        boxes.x1[k] = cx - w * 0.5f + offset;
+        boxes.y1[k] = cy - h * 0.5f + offset;
+        boxes.x2[k] = cx + w * 0.5f + offset;
+        boxes.y2[k] = cy + h * 0.5f + offset;
+        boxes.area[k] = w * h;
+    }
+
+    const SuppressFn suppress = kernel().suppress;
+    std::vector<std::uint8_t> removed(order.size(), 0);
+    const float inv = letterbox.scale > 0.0f ? 1.0f / letterbox.scale : 1.0f;
+    const float max_x = static_cast<float>(letterbox.src_width);
+    const float max_y = static_cast<float>(letterbox.src_height);
+    for (int k = 0; k < n && kept.size() < options.max_detections; ++k) {
+        if (removed[k]) continue;
+        suppress(boxes, k, k + 1, n, options.iou_threshold, removed.data());
+
+        // Coordinates come from the raw tensor, not the class-offset copies.
+        const int a = order[k];
+        const float cx = output[a] - letterbox.pad_x;
+        const float cy = output[anchors + a] - letterbox.pad_y;
+        const float hw = output[2 * anchors + a] * 0.5f;
+        const float hh = output[3 * anchors + a] * 0.5f;
+        Detection d;
+        d.x1 = std::clamp((cx - hw) * inv, 0.0f, max_x);
+        d.y1 = std::clamp((cy - hh) * inv, 0.0f, max_y);
+        d.x2 = std::clamp((cx + hw) * inv, 0.0f, max_x);
+        d.y2 = std::clamp((cy + hh) * inv, 0.0f, max_y);
+        d.score = best[a];
+        d.class_id = best_class[a];
+        kept.push_back(d);
+    }
+    return kept;
+}
+
+const char* postprocess_kernel_name() {
+    return kernel().name;
+}
+
+bool load_labels_file(const std::string& path, std::vector<std::string>& names, std::string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "labels file not found";
+        return false;
+    }
+    const nlohmann::json doc = nlohmann::json::parse(in, nullptr, false);
+    if (doc.is_discarded()) {
+        error = "labels file is empty or not JSON";
+        return false;
+    }
+
+    std::vector<std::string> parsed;
+    if (doc.is_array()) {
+        for (const auto& item : doc) {
+            parsed.push_back(item.is_string() ? item.get<std::string>() : std::string());
+        }
+    } else if (doc.is_object()) {
+        for (const auto& [key, value] : doc.items()) {
+            std::size_t id = 0;
+            try {
+                std::size_t used = 0;
+                id = static_cast<std::size_t>(std::stoul(key, &used));
+                if (used != key.size()) continue;
+            } catch (...) {
+                continue;
+            }
+            if (!value.is_string() || id > 4096) continue;
+            if (parsed.size() <= id) parsed.resize(id + 1);
+            parsed[id] = value.get<std::string>();
+        }
+    }
+    if (parsed.empty()) {
+        error = "labels file has no class names";
+        return false;
+    }
+    names = std::move(parsed);
+    return true;
+}
+
+std::string label_for_class(const std::vector<std::string>& names, int class_id) {
+    if (class_id >= 0 && static_cast<std::size_t>(class_id) < names.size() && !names[class_id].empty()) {
+        return names[class_id];
+    }
+    return std::to_string(class_id);
+}
+
+std::vector<std::string> damage_types_from_detections(const std::vector<Detection>& detections,
+                                                      const std::vector<std::string>& names) {
+    std::vector<std::string> out;
+    std::unordered_set<int> seen;
+    for (const auto& d : detections) {
+        if (!seen.insert(d.class_id).second) continue;
+        out.push_back(label_for_class(names, d.class_id));
+    }
+    return out;
+}
@@ -0,0 +1,414 @@
+#include "preprocessing/image_preprocess.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// AVX2 kernels are compiled with target attributes and picked at runtime;
+// NEON is baseline on aarch64.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BUILDCHECK_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define BUILDCHECK_X86_SIMD 0
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define BUILDCHECK_NEON_SIMD 1
+#include <arm_neon.h>
+#else
+#define BUILDCHECK_NEON_SIMD 0
+#endif
+
+#if defined(BUILDCHECK_HAVE_JPEG)
+#include <jpeglib.h>
+#endif
+#if defined(BUILDCHECK_HAVE_PNG)
+#include <png.h>
+#endif
+#if defined(BUILDCHECK_HAVE_WEBP)
+#include <webp/decode.h>
+#endif
+
+namespace {
+
+constexpr float kPadValue = 114.0f / 255.0f;
+
+bool is_jpeg(const std::uint8_t* d, std::size_t n) {
+    return n >= 3 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF;
+}
+
+bool is_png(const std::uint8_t* d, std::size_t n) {
+    static const std::uint8_t sig[8] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+    return n >= 8 && std::memcmp(d, sig, 8) == 0;
+}
+
+bool is_webp(const std::uint8_t* d, std::size_t n) {
+    return n >= 12 && std::memcmp(d, "RIFF", 4) == 0 && std::memcmp(d + 8, "WEBP", 4) == 0;
+}
+
+#if defined(BUILDCHECK_HAVE_JPEG)
+struct JpegErrorMgr {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    auto* err = reinterpret_cast<JpegErrorMgr*>(cinfo->err);
+    std::longjmp(err->jump, 1);
+}
+
+bool decode_jpeg(const std::uint8_t* data, std::size_t size, DecodedImage& out, std::string& error) {
+    jpeg_decompress_struct cinfo{};
+    JpegErrorMgr jerr{};
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        error = "corrupt jpeg";
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    out.width = static_cast<int>(cinfo.output_width);
+    out.height = static_cast<int>(cinfo.output_height);
+    out.rgb.resize(static_cast<std::size_t>(out.width) * out.height * 3);
+    const std::size_t stride = static_cast<std::size_t>(out.width) * 3;
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = out.rgb.data() + stride * cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+#endif
+
+#if defined(BUILDCHECK_HAVE_PNG)
+bool decode_png(const std::uint8_t* data, std::size_t size, DecodedImage& out, std::string& error) {
+    png_image image{};
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, data, size)) {
+        error = "corrupt png";
+        return false;
+    }
+    image.format = PNG_FORMAT_RGB;
+    out.width = static_cast<int>(image.width);
+    out.height = static_cast<int>(image.height);
+    out.rgb.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, out.rgb.data(), 0, nullptr)) {
+        png_image_free(&image);
+        error = "corrupt png";
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if defined(BUILDCHECK_HAVE_WEBP)
+bool decode_webp(const std::uint8_t* data, std::size_t size, DecodedImage& out, std::string& error) {
+    int w = 0;
+    int h = 0;
+    if (!WebPGetInfo(data, size, &w, &h) || w <= 0 || h <= 0) {
+        error = "corrupt webp";
+        return false;
+    }
+    out.width = w;
+    out.height = h;
+    out.rgb.resize(static_cast<std::size_t>(w) * h * 3);
+    if (!WebPDecodeRGBInto(data, size, out.rgb.data(), out.rgb.size(), w * 3)) {
+        error = "corrupt webp";
+        return false;
+    }
+    return true;
+}
+#endif
+
+// ----------------- resize kernels -----------------
+
+// Horizontal taps, struct-of-arrays so SIMD kernels can load them directly:
+// byte offsets of the two source pixels and the weight of the second.
+struct HTaps {
+    std::vector<int> i0;
+    std::vector<int> i1;
+    std::vector<float> w;
+};
+
+// Resamples one interleaved RGB row into three planar float rows (R, G, B),
+// each `n` wide, stored back to back in `dst`. Values stay in [0, 255].
+// `avail` is the number of readable bytes from `src` to the end of the image.
+using HPassFn = void (*)(const std::uint8_t* src, std::size_t avail, const HTaps& taps, int n, float* dst);
+// dst[i] = (a[i] + (b[i] - a[i]) * wy) / 255
+using VBlendFn = void (*)(const float* a, const float* b, float wy, float* dst, int n);
+
+struct Kernels {
+    HPassFn hpass;
+    VBlendFn vblend;
+    const char* name;
+};
+
+void hpass_scalar_range(const std::uint8_t* src, const HTaps& taps, int from, int n, float* dst) {
+    float* r = dst;
+    float* g = dst + n;
+    float* b = dst + 2 * static_cast<std::size_t>(n);
+    for (int x = from; x < n; ++x) {
+        const std::uint8_t* p0 = src + taps.i0[x];
+        const std::uint8_t* p1 = src + taps.i1[x];
+        const float w = taps.w[x];
+        r[x] = p0[0] + (static_cast<float>(p1[0]) - p0[0]) * w;
+        g[x] = p0[1] + (static_cast<float>(p1[1]) - p0[1]) * w;
+        b[x] = p0[2] + (static_cast<float>(p1[2]) - p0[2]) * w;
+    }
+}
+
+void hpass_scalar(const std::uint8_t* src, std::size_t, const HTaps& taps, int n, float* dst) {
+    hpass_scalar_range(src, taps, 0, n, dst);
+}
+
+void vblend_scalar(const float* a, const float* b, float wy, float* dst, int n) {
+    constexpr float inv = 1.0f / 255.0f;
+    for (int i = 0; i < n; ++i) dst[i] = (a[i] + (b[i] - a[i]) * wy) * inv;
+}
+
+#if BUILDCHECK_X86_SIMD
+__attribute__((target("avx2,fma")))
+void hpass_avx2(const std::uint8_t* src, std::size_t avail, const HTaps& taps, int n, float* dst) {
+    // 32-bit gathers read 4 bytes from each pixel start; stop before they could leave the image.
+    int safe = n;
+    while (safe > 0 && static_cast<std::size_t>(taps.i1[safe - 1]) + 4 > avail) --safe;
+
+    float* planes[3] = {dst, dst + n, dst + 2 * static_cast<std::size_t>(n)};
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const int* base = reinterpret_cast<const int*>(src);
+    int x = 0;
+    for (; x + 8 <= safe; x += 8) {
+        const __m256i idx0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(taps.i0.data() + x));
+        const __m256i idx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(taps.i1.data() + x));
+        const __m256 wx = _mm256_loadu_ps(taps.w.data() + x);
+        const __m256i p0 = _mm256_i32gather_epi32(base, idx0, 1);
+        const __m256i p1 = _mm256_i32gather_epi32(base, idx1, 1);
+        for (int c = 0; c < 3; ++c) {
+            const __m256 a = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p0, 8 * c), mask));
+            const __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p1, 8 * c), mask));
+            _mm256_storeu_ps(planes[c] + x, _mm256_fmadd_ps(_mm256_sub_ps(b, a), wx, a));
+        }
+    }
+    hpass_scalar_range(src, taps, x, n, dst);
+}
+
+__attribute__((target("avx2,fma")))
+void vblend_avx2(const float* a, const float* b, float wy, float* dst, int n) {
+    const __m256 w = _mm256_set1_ps(wy);
+    const __m256 inv = _mm256_set1_ps(1.0f / 255.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 va = _mm256_loadu_ps(a + i);
+        const __m256 vb = _mm256_loadu_ps(b + i);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_fmadd_ps(_mm256_sub_ps(vb, va), w, va), inv));
+    }
+    vblend_scalar(a + i, b + i, wy, dst + i, n - i);
+}
+#endif
+
+#if BUILDCHECK_NEON_SIMD
+void hpass_neon(const std::uint8_t* src, std::size_t avail, const HTaps& taps, int n, float* dst) {
+    // NEON has no gather: each pixel's 4 bytes come in with one scalar load, under the
+    // same end-of-image bound as the AVX2 gathers, and are widened and blended 4 at a time.
+    int safe = n;
+    while (safe > 0 && static_cast<std::size_t>(taps.i1[safe - 1]) + 4 > avail) --safe;
+
+    float* r = dst;
+    float* g = dst + n;
+    float* b = dst + 2 * static_cast<std::size_t>(n);
+    const uint32x4_t mask = vdupq_n_u32(0xFF);
+    int x = 0;
+    for (; x + 4 <= safe; x += 4) {
+        std::uint32_t q0[4];
+        std::uint32_t q1[4];
+        for (int j = 0; j < 4; ++j) {
+            std::memcpy(&q0[j], src + taps.i0[x + j], 4);
+            std::memcpy(&q1[j], src + taps.i1[x + j], 4);
+        }
+        const uint32x4_t p0 = vld1q_u32(q0);
+        const uint32x4_t p1 = vld1q_u32(q1);
+        const float32x4_t wx = vld1q_f32(taps.w.data() + x);
+
+        float32x4_t a = vcvtq_f32_u32(vandq_u32(p0, mask));
+        float32x4_t c = vcvtq_f32_u32(vandq_u32(p1, mask));
+        vst1q_f32(r + x, vmlaq_f32(a, vsubq_f32(c, a), wx));
+        a = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(p0, 8), mask));
+        c = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(p1, 8), mask));
+        vst1q_f32(g + x, vmlaq_f32(a, vsubq_f32(c, a), wx));
+        a = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(p0, 16), mask));
+        c = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(p1, 16), mask));
+        vst1q_f32(b + x, vmlaq_f32(a, vsubq_f32(c, a), wx));
+    }
+    hpass_scalar_range(src, taps, x, n, dst);
+}
+
+void vblend_neon(const float* a, const float* b, float wy, float* dst, int n) {
+    const float32x4_t w = vdupq_n_f32(wy);
+    const float32x4_t inv = vdupq_n_f32(1.0f / 255.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t va = vld1q_f32(a + i);
+        const float32x4_t vb = vld1q_f32(b + i);
+        vst1q_f32(dst + i, vmulq_f32(vmlaq_f32(va, vsubq_f32(vb, va), w), inv));
+    }
+    vblend_scalar(a + i, b + i, wy, dst + i, n - i);
+}
+#endif
+
+bool simd_disabled_by_env() {
+    const char* env = std::getenv("ENGINE_DISABLE_SIMD");
+    return env && (std::strcmp(env, "1") == 0 || std::strcmp(env, "true") == 0);
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+        if (!simd_disabled_by_env()) {
+#if BUILDCHECK_X86_SIMD
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return Kernels{hpass_avx2, vblend_avx2, "avx2"};
+            }
+#endif
+#if BUILDCHECK_NEON_SIMD
+            return Kernels{hpass_neon, vblend_neon, "neon"};
+#endif
+        }
+        return Kernels{hpass_scalar, vblend_scalar, "scalar"};
+    }();
+    return selected;
+}
+
+} // namespace
+
+bool decode_image(const std::uint8_t* data, std::size_t size, DecodedImage& out, std::string& error) {
+    if (is_jpeg(data, size)) {
+#if defined(BUILDCHECK_HAVE_JPEG)
+        return decode_jpeg(data, size, out, error);
+#else
+        error = "jpeg decoder not available";
+        return false;
+#endif
+    }
+    if (is_png(data, size)) {
+#if defined(BUILDCHECK_HAVE_PNG)
+        return decode_png(data, size, out, error);
+#else
+        error = "png decoder not available";
+        return false;
+#endif
+    }
+    if (is_webp(data, size)) {
+#if defined(BUILDCHECK_HAVE_WEBP)
+        return decode_webp(data, size, out, error);
+#else
+        error = "webp decoder not available";
+        return false;
+#endif
+    }
+    error = "unsupported image format";
+    return false;
+}
+
+bool decode_image_file(const std::string& path, DecodedImage& out, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        error = "file not found";
+        return false;
+    }
+    const std::vector<std::uint8_t> raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return decode_image(raw.data(), raw.size(), out, error);
+}
+
+LetterboxInfo letterbox_to_chw(const DecodedImage& img, int target, float* out) {
+    LetterboxInfo info;
+    info.src_width = img.width;
+    info.src_height = img.height;
+    info.scale = std::min(static_cast<float>(target) / img.width, static_cast<float>(target) / img.height);
+
+    const int new_w = std::min(target, std::max(1, static_cast<int>(std::lround(img.width * info.scale))));
+    const int new_h = std::min(target, std::max(1, static_cast<int>(std::lround(img.height * info.scale))));
+    info.pad_x = static_cast<int>(std::lround((target - new_w) / 2.0 - 0.1));
+    info.pad_y = static_cast<int>(std::lround((target - new_h) / 2.0 - 0.1));
+
+    const std::size_t plane = static_cast<std::size_t>(target) * target;
+    const Kernels& k = kernels();
+
+    // Padding: only the border is filled, the resized area is written exactly once.
+    for (int c = 0; c < 3; ++c) {
+        float* p = out + plane * c;
+        std::fill(p, p + static_cast<std::size_t>(info.pad_y) * target, kPadValue);
+        std::fill(p + static_cast<std::size_t>(info.pad_y + new_h) * target, p + plane, kPadValue);
+        for (int y = info.pad_y; y < info.pad_y + new_h; ++y) {
+            float* row = p + static_cast<std::size_t>(y) * target;
+            std::fill(row, row + info.pad_x, kPadValue);
+            std::fill(row + info.pad_x + new_w, row + target, kPadValue);
+        }
+    }
+
+    // Half-pixel-centered bilinear sampling (matches cv2.INTER_LINEAR), done separably:
+    // each source row is resampled horizontally once into planar floats, then pairs of
+    // rows are blended vertically, scaled by 1/255 and stored into the CHW planes.
+    HTaps taps;
+    taps.i0.resize(static_cast<std::size_t>(new_w));
+    taps.i1.resize(static_cast<std::size_t>(new_w));
+    taps.w.resize(static_cast<std::size_t>(new_w));
+    const float sx = static_cast<float>(img.width) / new_w;
+    for (int x = 0; x < new_w; ++x) {
+        const float fx = std::max(0.0f, (x + 0.5f) * sx - 0.5f);
+        const int x0 = std::min(static_cast<int>(fx), img.width - 1);
+        const int x1 = std::min(x0 + 1, img.width - 1);
+        taps.i0[x] = x0 * 3;
+        taps.i1[x] = x1 * 3;
+        taps.w[x] = fx - x0;
+    }
+
+    const std::size_t stride = static_cast<std::size_t>(img.width) * 3;
+    const std::size_t hrow_len = static_cast<std::size_t>(new_w) * 3;
+    std::vector<float> cache(hrow_len * 2);
+    float* rows[2] = {cache.data(), cache.data() + hrow_len};
+    int cached[2] = {-1, -1};
+    auto hrow = [&](int sy, int slot) -> const float* {
+        if (cached[slot] != sy) {
+            if (cached[slot ^ 1] == sy) {
+                std::swap(rows[0], rows[1]);
+                std::swap(cached[0], cached[1]);
+            } else {
+                const std::uint8_t* src = img.rgb.data() + stride * sy;
+                k.hpass(src, img.rgb.size() - stride * sy, taps, new_w, rows[slot]);
+                cached[slot] = sy;
+            }
+        }
+        return rows[slot];
+    };
+
+    const float sy = static_cast<float>(img.height) / new_h;
+    for (int y = 0; y < new_h; ++y) {
+        const float fy = std::max(0.0f, (y + 0.5f) * sy - 0.5f);
+        const int y0 = std::min(static_cast<int>(fy), img.height - 1);
+        const int y1 = std::min(y0 + 1, img.height - 1);
+        const float wy = fy - y0;
+        const float* r0 = hrow(y0, 0);
+        const float* r1 = hrow(y1, 1);
+        const std::size_t out_off = static_cast<std::size_t>(y + info.pad_y) * target + info.pad_x;
+        for (int c = 0; c < 3; ++c) {
+            k.vblend(r0 + static_cast<std::size_t>(new_w) * c, r1 + static_cast<std::size_t>(new_w) * c,
+                     wy, out + plane * c + out_off, new_w);
+        }
+    }
+    return info;
+}
+
+const char* preprocess_kernel_name() {
+    return kernels().name;
+}
@@ -1,21 +1,461 @@
-#include "utils/httplib.h"
+#include "routes/analyze_route.h"
+#include "dto/engine_request.h"
+#include "dto/engine_response.h"
+#include "preprocessing/image_preprocess.h"
+#include "utils/engine_frame.h"
+#include "utils/engine_metrics.h"
 #include "../../third_party/json.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <regex>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using nlohmann::json;
 
-void register_analyze_route(httplib::Server& server) {
-    server.Post("/engine/analyze", [](const httplib::Request&, httplib::Response& res) {
-        // This C++ route is intentionally disabled.
-        // Production analyze runtime is BuildCheck/Engine/engine_service.py.
-        res.status = 501;
-        res.set_header("Content-Type", "application/json");
-        res.set_content(
-            json{
-                {"ok", false},
-                {"error", "cpp_engine_stub_disabled"},
-                {"message", "Use Python engine_service.py runtime for /engine/analyze"}
-            }.dump(),
-            "application/json"
-        );
+namespace {
+
+std::string to_lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+bool is_engine_key_strong(const std::string& key, std::size_t min_len) {
+    if (key.size() < min_len) return false;
+    const std::string lowered = to_lower(key);
+    return lowered != "change-me" &&
+           lowered != "changeme" &&
+           lowered != "default" &&
+           lowered != "password" &&
+           lowered != "123456";
+}
+
+void send_json(httplib::Response& res, int status, const json& body) {
+    res.status = status;
+    res.set_content(body.dump(), "application/json");
+}
+
+bool is_path_within_allowed_roots(const std::filesystem::path& path,
+                                  const std::vector<std::filesystem::path>& roots) {
+    std::error_code ec;
+    const auto resolved = std::filesystem::weakly_canonical(path, ec);
+    if (ec) return false;
+    for (const auto& root : roots) {
+        auto r = root.begin();
+        auto p = resolved.begin();
+        for (; r != root.end() && p != resolved.end() && *r == *p; ++r, ++p) {}
+        if (r == root.end()) return true;
+    }
+    return false;
+}
+
+bool is_allowed_shm_name(const std::string& name) {
+    // API creates segments as /buildcheck_<request_id>_<n>; never map anything else.
+    static const std::regex re(R"(^/?buildcheck_[A-Za-z0-9_\-]{1,200}$)");
+    return std::regex_match(name, re);
+}
+
+bool read_file_bytes(const std::string& path, std::vector<std::uint8_t>& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Decodes straight from the mapped segment; the bytes never touch a filesystem.
+bool decode_shm_image(const EngineShmRef& ref, DecodedImage& img, std::string& error) {
+#if defined(_WIN32)
+    (void)ref; (void)img;
+    error = "shm transport not supported";
+    return false;
+#else
+    const std::string name = ref.name.front() == '/' ? ref.name : "/" + ref.name;
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = "shm segment unreadable";
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0 ||
+        (ref.size && static_cast<std::size_t>(st.st_size) != ref.size)) {
+        ::close(fd);
+        error = "shm segment unreadable";
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* mem = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        error = "shm segment unreadable";
+        return false;
+    }
+    engine_metrics().bytes_read.inc(size);
+    const bool ok = decode_image(static_cast<const std::uint8_t*>(mem), size, img, error);
+    ::munmap(mem, size);
+    return ok;
+#endif
+}
+
+bool parse_request(const std::string& body, EngineRequest& out) {
+    json payload = json::parse(body, nullptr, false);
+    if (payload.is_discarded() || !payload.is_object()) return false;
+    out.request_id = payload.value("request_id", "");
+    if (payload.contains("paths") && payload["paths"].is_array()) {
+        for (const auto& p : payload["paths"]) {
+            if (p.is_string()) out.paths.push_back(p.get<std::string>());
+        }
+    }
+    if (payload.contains("shm") && payload["shm"].is_array()) {
+        for (const auto& s : payload["shm"]) {
+            if (!s.is_object() || !s.contains("name") || !s["name"].is_string()) continue;
+            EngineShmRef ref;
+            ref.name = s["name"].get<std::string>();
+            if (s.contains("size") && s["size"].is_number_unsigned()) ref.size = s["size"].get<std::size_t>();
+            out.shm.push_back(ref);
+        }
+    }
+    return true;
+}
+
+json to_json(const EngineImageResult& r) {
+    json item{
+        {"ok", r.ok},
+        {"damage_types", r.damage_types},
+        {"inference_mode", r.inference_mode}
+    };
+    if (!r.shm.empty()) {
+        item["shm"] = r.shm;
+    } else {
+        item["path"] = r.path;
+    }
+    if (!r.detections.empty()) {
+        json detections = json::array();
+        for (const auto& d : r.detections) {
+            detections.push_back(json{
+                {"label", d.label},
+                {"class_id", d.class_id},
+                {"score", d.score},
+                {"box", {d.box[0], d.box[1], d.box[2], d.box[3]}}
+            });
+        }
+        item["detections"] = std::move(detections);
+    }
+    if (!r.error.empty()) item["error"] = r.error;
+    return item;
+}
+
+// An image handed to the batch scheduler, resolved after every input is queued
+// so one request's images can share a forward pass.
+struct PendingInference {
+    std::size_t result_index = 0;
+    LetterboxInfo letterbox;
+    std::future<BatchOutput> output;
+    std::chrono::steady_clock::time_point submitted_at;
+};
+
+PendingInference submit_decoded(BatchScheduler& scheduler, const DecodedImage& img, std::size_t result_index,
+                                std::chrono::steady_clock::time_point deadline) {
+    const int size = scheduler.runner().input_size();
+    std::vector<float> input(static_cast<std::size_t>(3) * size * size);
+    PendingInference pending;
+    pending.result_index = result_index;
+    const auto t0 = std::chrono::steady_clock::now();
+    pending.letterbox = letterbox_to_chw(img, size, input.data());
+    pending.submitted_at = std::chrono::steady_clock::now();
+    engine_metrics().preprocess_duration.observe(pending.submitted_at - t0);
+    pending.output = scheduler.submit(std::move(input), deadline);
+    return pending;
+}
+
+void finish_inference(const AnalyzeRouteConfig& config, PendingInference& pending, EngineImageResult& result) {
+    EngineMetrics& metrics = engine_metrics();
+    const BatchOutput output = pending.output.get();
+    const auto t_output = std::chrono::steady_clock::now();
+    metrics.inference_duration.observe(t_output - pending.submitted_at);
+    if (output.error == kDeadlineExceededError) {
+        metrics.count_image_error(ImageErrorKind::DeadlineExceeded);
+        result.error = kDeadlineExceededError;
+        return;
+    }
+    if (!output.ok) {
+        std::cerr << "[ENGINE] " << output.error << "\n";
+        const bool busy = output.error == "inference queue full";
+        metrics.count_image_error(busy ? ImageErrorKind::EngineBusy : ImageErrorKind::InferenceFailed);
+        result.error = busy ? "engine busy" : "inference failed";
+        return;
+    }
+    const auto detections = postprocess_yolo(output.head.data(), static_cast<int>(output.channels),
+                                             static_cast<int>(output.anchors), pending.letterbox,
+                                             config.postprocess);
+    metrics.postprocess_duration.observe(std::chrono::steady_clock::now() - t_output);
+    result.damage_types = damage_types_from_detections(detections, config.class_names);
+    result.detections.reserve(detections.size());
+    for (const auto& d : detections) {
+        EngineDetection out;
+        out.label = label_for_class(config.class_names, d.class_id);
+        out.class_id = d.class_id;
+        out.score = d.score;
+        out.box[0] = d.x1;
+        out.box[1] = d.y1;
+        out.box[2] = d.x2;
+        out.box[3] = d.y2;
+        result.detections.push_back(std::move(out));
+    }
+    result.ok = !result.damage_types.empty();
+    if (!result.ok) result.error = "no damage detected";
+    (result.ok ? metrics.images_ok : metrics.images_no_damage).inc();
+}
+
+// Key, auth and runner checks shared by both analyze routes; sends the error itself.
+bool admit_request(const AnalyzeRouteConfig& config, const YoloRunner& runner,
+                   const httplib::Request& req, httplib::Response& res) {
+    if (config.api_key.empty()) {
+        send_json(res, 503, json{{"ok", false}, {"error", "engine auth not configured"}});
+        return false;
+    }
+    if (!is_engine_key_strong(config.api_key, config.min_key_len)) {
+        send_json(res, 503, json{{"ok", false}, {"error", "engine auth key is weak"}});
+        return false;
+    }
+    if (req.get_header_value("X-Engine-Key") != config.api_key) {
+        send_json(res, 401, json{{"ok", false}, {"error", "unauthorized"}});
+        return false;
+    }
+    if (!runner.loaded()) {
+        // Built without ONNX Runtime (ALLOW_CPP_ENGINE_STUB) or model failed to load.
+        send_json(res, 501, json{
+            {"ok", false},
+            {"error", "cpp_engine_stub_disabled"},
+            {"message", "Native inference unavailable; use Python engine_service.py runtime for /engine/analyze"}
+        });
+        return false;
+    }
+    return true;
+}
+
+// kRequestTimeoutHeader, counted from now; absent or malformed means no deadline.
+void read_deadline(const httplib::Request& req, EngineRequest& request) {
+    const std::string raw = req.get_header_value(kRequestTimeoutHeader);
+    if (raw.empty() || raw.size() > 9 ||
+        !std::all_of(raw.begin(), raw.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+        return;
+    }
+    const long long ms = std::stoll(raw);
+    if (ms > 0) request.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+}
+
+// Answers an input the request's deadline no longer leaves time for.
+bool past_deadline(const EngineRequest& request, EngineImageResult& result) {
+    if (std::chrono::steady_clock::now() < request.deadline) return false;
+    engine_metrics().count_image_error(ImageErrorKind::DeadlineExceeded);
+    result.error = kDeadlineExceededError;
+    return true;
+}
+
+bool check_request_size(const AnalyzeRouteConfig& config, const EngineRequest& request, httplib::Response& res) {
+    const std::size_t inputs = request.paths.size() + request.shm.size() + request.images.size();
+    if (inputs == 0) {
+        send_json(res, 400, json{{"ok", false}, {"error", "missing paths array"}});
+        return false;
+    }
+    if (inputs > config.max_paths) {
+        send_json(res, 400, json{{"ok", false},
+                                 {"error", "too many paths (max " + std::to_string(config.max_paths) + ")"}});
+        return false;
+    }
+    return true;
+}
+
+// Reads and decodes every input, queues them on the scheduler together, then collects
+// results in input order: paths, shm segments, inline images. Once request.deadline
+// has passed, the remaining inputs are answered "deadline exceeded" unread.
+EngineResponse analyze_inputs(BatchScheduler& scheduler, const AnalyzeRouteConfig& config,
+                              const EngineRequest& request) {
+    EngineMetrics& metrics = engine_metrics();
+    EngineResponse response;
+    response.results.reserve(request.paths.size() + request.shm.size() + request.images.size());
+    std::vector<PendingInference> pending;
+
+    for (const auto& raw_path : request.paths) {
+        EngineImageResult result;
+        result.path = raw_path;
+        if (past_deadline(request, result)) {
+            response.results.push_back(std::move(result));
+            continue;
+        }
+        const std::filesystem::path path(raw_path);
+        std::vector<std::uint8_t> bytes;
+        DecodedImage img;
+        std::string error;
+        const auto t0 = std::chrono::steady_clock::now();
+        if (!is_path_within_allowed_roots(path, config.allowed_roots)) {
+            result.error = "path not allowed";
+            metrics.count_image_error(ImageErrorKind::PathNotAllowed);
+        } else if (!std::filesystem::is_regular_file(path) || !read_file_bytes(raw_path, bytes)) {
+            result.error = "file not found";
+            metrics.count_image_error(ImageErrorKind::FileNotFound);
+        } else if (!decode_image(bytes.data(), bytes.size(), img, error)) {
+            result.error = "inference failed";
+            metrics.bytes_read.inc(bytes.size());
+            metrics.count_image_error(ImageErrorKind::DecodeFailed);
+        } else {
+            metrics.bytes_read.inc(bytes.size());
+            metrics.read_decode_duration.observe(std::chrono::steady_clock::now() - t0);
+            pending.push_back(submit_decoded(scheduler, img, response.results.size(), request.deadline));
+        }
+        response.results.push_back(std::move(result));
+    }
+
+    for (const auto& ref : request.shm) {
+        EngineImageResult result;
+        result.shm = ref.name;
+        if (past_deadline(request, result)) {
+            response.results.push_back(std::move(result));
+            continue;
+        }
+        DecodedImage img;
+        std::string error;
+        const auto t0 = std::chrono::steady_clock::now();
+        if (!is_allowed_shm_name(ref.name)) {
+            result.error = "shm segment not allowed";
+            metrics.count_image_error(ImageErrorKind::ShmRejected);
+        } else if (!decode_shm_image(ref, img, error)) {
+            const bool unreadable = error == "shm segment unreadable";
+            result.error = unreadable ? error : "inference failed";
+            metrics.count_image_error(unreadable ? ImageErrorKind::ShmRejected : ImageErrorKind::DecodeFailed);
+        } else {
+            metrics.read_decode_duration.observe(std::chrono::steady_clock::now() - t0);
+            pending.push_back(submit_decoded(scheduler, img, response.results.size(), request.deadline));
+        }
+        response.results.push_back(std::move(result));
+    }
+
+    for (std::size_t i = 0; i < request.images.size(); ++i) {
+        const std::string_view bytes = request.images[i];
+        EngineImageResult result;
+        result.image = static_cast<int>(i);
+        if (past_deadline(request, result)) {
+            response.results.push_back(std::move(result));
+            continue;
+        }
+        DecodedImage img;
+        std::string error;
+        const auto t0 = std::chrono::steady_clock::now();
+        metrics.bytes_read.inc(bytes.size());
+        if (!decode_image(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size(), img, error)) {
+            result.error = "inference failed";
+            metrics.count_image_error(ImageErrorKind::DecodeFailed);
+        } else {
+            metrics.read_decode_duration.observe(std::chrono::steady_clock::now() - t0);
+            pending.push_back(submit_decoded(scheduler, img, response.results.size(), request.deadline));
+        }
+        response.results.push_back(std::move(result));
+    }
+
+    for (auto& p : pending) {
+        finish_inference(config, p, response.results[p.result_index]);
+    }
+    for (const auto& r : response.results) response.ok = response.ok || r.ok;
+    return response;
+}
+
+FrameAnalyzeResponse to_frame(EngineResponse&& response) {
+    FrameAnalyzeResponse out;
+    out.ok = response.ok;
+    out.has_results = true;
+    out.results.reserve(response.results.size());
+    for (auto& r : response.results) {
+        FrameImageResult item;
+        item.ok = r.ok;
+        if (r.image >= 0) {
+            item.source = FrameSource::Image;
+            item.handle = std::to_string(r.image);
+        } else if (!r.shm.empty()) {
+            item.source = FrameSource::Shm;
+            item.handle = std::move(r.shm);
+        } else {
+            item.source = FrameSource::Path;
+            item.handle = std::move(r.path);
+        }
+        item.inference_mode = std::move(r.inference_mode);
+        item.error = std::move(r.error);
+        item.damage_types = std::move(r.damage_types);
+        item.detections.reserve(r.detections.size());
+        for (auto& d : r.detections) {
+            FrameDetection fd;
+            fd.label = std::move(d.label);
+            fd.class_id = d.class_id;
+            fd.score = d.score;
+            std::copy(std::begin(d.box), std::end(d.box), fd.box);
+            item.detections.push_back(std::move(fd));
+        }
+        out.results.push_back(std::move(item));
+    }
+    return out;
+}
+
+} // namespace
+
+void register_analyze_route(httplib::Server& server, BatchScheduler& scheduler, const AnalyzeRouteConfig& config) {
+    server.Post("/engine/analyze", [&scheduler, &config](const httplib::Request& req, httplib::Response& res) {
+        const GaugeGuard in_flight(engine_metrics().analyze_in_flight);
+        if (!admit_request(config, scheduler.runner(), req, res)) return;
+
+        EngineRequest request;
+        read_deadline(req, request);
+        if (!parse_request(req.body, request)) {
+            send_json(res, 400, json{{"ok", false}, {"error", "expected JSON body"}});
+            return;
+        }
+        if (!check_request_size(config, request, res)) return;
+
+        const EngineResponse response = analyze_inputs(scheduler, config, request);
+        json results = json::array();
+        for (const auto& r : response.results) results.push_back(to_json(r));
+        send_json(res, 200, json{{"ok", response.ok}, {"results", results}});
+    });
+
+    // Same analysis with utils/engine_frame.h bodies; inline images are only reachable
+    // here. Errors are JSON, as on /engine/analyze.
+    server.Post(kEngineFramePath, [&scheduler, &config](const httplib::Request& req, httplib::Response& res) {
+        const GaugeGuard in_flight(engine_metrics().analyze_in_flight);
+        if (!admit_request(config, scheduler.runner(), req, res)) return;
+        if (req.get_header_value("Content-Type") != kEngineFrameContentType) {
+            send_json(res, 415, json{{"ok", false}, {"error", std::string("expected ") + kEngineFrameContentType}});
+            return;
+        }
+
+        FrameAnalyzeRequest frame;
+        std::string frame_error;
+        if (!decode_frame_request(req.body, frame, frame_error)) {
+            send_json(res, 400, json{{"ok", false}, {"error", "invalid frame: " + frame_error}});
+            return;
+        }
+        EngineRequest request;
+        read_deadline(req, request);
+        request.request_id = std::move(frame.request_id);
+        request.paths = std::move(frame.paths);
+        request.shm.reserve(frame.shm.size());
+        for (auto& ref : frame.shm) {
+            request.shm.push_back({std::move(ref.name), static_cast<std::size_t>(ref.size)});
+        }
+        request.images = std::move(frame.images);
+        if (!check_request_size(config, request, res)) return;
+
+        res.status = 200;
+        res.set_content(encode_frame_response(to_frame(analyze_inputs(scheduler, config, request))),
+                        kEngineFrameContentType);
     });
 }
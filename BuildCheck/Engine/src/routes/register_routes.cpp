@@ -1,7 +1,5 @@
-#include "utils/httplib.h"
+#include "routes/register_routes.h"
 
-void register_analyze_route(httplib::Server& server);
-
-void register_engine_routes(httplib::Server& server) {
-    register_analyze_route(server);
+void register_engine_routes(httplib::Server& server, BatchScheduler& scheduler, const AnalyzeRouteConfig& config) {
+    register_analyze_route(server, scheduler, config);
 }
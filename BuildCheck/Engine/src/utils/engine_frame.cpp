@@ -0,0 +1,325 @@
+#include "utils/engine_frame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr char kMagic[4] = {'B', 'C', 'F', '1'};
+constexpr std::uint8_t kVersion = 1;
+constexpr std::size_t kHeaderSize = 12;
+constexpr std::size_t kRecordHeaderSize = 5;
+
+enum class FrameKind : std::uint8_t { Request = 1, Response = 2 };
+
+enum class RecordType : std::uint8_t {
+    RequestId = 1,
+    Path = 2,
+    Shm = 3,
+    Image = 4,
+    Status = 16,
+    Result = 17,
+};
+
+class FrameWriter {
+public:
+    FrameWriter(FrameKind kind, std::size_t reserve) {
+        buf_.reserve(kHeaderSize + reserve);
+        buf_.append(kMagic, sizeof(kMagic));
+        u8(kVersion);
+        u8(static_cast<std::uint8_t>(kind));
+        u16(0);
+        u32(0);   // record count, patched by finish()
+    }
+
+    void u8(std::uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+    void u16(std::uint16_t v) { put_le(v, 2); }
+    void u32(std::uint32_t v) { put_le(v, 4); }
+    void u64(std::uint64_t v) { put_le(v, 8); }
+    void i32(std::int32_t v) { put_le(static_cast<std::uint32_t>(v), 4); }
+    void f32(float v) {
+        std::uint32_t bits = 0;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put_le(bits, 4);
+    }
+    // Strings longer than a u16 length are cut; nothing the engine sends comes close.
+    void str16(std::string_view s) {
+        const std::size_t n = std::min<std::size_t>(s.size(), std::numeric_limits<std::uint16_t>::max());
+        u16(static_cast<std::uint16_t>(n));
+        buf_.append(s.data(), n);
+    }
+    void bytes(std::string_view s) { buf_.append(s.data(), s.size()); }
+
+    // Starts a record whose length is patched by end_record().
+    void begin_record(RecordType type) {
+        u8(static_cast<std::uint8_t>(type));
+        record_len_at_ = buf_.size();
+        u32(0);
+        ++records_;
+    }
+    void end_record() {
+        patch_le(record_len_at_, static_cast<std::uint32_t>(buf_.size() - record_len_at_ - 4));
+    }
+    void record(RecordType type, std::string_view payload) {
+        begin_record(type);
+        bytes(payload);
+        end_record();
+    }
+
+    std::string finish() {
+        patch_le(8, records_);
+        return std::move(buf_);
+    }
+
+private:
+    void put_le(std::uint64_t v, int n) {
+        for (int i = 0; i < n; ++i) buf_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    void patch_le(std::size_t at, std::uint32_t v) {
+        for (int i = 0; i < 4; ++i) buf_[at + i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    std::string buf_;
+    std::size_t record_len_at_ = 0;
+    std::uint32_t records_ = 0;
+};
+
+// Bounds-checked cursor; every read fails once the input is exhausted.
+class FrameReader {
+public:
+    explicit FrameReader(std::string_view data) : data_(data) {}
+
+    bool u8(std::uint8_t& v) {
+        if (!need(1)) return false;
+        v = static_cast<std::uint8_t>(data_[pos_++]);
+        return true;
+    }
+    bool u16(std::uint16_t& v) { return get_le(v, 2); }
+    bool u32(std::uint32_t& v) { return get_le(v, 4); }
+    bool u64(std::uint64_t& v) { return get_le(v, 8); }
+    bool i32(std::int32_t& v) {
+        std::uint32_t u = 0;
+        if (!get_le(u, 4)) return false;
+        v = static_cast<std::int32_t>(u);
+        return true;
+    }
+    bool f32(float& v) {
+        std::uint32_t bits = 0;
+        if (!get_le(bits, 4)) return false;
+        std::memcpy(&v, &bits, sizeof(v));
+        return true;
+    }
+    bool str16(std::string& s) {
+        std::uint16_t n = 0;
+        if (!u16(n) || !need(n)) return false;
+        s.assign(data_.data() + pos_, n);
+        pos_ += n;
+        return true;
+    }
+    bool view(std::size_t n, std::string_view& out) {
+        if (!need(n)) return false;
+        out = data_.substr(pos_, n);
+        pos_ += n;
+        return true;
+    }
+    std::size_t remaining() const { return data_.size() - pos_; }
+
+private:
+    bool need(std::size_t n) const { return data_.size() - pos_ >= n; }
+    template <typename T>
+    bool get_le(T& v, int n) {
+        if (!need(static_cast<std::size_t>(n))) return false;
+        std::uint64_t acc = 0;
+        for (int i = 0; i < n; ++i) {
+            acc |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(data_[pos_ + i])) << (8 * i);
+        }
+        pos_ += static_cast<std::size_t>(n);
+        v = static_cast<T>(acc);
+        return true;
+    }
+
+    std::string_view data_;
+    std::size_t pos_ = 0;
+};
+
+// Validates the header and hands each record to `on_record(type, payload)`.
+template <typename OnRecord>
+bool read_frame(std::string_view frame, FrameKind kind, std::string& error, OnRecord&& on_record) {
+    FrameReader r(frame);
+    std::string_view magic;
+    std::uint8_t version = 0;
+    std::uint8_t got_kind = 0;
+    std::uint16_t reserved = 0;
+    std::uint32_t count = 0;
+    if (!r.view(sizeof(kMagic), magic) || !r.u8(version) || !r.u8(got_kind) || !r.u16(reserved) || !r.u32(count)) {
+        error = "truncated frame header";
+        return false;
+    }
+    if (std::memcmp(magic.data(), kMagic, sizeof(kMagic)) != 0) {
+        error = "bad frame magic";
+        return false;
+    }
+    if (version != kVersion) {
+        error = "unsupported frame version " + std::to_string(version);
+        return false;
+    }
+    if (got_kind != static_cast<std::uint8_t>(kind)) {
+        error = "unexpected frame kind";
+        return false;
+    }
+    // Each record costs at least its 5-byte header, which caps `count` by the input size.
+    if (count > r.remaining() / kRecordHeaderSize) {
+        error = "record count exceeds frame size";
+        return false;
+    }
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint8_t type = 0;
+        std::uint32_t len = 0;
+        std::string_view payload;
+        if (!r.u8(type) || !r.u32(len) || !r.view(len, payload)) {
+            error = "truncated record";
+            return false;
+        }
+        if (!on_record(type, payload)) {
+            error = "malformed record type " + std::to_string(type);
+            return false;
+        }
+    }
+    if (r.remaining() != 0) {
+        error = "trailing bytes after last record";
+        return false;
+    }
+    return true;
+}
+
+bool decode_result(std::string_view payload, FrameImageResult& out) {
+    FrameReader r(payload);
+    std::uint8_t flags = 0;
+    std::uint8_t source = 0;
+    if (!r.u8(flags) || !r.u8(source)) return false;
+    if (source < static_cast<std::uint8_t>(FrameSource::Path) || source > static_cast<std::uint8_t>(FrameSource::Image)) {
+        return false;
+    }
+    out.ok = (flags & 1u) != 0;
+    out.source = static_cast<FrameSource>(source);
+    if (!r.str16(out.handle) || !r.str16(out.inference_mode) || !r.str16(out.error)) return false;
+    std::uint16_t n = 0;
+    if (!r.u16(n)) return false;
+    out.damage_types.resize(n);
+    for (auto& d : out.damage_types) {
+        if (!r.str16(d)) return false;
+    }
+    if (!r.u16(n)) return false;
+    if (n > r.remaining() / 26) return false;   // 26 = smallest encoded detection
+    out.detections.resize(n);
+    for (auto& d : out.detections) {
+        if (!r.i32(d.class_id) || !r.f32(d.score) || !r.f32(d.box[0]) || !r.f32(d.box[1]) ||
+            !r.f32(d.box[2]) || !r.f32(d.box[3]) || !r.str16(d.label)) {
+            return false;
+        }
+    }
+    return true;   // trailing bytes are fields added by a newer writer
+}
+
+} // namespace
+
+std::string encode_frame_request(const FrameAnalyzeRequest& req) {
+    std::size_t reserve = req.request_id.size() + kRecordHeaderSize;
+    for (const auto& p : req.paths) reserve += kRecordHeaderSize + p.size();
+    for (const auto& s : req.shm) reserve += kRecordHeaderSize + 8 + s.name.size();
+    for (const auto& img : req.images) reserve += kRecordHeaderSize + img.size();
+
+    FrameWriter w(FrameKind::Request, reserve);
+    w.record(RecordType::RequestId, req.request_id);
+    for (const auto& p : req.paths) w.record(RecordType::Path, p);
+    for (const auto& s : req.shm) {
+        w.begin_record(RecordType::Shm);
+        w.u64(s.size);
+        w.bytes(s.name);
+        w.end_record();
+    }
+    for (const auto& img : req.images) w.record(RecordType::Image, img);
+    return w.finish();
+}
+
+bool decode_frame_request(std::string_view frame, FrameAnalyzeRequest& req, std::string& error) {
+    req = FrameAnalyzeRequest{};
+    return read_frame(frame, FrameKind::Request, error, [&req](std::uint8_t type, std::string_view payload) {
+        switch (static_cast<RecordType>(type)) {
+            case RecordType::RequestId:
+                req.request_id.assign(payload.data(), payload.size());
+                return true;
+            case RecordType::Path:
+                req.paths.emplace_back(payload);
+                return true;
+            case RecordType::Shm: {
+                FrameReader r(payload);
+                FrameShmRef ref;
+                if (!r.u64(ref.size)) return false;
+                ref.name.assign(payload.substr(8));
+                req.shm.push_back(std::move(ref));
+                return true;
+            }
+            case RecordType::Image:
+                req.images.push_back(payload);
+                return true;
+            default:
+                return true;
+        }
+    });
+}
+
+std::string encode_frame_response(const FrameAnalyzeResponse& res) {
+    std::size_t reserve = kRecordHeaderSize + 1;
+    for (const auto& r : res.results) {
+        reserve += kRecordHeaderSize + 12 + r.handle.size() + r.inference_mode.size() + r.error.size();
+        for (const auto& d : r.damage_types) reserve += 2 + d.size();
+        for (const auto& d : r.detections) reserve += 26 + d.label.size();
+    }
+
+    FrameWriter w(FrameKind::Response, reserve);
+    w.begin_record(RecordType::Status);
+    w.u8(static_cast<std::uint8_t>((res.ok ? 1u : 0u) | (res.has_results ? 2u : 0u)));
+    w.end_record();
+    for (const auto& r : res.results) {
+        w.begin_record(RecordType::Result);
+        w.u8(r.ok ? 1 : 0);
+        w.u8(static_cast<std::uint8_t>(r.source));
+        w.str16(r.handle);
+        w.str16(r.inference_mode);
+        w.str16(r.error);
+        w.u16(static_cast<std::uint16_t>(std::min<std::size_t>(r.damage_types.size(), 0xFFFF)));
+        for (std::size_t i = 0; i < r.damage_types.size() && i < 0xFFFF; ++i) w.str16(r.damage_types[i]);
+        w.u16(static_cast<std::uint16_t>(std::min<std::size_t>(r.detections.size(), 0xFFFF)));
+        for (std::size_t i = 0; i < r.detections.size() && i < 0xFFFF; ++i) {
+            const FrameDetection& d = r.detections[i];
+            w.i32(d.class_id);
+            w.f32(d.score);
+            for (float v : d.box) w.f32(v);
+            w.str16(d.label);
+        }
+        w.end_record();
+    }
+    return w.finish();
+}
+
+bool decode_frame_response(std::string_view frame, FrameAnalyzeResponse& res, std::string& error) {
+    res = FrameAnalyzeResponse{};
+    return read_frame(frame, FrameKind::Response, error, [&res](std::uint8_t type, std::string_view payload) {
+        switch (static_cast<RecordType>(type)) {
+            case RecordType::Status: {
+                if (payload.empty()) return false;
+                const auto flags = static_cast<std::uint8_t>(payload[0]);
+                res.ok = (flags & 1u) != 0;
+                res.has_results = (flags & 2u) != 0;
+                return true;
+            }
+            case RecordType::Result:
+                res.results.emplace_back();
+                return decode_result(payload, res.results.back());
+            default:
+                return true;
+        }
+    });
+}
@@ -0,0 +1,87 @@
+#include "utils/engine_metrics.h"
+
+namespace {
+constexpr std::array<const char*, EngineMetrics::kRoutes> kRouteLabels = {
+    "/engine/analyze", "/engine/health", "/metrics", "other"
+};
+
+constexpr std::array<const char*, static_cast<std::size_t>(ImageErrorKind::Count)> kImageErrorLabels = {
+    "path_not_allowed", "file_not_found", "shm_rejected", "decode_failed", "engine_busy", "inference_failed",
+    "deadline_exceeded"
+};
+
+EngineRoute route_for(const std::string& matched_route) {
+    for (std::size_t i = 0; i + 1 < EngineMetrics::kRoutes; ++i) {
+        if (matched_route == kRouteLabels[i]) return static_cast<EngineRoute>(i);
+    }
+    return EngineRoute::Other;
+}
+} // namespace
+
+EngineMetrics& engine_metrics() {
+    static EngineMetrics metrics;
+    return metrics;
+}
+
+void EngineMetrics::observe_request(const std::string& matched_route, int status,
+                                    std::chrono::steady_clock::duration elapsed) noexcept {
+    const auto route = static_cast<std::size_t>(route_for(matched_route));
+    if (status >= kMinStatus && status <= kMaxStatus) {
+        requests[route][static_cast<std::size_t>(status - kMinStatus)].inc();
+    }
+    request_duration[route].observe(elapsed);
+}
+
+void EngineMetrics::render(PrometheusWriter& out) const {
+    out.family("buildcheck_engine_requests_total", "counter", "HTTP requests by route and status.");
+    for (std::size_t r = 0; r < kRoutes; ++r) {
+        for (std::size_t s = 0; s < kStatuses; ++s) {
+            const std::uint64_t n = requests[r][s].value();
+            if (n == 0) continue;
+            out.sample("buildcheck_engine_requests_total",
+                       std::string("route=\"") + kRouteLabels[r] + "\",status=\"" +
+                           std::to_string(kMinStatus + static_cast<int>(s)) + "\"",
+                       n);
+        }
+    }
+
+    out.family("buildcheck_engine_request_duration_seconds", "histogram",
+               "Time from request line to response headers, by route.");
+    for (std::size_t r = 0; r < kRoutes; ++r) {
+        if (request_duration[r].count() == 0) continue;
+        out.histogram("buildcheck_engine_request_duration_seconds",
+                      std::string("route=\"") + kRouteLabels[r] + "\"", request_duration[r]);
+    }
+
+    const struct { const char* name; const char* help; const LatencyHistogram& h; } phases[] = {
+        {"buildcheck_engine_read_decode_duration_seconds", "Per image: reading the file or shm segment and decoding it.", read_decode_duration},
+        {"buildcheck_engine_preprocess_duration_seconds", "Per image: letterbox resize and CHW normalization.", preprocess_duration},
+        {"buildcheck_engine_inference_duration_seconds", "Per image: batch queue wait plus forward pass.", inference_duration},
+        {"buildcheck_engine_postprocess_duration_seconds", "Per image: YOLO decode and NMS.", postprocess_duration},
+        {"buildcheck_engine_batch_wait_duration_seconds", "Time an image waited in the batch queue.", batch_wait_duration},
+        {"buildcheck_engine_forward_duration_seconds", "One batched forward pass.", forward_duration},
+    };
+    for (const auto& p : phases) {
+        out.family(p.name, "histogram", p.help);
+        out.histogram(p.name, "", p.h);
+    }
+
+    out.family("buildcheck_engine_batches_total", "counter", "Forward passes run by the batch scheduler.");
+    out.sample("buildcheck_engine_batches_total", "", batches.value());
+    out.family("buildcheck_engine_batched_images_total", "counter", "Images run through forward passes.");
+    out.sample("buildcheck_engine_batched_images_total", "", batched_images.value());
+
+    out.family("buildcheck_engine_analyze_in_flight", "gauge", "Analyze requests currently being handled.");
+    out.sample("buildcheck_engine_analyze_in_flight", "", analyze_in_flight.value());
+    out.family("buildcheck_engine_bytes_read_total", "counter", "Image bytes read from files and shm segments.");
+    out.sample("buildcheck_engine_bytes_read_total", "", bytes_read.value());
+
+    out.family("buildcheck_engine_images_total", "counter", "Analyzed images by outcome.");
+    out.sample("buildcheck_engine_images_total", "result=\"damage\"", images_ok.value());
+    out.sample("buildcheck_engine_images_total", "result=\"no_damage\"", images_no_damage.value());
+    out.family("buildcheck_engine_image_errors_total", "counter", "Images that could not be analyzed, by kind.");
+    for (std::size_t k = 0; k < image_errors.size(); ++k) {
+        out.sample("buildcheck_engine_image_errors_total",
+                   std::string("kind=\"") + kImageErrorLabels[k] + "\"", image_errors[k].value());
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Minimal assertions for the unit tests under tests/: a failed CHECK prints where and
+// what, and the test keeps going so one run reports every broken expectation.
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+
+inline int& check_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++check_failures();                                                      \
+        }                                                                            \
+    } while (0)
+
+inline int check_result(const char* name) {
+    if (check_failures() == 0) {
+        std::printf("%s: ok\n", name);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", name, check_failures());
+    return 1;
+}
+
+// A fresh directory under the system temp dir, removed when the object goes away.
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string& prefix) {
+        path_ = std::filesystem::temp_directory_path() / (prefix + "_" + std::to_string(std::random_device{}()));
+        std::filesystem::create_directories(path_);
+    }
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    std::string file(const std::string& name) const { return (path_ / name).string(); }
+
+private:
+    std::filesystem::path path_;
+};
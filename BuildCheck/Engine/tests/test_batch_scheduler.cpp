@@ -0,0 +1,94 @@
+// BatchScheduler: images are grouped into one forward pass once max_batch are queued
+// or the oldest has waited max_wait, images past their deadline are answered without
+// running, and nothing is left pending at shutdown. The runner is the build without
+// ONNX Runtime, whose forward pass fails; every answer still says how big its batch was.
+#include "inference/batch_scheduler.h"
+#include "check.h"
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+namespace {
+
+using std::chrono::milliseconds;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSize = 8;
+
+std::vector<float> image() {
+    return std::vector<float>(3 * kSize * kSize, 0.5f);
+}
+
+YoloRunnerOptions runner_options() {
+    YoloRunnerOptions o;
+    o.input_size = kSize;
+    return o;
+}
+
+bool ready_within(std::future<BatchOutput>& f, milliseconds timeout) {
+    return f.wait_for(timeout) == std::future_status::ready;
+}
+
+void test_full_batch_runs_without_waiting() {
+    YoloRunner runner(runner_options());
+    BatchScheduler scheduler(runner, BatchSchedulerOptions{4, std::chrono::seconds(10), 16});
+    std::vector<std::future<BatchOutput>> futures;
+    for (int i = 0; i < 4; ++i) futures.push_back(scheduler.submit(image()));
+    for (auto& f : futures) {
+        CHECK(ready_within(f, std::chrono::seconds(5)));
+        const BatchOutput out = f.get();
+        CHECK(!out.ok);
+        CHECK(out.error == "engine_server was built without ONNX Runtime");
+        CHECK(out.batch_size == 4);
+    }
+}
+
+void test_partial_batch_flushes_after_max_wait() {
+    YoloRunner runner(runner_options());
+    BatchScheduler scheduler(runner, BatchSchedulerOptions{8, milliseconds(100), 16});
+    const auto t0 = Clock::now();
+    std::future<BatchOutput> a = scheduler.submit(image());
+    std::future<BatchOutput> b = scheduler.submit(image());
+    CHECK(ready_within(a, std::chrono::seconds(5)));
+    CHECK(Clock::now() - t0 >= milliseconds(90));
+    CHECK(a.get().batch_size == 2);
+    CHECK(b.get().batch_size == 2);
+}
+
+void test_expired_images_are_not_run() {
+    YoloRunner runner(runner_options());
+    BatchScheduler scheduler(runner, BatchSchedulerOptions{4, milliseconds(50), 16});
+    std::future<BatchOutput> late = scheduler.submit(image(), Clock::now());
+    std::future<BatchOutput> live = scheduler.submit(image(), Clock::now() + std::chrono::seconds(10));
+    CHECK(ready_within(late, std::chrono::seconds(5)));
+    const BatchOutput dropped = late.get();
+    CHECK(dropped.error == "deadline exceeded");
+    CHECK(dropped.batch_size == 0);
+    CHECK(live.get().batch_size == 1);   // the expired image does not count toward the batch
+}
+
+void test_bad_input_and_shutdown() {
+    YoloRunner runner(runner_options());
+    std::future<BatchOutput> pending;
+    {
+        BatchScheduler scheduler(runner, BatchSchedulerOptions{4, std::chrono::seconds(10), 16});
+        std::future<BatchOutput> bad = scheduler.submit(std::vector<float>(5));
+        CHECK(ready_within(bad, milliseconds(0)));
+        CHECK(bad.get().error == "bad input size");
+        pending = scheduler.submit(image());
+    }
+    // Destroying the scheduler runs what is still queued instead of abandoning it.
+    CHECK(ready_within(pending, milliseconds(0)));
+    CHECK(pending.get().batch_size == 1);
+}
+
+} // namespace
+
+int main() {
+    test_full_batch_runs_without_waiting();
+    test_partial_batch_flushes_after_max_wait();
+    test_expired_images_are_not_run();
+    test_bad_input_and_shutdown();
+    return check_result("test_batch_scheduler");
+}
@@ -0,0 +1,126 @@
+// letterbox_to_chw: letterbox geometry, padding, and the fused resize/normalize kernels
+// against a plain double-precision bilinear reference (cv2.INTER_LINEAR sampling).
+#include "preprocessing/image_preprocess.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float kPad = 114.0f / 255.0f;
+
+DecodedImage make_image(int width, int height, unsigned seed) {
+    DecodedImage img;
+    img.width = width;
+    img.height = height;
+    img.rgb.resize(static_cast<std::size_t>(width) * height * 3);
+    std::mt19937 rng(seed);
+    for (auto& v : img.rgb) v = static_cast<std::uint8_t>(rng() & 0xFFu);
+    return img;
+}
+
+// Half-pixel-centered bilinear sample of channel `c` at output pixel (x, y) of a
+// new_w x new_h resize, in [0, 1].
+double reference(const DecodedImage& img, int new_w, int new_h, int c, int x, int y) {
+    const double sx = static_cast<double>(img.width) / new_w;
+    const double sy = static_cast<double>(img.height) / new_h;
+    const double fx = std::max(0.0, (x + 0.5) * sx - 0.5);
+    const double fy = std::max(0.0, (y + 0.5) * sy - 0.5);
+    const int x0 = std::min(static_cast<int>(fx), img.width - 1);
+    const int y0 = std::min(static_cast<int>(fy), img.height - 1);
+    const int x1 = std::min(x0 + 1, img.width - 1);
+    const int y1 = std::min(y0 + 1, img.height - 1);
+    const double wx = fx - x0;
+    const double wy = fy - y0;
+    auto at = [&](int px, int py) {
+        return static_cast<double>(img.rgb[(static_cast<std::size_t>(py) * img.width + px) * 3 + c]);
+    };
+    const double top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * wx;
+    const double bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * wx;
+    return (top + (bottom - top) * wy) / 255.0;
+}
+
+// Largest difference from the reference over the resized area; padding must be exact.
+double max_error(const DecodedImage& img, int target) {
+    std::vector<float> out(static_cast<std::size_t>(3) * target * target, -1.0f);
+    const LetterboxInfo info = letterbox_to_chw(img, target, out.data());
+    const int new_w = std::min(target, std::max(1, static_cast<int>(std::lround(img.width * info.scale))));
+    const int new_h = std::min(target, std::max(1, static_cast<int>(std::lround(img.height * info.scale))));
+    double worst = 0.0;
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < target; ++y) {
+            for (int x = 0; x < target; ++x) {
+                const float v = out[(static_cast<std::size_t>(c) * target + y) * target + x];
+                const int rx = x - info.pad_x;
+                const int ry = y - info.pad_y;
+                if (rx < 0 || ry < 0 || rx >= new_w || ry >= new_h) {
+                    if (v != kPad) return 1.0;
+                    continue;
+                }
+                worst = std::max(worst, std::abs(v - reference(img, new_w, new_h, c, rx, ry)));
+            }
+        }
+    }
+    return worst;
+}
+
+void test_letterbox_geometry() {
+    DecodedImage img;
+    img.width = 40;
+    img.height = 20;
+    img.rgb.resize(40 * 20 * 3);
+    for (std::size_t i = 0; i < img.rgb.size(); i += 3) {
+        img.rgb[i] = 10;
+        img.rgb[i + 1] = 20;
+        img.rgb[i + 2] = 30;
+    }
+    std::vector<float> out(3 * 32 * 32, -1.0f);
+    const LetterboxInfo info = letterbox_to_chw(img, 32, out.data());
+    CHECK(info.scale == 0.8f);
+    CHECK(info.pad_x == 0);
+    CHECK(info.pad_y == 8);
+    CHECK(info.src_width == 40 && info.src_height == 20);
+
+    // Rows 8..23 hold the image, the eight rows above and below are padding.
+    for (int c = 0; c < 3; ++c) {
+        const float expect = (10.0f * (c + 1)) / 255.0f;
+        for (int y = 0; y < 32; ++y) {
+            const bool inside = y >= 8 && y < 24;
+            for (int x = 0; x < 32; ++x) {
+                const float v = out[(static_cast<std::size_t>(c) * 32 + y) * 32 + x];
+                CHECK(inside ? std::abs(v - expect) < 1e-6f : v == kPad);
+            }
+        }
+    }
+
+    // Portrait images are padded left and right, centered with the odd column on the right.
+    DecodedImage tall = make_image(9, 30, 1);
+    const LetterboxInfo t = letterbox_to_chw(tall, 32, out.data());
+    CHECK(t.pad_y == 0);
+    CHECK(t.pad_x == 11);   // new_w = 10: 11 columns left, 11 right
+}
+
+void test_kernels_match_reference() {
+    // Upscale, downscale, widths that leave SIMD tails, and degenerate one-pixel sides.
+    const int shapes[][3] = {{37, 23, 64}, {97, 61, 32}, {640, 480, 320}, {17, 1, 24}, {1, 33, 16}, {8, 8, 8}};
+    unsigned seed = 7;
+    for (const auto& s : shapes) {
+        const DecodedImage img = make_image(s[0], s[1], seed++);
+        const double err = max_error(img, s[2]);
+        if (err >= 1e-5) std::fprintf(stderr, "%dx%d -> %d: max error %g\n", s[0], s[1], s[2], err);
+        CHECK(err < 1e-5);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel: %s\n", preprocess_kernel_name());
+    test_letterbox_geometry();
+    test_kernels_match_reference();
+    return check_result("test_image_preprocess");
+}
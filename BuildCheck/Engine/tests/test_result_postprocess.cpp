@@ -0,0 +1,209 @@
+// postprocess_yolo: YOLO_CONF is a strict lower bound, NMS is class-aware and greedy by
+// score, boxes map back through the letterbox, and the vectorized argmax/IoU kernels
+// keep exactly what a plain greedy NMS keeps. Also the labels helpers.
+#include "postprocessing/result_postprocess.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Raw head output, [4 + classes, anchors].
+struct Head {
+    int classes;
+    int anchors;
+    std::vector<float> data;
+
+    Head(int c, int a) : classes(c), anchors(a), data(static_cast<std::size_t>(4 + c) * a, 0.0f) {}
+
+    void set(int a, float cx, float cy, float w, float h, int cls, float score) {
+        data[a] = cx;
+        data[static_cast<std::size_t>(anchors) + a] = cy;
+        data[2 * static_cast<std::size_t>(anchors) + a] = w;
+        data[3 * static_cast<std::size_t>(anchors) + a] = h;
+        data[static_cast<std::size_t>(4 + cls) * anchors + a] = score;
+    }
+    std::vector<Detection> run(const LetterboxInfo& lb, const PostprocessOptions& options) const {
+        return postprocess_yolo(data.data(), 4 + classes, anchors, lb, options);
+    }
+};
+
+LetterboxInfo identity(int size) {
+    LetterboxInfo lb;
+    lb.src_width = size;
+    lb.src_height = size;
+    return lb;
+}
+
+void test_threshold_and_class_aware_nms() {
+    Head head(3, 21);   // an odd anchor count leaves a tail after the SIMD lanes
+    head.set(0, 100, 100, 50, 50, 0, 0.90f);
+    head.set(1, 102, 101, 50, 50, 0, 0.80f);   // overlaps anchor 0, same class: suppressed
+    head.set(2, 102, 101, 50, 50, 1, 0.85f);   // same box, other class: kept
+    head.set(3, 400, 400, 40, 40, 0, 0.60f);
+    head.set(4, 300, 100, 20, 20, 2, 0.25f);   // exactly YOLO_CONF: dropped
+    head.set(20, 500, 100, 20, 20, 2, 0.26f);  // the tail anchor
+    const std::vector<Detection> d = head.run(identity(640), PostprocessOptions{});
+
+    CHECK(d.size() == 4);
+    if (d.size() == 4) {
+        CHECK(d[0].class_id == 0 && d[0].score == 0.90f);
+        CHECK(d[1].class_id == 1 && d[1].score == 0.85f);
+        CHECK(d[2].class_id == 0 && d[2].score == 0.60f);
+        CHECK(d[3].class_id == 2 && d[3].score == 0.26f);
+        CHECK(d[0].x1 == 75.0f && d[0].y1 == 75.0f && d[0].x2 == 125.0f && d[0].y2 == 125.0f);
+    }
+
+    // A looser IoU threshold keeps the overlapping box; a cap keeps the best ones.
+    PostprocessOptions loose;
+    loose.iou_threshold = 0.95f;
+    CHECK(head.run(identity(640), loose).size() == 5);
+    PostprocessOptions capped;
+    capped.max_detections = 2;
+    const std::vector<Detection> top = head.run(identity(640), capped);
+    CHECK(top.size() == 2 && top[1].score == 0.85f);
+
+    // Nothing above the threshold, or a head without classes, yields nothing.
+    PostprocessOptions strict;
+    strict.conf_threshold = 0.95f;
+    CHECK(head.run(identity(640), strict).empty());
+    CHECK(postprocess_yolo(head.data.data(), 4, 21, identity(640), PostprocessOptions{}).empty());
+}
+
+void test_boxes_map_back_through_letterbox() {
+    // A 400x300 source letterboxed into 320: scale 0.8, 10px padding above and below.
+    LetterboxInfo lb;
+    lb.scale = 0.8f;
+    lb.pad_x = 0;
+    lb.pad_y = 10;
+    lb.src_width = 400;
+    lb.src_height = 300;
+    Head head(1, 8);
+    head.set(0, 160, 130, 80, 40, 0, 0.9f);   // (120, 110)-(200, 150) in model pixels
+    head.set(1, 5, 300, 30, 40, 0, 0.8f);     // spills past the source on the left and bottom
+    const std::vector<Detection> d = head.run(lb, PostprocessOptions{});
+    CHECK(d.size() == 2);
+    if (d.size() == 2) {
+        CHECK(std::abs(d[0].x1 - 150.0f) < 1e-4f && std::abs(d[0].y1 - 125.0f) < 1e-4f);
+        CHECK(std::abs(d[0].x2 - 250.0f) < 1e-4f && std::abs(d[0].y2 - 175.0f) < 1e-4f);
+        CHECK(d[1].x1 == 0.0f);
+        CHECK(d[1].y2 == 300.0f);
+    }
+}
+
+// Greedy per-class NMS over the same float IoU test (inter > thr * union).
+std::vector<int> reference_nms(const Head& head, float conf, float iou, std::size_t max_detections) {
+    const int n = head.anchors;
+    auto at = [&](int row, int a) { return head.data[static_cast<std::size_t>(row) * n + a]; };
+    std::vector<float> best(n);
+    std::vector<int> cls(n);
+    std::vector<int> order;
+    for (int a = 0; a < n; ++a) {
+        best[a] = at(4, a);
+        cls[a] = 0;
+        for (int c = 1; c < head.classes; ++c) {
+            if (at(4 + c, a) > best[a]) {
+                best[a] = at(4 + c, a);
+                cls[a] = c;
+            }
+        }
+        if (best[a] > conf) order.push_back(a);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int l, int r) { return best[l] > best[r]; });
+    std::vector<int> kept;
+    std::vector<bool> removed(order.size(), false);
+    for (std::size_t i = 0; i < order.size() && kept.size() < max_detections; ++i) {
+        if (removed[i]) continue;
+        const int a = order[i];
+        kept.push_back(a);
+        for (std::size_t j = i + 1; j < order.size(); ++j) {
+            const int b = order[j];
+            if (cls[b] != cls[a]) continue;
+            const float iw = std::max(0.0f, std::min(at(0, a) + at(2, a) / 2, at(0, b) + at(2, b) / 2) -
+                                                std::max(at(0, a) - at(2, a) / 2, at(0, b) - at(2, b) / 2));
+            const float ih = std::max(0.0f, std::min(at(1, a) + at(3, a) / 2, at(1, b) + at(3, b) / 2) -
+                                                std::max(at(1, a) - at(3, a) / 2, at(1, b) - at(3, b) / 2));
+            const float inter = iw * ih;
+            const float uni = at(2, a) * at(3, a) + at(2, b) * at(3, b) - inter;
+            if (uni > 0.0f && inter > iou * uni) removed[j] = true;
+        }
+    }
+    return kept;
+}
+
+void test_kernels_match_greedy_nms() {
+    // Integer centers and even sizes keep every coordinate exact, with or without the
+    // per-class offset, so the comparison is exact too.
+    std::mt19937 rng(42);
+    for (int round = 0; round < 20; ++round) {
+        const int anchors = 257 + round * 61;
+        Head head(5, anchors);
+        std::vector<int> ranks(static_cast<std::size_t>(anchors));
+        std::iota(ranks.begin(), ranks.end(), 1);
+        std::shuffle(ranks.begin(), ranks.end(), rng);
+        for (int a = 0; a < anchors; ++a) {
+            const float cx = static_cast<float>(rng() % 640);
+            const float cy = static_cast<float>(rng() % 640);
+            const float w = static_cast<float>(2 * (1 + rng() % 60));
+            const float h = static_cast<float>(2 * (1 + rng() % 60));
+            head.set(a, cx, cy, w, h, static_cast<int>(rng() % 5), static_cast<float>(ranks[a]) / (anchors + 1));
+        }
+        const std::vector<Detection> got = head.run(identity(640), PostprocessOptions{});
+        const std::vector<int> want = reference_nms(head, 0.25f, 0.7f, 300);
+        CHECK(got.size() == want.size());
+        for (std::size_t i = 0; i < std::min(got.size(), want.size()); ++i) {
+            const int a = want[i];
+            const float cx = head.data[a];
+            const float w = head.data[2 * static_cast<std::size_t>(anchors) + a];
+            if (got[i].score != static_cast<float>(ranks[a]) / (anchors + 1) ||
+                got[i].x1 != std::clamp(cx - w / 2, 0.0f, 640.0f)) {
+                std::fprintf(stderr, "round %d: detection %zu differs\n", round, i);
+                CHECK(false);
+                break;
+            }
+        }
+    }
+}
+
+void test_labels(const ScratchDir& dir) {
+    const std::string list = dir.file("list.json");
+    const std::string map = dir.file("map.json");
+    const std::string bad = dir.file("bad.json");
+    std::ofstream(list) << R"(["crack", "spalling"])";
+    std::ofstream(map) << R"({"0": "crack", "2": "mold", "x": "ignored"})";
+    std::ofstream(bad) << "{";
+
+    std::vector<std::string> names;
+    std::string error;
+    CHECK(load_labels_file(list, names, error) && names.size() == 2 && names[1] == "spalling");
+    CHECK(load_labels_file(map, names, error) && names.size() == 3 && names[2] == "mold" && names[1].empty());
+    CHECK(!load_labels_file(bad, names, error) && !error.empty());
+    CHECK(!load_labels_file(dir.file("missing.json"), names, error));
+
+    // Unnamed ids fall back to the number; repeats are reported once, in order.
+    std::vector<Detection> d(4);
+    d[0].class_id = 2;
+    d[1].class_id = 1;
+    d[2].class_id = 2;
+    d[3].class_id = 0;
+    const std::vector<std::string> types = damage_types_from_detections(d, names);
+    CHECK((types == std::vector<std::string>{"mold", "1", "crack"}));
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel: %s\n", postprocess_kernel_name());
+    ScratchDir dir("buildcheck_postprocess");
+    test_threshold_and_class_aware_nms();
+    test_boxes_map_back_through_letterbox();
+    test_kernels_match_greedy_nms();
+    test_labels(dir);
+    return check_result("test_result_postprocess");
+}
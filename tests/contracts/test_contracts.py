@@ -104,6 +104,9 @@ def test_api_engine_contract_files_are_consistent():
     assert analyze["path"] == "/engine/analyze"
     assert analyze["request"]["shape"]["request_id"] == "string"
     assert analyze["request"]["shape"]["paths"] == ["string"]
+    analyze_frame = engine_contract["endpoints"]["analyze_frame"]
+    assert analyze_frame["path"] == "/engine/analyze/frame"
+    assert analyze_frame["request"]["contentType"] == analyze_frame["response"]["contentType"]
 
     assert "request_id" in req_example and isinstance(req_example["request_id"], str)
     assert "paths" in req_example and isinstance(req_example["paths"], list)
@@ -1,9 +1,12 @@
 import importlib.util
 import io
 import json
+import sys
 from pathlib import Path
 from urllib import error
 
+import pytest
+
 
 ROOT = Path(__file__).resolve().parents[2]
 
@@ -17,6 +20,7 @@ def _load_module(rel_path: str, module_name: str):
     spec = importlib.util.spec_from_file_location(module_name, module_path)
     assert spec is not None and spec.loader is not None
     module = importlib.util.module_from_spec(spec)
+    sys.modules[module_name] = module
     spec.loader.exec_module(module)
     return module
 
@@ -49,6 +53,49 @@ def test_api_analyze_route_hardening_for_temp_files_and_file_count_cap():
     assert "file_size(tmp_path" in source
 
 
+def test_api_shm_transport_keeps_file_fallback():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    engine_service = _read_text("BuildCheck/Engine/engine_service.py")
+    assert "BUILDCHECK_ENGINE_TRANSPORT" in route
+    assert "falling back to temp files" in route
+    assert "engine.analyze(request_id, temp_paths, shm_images" in route
+    assert "def _is_allowed_shm_name(" in engine_service
+
+
+def test_api_streams_uploads_through_content_reader():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "const httplib::ContentReader& content_reader" in route
+    assert "req.form" not in route
+    assert "too_many_files = true;" in route
+    assert "Xxh64Stream" in _read_text("BuildCheck/API/include/utils/content_hash.h")
+
+
+def test_api_async_analyze_jobs_are_bounded_and_pollable():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    queue = _read_text("BuildCheck/API/src/services/job_queue.cpp")
+    main = _read_text("BuildCheck/API/src/main.cpp")
+    assert "send_json(res, 202, request_id" in route
+    assert '"/api/property/jobs/' in route
+    assert '"QUEUE_FULL"' in route
+    assert "pending_.size() >= options_.max_queue" in queue
+    assert 'env_int("BUILDCHECK_JOB_QUEUE"' in main
+
+
+def test_metrics_endpoints_exist_on_api_and_engines():
+    api_routes = _read_text("BuildCheck/API/src/routes/register_routes.cpp")
+    api_main = _read_text("BuildCheck/API/src/main.cpp")
+    metrics = _read_text("BuildCheck/API/include/utils/metrics.h")
+    engine_main = _read_text("BuildCheck/Engine/src/main.cpp")
+    engine_service = _read_text("BuildCheck/Engine/engine_service.py")
+    assert 'server.Get("/metrics"' in api_routes
+    assert "register_metrics_route(metrics_server" in api_main
+    assert "set_post_routing_handler" in api_main
+    assert "std::memory_order_relaxed" in metrics
+    assert "std::mutex" not in metrics
+    assert 'server.Get("/metrics"' in engine_main
+    assert '@app.get("/metrics")' in engine_service
+
+
 def test_engine_env_parsing_is_hardened():
     source = _read_text("BuildCheck/Engine/engine_service.py")
     assert "def _env_int(" in source
@@ -64,6 +111,38 @@ def test_cpp_engine_stub_is_disabled_by_default():
     assert "stub runtime is disabled by default" in source
 
 
+def test_cpp_engine_native_route_matches_engine_contract():
+    route = _read_text("BuildCheck/Engine/src/routes/analyze_route.cpp")
+    cmake = _read_text("BuildCheck/Engine/CMakeLists.txt")
+    assert 'server.Post("/engine/analyze"' in route
+    assert '"X-Engine-Key"' in route
+    assert '"damage_types"' in route
+    assert "path not allowed" in route
+    assert "BUILDCHECK_HAVE_ONNXRUNTIME" in cmake
+
+
+def test_cpp_engine_postprocess_follows_yolo_conf_and_labels():
+    main = _read_text("BuildCheck/Engine/src/main.cpp")
+    assert 'env_float("YOLO_CONF"' in main
+    assert '"labels.json"' in main
+
+
+def test_engine_batches_concurrent_predictions():
+    service = _read_text("BuildCheck/Engine/engine_service.py")
+    route = _read_text("BuildCheck/Engine/src/routes/analyze_route.cpp")
+    assert 'MAX_BATCH = _env_int("ENGINE_MAX_BATCH"' in service
+    assert "BATCHER.submit(" in service
+    assert "scheduler.submit(" in route
+
+
+def test_api_result_cache_only_replays_stable_verdicts():
+    source = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    engine = _read_text("BuildCheck/Engine/engine_service.py")
+    assert "engine.model_fingerprint()" in source
+    assert 'v.ok || v.error == "no damage detected"' in source
+    assert 'payload["model_version"] = MODEL_VERSION' in engine
+
+
 def test_engine_status_is_propagated_back_to_client():
     source = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
     client_source = _read_text("BuildCheck/API/src/services/engine_client.cpp")
@@ -96,6 +175,144 @@ def test_contact_admin_endpoint_is_auth_protected_and_persistent():
     assert "BUILDCHECK_CONTACT_DB_PATH" in source
 
 
+def test_api_responses_use_streaming_json_writer():
+    header = _read_text("BuildCheck/API/include/utils/json.h")
+    writer = _read_text("BuildCheck/API/src/utils/json.cpp")
+    dto = _read_text("BuildCheck/API/include/dto/analyze_response.h")
+    routes = _read_text("BuildCheck/API/src/routes/register_routes.cpp")
+    analyze = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "class JsonWriter" in header
+    assert "thread_local" in writer
+    assert "_mm_movemask_epi8" in writer
+    assert "ostringstream" not in dto
+    assert "JsonWriter w;" in dto
+    assert ".dump()" not in routes
+    assert "json_escape(" not in analyze
+    assert (ROOT / "BuildCheck/API/bench/bench_json.cpp").exists()
+
+
+def test_engine_responses_are_parsed_with_sax():
+    analyze = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "parse_engine_response(analyze_json(" in _read_text("BuildCheck/API/src/services/engine_client.cpp")
+    assert "nlohmann::json::parse" not in analyze
+
+
+@pytest.mark.parametrize("rel_path", [
+    "include/utils/metrics.h",
+    "src/utils/metrics.cpp",
+    "include/utils/engine_frame.h",
+    "src/utils/engine_frame.cpp",
+    "include/utils/httplib.h",
+    "tests/check.h",
+])
+def test_sources_shared_by_api_and_engine_stay_identical(rel_path):
+    assert (ROOT / "BuildCheck/API" / rel_path).read_bytes() == (ROOT / "BuildCheck/Engine" / rel_path).read_bytes()
+
+
+def test_engine_frame_protocol_roundtrips_and_is_negotiated():
+    frame = _load_module("BuildCheck/Engine/engine_frame.py", "engine_frame_module")
+    req = frame.FrameRequest("req_1", ["/tmp/a.jpg"], [("/buildcheck_req_1_0", 42)], [memoryview(b"\xff\xd8\xff")])
+    decoded = frame.decode_request(frame.encode_request(req))
+    assert (decoded.request_id, decoded.paths, decoded.shm) == ("req_1", ["/tmp/a.jpg"], [("/buildcheck_req_1_0", 42)])
+    assert [bytes(i) for i in decoded.images] == [b"\xff\xd8\xff"]
+
+    results = [{"ok": True, "path": "/tmp/a.jpg", "damage_types": ["crack"], "inference_mode": "model",
+                "detections": [{"label": "crack", "class_id": 0, "score": 0.5, "box": [1.0, 2.0, 3.0, 4.0]}]},
+               {"ok": False, "image": 0, "damage_types": [], "inference_mode": "model", "error": "inference failed"}]
+    body = frame.encode_response(True, results)
+    assert body[:4] == b"BCF1"
+    assert frame.decode_response(body) == {"ok": True, "results": results}
+    for cut in range(len(body)):
+        try:
+            frame.decode_response(body[:cut])
+        except frame.FrameError:
+            continue
+        raise AssertionError(f"truncated frame of {cut} bytes decoded")
+
+    assert '"protocols": ["json", engine_frame.PROTOCOL]' in _read_text("BuildCheck/Engine/engine_service.py")
+    assert "kEngineFramePath" in _read_text("BuildCheck/Engine/src/routes/analyze_route.cpp")
+    client = _read_text("BuildCheck/API/src/services/engine_client.cpp")
+    assert "BUILDCHECK_ENGINE_PROTOCOL" in _read_text("BuildCheck/API/src/main.cpp")
+    assert "kEngineFrameProtocol" in client
+    assert "e.status_code() != 404 && e.status_code() != 415" in client
+
+def test_uploads_are_spooled_on_shared_pool_in_input_order():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "std::unique_ptr<SpoolStrand> strand;" in route
+    assert "spooler.wait();" in route
+    # verdicts are built by walking the uploads in arrival order after the strands drain
+    assert route.index("spooler.wait();") < route.index("for (std::size_t i = 0; i < spooler.uploads.size(); ++i)")
+    assert "u.index = spooler.uploads.size() - 1;" in route
+    main = _read_text("BuildCheck/API/src/main.cpp")
+    assert "BUILDCHECK_SPOOL_WORKERS" in main
+    assert "BUILDCHECK_SPOOL_QUEUE" in main
+    assert "src/services/spool_pool.cpp" in _read_text("BuildCheck/API/CMakeLists.txt")
+
+def test_uploads_are_checked_against_header_dimension_limits():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "u.header.feed(data, n);" in route
+    assert "check_image_limits(u.header.info(), image_limits, r.error)" in route
+    assert "BUILDCHECK_MAX_IMAGE_PIXELS" in route
+    assert "BUILDCHECK_MAX_IMAGE_SIDE" in route
+
+def test_oversized_uploads_can_be_downscaled_before_engine():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    assert "BUILDCHECK_DOWNSCALE_MAX_EDGE" in route
+    assert "spooler.downscale(accepted, job.downscale)" in route
+    # the cache lookup runs first, so hits never pay for the resize
+    assert route.index("cache.lookup(key, cached)") < route.index("spooler.downscale(accepted, job.downscale)")
+    downscale = _read_text("BuildCheck/API/src/utils/image_downscale.cpp")
+    assert "cinfo.scale_denom = denom;" in downscale
+    assert "jpeg_write_marker(&cinfo, JPEG_APP0 + 1" in downscale
+    cmake = _read_text("BuildCheck/API/CMakeLists.txt")
+    assert "find_package(JPEG QUIET)" in cmake
+    assert "BUILDCHECK_HAVE_PNG=1" in cmake
+
+def test_request_deadline_propagates_to_engine():
+    route = _read_text("BuildCheck/API/src/routes/analyze_route.cpp")
+    for env in ("BUILDCHECK_REQUEST_TIMEOUT_MS", "BUILDCHECK_REQUEST_TIMEOUT_MAX_MS", "BUILDCHECK_DEADLINE_RESERVE_MS"):
+        assert env in route
+    assert "req.get_header_value(kRequestTimeoutHeader)" in route
+    assert '"DEADLINE_EXCEEDED", "Request deadline exceeded"' in route
+    client = _read_text("BuildCheck/API/src/services/engine_client.cpp")
+    assert "headers.emplace(kRequestTimeoutHeader" in client
+    assert 'throw EngineClientError("ENGINE_DEADLINE_EXCEEDED", 504);' in client
+    engine = _read_text("BuildCheck/Engine/engine_service.py")
+    assert 'DEADLINE_ERROR = "deadline exceeded"' in engine
+    assert "deadline = _request_deadline(request)" in engine
+    assert "read_deadline(req, request);" in _read_text("BuildCheck/Engine/src/routes/analyze_route.cpp")
+    assert '"X-Request-Timeout-Ms"' in _read_text("BuildCheck/Client/JS/app.js")
+
+def test_redis_rate_limit_leases_tokens_from_one_bucket():
+    fakeredis = pytest.importorskip("fakeredis")
+    pytest.importorskip("lupa")
+    rate_limit = _load_module("BuildCheck/Engine/rate_limit.py", "rate_limit_module")
+    server = fakeredis.FakeServer()
+    calls = []
+    nodes = [rate_limit.LeasedRateLimiter(fakeredis.FakeRedis(server=server), "rl", 60, lease=16,
+                                          on_store_call=calls.append) for _ in range(3)]
+    try:
+        admitted = sum(nodes[i % 3].allow("client") for i in range(200))
+        assert admitted == 60
+        # denials after the bucket ran dry are answered without the store
+        assert len(calls) < 30
+        assert not nodes[0].allow("client")
+    finally:
+        for node in nodes:
+            node.close()
+    engine = _read_text("BuildCheck/Engine/engine_service.py")
+    assert "rate_limit.LeasedRateLimiter(" in engine
+    assert "client.incr(" not in engine
+
+def test_bench_analyze_is_an_open_loop_load_generator():
+    cmake = _read_text("BuildCheck/API/CMakeLists.txt")
+    assert "add_executable(bench_analyze" in cmake
+    bench = _read_text("BuildCheck/API/bench/bench_analyze.cpp")
+    assert "class HdrHistogram" in bench
+    assert "done - due" in bench   # latency from the scheduled start, not the send
+    for key in ('\\"p50\\"', '\\"p999\\"', '\\"throughput_rps\\"', '\\"error_rate\\"'):
+        assert key in bench
+
 def test_smoke_post_analyze_accepts_http_error_payload(monkeypatch):
     smoke = _load_module("scripts/smoke_e2e_live.py", "smoke_e2e_live_module")
     img = ROOT / "BuildCheck" / "Engine" / "test.jpg"
@@ -1,15 +1,53 @@
 #!/usr/bin/env python3
 """
-Placeholder for model export to ONNX.
+Export the trained YOLO checkpoint to ONNX for the native C++ engine.
 
-Expected future responsibilities:
-- load trained checkpoint
-- export ONNX with fixed input shape
-- validate exported model graph
+Writes <weights>.onnx next to the checkpoint, plus labels.json (class names by id)
+and config.json (input size / batching) that engine_server reads at startup.
 """
 
+from __future__ import annotations
+
+import argparse
+import json
+from pathlib import Path
+
+
+ROOT = Path(__file__).resolve().parents[2]
+DEFAULT_WEIGHTS = ROOT / "BuildCheck" / "Engine" / "models" / "mbdd2025" / "best_mbdd_yolo.pt"
+
+
 def main() -> None:
-    print("export_onnx.py is a placeholder. No export implemented yet.")
+    parser = argparse.ArgumentParser(description="Export YOLO checkpoint to ONNX")
+    parser.add_argument("--weights", type=Path, default=DEFAULT_WEIGHTS)
+    parser.add_argument("--imgsz", type=int, default=640)
+    parser.add_argument("--opset", type=int, default=17)
+    parser.add_argument("--static-batch", action="store_true",
+                        help="export batch=1 only (disables engine micro-batching)")
+    args = parser.parse_args()
+
+    from ultralytics import YOLO
+
+    weights = args.weights.expanduser().resolve()
+    if not weights.exists():
+        raise SystemExit(f"checkpoint not found: {weights}")
+
+    model = YOLO(str(weights))
+    dynamic = not args.static_batch
+    exported = Path(model.export(format="onnx", imgsz=args.imgsz, opset=args.opset,
+                                 dynamic=dynamic, simplify=True))
+
+    names = model.names
+    labels = [str(names[i]) for i in sorted(names)] if isinstance(names, dict) else [str(n) for n in names]
+    out_dir = exported.parent
+    (out_dir / "labels.json").write_text(json.dumps(labels, indent=2) + "\n", encoding="utf-8")
+    (out_dir / "config.json").write_text(json.dumps({
+        "model": exported.name,
+        "input_size": args.imgsz,
+        "dynamic_batch": dynamic,
+    }, indent=2) + "\n", encoding="utf-8")
+
+    print(f"exported {exported} ({len(labels)} classes)")
 
 
 if __name__ == "__main__":